@@ -0,0 +1,259 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Utils/IReferenceCounted.h"
+#include "Utils/irrTypes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace os {
+
+class JobSystem;
+
+//! Counts the unfinished jobs which were started with it.
+/** Used for waiting on a group of jobs (fork/join) and for starting jobs only
+after others are done (dependencies). A counter must not be destroyed while
+jobs started with it are still running, wait for it first. */
+class JobCounter
+{
+public:
+	JobCounter() = default;
+
+	JobCounter(const JobCounter &) = delete;
+	JobCounter &operator=(const JobCounter &) = delete;
+
+	//! Returns true if all jobs started with this counter have finished.
+	bool isDone() const
+	{
+		std::lock_guard<std::mutex> lock(Lock);
+		return Pending == 0;
+	}
+
+private:
+	struct SJob
+	{
+		std::function<void()> Func;
+		JobCounter *Counter;
+	};
+
+	mutable std::mutex Lock;
+	u32 Pending = 0;
+
+	//! Jobs waiting for this counter to reach zero
+	std::vector<SJob> Continuations;
+
+	friend class JobSystem;
+};
+
+//! Linear allocator for short lived temporary memory of a job.
+/** Every worker of the job system owns one. Allocating only bumps a pointer,
+memory is given back all at once with rewind(). Once warmed up, no heap
+allocations happen anymore. */
+class ScratchArena
+{
+public:
+	//! constructor
+	/** \param blockSize Size of the memory blocks requested from the heap. */
+	ScratchArena(size_t blockSize = 64 * 1024);
+
+	ScratchArena(const ScratchArena &) = delete;
+	ScratchArena &operator=(const ScratchArena &) = delete;
+
+	//! Position in the arena, used to free everything allocated after it.
+	struct Marker
+	{
+		size_t Block;
+		size_t Offset;
+	};
+
+	//! Allocates uninitialized memory.
+	void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+	//! Allocates uninitialized memory for count elements of type T.
+	template <class T>
+	T *allocate(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value,
+				"Destructors of objects in a ScratchArena are never called.");
+		return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	//! Returns the current position.
+	Marker getMarker() const { return {Current, Offset}; }
+
+	//! Frees everything allocated after the marker.
+	void rewind(const Marker &marker)
+	{
+		Current = marker.Block;
+		Offset = marker.Offset;
+	}
+
+	//! Frees everything, but keeps the blocks for later use.
+	void reset() { rewind({0, 0}); }
+
+	//! Frees everything allocated during its lifetime.
+	class Scope
+	{
+	public:
+		Scope(ScratchArena &arena) :
+				Arena(arena), Mark(arena.getMarker()) {}
+		~Scope() { Arena.rewind(Mark); }
+
+	private:
+		ScratchArena &Arena;
+		Marker Mark;
+	};
+
+private:
+	struct SBlock
+	{
+		std::unique_ptr<u8[]> Data;
+		size_t Size;
+	};
+
+	size_t BlockSize;
+	std::vector<SBlock> Blocks;
+	size_t Current;
+	size_t Offset;
+};
+
+//! Work stealing job scheduler.
+/** Owned by the device and reachable from everywhere through g_irrjobs. Each
+worker thread keeps its own job queue, taking its newest jobs first while idle
+workers steal the oldest ones from the others. The thread which created the
+job system is worker 0 and executes jobs while waiting for them.
+Jobs may start further jobs and wait for them. */
+class JobSystem : public virtual IReferenceCounted
+{
+public:
+	typedef std::function<void()> JobFunc;
+
+	//! Function run by parallelFor() for the range [begin, end)
+	typedef std::function<void(u32 begin, u32 end)> RangeFunc;
+
+	//! Returned by getCurrentWorker() for threads not belonging to the job system.
+	static constexpr u32 NOT_A_WORKER = 0xFFFFFFFF;
+
+	//! constructor
+	/** \param threadCount Amount of worker threads started in addition to the
+	calling thread. If 0, one per remaining hardware thread is started. */
+	JobSystem(u32 threadCount = 0);
+
+	//! destructor, waits for the started jobs to finish
+	~JobSystem();
+
+	//! Starts a job.
+	/** \param job Function to execute.
+	\param counter Optional counter incremented now and decremented when the job is done. */
+	void run(JobFunc &&job, JobCounter *counter = nullptr);
+
+	//! Starts a job once all jobs of dependency have finished.
+	/** \param dependency Counter to wait for, must stay alive until it is done.
+	\param job Function to execute.
+	\param counter Optional counter incremented now and decremented when the job is done. */
+	void runAfter(JobCounter &dependency, JobFunc &&job, JobCounter *counter = nullptr);
+
+	//! Waits until all jobs of the counter are done.
+	/** Workers execute other jobs meanwhile, so waiting from inside of a job
+	doesn't block a thread. */
+	void wait(JobCounter &counter);
+
+	//! Calls func for sub ranges of [begin, end) in parallel and waits for them.
+	/** \param grainSize Maximal amount of elements per call, 0 to choose
+	automatically from the amount of workers. */
+	void parallelFor(u32 begin, u32 end, u32 grainSize, const RangeFunc &func);
+
+	//! Returns the amount of workers including the thread which created the job system.
+	u32 getWorkerCount() const { return (u32)Workers.size(); }
+
+	//! Returns the index of the worker running on the calling thread, or NOT_A_WORKER.
+	u32 getCurrentWorker() const;
+
+	//! Returns the scratch arena of the calling thread.
+	/** Threads not belonging to the job system get a thread local one. */
+	ScratchArena &getScratchArena();
+
+	//! Scheduling counters
+	struct SStats
+	{
+		u32 JobsExecuted = 0;
+		u32 JobsStolen = 0;
+		u32 Sleeps = 0;
+	};
+
+	//! Returns the counters accumulated since start.
+	SStats getStats() const;
+
+	//! Results of benchmark()
+	struct SBenchmarkResult
+	{
+		//! Average time from starting an empty job until its counter is done
+		f64 NanosecondsPerEmptyJob = 0.0;
+
+		//! Time of a compute bound loop run on the calling thread only
+		f64 SerialMilliseconds = 0.0;
+
+		//! Time of the same loop with parallelFor()
+		f64 ParallelMilliseconds = 0.0;
+
+		//! SerialMilliseconds / ParallelMilliseconds
+		f64 Speedup = 0.0;
+	};
+
+	//! Measures scheduling overhead and scaling over the available cores.
+	/** Must be called by worker 0 while no other jobs are running.
+	\param jobCount Amount of empty jobs used for the overhead measurement. */
+	SBenchmarkResult benchmark(u32 jobCount = 100000);
+
+private:
+	typedef JobCounter::SJob SJob;
+
+	struct SWorker
+	{
+		std::mutex Lock;
+		std::vector<SJob> Queue;
+		size_t Head = 0;
+
+		ScratchArena Scratch;
+
+		std::atomic<u32> JobsExecuted{0};
+		std::atomic<u32> JobsStolen{0};
+	};
+
+	void schedule(SJob &&job);
+	bool popOwn(u32 worker, SJob &job);
+	bool steal(u32 thief, SJob &job);
+	bool tryRunOne(u32 worker);
+	void execute(u32 worker, SJob &job, bool stolen);
+	void finish(JobCounter *counter);
+	void threadMain(u32 worker);
+
+	std::vector<std::unique_ptr<SWorker>> Workers;
+	std::vector<std::thread> Threads;
+
+	//! Jobs started from threads not belonging to the job system
+	std::mutex ExternalLock;
+	std::vector<SJob> ExternalQueue;
+	size_t ExternalHead = 0;
+
+	std::mutex SleepLock;
+	std::condition_variable WakeUp;
+	std::atomic<u32> QueuedJobs;
+	std::atomic<u32> Sleeps;
+	bool Quit;
+};
+
+} // end namespace os
+
+extern os::JobSystem *g_irrjobs;
@@ -7,6 +7,8 @@
 #include "Utils/IReferenceCounted.h"
 #include "Utils/irrString.h"
 
+#include <mutex>
+
 //! Possible log levels.
 //! When used has filter ELL_DEBUG means => log everything and ELL_NONE means => log (nearly) nothing.
 //! When used to print logging information ELL_DEBUG will have lowest priority while ELL_NONE
@@ -47,6 +49,8 @@ public:
 	void setLogLevel(ELOG_LEVEL ll);
 
 	//! Prints out a text into the log
+	/** May be called from the workers of the job system, e.g. by mesh
+	loaders, the event receiver is called on the logging thread. */
 	void log(const c8 *text, ELOG_LEVEL ll = ELL_INFORMATION);
 
 	void log(const core::stringc &text, ELOG_LEVEL ll = ELL_INFORMATION)
@@ -68,6 +72,9 @@ public:
 private:
 	ELOG_LEVEL LogLevel;
 	IEventReceiver *Receiver;
+
+	//! Keeps messages of several threads apart
+	std::mutex Lock;
 };
 
 } // end namespace os
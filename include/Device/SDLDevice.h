@@ -38,6 +38,7 @@
 namespace os
 {
 class Logger;
+class JobSystem;
 }
 
 namespace video
@@ -265,6 +266,9 @@ public:
 	//! Returns a pointer to the logger.
 	os::Logger *getLogger();
 
+	//! Returns the job system shared by all parts of the engine.
+	os::JobSystem *getJobSystem();
+
 	//! Returns the operation system opertator object.
 	os::Clipboard *getOSOperator();
 
@@ -321,6 +325,8 @@ private:
 	IEventReceiver *UserReceiver;
 	// logger
 	os::Logger *Logger;
+	// job system
+	os::JobSystem *Jobs;
 	// clipboard
 	os::Clipboard *ClipBoard;
 	// file system
@@ -170,6 +170,10 @@ struct SDLDeviceParameters
 	ELOG_LEVEL LoggingLevel{ELL_INFORMATION};
 #endif
 
+	//! Amount of worker threads of the job system, besides the main thread.
+	/** The default value 0 starts one thread per remaining hardware thread. */
+	u32 JobThreadCount{0};
+
 	//! Define some private data storage.
 	/** Used when platform devices need access to OS specific data structures etc.
 	This is only used for Android at the moment in order to access the native
@@ -37,6 +37,9 @@ enum ESCENE_NODE_TYPE
 	//! Animated Mesh Scene Node
 	ESNT_ANIMATED_MESH = MAKE_IRR_ID('a', 'm', 's', 'h'),
 
+	//! Static Batch Scene Node, see ISceneManager::batchStaticGeometry()
+	ESNT_STATIC_BATCH = MAKE_IRR_ID('b', 't', 'c', 'h'),
+
 	//! Unknown scene node
 	ESNT_UNKNOWN = MAKE_IRR_ID('u', 'n', 'k', 'n'),
 
@@ -95,6 +95,29 @@ public:
 		return Dirty;
 	}
 
+	bool setQuantized(bool quantized) override
+	{
+		if (quantized && !getQuantizedVertexTypeDescription(getType()))
+			return false;
+
+		if (Quantized != quantized) {
+			Quantized = quantized;
+			Dirty = true;
+		}
+		return true;
+	}
+
+	bool isQuantized() const override
+	{
+		return Quantized;
+	}
+
+	void getQuantization(core::vector3df &scale, core::vector3df &offset) const override
+	{
+		scale = QuantizationScale;
+		offset = QuantizationOffset;
+	}
+
 	const video::HWBuffer &getVBO() const override
 	{
 		return VBO;
@@ -107,6 +130,13 @@ public:
 
 		Dirty = false;
 
+		if (Quantized) {
+			std::vector<u8> quantized;
+			quantizeVertices(getType(), Data.data(), getCount(), quantized,
+					QuantizationScale, QuantizationOffset);
+			return VBO.upload(quantized.data(), quantized.size(), 0, MappingHint);
+		}
+
 		return VBO.upload(Data.data(), T::FORMAT.Size * Data.size(), 0, MappingHint);
 	}
 
@@ -117,6 +147,10 @@ private:
 	bool Dirty = true;
 	//! hardware mapping hint
 	E_HARDWARE_MAPPING MappingHint = EHM_NEVER;
+	//! upload the vertices in their quantized format
+	bool Quantized = false;
+	core::vector3df QuantizationScale{1.f};
+	core::vector3df QuantizationOffset{0.f};
 	mutable video::HWBuffer VBO;
 };
 
@@ -126,5 +160,7 @@ typedef CVertexBuffer<scene::Vertex3D> SVertexBuffer;
 typedef CVertexBuffer<scene::Vertex2TCoords> SVertexBufferLightMap;
 //! Buffer with vertices having tangents stored, e.g. for normal mapping
 typedef CVertexBuffer<scene::VertexTangents> SVertexBufferTangents;
+//! Buffer with joint indices and weights per vertex, for hardware skinning
+typedef CVertexBuffer<scene::VertexSkinned> SVertexBufferSkinned;
 
 } // end namespace scene
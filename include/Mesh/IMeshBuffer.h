@@ -201,6 +201,22 @@ public:
 			getIndexBuffer()->setDirty();
 	}
 
+	//! Uploads the vertices in their quantized format
+	/** See IVertexBuffer::setQuantized().
+	\return False if the vertex type has no quantized format. */
+	inline bool setQuantized(bool quantized)
+	{
+		IVertexBuffer *vertices = getVertexBuffer();
+		if (vertices->isQuantized() == quantized)
+			return true;
+		if (!vertices->setQuantized(quantized))
+			return false;
+
+		// the attribute layout changes, set it up again with the next upload
+		VAObj.destroy();
+		return true;
+	}
+
 	void bind() const
 	{
 		VAObj.bind();
@@ -218,7 +234,7 @@ public:
 		updated = ibo->reload(driver);
 
 		VAObj.update(
-			driver, getVertexTypeDescription(getVertexType()),
+			driver, getVertexBuffer()->getFormat(),
 			getVertexBuffer()->getVBO(), ibo->getIBO());
 
 		return updated;
@@ -256,6 +272,9 @@ public:
 			case scene::EVT_TANGENTS:
 				ret += sizeof(scene::VertexTangents) * getVertexCount();
 				break;
+			case scene::EVT_SKINNED:
+				ret += sizeof(scene::VertexSkinned) * getVertexCount();
+				break;
 			default:
 				break;
 		}
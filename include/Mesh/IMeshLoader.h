@@ -43,6 +43,13 @@ public:
 	If you no longer need the mesh, you should call IAnimatedMesh::drop().
 	See IReferenceCounted::drop() for more information. */
 	virtual IAnimatedMesh *createMesh(io::IReadFile *file) = 0;
+
+	//! Returns true if createMesh() may run on several threads at once.
+	/** Such loaders keep the state of a load per call and don't use the
+	video driver, which may only be used on the main thread.
+	ISceneManager::getMeshAsync() parses files with them on the worker
+	threads of the job system, other loaders run on the main thread. */
+	virtual bool isReentrant() const { return false; }
 };
 
 } // end namespace scene
@@ -69,6 +69,29 @@ public:
 	/** This shouldn't be used for anything outside the VideoDriver. */
 	virtual bool getDirty() const = 0;
 
+	//! Uploads the vertices in their quantized format
+	/** The vertices stay in full precision in memory, only the copy on the
+	GPU is converted, see getQuantizedVertexTypeDescription(). Needs a shader
+	decoding them, see video::MaterialSystem::setVertexQuantization().
+	\return False if the vertex type has no quantized format. */
+	virtual bool setQuantized(bool quantized) = 0;
+
+	//! Returns if the vertices are uploaded in their quantized format
+	virtual bool isQuantized() const = 0;
+
+	//! Returns the scale and offset decoding the quantized positions
+	/** Valid after the buffer has been uploaded quantized:
+	position = quantized position * scale + offset. */
+	virtual void getQuantization(core::vector3df &scale, core::vector3df &offset) const = 0;
+
+	//! Returns the layout of the vertices on the GPU
+	const VertexDescriptor &getFormat() const
+	{
+		if (isQuantized())
+			return *getQuantizedVertexTypeDescription(getType());
+		return getVertexTypeDescription(getType());
+	}
+
 	virtual const video::HWBuffer &getVBO() const = 0;
 
 	virtual bool reload(video::VideoDriver *driver) = 0;
@@ -12,6 +12,8 @@
 #include "SMesh.h"
 #include "SVertexManipulator.h"
 
+#include <vector>
+
 namespace scene
 {
 
@@ -25,6 +27,27 @@ animations during runtime.
 class MeshManipulator : public virtual IReferenceCounted
 {
 public:
+	//! Efficiency of the post-transform vertex cache of the GPU
+	/** Measured with a FIFO cache, as found on most hardware. */
+	struct SVertexCacheStats
+	{
+		//! Average cache miss ratio, transformed vertices per triangle
+		/** Between 3 and about 0.5 for large regular meshes. */
+		f32 ACMR = 0.f;
+
+		//! Average transform to vertex ratio, transformed vertices per used vertex
+		/** 1 is the optimum, every vertex transformed once. */
+		f32 ATVR = 0.f;
+
+		//! Vertices transformed, the cache misses
+		u32 Transformed = 0;
+
+		//! Vertices referenced by the indices
+		u32 Vertices = 0;
+
+		u32 Triangles = 0;
+	};
+
 	//! Recalculates all normals of the mesh.
 	/** \param mesh: Mesh on which the operation is performed.
 	\param smooth: If the normals shall be smoothed.
@@ -74,6 +97,142 @@ public:
 	\return Number of polygons in mesh. */
 	s32 getPolyCount(IAnimatedMesh *mesh) const;
 
+	//! Simulates the vertex cache for the triangles of a mesh buffer.
+	/** \param buffer Mesh buffer of type EPT_TRIANGLES.
+	\param cacheSize Amount of vertices in the cache.
+	\return Statistics, all 0 for buffers without triangles. */
+	SVertexCacheStats getVertexCacheStats(const IMeshBuffer *buffer, u32 cacheSize = 16) const;
+
+	//! Simulates the vertex cache for all mesh buffers of a mesh.
+	/** Each mesh buffer starts with an empty cache, as it is a draw call
+	of its own. */
+	SVertexCacheStats getVertexCacheStats(IMesh *mesh, u32 cacheSize = 16) const;
+
+	//! Reorders the triangles of a mesh buffer for the vertex cache.
+	/** Uses Tipsify, which fans around vertices while they are in the
+	cache. Runs in linear time. The vertices are not changed.
+	\param buffer Mesh buffer of type EPT_TRIANGLES.
+	\param cacheSize Amount of vertices in the cache to optimize for. */
+	void optimizeVertexCache(IMeshBuffer *buffer, u32 cacheSize = 16) const;
+
+	//! Reorders clusters of triangles to reduce overdraw.
+	/** Call after optimizeVertexCache(). The triangles are cut into
+	clusters where the cache is cold anyway, or where the cache efficiency
+	of a cluster is good enough, and the clusters are sorted to draw the
+	outward facing ones first. Buffers with a transparent material are
+	left alone, their triangles are blended in the order they are drawn.
+	\param buffer Mesh buffer of type EPT_TRIANGLES.
+	\param threshold ACMR of the result relative to the input which is
+	acceptable, e.g. 1.05 trades up to 5% more vertex transforms for less
+	overdraw. 1 keeps the ACMR.
+	\param cacheSize Amount of vertices in the cache to optimize for. */
+	void optimizeOverdraw(IMeshBuffer *buffer, f32 threshold = 1.05f, u32 cacheSize = 16) const;
+
+	//! Reorders the vertices in the order the indices use them.
+	/** Call after reordering the triangles, so vertices are fetched
+	sequentially from memory. Unused vertices are moved to the end.
+	Other data referring to vertices by their index, like the weights
+	of a SkinnedMesh, is not updated.
+	\param buffer Mesh buffer to reorder. */
+	void optimizeVertexFetch(IMeshBuffer *buffer) const;
+
+	//! Optimizes all mesh buffers of a mesh for rendering.
+	/** Runs optimizeVertexCache(), optimizeOverdraw() and, except for
+	skinned meshes, optimizeVertexFetch(). The triangles of buffers with a
+	transparent material keep their order, so the rendered result stays the
+	same. The ACMR before and after is logged.
+	\param mesh Mesh to optimize.
+	\param cacheSize Amount of vertices in the cache to optimize for.
+	\param overdrawThreshold See optimizeOverdraw(). */
+	void optimizeForGPU(IMesh *mesh, u32 cacheSize = 16, f32 overdrawThreshold = 1.05f) const;
+
+	//! Uploads the vertices of a mesh buffer in their quantized format.
+	/** Positions become 16 bit integers relative to the bounding box of the
+	buffer, normals and tangents 16 bit octahedral vectors and texture
+	coordinates half floats, see getQuantizedVertexTypeDescription(). The
+	vertices in memory keep their full precision. Only buffers with one of
+	the built-in 3D materials are converted, other materials have no shader
+	decoding the vertices, see video::MaterialSystem::queryVertexQuantization().
+	\param buffer Mesh buffer to convert.
+	\param quantized False to upload full precision vertices again.
+	\return False if the vertex type has no quantized format or the material
+	no quantized variant. */
+	bool quantize(IMeshBuffer *buffer, bool quantized = true) const;
+
+	//! Uploads the vertices of all mesh buffers of a mesh in their quantized format.
+	/** Buffers with vertex types without a quantized format, e.g. the ones of
+	hardware skinned meshes, and buffers with other than the built-in 3D
+	materials are skipped.
+	\param mesh Mesh to convert.
+	\param quantized False to upload full precision vertices again.
+	\return Amount of converted mesh buffers. */
+	u32 quantize(IMesh *mesh, bool quantized = true) const;
+
+	//! Creates a copy of a mesh buffer with less triangles.
+	/** Collapses edges in the order of their quadric error, the sum of
+	the squared distances to the planes of the original triangles. The
+	vertices are a subset of the original ones, so their attributes are
+	kept, and collapses changing the normals or texture coordinates a lot
+	are done last. Vertices on the border of the mesh and on seams, where
+	several vertices share a position, e.g. with different texture
+	coordinates, are locked, so the outline and texture mapping stay intact. Collapses which flip
+	triangles are skipped.
+	\param buffer Mesh buffer of type EPT_TRIANGLES with vertices of type
+	EVT_3D, EVT_2TCOORDS or EVT_TANGENTS.
+	\param ratio Amount of triangles to keep, relative to the input. Less
+	may be kept if nothing more can be collapsed.
+	\param error Receives an estimate of the largest distance a vertex was
+	moved from the original surface, in object space.
+	\return New mesh buffer with 16 bit indices, null if the buffer isn't
+	supported. If you no longer need it, you should call IMeshBuffer::drop(). */
+	IMeshBuffer *createSimplifiedMeshBuffer(const IMeshBuffer *buffer, f32 ratio, f32 *error = nullptr) const;
+
+	//! Creates a copy of a static mesh with less triangles.
+	/** Every mesh buffer is simplified with createSimplifiedMeshBuffer(),
+	so the copy has the same mesh buffers and materials.
+	\param mesh Static mesh to simplify.
+	\param ratio Amount of triangles to keep in each mesh buffer.
+	\param error Receives the largest error of the mesh buffers.
+	\return New mesh, null if a mesh buffer isn't supported. If you no
+	longer need it, you should call SMesh::drop(). */
+	SMesh *createSimplifiedMesh(IMesh *mesh, f32 ratio, f32 *error = nullptr) const;
+
+	//! Creates a chain of levels of detail for a static mesh.
+	/** Each level is simplified from the previous one, so errors add up
+	like they do when switching between the levels.
+	\param mesh Static mesh of the highest detail, not part of the chain.
+	\param levels Amount of levels to create. The chain ends early when a
+	level can't be simplified further.
+	\param ratio Amount of triangles of each level relative to the previous one.
+	\return The levels from the highest to the lowest detail. If you no
+	longer need them, you should call SMesh::drop() on each. */
+	std::vector<SMesh *> createLODChain(IMesh *mesh, u32 levels, f32 ratio = 0.5f) const;
+
+	//! A mesh buffer to merge with createBatchedMesh()
+	struct SBatchedBuffer
+	{
+		const IMeshBuffer *Buffer;
+
+		//! Material to draw the buffer with, e.g. the one of its scene node
+		const video::SMaterial *Material;
+
+		//! Transformation into the space of the batch
+		core::matrix4 Transformation;
+	};
+
+	//! Returns true if createBatchedMesh() can merge a mesh buffer
+	bool isBatchable(const IMeshBuffer *buffer) const;
+
+	//! Merges many mesh buffers into few large ones.
+	/** The buffers are transformed and appended to a buffer of the same
+	material and vertex type. Another one is started when the 16 bit
+	indices would overflow. Only triangle lists of the vertex types
+	EVT_3D, EVT_2TCOORDS and EVT_TANGENTS are merged, others are skipped.
+	\param buffers Buffers to merge.
+	\return Mesh of the merged buffers, with the hardware mapping hint
+	EHM_STATIC. If you no longer need it, you should call SMesh::drop(). */
+	SMesh *createBatchedMesh(const std::vector<SBatchedBuffer> &buffers) const;
+
 	//! Create a new AnimatedMesh and adds the mesh to it
 	/** \param mesh Input mesh
 	\param type The type of the animated mesh to create.
@@ -149,6 +308,10 @@ protected:
 				scene::VertexTangents *verts = (scene::VertexTangents *)buffer->getVertices();
 				func(verts[i]);
 			} break;
+			case scene::EVT_SKINNED: {
+				scene::VertexSkinned *verts = (scene::VertexSkinned *)buffer->getVertices();
+				func(verts[i]);
+			} break;
 			default:
 				break;
 			}
@@ -24,6 +24,7 @@ struct SSkinMeshBuffer final : public IMeshBuffer
 		Vertices_Tangents = new SVertexBufferTangents();
 		Vertices_2TCoords = new SVertexBufferLightMap();
 		Vertices_Standard = new SVertexBuffer();
+		Vertices_Skinned = new SVertexBufferSkinned();
 		Indices = new SIndexBuffer();
 	}
 
@@ -35,11 +36,48 @@ struct SSkinMeshBuffer final : public IMeshBuffer
 		Indices->Data = std::move(indices);
 	}
 
+	//! Creates a buffer sharing the indices of another one
+	/** \param copyVertices If true, the vertices are copied so they can be
+	changed independently, e.g. by skinning. Else they are shared as well. */
+	SSkinMeshBuffer(SSkinMeshBuffer &other, bool copyVertices) :
+			Transformation(other.Transformation), Material(other.Material),
+			VertexType(other.VertexType), BoundingBox(other.BoundingBox),
+			PrimitiveType(other.PrimitiveType),
+			BoundingBoxNeedsRecalculated(other.BoundingBoxNeedsRecalculated)
+	{
+		if (copyVertices) {
+			Vertices_Tangents = new SVertexBufferTangents();
+			Vertices_2TCoords = new SVertexBufferLightMap();
+			Vertices_Standard = new SVertexBuffer();
+			Vertices_Skinned = new SVertexBufferSkinned();
+
+			Vertices_Tangents->Data = other.Vertices_Tangents->Data;
+			Vertices_2TCoords->Data = other.Vertices_2TCoords->Data;
+			Vertices_Standard->Data = other.Vertices_Standard->Data;
+			Vertices_Skinned->Data = other.Vertices_Skinned->Data;
+			getVertexBuffer()->setHardwareMappingHint(other.getVertexBuffer()->getHardwareMappingHint());
+		} else {
+			Vertices_Tangents = other.Vertices_Tangents;
+			Vertices_2TCoords = other.Vertices_2TCoords;
+			Vertices_Standard = other.Vertices_Standard;
+			Vertices_Skinned = other.Vertices_Skinned;
+
+			Vertices_Tangents->grab();
+			Vertices_2TCoords->grab();
+			Vertices_Standard->grab();
+			Vertices_Skinned->grab();
+		}
+
+		Indices = other.Indices;
+		Indices->grab();
+	}
+
 	~SSkinMeshBuffer()
 	{
 		Vertices_Tangents->drop();
 		Vertices_2TCoords->drop();
 		Vertices_Standard->drop();
+		Vertices_Skinned->drop();
 		Indices->drop();
 	}
 
@@ -62,6 +100,8 @@ struct SSkinMeshBuffer final : public IMeshBuffer
 			return Vertices_2TCoords;
 		case scene::EVT_TANGENTS:
 			return Vertices_Tangents;
+		case scene::EVT_SKINNED:
+			return Vertices_Skinned;
 		default:
 			return Vertices_Standard;
 		}
@@ -74,6 +114,8 @@ struct SSkinMeshBuffer final : public IMeshBuffer
 			return Vertices_2TCoords;
 		case scene::EVT_TANGENTS:
 			return Vertices_Tangents;
+		case scene::EVT_SKINNED:
+			return Vertices_Skinned;
 		default:
 			return Vertices_Standard;
 		}
@@ -97,6 +139,8 @@ struct SSkinMeshBuffer final : public IMeshBuffer
 			return &Vertices_2TCoords->Data[index];
 		case scene::EVT_TANGENTS:
 			return &Vertices_Tangents->Data[index];
+		case scene::EVT_SKINNED:
+			return &Vertices_Skinned->Data[index];
 		default:
 			return &Vertices_Standard->Data[index];
 		}
@@ -157,6 +201,10 @@ public:
 			recalculateBoundingBox(Vertices_Tangents);
 			break;
 		}
+		case scene::EVT_SKINNED: {
+			recalculateBoundingBox(Vertices_Skinned);
+			break;
+		}
 		default:
 			break;
 		}
@@ -198,6 +246,35 @@ public:
 		}
 	}
 
+	//! Convert to skinned vertex type, for skinning in the shaders
+	/** The joints and weights of the vertices are zeroed. */
+	void convertToSkinned()
+	{
+		if (VertexType == scene::EVT_3D) {
+			scene::VertexSkinned Vertex;
+			for (const auto &Vertex_Standard : Vertices_Standard->Data) {
+				copyVertex(Vertex_Standard, Vertex);
+				Vertices_Skinned->Data.push_back(Vertex);
+			}
+			Vertices_Standard->Data.clear();
+			VertexType = scene::EVT_SKINNED;
+		}
+	}
+
+	//! Convert skinned vertices back to the standard vertex type
+	void convertToStandard()
+	{
+		if (VertexType == scene::EVT_SKINNED) {
+			scene::Vertex3D Vertex;
+			for (const auto &Vertex_Skinned : Vertices_Skinned->Data) {
+				copyVertex(Vertex_Skinned, Vertex);
+				Vertices_Standard->Data.push_back(Vertex);
+			}
+			Vertices_Skinned->Data.clear();
+			VertexType = scene::EVT_3D;
+		}
+	}
+
 	//! append the vertices and indices to the current buffer
 	void append(const void *const vertices, u32 numVertices, const u16 *const indices, u32 numIndices) override
 	{
@@ -222,6 +299,7 @@ public:
 	SVertexBufferTangents *Vertices_Tangents;
 	SVertexBufferLightMap *Vertices_2TCoords;
 	SVertexBuffer *Vertices_Standard;
+	SVertexBufferSkinned *Vertices_Skinned;
 	SIndexBuffer *Indices;
 
 	core::matrix4 Transformation;
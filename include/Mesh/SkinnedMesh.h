@@ -11,6 +11,8 @@
 #include "Utils/quaternion.h"
 #include "Utils/vector3d.h"
 
+#include <algorithm>
+#include <cmath>
 #include <optional>
 #include <string>
 
@@ -35,12 +37,10 @@ public:
 	//! constructor
 	SkinnedMesh(SourceFormat src_format) :
 		EndFrame(0.f), FramesPerSecond(25.f),
-		LastAnimatedFrame(-1), SkinnedLastFrame(false),
 		HasAnimation(false), PreparedForSkinning(false),
-		AnimateNormals(true), HardwareSkinning(false),
-		SrcFormat(src_format)
+		AnimateNormals(true), HardwareSkinning(false), ConservativeBounds(false),
+		Revision(0), SrcFormat(src_format)
 	{
-		SkinningBuffers = &LocalBuffers;
 	}
 
 	//! destructor
@@ -63,12 +63,14 @@ public:
 	void setAnimationSpeed(f32 fps) override;
 
 	//! returns the animated mesh for the given frame
+	/** Animates and skins the mesh buffers of the mesh itself. Scene nodes
+	use a SkinnedMeshInstance instead, so they can share the mesh. */
 	IMesh *getMesh(f32) override;
 
-	//! Animates joints based on frame input
+	//! Animates the joints of the pose of the mesh itself based on frame input
 	void animateMesh(f32 frame);
 
-	//! Performs a software skin on this mesh based of joint positions
+	//! Performs a software skin on the mesh buffers of this mesh based of joint positions
 	void skinMesh();
 
 	//! returns amount of mesh buffers.
@@ -139,9 +141,52 @@ public:
 	}
 
 	//! Allows to enable hardware skinning.
-	/* This feature is not implemented in Irrlicht yet */
+	/** The skinned mesh buffers are converted to EVT_SKINNED vertices holding
+	their 4 strongest joints, and skinMesh() only updates the joint matrices and
+	the bounding box. The scene node passes getSkinningMatrices() to
+	VideoDriver::setJointTransforms() while drawing the skinned buffers.
+	Needs VideoDriver::queryHardwareSkinning(), at most
+	MAX_HARDWARE_SKINNING_JOINTS joints and skinned buffers with EVT_3D vertices.
+	\return True if hardware skinning is enabled now. */
 	bool setHardwareSkinning(bool on);
 
+	//! Returns true if the mesh is skinned by the shaders.
+	bool isHardwareSkinned() const {
+		return HardwareSkinning;
+	}
+
+	//! Bounds skinned buffers by boxes of their joints instead of their vertices
+	/** The boxes of the vertices influenced by each joint are built once in
+	the space of the joint, so bounding a pose only transforms one box per
+	joint and never reads vertex data. The result encloses the skinned
+	vertices, but is larger than their exact box. Hardware skinned meshes
+	always use these boxes. */
+	void setConservativeBounds(bool on);
+
+	//! Returns true if skinned buffers are bounded by the boxes of their joints
+	bool hasConservativeBounds() const {
+		return ConservativeBounds;
+	}
+
+	//! Returns the joint matrices of the pose of the mesh itself, indexed like getAllJoints()
+	/** Each is the animated global matrix of the joint multiplied with its inverse bind matrix. */
+	const std::vector<core::matrix4> &getSkinningMatrices() const {
+		return Pose.SkinningMatrices;
+	}
+
+	//! Returns true if skinning or morph targets change the vertices of a mesh buffer
+	/** Users skinning copies of the mesh buffers only need to copy these,
+	the others can share the vertices of the mesh. With hardware skinning only
+	buffers with morph targets are changed. */
+	bool hasSkinnedVertices(u32 nr) const;
+
+	//! Returns a number changed whenever the vertices of the mesh buffers are changed
+	/** E.g. by recalculating the normals or by switching to hardware skinning.
+	Copies of the mesh buffers have to be recreated then. */
+	u32 getRevision() const {
+		return Revision;
+	}
+
 	//! Refreshes vertex data cached in joints such as positions and normals
 	void refreshJointCache();
 
@@ -150,17 +195,16 @@ public:
 
 	void updateBoundingBox();
 
-	//! Recovers the joints from the mesh
-	void recoverJointsFromMesh(std::vector<IBoneSceneNode *> &jointChildSceneNodes);
-
-	//! Transfers the joint data to the mesh
-	void transferJointsToMesh(const std::vector<IBoneSceneNode *> &jointChildSceneNodes);
-
 	//! Creates an array of joints from this mesh as children of node
 	void addJoints(std::vector<IBoneSceneNode *> &jointChildSceneNodes,
 			IAnimatedMeshSceneNode *node,
 			ISceneManager *smgr);
 
+	//! Returns the index of the parent of a joint, or -1 for root joints
+	s32 getJointParent(u32 number) const {
+		return JointParents[number];
+	}
+
 	//! A vertex weight
 	struct SWeight
 	{
@@ -172,15 +216,15 @@ public:
 
 		//! Weight Strength/Percentage (0-1)
 		f32 strength;
-
-	private:
-		//! Internal members used by SkinnedMesh
-		friend class SkinnedMesh;
-		char *Moved;
-		core::vector3df StaticPos;
-		core::vector3df StaticNormal;
 	};
 
+	//! Maximal amount of joints influencing a single vertex
+	/** Vertices with more weights only keep the strongest ones. */
+	static constexpr u32 MAX_SKIN_INFLUENCES = 8;
+
+	//! Maximal amount of joints of hardware skinned meshes, the size of the shader palette
+	static constexpr u32 MAX_HARDWARE_SKINNING_JOINTS = 64;
+
 	template <class T>
 	struct Channel {
 		struct Frame {
@@ -190,14 +234,44 @@ public:
 		std::vector<Frame> frames;
 		bool interpolate = true;
 
+		//! Quantized keys, replacing the frames after compress()
+		struct Packed {
+			//! Amount of keys
+			u32 count = 0;
+
+			//! Time of the first key and between two keys, if they are evenly spaced
+			f32 start = 0.f;
+			f32 interval = 0.f;
+
+			//! Times of the keys, empty if they are evenly spaced
+			std::vector<f32> times;
+
+			//! Three quantized components per key
+			std::vector<u16> values;
+
+			//! Range of the quantized components of vectors
+			core::vector3df min;
+			core::vector3df extent;
+		};
+		Packed packed;
+
 		bool empty() const {
-			return frames.empty();
+			return frames.empty() && packed.count == 0;
 		}
 
 		f32 getEndFrame() const {
+			if (packed.count)
+				return getPackedTime(packed.count - 1);
 			return frames.empty() ? 0 : frames.back().time;
 		}
 
+		//! Returns the memory used by the keys in bytes
+		size_t getDataSize() const {
+			return frames.capacity() * sizeof(Frame) +
+					packed.times.capacity() * sizeof(f32) +
+					packed.values.capacity() * sizeof(u16);
+		}
+
 		void pushBack(f32 time, const T &value) {
 			frames.push_back({time, value});
 		}
@@ -232,6 +306,84 @@ public:
 			frames.shrink_to_fit();
 		}
 
+		//! Drops middle keys which interpolating the kept keys reproduces within tolerance
+		/** Positions and scales are compared by distance, rotations by angle in radians. */
+		void reduce(f32 tolerance) {
+			if (!interpolate || frames.size() < 3)
+				return;
+
+			std::vector<Frame> kept;
+			kept.push_back(frames.front());
+
+			// grow the span from the last kept key as long as all keys inside fit
+			size_t anchor = 0;
+			for (size_t end = 2; end < frames.size(); ++end) {
+				const Frame &from = frames[anchor];
+				const Frame &to = frames[end];
+
+				bool fits = true;
+				for (size_t k = anchor + 1; k < end && fits; ++k) {
+					const f32 t = (frames[k].time - from.time) / (to.time - from.time);
+					fits = difference(interpolateValue(from.value, to.value, t), frames[k].value) <= tolerance;
+				}
+
+				if (!fits) {
+					anchor = end - 1;
+					kept.push_back(frames[anchor]);
+				}
+			}
+			kept.push_back(frames.back());
+
+			frames = std::move(kept);
+		}
+
+		//! Replaces the frames by quantized keys
+		/** Rotations are stored as the smallest three components with 15 bits
+		each, vectors with 16 bits per component within the range of the
+		channel. Evenly spaced keys don't store their times. */
+		void compress() {
+			if (frames.empty())
+				return;
+
+			packed = Packed();
+
+			const u32 count = frames.size();
+			packed.count = count;
+			packed.start = frames.front().time;
+
+			bool uniform = true;
+			if (count > 1) {
+				packed.interval = (frames.back().time - packed.start) / (count - 1);
+				for (u32 i = 1; i < count - 1 && uniform; ++i) {
+					const f32 expected = packed.start + i * packed.interval;
+					uniform = std::fabs(frames[i].time - expected) <= 0.0001f * std::max(1.f, std::fabs(expected));
+				}
+			}
+
+			if (!uniform) {
+				packed.interval = 0.f;
+				packed.times.reserve(count);
+				for (const auto &frame : frames)
+					packed.times.push_back(frame.time);
+			}
+
+			core::vector3df max = rangePoint(frames.front().value);
+			packed.min = max;
+			for (const auto &frame : frames) {
+				const core::vector3df point = rangePoint(frame.value);
+				packed.min.set(std::min(packed.min.X, point.X), std::min(packed.min.Y, point.Y), std::min(packed.min.Z, point.Z));
+				max.set(std::max(max.X, point.X), std::max(max.Y, point.Y), std::max(max.Z, point.Z));
+			}
+			packed.extent = max - packed.min;
+
+			packed.values.resize(count * 3);
+			for (u32 i = 0; i < count; ++i)
+				encode(frames[i].value, packed, &packed.values[i * 3]);
+
+			frames.clear();
+			frames.shrink_to_fit();
+		}
+
 		static core::quaternion interpolateValue(core::quaternion from, core::quaternion to, f32 time) {
 			core::quaternion result;
 			result.slerp(from, to, time, 0.001f);
@@ -243,23 +395,202 @@ public:
 			return to.getInterpolated(from, time);
 		}
 
+		static f32 interpolateValue(f32 from, f32 to, f32 time) {
+			return from + (to - from) * time;
+		}
+
 		std::optional<T> get(f32 time) const {
+			u32 cursor = 0;
+			return get(time, cursor);
+		}
+
+		//! Samples the channel, starting the key search at a cursor
+		/** The cursor keeps the key found for the next call, so sampling a
+		playing animation only looks at the next key or two. */
+		std::optional<T> get(f32 time, u32 &cursor) const {
+			if (packed.count)
+				return getPacked(time, cursor);
+
 			if (frames.empty())
 				return std::nullopt;
 
-			const auto next = std::lower_bound(frames.begin(), frames.end(), time, [](const auto& frame, f32 time) {
-				return frame.time < time;
-			});
-			if (next == frames.begin())
-				return next->value;
-			if (next == frames.end())
+			const u32 count = frames.size();
+			if (time <= frames.front().time)
+				return frames.front().value;
+			if (time > frames.back().time)
 				return frames.back().value;
 
-			const auto prev = next - 1;
+			const u32 prev = findKey(count, time, cursor, [this](u32 i) {
+				return frames[i].time;
+			});
+			if (!interpolate)
+				return frames[prev].value;
+
+			const Frame &from = frames[prev];
+			const Frame &to = frames[prev + 1];
+			return interpolateValue(from.value, to.value, (time - from.time) / (to.time - from.time));
+		}
+
+	private:
+		//! Returns the last key before time, time must be within the keys
+		template <class TimeOf>
+		static u32 findKey(u32 count, f32 time, u32 &cursor, const TimeOf &timeOf) {
+			// playing forward usually only moves by a key or two
+			if (cursor < count - 1 && timeOf(cursor) < time) {
+				for (u32 step = 0; step < 4; ++step) {
+					if (!(timeOf(cursor + 1) < time))
+						return cursor;
+					++cursor;
+				}
+			}
+
+			// first key at or after time
+			u32 low = 1;
+			u32 high = count - 1;
+			while (low < high) {
+				const u32 mid = (low + high) / 2;
+				if (timeOf(mid) < time)
+					low = mid + 1;
+				else
+					high = mid;
+			}
+			cursor = low - 1;
+			return cursor;
+		}
+
+		f32 getPackedTime(u32 i) const {
+			return packed.times.empty() ? packed.start + i * packed.interval : packed.times[i];
+		}
+
+		T getPackedValue(u32 i) const {
+			T value;
+			decode(&packed.values[i * 3], packed, value);
+			return value;
+		}
+
+		std::optional<T> getPacked(f32 time, u32 &cursor) const {
+			const u32 count = packed.count;
+			if (time <= getPackedTime(0))
+				return getPackedValue(0);
+			if (time > getPackedTime(count - 1))
+				return getPackedValue(count - 1);
+
+			u32 prev;
+			if (packed.times.empty()) {
+				const s32 key = (s32)std::ceil((time - packed.start) / packed.interval) - 1;
+				prev = core::clamp<s32>(key, 0, count - 2);
+			} else {
+				prev = findKey(count, time, cursor, [this](u32 i) {
+					return packed.times[i];
+				});
+			}
+
 			if (!interpolate)
-				return prev->value;
+				return getPackedValue(prev);
+
+			const f32 from = getPackedTime(prev);
+			const f32 to = getPackedTime(prev + 1);
+			return interpolateValue(getPackedValue(prev), getPackedValue(prev + 1), (time - from) / (to - from));
+		}
+
+		static f32 difference(const core::vector3df &a, const core::vector3df &b) {
+			return a.getDistanceFrom(b);
+		}
+
+		static f32 difference(f32 a, f32 b) {
+			return std::fabs(a - b);
+		}
+
+		static f32 difference(const core::quaternion &a, const core::quaternion &b) {
+			// angle from the chord between the quaternions, acos of the dot
+			// product is too imprecise for small angles. q and -q are the same rotation.
+			const f32 sign = a.dotProduct(b) < 0.f ? -1.f : 1.f;
+			const f32 x = a.X - b.X * sign, y = a.Y - b.Y * sign;
+			const f32 z = a.Z - b.Z * sign, w = a.W - b.W * sign;
+			const f32 chord = core::squareroot(x * x + y * y + z * z + w * w);
+			return 4.f * std::asin(std::min(1.f, chord * 0.5f));
+		}
 
-			return interpolateValue(prev->value, next->value, (time - prev->time) / (next->time - prev->time));
+		static core::vector3df rangePoint(const core::vector3df &value) {
+			return value;
+		}
+
+		static core::vector3df rangePoint(const core::quaternion &) {
+			return core::vector3df(0.f, 0.f, 0.f);
+		}
+
+		static core::vector3df rangePoint(f32 value) {
+			return core::vector3df(value, 0.f, 0.f);
+		}
+
+		static void encode(const core::vector3df &value, const Packed &p, u16 *out) {
+			const f32 in[3] = {value.X - p.min.X, value.Y - p.min.Y, value.Z - p.min.Z};
+			const f32 extent[3] = {p.extent.X, p.extent.Y, p.extent.Z};
+			for (u32 i = 0; i < 3; ++i)
+				out[i] = extent[i] > 0.f ? (u16)core::round32(core::clamp(in[i] / extent[i], 0.f, 1.f) * 65535.f) : 0;
+		}
+
+		static void decode(const u16 *in, const Packed &p, core::vector3df &value) {
+			value.set(p.min.X + in[0] * (p.extent.X / 65535.f),
+					p.min.Y + in[1] * (p.extent.Y / 65535.f),
+					p.min.Z + in[2] * (p.extent.Z / 65535.f));
+		}
+
+		//! Scalars use the first component of a vector
+		static void encode(f32 value, const Packed &p, u16 *out) {
+			encode(core::vector3df(value, 0.f, 0.f), p, out);
+		}
+
+		static void decode(const u16 *in, const Packed &p, f32 &value) {
+			core::vector3df v;
+			decode(in, p, v);
+			value = v.X;
+		}
+
+		static void encode(const core::quaternion &value, const Packed &, u16 *out) {
+			core::quaternion q = value;
+			q.normalize();
+			const f32 c[4] = {q.X, q.Y, q.Z, q.W};
+
+			// drop the largest component, it follows from the others
+			u32 largest = 0;
+			for (u32 i = 1; i < 4; ++i) {
+				if (std::fabs(c[i]) > std::fabs(c[largest]))
+					largest = i;
+			}
+
+			// q and -q are the same rotation, so the dropped component is made positive
+			// and the others are within +-1/sqrt(2)
+			const f32 scale = (c[largest] < 0.f ? -1.f : 1.f) * core::squareroot(2.f);
+			u32 n = 0;
+			for (u32 i = 0; i < 4; ++i) {
+				if (i == largest)
+					continue;
+				const f32 v = core::clamp(c[i] * scale, -1.f, 1.f);
+				out[n++] = (u16)core::round32((v * 0.5f + 0.5f) * 32767.f);
+			}
+
+			// the index of the dropped component goes into the spare top bits
+			out[0] |= (largest & 1) << 15;
+			out[1] |= (largest >> 1) << 15;
+		}
+
+		static void decode(const u16 *in, const Packed &, core::quaternion &value) {
+			const u32 largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+			const f32 scale = 1.f / core::squareroot(2.f);
+
+			f32 c[4];
+			f32 sum = 0.f;
+			u32 n = 0;
+			for (u32 i = 0; i < 4; ++i) {
+				if (i == largest)
+					continue;
+				c[i] = ((in[n++] & 0x7FFF) / 32767.f * 2.f - 1.f) * scale;
+				sum += c[i] * c[i];
+			}
+			c[largest] = core::squareroot(std::max(0.f, 1.f - sum));
+
+			value.set(c[0], c[1], c[2], c[3]);
 		}
 	};
 
@@ -286,14 +617,25 @@ public:
 			});
 		}
 
+		size_t getDataSize() const {
+			return position.getDataSize() + rotation.getDataSize() + scale.getDataSize();
+		}
+
+		//! Samples the channels
+		/** \param cursors Optional cursors of the position, rotation and scale channel. */
 		void updateTransform(f32 frame,
-				core::vector3df &t, core::quaternion &r, core::vector3df &s) const
+				core::vector3df &t, core::quaternion &r, core::vector3df &s,
+				u32 *cursors = nullptr) const
 		{
-			if (auto pos = position.get(frame))
+			u32 local[3] = {0, 0, 0};
+			if (!cursors)
+				cursors = local;
+
+			if (auto pos = position.get(frame, cursors[0]))
 				t = *pos;
-			if (auto rot = rotation.get(frame))
+			if (auto rot = rotation.get(frame, cursors[1]))
 				r = *rot;
-			if (auto scl = scale.get(frame))
+			if (auto scl = scale.get(frame, cursors[2]))
 				s = *scl;
 		}
 
@@ -307,8 +649,6 @@ public:
 	//! Joints
 	struct SJoint
 	{
-		SJoint() : GlobalSkinningSpace(false) {}
-
 		//! The name of this joint
 		std::optional<std::string> Name;
 
@@ -329,47 +669,393 @@ public:
 
 		//! Unnecessary for loaders, will be overwritten on finalize
 		core::matrix4 GlobalMatrix; // loaders may still choose to set this (temporarily) to calculate absolute vertex data.
-		core::matrix4 GlobalAnimatedMatrix;
-		core::matrix4 LocalAnimatedMatrix;
 
 		//! These should be set by loaders.
+		//! Used for the channels without keys when animating a pose.
 		core::vector3df Animatedposition;
 		core::vector3df Animatedscale;
 		core::quaternion Animatedrotation;
 
 		// The .x and .gltf formats pre-calculate this
 		std::optional<core::matrix4> GlobalInversedMatrix;
-	private:
-		//! Internal members used by SkinnedMesh
-		friend class SkinnedMesh;
-
-		bool GlobalSkinningSpace;
 	};
 
 	const std::vector<SJoint *> &getAllJoints() const {
 		return AllJoints;
 	}
 
+	//! Blend shape of a mesh buffer
+	/** Moves vertices of the buffer by their delta times the weight of the
+	target before they are skinned. Only the moved vertices are stored. */
+	struct SMorphTarget
+	{
+		//! The name of this target
+		std::optional<std::string> Name;
+
+		//! Index of the mesh buffer
+		u32 Buffer = 0;
+
+		//! Moved vertices, ascending after finalize
+		std::vector<u32> VertexIds;
+
+		//! Position delta of each moved vertex, 4 floats each with the last one unused
+		std::vector<f32> PositionDeltas;
+
+		//! Normal deltas laid out like PositionDeltas, or empty
+		std::vector<f32> NormalDeltas;
+
+		//! Weight keys
+		Channel<f32> Weights;
+
+		//! Weight used without weight keys
+		f32 DefaultWeight = 0.f;
+	};
+
+	const std::vector<SMorphTarget *> &getMorphTargets() const {
+		return MorphTargets;
+	}
+
+	//! Returns the index of a morph target by its name
+	std::optional<u32> getMorphTargetNumber(const std::string &name) const;
+
+	//! Animation state of one user of the mesh
+	/** Animating and skinning a pose only reads the mesh, so the scene nodes
+	sharing a mesh keep a pose each and can animate it at the same time. */
+	struct SPose
+	{
+		//! Animated local and global matrices, indexed like getAllJoints()
+		std::vector<core::matrix4> LocalMatrices;
+		std::vector<core::matrix4> GlobalMatrices;
+
+		//! Global matrices multiplied with the inverse bind matrices
+		std::vector<core::matrix4> SkinningMatrices;
+
+		//! Joints whose local matrix is in global space, see EBSS_GLOBAL
+		std::vector<u8> GlobalSkinningSpace;
+
+		//! Bounding boxes of the vertex ranges skinned by the jobs
+		std::vector<core::aabbox3df> RangeBoxes;
+
+		//! Last keys found in the position, rotation and scale channel of each joint
+		std::vector<u32> KeyCursors;
+
+		//! Weights of the morph targets, indexed like getMorphTargets()
+		/** Sampled by animatePose(). They may be changed before skinPose(),
+		setting Skinned to false. */
+		std::vector<f32> MorphWeights;
+		std::vector<u32> MorphCursors;
+
+		//! Weights the morphed vertices were accumulated with
+		std::vector<f32> AppliedMorphWeights;
+
+		//! Morphed positions and normals of each buffer with targets, 4 floats per vertex
+		std::vector<std::vector<f32>> MorphedPositions;
+		std::vector<std::vector<f32>> MorphedNormals;
+
+		//! Frame the local matrices were animated for, -1 if set otherwise
+		f32 Frame = -1.f;
+
+		//! Global matrices and skinned buffers are up to date with the local matrices
+		bool Skinned = false;
+	};
+
+	//! Sets a pose to the rest pose of the mesh
+	void resetPose(SPose &pose) const;
+
+	//! Animates the local joint matrices of a pose based on frame input
+	void animatePose(SPose &pose, f32 frame) const;
+
+	//! Samples the weight keys of the morph targets into a pose
+	/** Called by animatePose(). Targets without weight keys keep their
+	weight, so it can be set by the user. */
+	void sampleMorphWeights(SPose &pose, f32 frame) const;
+
+	//! Updates the global and skinning matrices of a pose and skins mesh buffers with it
+	/** \param buffers Mesh buffers receiving the skinned vertices, the
+	transformations of rigidly animated buffers and the bounding boxes. Indexed
+	like the buffers of this mesh, only those with hasSkinnedVertices() need
+	own vertices.
+	\param box Receives the bounding box of all buffers. */
+	void skinPose(SPose &pose, const std::vector<SSkinMeshBuffer *> &buffers,
+			core::aabbox3df &box) const;
+
+	//! Like skinPose(), but leaves the vertices alone
+	/** Much cheaper, used for poses which aren't visible. Skinned buffers
+	are bounded by the boxes of their joints, see setConservativeBounds(). */
+	void boundPose(SPose &pose, const std::vector<SSkinMeshBuffer *> &buffers,
+			core::aabbox3df &box) const;
+
+	//! Local transformations of the joints, one array per component
+	/** Poses are blended in this form instead of as matrices, as positions,
+	rotations and scales interpolate independently. Indexed like getAllJoints(),
+	only the entries of joints with keys are used. The others aren't animated
+	and keep their local matrix. */
+	struct SJointTransforms
+	{
+		std::vector<core::vector3df> Positions;
+		std::vector<core::quaternion> Rotations;
+		std::vector<core::vector3df> Scales;
+	};
+
+	//! How a rotation is interpolated by blendTransforms()
+	enum E_ROTATION_BLEND
+	{
+		//! Normalized linear interpolation, cheap and good for small angles
+		ERB_NLERP = 0,
+
+		//! Spherical interpolation, constant angular speed
+		ERB_SLERP
+	};
+
+	//! Samples the keys of all joints with keys at a frame
+	/** \param cursors Optional key cursors, 3 per joint like SPose::KeyCursors. */
+	void sampleTransforms(SJointTransforms &transforms, f32 frame,
+			std::vector<u32> *cursors = nullptr) const;
+
+	//! Blends src over dst
+	/** \param weight Influence of src, 0 keeps dst and 1 replaces it.
+	\param mask Optional weight per joint, multiplied with weight. */
+	void blendTransforms(SJointTransforms &dst, const SJointTransforms &src,
+			f32 weight, const std::vector<f32> *mask = nullptr,
+			E_ROTATION_BLEND rotationBlend = ERB_NLERP) const;
+
+	//! Adds the difference of src to reference on top of dst
+	/** Used for additive animations, e.g. breathing or leaning, which are
+	stored relative to a reference frame of the same animation.
+	\param weight Influence of the difference, 0 keeps dst.
+	\param mask Optional weight per joint, multiplied with weight. */
+	void addTransforms(SJointTransforms &dst, const SJointTransforms &src,
+			const SJointTransforms &reference, f32 weight,
+			const std::vector<f32> *mask = nullptr) const;
+
+	//! Sets the local matrices of a pose from transforms
+	void buildLocalMatrices(SPose &pose, const SJointTransforms &transforms) const;
+
+	//! Settings of compressAnimation()
+	struct SCompressionSettings
+	{
+		SCompressionSettings() :
+				PositionTolerance(0.001f), RotationTolerance(0.001f),
+				ScaleTolerance(0.001f), WeightTolerance(0.001f) {}
+
+		//! Largest error of a dropped position key, in the units of the mesh
+		f32 PositionTolerance;
+
+		//! Largest error of a dropped rotation key, in radians
+		f32 RotationTolerance;
+
+		//! Largest error of a dropped scale key
+		f32 ScaleTolerance;
+
+		//! Largest error of a dropped morph target weight key
+		f32 WeightTolerance;
+	};
+
+	//! Reduces and quantizes the keys of all joints
+	/** Keys which interpolating the remaining ones reproduces within the
+	tolerances are dropped. The others are quantized, see Channel::compress().
+	Must not be called while poses are animated.
+	\return Size of the keys in bytes afterwards. */
+	size_t compressAnimation(const SCompressionSettings &settings = SCompressionSettings());
+
+	//! Returns the size of the keys of all joints in bytes
+	size_t getAnimationDataSize() const;
+
+	//! Settings of bakeAnimation()
+	struct SBakeSettings
+	{
+		SBakeSettings() :
+				SamplesPerFrame(1.f), Interpolate(true), Quantize(false) {}
+
+		//! Samples taken per animation frame
+		/** More samples need more memory, but reduce the error of blending
+		between them. */
+		f32 SamplesPerFrame;
+
+		//! Blend linearly between the two nearest samples, else take the nearest one
+		bool Interpolate;
+
+		//! Store the matrix elements with 16 bits, else as full floats
+		/** Each element is quantized within its range over the animation of
+		its joint, like the keys of Channel::compress(). This halves the
+		table, the error is at most 1/65535 of the range. */
+		bool Quantize;
+	};
+
+	//! Samples the animation into a table of local joint matrices
+	/** Afterwards animatePose() only blends two rows of the table, instead of
+	searching and interpolating the keys of every joint. Blending matrices
+	slightly shrinks the rotations between two samples, so the sample rate
+	trades memory for precision. Must not be called while poses are animated.
+	\return Size of the table in bytes, 0 if there is nothing to bake. */
+	size_t bakeAnimation(const SBakeSettings &settings = SBakeSettings());
+
+	//! Removes the baked table, poses are animated from the keys again
+	void clearBakedAnimation();
+
+	//! Returns true if poses are animated from a baked table
+	bool isAnimationBaked() const {
+		return Baked.SampleCount != 0;
+	}
+
+	//! Results of benchmarkAnimation()
+	struct SAnimationBenchmarkResult
+	{
+		//! Average time for animating a pose from the keys
+		f64 LiveMicroseconds = 0.0;
+
+		//! Average time for animating a pose from the baked table
+		f64 BakedMicroseconds = 0.0;
+
+		//! LiveMicroseconds / BakedMicroseconds
+		f64 Speedup = 0.0;
+
+		//! Largest difference of an element of a baked and a live local matrix
+		f32 MaxError = 0.f;
+
+		//! Size of the baked table in bytes
+		size_t TableSize = 0;
+	};
+
+	//! Compares animating poses from the keys with animating them from a baked table
+	/** The table is baked with the given settings just for the benchmark, a
+	table baked before is kept.
+	\param poseCount Amount of poses animated, spread over the whole animation. */
+	SAnimationBenchmarkResult benchmarkAnimation(u32 poseCount = 10000,
+			const SBakeSettings &settings = SBakeSettings());
+
+	//! Sets bone scene nodes to the local matrices of a pose
+	void recoverJoints(const SPose &pose, std::vector<IBoneSceneNode *> &jointChildSceneNodes) const;
+
+	//! Sets the local matrices of a pose to bone scene nodes
+	void transferJoints(SPose &pose, const std::vector<IBoneSceneNode *> &jointChildSceneNodes) const;
+
 protected:
 	void checkForAnimation();
 
 	void normalizeWeights();
 
-	void buildAllLocalAnimatedMatrices();
+	void buildAllLocalAnimatedMatrices(SPose &pose, f32 frame) const;
+
+	//! Like buildAllLocalAnimatedMatrices(), but blends the samples of the baked table
+	void buildBakedLocalMatrices(SPose &pose, f32 frame) const;
 
-	void buildAllGlobalAnimatedMatrices(SJoint *Joint = 0, SJoint *ParentJoint = 0);
+	void buildAllGlobalAnimatedMatrices(SPose &pose) const;
 
 	void calculateGlobalMatrices(SJoint *Joint, SJoint *ParentJoint);
 
-	void skinJoint(SJoint *Joint, SJoint *ParentJoint);
+	//! Fills JointParents and JointOrder from the joint hierarchy
+	void buildJointHierarchy();
+
+	//! Vertex major skinning data of a mesh buffer
+	/** Built once from the joint weights, so skinning reads the joint matrices
+	of each vertex and writes its position and normal exactly once. */
+	struct SSkinLayout
+	{
+		//! Index of the mesh buffer
+		u32 Buffer = 0;
+
+		//! Influences stored per vertex, 4 or 8
+		u32 InfluenceCount = 0;
+
+		//! Indices of the skinned vertices in the mesh buffer
+		std::vector<u32> VertexIds;
+
+		//! Rest pose of the skinned vertices
+		std::vector<f32> PosX, PosY, PosZ;
+		std::vector<f32> NormalX, NormalY, NormalZ;
+
+		//! InfluenceCount joint indices and weights per vertex, strongest first.
+		//! Unused slots have a weight of 0.
+		std::vector<u16> Joints;
+		std::vector<f32> Weights;
+
+		//! Joints influencing any vertex of the buffer
+		std::vector<u16> UsedJoints;
+
+		//! Bounding box of the whole buffer in the rest pose
+		core::aabbox3df RestBox{{0, 0, 0}};
+
+		//! Bounding boxes of the vertices influenced by each of the
+		//! UsedJoints, in the space of the joint at the rest pose
+		std::vector<core::aabbox3df> JointBoxes;
+
+		//! Bounding box of the vertices without weights, which never move
+		core::aabbox3df UnweightedBox{{0, 0, 0}};
+		bool HasUnweighted = false;
+	};
+
+	//! Builds SkinLayouts from the normalized joint weights
+	void buildSkinLayouts();
+
+	//! Builds the joint boxes of the layouts from their rest pose
+	void buildJointBounds();
+
+	//! Rest pose and targets of a mesh buffer with morph targets
+	struct SMorphBuffer
+	{
+		u32 Buffer = 0;
+
+		//! Indices into MorphTargets
+		std::vector<u32> Targets;
+
+		//! Positions and normals of all vertices, 4 floats each
+		std::vector<f32> RestPositions;
+		std::vector<f32> RestNormals;
+
+		//! Per vertex range of the positions reachable with weights
+		//! within [0, 1], 4 floats each, only used for the bounds
+		std::vector<f32> DeltaMin;
+		std::vector<f32> DeltaMax;
+
+		//! Box enclosing the vertices for any weights within [0, 1]
+		core::aabbox3df Bounds{{0, 0, 0}};
+	};
+
+	//! Drops invalid deltas and sorts the rest by vertex id
+	void prepareMorphTargets();
+
+	//! Builds MorphBuffers from the morph targets and the vertices
+	void buildMorphBuffers();
+
+	//! Returns the morph buffer of a mesh buffer, or 0 if it has no targets
+	const SMorphBuffer *getMorphBuffer(u32 buffer) const;
+
+	//! Accumulates the active morph targets of a pose into its morphed vertices
+	/** Also writes them to the vertices of the buffers which aren't skinned
+	on the CPU. */
+	void morphPose(SPose &pose, const std::vector<SSkinMeshBuffer *> &buffers) const;
+
+	//! Returns the layout of a mesh buffer, or 0 if it has no skinned vertices
+	const SSkinLayout *getSkinLayout(u32 buffer) const;
+
+	//! Sets the transformations of rigidly animated buffers and the skinning matrices
+	void buildJointTransformations(SPose &pose, const std::vector<SSkinMeshBuffer *> &buffers) const;
+
+	//! Returns a box enclosing the vertices of a layout skinned with a pose
+	core::aabbox3df getConservativeBox(const SSkinLayout &layout, const SPose &pose) const;
+
+	//! Copies the rest pose of the skinned vertices into the mesh buffers
+	void copyRestPoseToBuffers();
+
+	//! Skins the vertices [begin, end) of a layout with the skinning matrices of a pose
+	/** \return Bounding box of the skinned vertices. */
+	core::aabbox3df skinVertices(const SSkinLayout &layout, const SPose &pose,
+			SSkinMeshBuffer *buffer, u32 begin, u32 end) const;
+
+	//! Vertices of a layout skinned by one job
+	struct SSkinningRange
+	{
+		u32 Layout;
+		u32 Begin;
+		u32 End;
+	};
 
 	void calculateTangents(core::vector3df &normal,
 			core::vector3df &tangent, core::vector3df &binormal,
 			const core::vector3df &vt1, const core::vector3df &vt2, const core::vector3df &vt3,
 			const core::vector2df &tc1, const core::vector2df &tc2, const core::vector2df &tc3);
 
-	std::vector<SSkinMeshBuffer *> *SkinningBuffers; // Meshbuffer to skin, default is to skin localBuffers
-
 	std::vector<SSkinMeshBuffer *> LocalBuffers;
 	//! Mapping from meshbuffer number to bindable texture slot
 	std::vector<u32> TextureSlots;
@@ -377,22 +1063,59 @@ protected:
 	std::vector<SJoint *> AllJoints;
 	std::vector<SJoint *> RootJoints;
 
-	// bool can't be used here because std::vector<bool>
-	// doesn't allow taking a reference to individual elements.
-	std::vector<std::vector<char>> Vertices_Moved;
+	std::vector<SMorphTarget *> MorphTargets;
+	std::vector<SMorphBuffer> MorphBuffers;
+
+	//! Index of the parent of each joint, -1 for root joints
+	std::vector<s32> JointParents;
+
+	//! Joint indices ordered so parents come before their children
+	std::vector<u32> JointOrder;
+
+	//! Joints with keys, the only ones changed by animating
+	std::vector<u32> AnimatedJoints;
+
+	std::vector<SSkinLayout> SkinLayouts;
+	std::vector<SSkinningRange> SkinningRanges;
+
+	//! Pose of the mesh itself, used by getMesh()
+	SPose Pose;
+
+	//! Animation sampled by bakeAnimation()
+	struct SBakedAnimation
+	{
+		f32 SamplesPerFrame = 0.f;
+		u32 SampleCount = 0;
+		bool Interpolate = true;
+
+		//! Joints with keys, the others keep their local matrix
+		std::vector<u32> Joints;
+
+		//! Local matrices of the joints sample by sample, without the
+		//! elements 3, 7, 11 and 15 which are always 0 or 1
+		std::vector<f32> Matrices;
+
+		//! Matrices quantized with SBakeSettings::Quantize, replacing Matrices
+		std::vector<u16> Quantized;
+
+		//! Minimum and step of each quantized element of each joint
+		std::vector<f32> Ranges;
+	};
+
+	SBakedAnimation Baked;
 
 	core::aabbox3d<f32> BoundingBox{{0, 0, 0}};
 
 	f32 EndFrame;
 	f32 FramesPerSecond;
 
-	f32 LastAnimatedFrame;
-	bool SkinnedLastFrame;
-
 	bool HasAnimation;
 	bool PreparedForSkinning;
 	bool AnimateNormals;
 	bool HardwareSkinning;
+	bool ConservativeBounds;
+
+	u32 Revision;
 
 	SourceFormat SrcFormat;
 };
@@ -426,6 +1149,15 @@ public:
 
 	//! Adds a new weight to the mesh, access it as last one
 	SWeight *addWeight(SJoint *joint);
+
+	//! Adds a new morph target of a mesh buffer, access it as last one
+	SMorphTarget *addMorphTarget(u32 buffer);
+
+	//! Moves a vertex with a morph target
+	void addMorphDelta(SMorphTarget *target, u32 vertex,
+			const core::vector3df &position, const core::vector3df &normal = core::vector3df(0.f));
+
+	void addMorphWeightKey(SMorphTarget *target, f32 frame, f32 weight);
 };
 
 } // end namespace scene
@@ -0,0 +1,208 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Mesh/SkinnedMesh.h"
+
+#include <vector>
+
+namespace scene
+{
+
+class IBoneSceneNode;
+
+//! How an animation layer is combined with the layers below it
+enum E_ANIMATION_LAYER_MODE
+{
+	//! Blend towards the layer by its weight
+	EALM_OVERRIDE = 0,
+
+	//! Add the difference of the layer to its reference frame
+	EALM_ADDITIVE
+};
+
+//! Animation played on top of the base frame of a SkinnedMeshInstance
+struct SAnimationLayer
+{
+	SAnimationLayer() :
+			Frame(0.f), Weight(1.f), Mode(EALM_OVERRIDE), ReferenceFrame(0.f),
+			RotationBlend(SkinnedMesh::ERB_NLERP) {}
+
+	//! Frame of the mesh animation sampled by the layer
+	f32 Frame;
+
+	//! Influence of the layer, 0 disables it
+	f32 Weight;
+
+	E_ANIMATION_LAYER_MODE Mode;
+
+	//! Frame the differences of an additive layer are taken to
+	f32 ReferenceFrame;
+
+	//! Optional weight per joint multiplied with Weight, indexed like
+	//! the joints of the mesh. Missing entries count as 1.
+	std::vector<f32> Mask;
+
+	//! Interpolation of the rotations of an override layer
+	SkinnedMesh::E_ROTATION_BLEND RotationBlend;
+};
+
+//! Pose and skinned mesh buffers of one user of a shared SkinnedMesh
+/** The mesh keeps everything which doesn't change while animating: the rest
+pose, the weights and the keyframes. Each instance owns a pose and copies of
+the mesh buffers changed by skinning, the other buffers share their vertices
+with the mesh. So any amount of scene nodes can play different frames of the
+same mesh, and instances can be skinned in parallel.
+
+Without layers and transitions the pose is animated straight into matrices.
+Otherwise the joints are sampled into position, rotation and scale arrays,
+blended there and turned into matrices once, so bone scene nodes are never
+involved. */
+class SkinnedMeshInstance : public IMesh
+{
+public:
+	//! constructor
+	SkinnedMeshInstance(SkinnedMesh *mesh);
+
+	//! destructor
+	virtual ~SkinnedMeshInstance();
+
+	//! Returns the shared mesh
+	SkinnedMesh *getSkinnedMesh() const { return Mesh; }
+
+	//! Animates the joints of the pose based on frame input
+	/** The frame is the base of the layers and the target of a transition. */
+	void animate(f32 frame);
+
+	//! Adds a layer blended over the base frame, in the order of adding
+	/** \return Index of the layer. */
+	u32 addLayer(const SAnimationLayer &layer = SAnimationLayer());
+
+	//! Returns a layer to change its frame, weight or mask
+	SAnimationLayer &getLayer(u32 index) { return Layers[index]; }
+
+	u32 getLayerCount() const { return Layers.size(); }
+
+	void removeLayer(u32 index);
+
+	void clearLayers();
+
+	//! Starts a transition from the current pose
+	/** The following animated poses are blended from the current one
+	towards the animated one by setTransitionBlend(). */
+	void beginTransition();
+
+	//! Sets the progress of a transition, 0 is the start and 1 ends it
+	void setTransitionBlend(f32 blend);
+
+	//! Returns true while a transition is blended
+	bool isTransiting() const { return Transiting; }
+
+	//! Skins the mesh buffers of the instance for the current pose
+	void skin();
+
+	//! Updates the joint matrices and the bounding box, but not the vertices
+	/** Used instead of skin() while the instance isn't visible, see
+	SkinnedMesh::boundPose(). */
+	void bound();
+
+	//! Returns the pose of this instance
+	SkinnedMesh::SPose &getPose() { return Pose; }
+
+	//! Returns the pose of this instance
+	const SkinnedMesh::SPose &getPose() const { return Pose; }
+
+	//! Returns the joint matrices of the pose, for hardware skinning
+	const std::vector<core::matrix4> &getSkinningMatrices() const
+	{
+		return Pose.SkinningMatrices;
+	}
+
+	//! Sets bone scene nodes to the local matrices of the pose
+	void recoverJoints(std::vector<IBoneSceneNode *> &jointChildSceneNodes) const;
+
+	//! Sets the local matrices of the pose to bone scene nodes
+	void transferJoints(const std::vector<IBoneSceneNode *> &jointChildSceneNodes);
+
+	//! returns amount of mesh buffers.
+	u32 getMeshBufferCount() const override;
+
+	//! returns pointer to a mesh buffer
+	IMeshBuffer *getMeshBuffer(u32 nr) const override;
+
+	//! Returns pointer to a mesh buffer which fits a material
+	IMeshBuffer *getMeshBuffer(const video::SMaterial &material) const override;
+
+	u32 getTextureSlot(u32 meshbufNr) const override;
+
+	//! returns an axis aligned bounding box
+	const core::aabbox3d<f32> &getBoundingBox() const override
+	{
+		return BoundingBox;
+	}
+
+	//! set user axis aligned bounding box
+	void setBoundingBox(const core::aabbox3df &box) override
+	{
+		BoundingBox = box;
+	}
+
+	//! set the hardware mapping hint, for driver
+	void setHardwareMappingHint(E_HARDWARE_MAPPING newMappingHint, u8 buffer = EBF_VERTEX | EBF_INDEX) override;
+
+	//! flags the meshbuffer as changed, reloads hardware buffers
+	void setDirty(u8 buffer = EBF_VERTEX | EBF_INDEX) override;
+
+private:
+	//! Creates the mesh buffers from the current ones of the mesh
+	void createBuffers();
+
+	void dropBuffers();
+
+	//! Recreates the buffers if the vertices of the mesh were changed
+	void checkRevision();
+
+	//! Animates the pose through the transforms, for layers and transitions
+	void blendPose(f32 frame);
+
+	//! Internal state of a layer
+	struct SLayerState
+	{
+		std::vector<u32> Cursors;
+
+		//! Sampled reference of an additive layer
+		SkinnedMesh::SJointTransforms Reference;
+		f32 ReferenceFrame = -1.f;
+	};
+
+	SkinnedMesh *Mesh;
+	SkinnedMesh::SPose Pose;
+
+	std::vector<SAnimationLayer> Layers;
+	std::vector<SLayerState> LayerStates;
+
+	//! Blended transforms of the pose and the sampled ones of a layer
+	SkinnedMesh::SJointTransforms Transforms;
+	SkinnedMesh::SJointTransforms LayerTransforms;
+
+	//! Transforms the transition starts from
+	SkinnedMesh::SJointTransforms TransitionStart;
+	f32 TransitionBlend;
+	bool Transiting;
+
+	//! Transforms are the source of the local matrices of the pose
+	bool TransformsValid;
+
+	//! Base frame of the last animated pose
+	f32 Frame;
+
+	std::vector<SSkinMeshBuffer *> Buffers;
+	core::aabbox3d<f32> BoundingBox{{0, 0, 0}};
+
+	//! Revision of the mesh the buffers were created from
+	u32 Revision;
+};
+
+} // end namespace scene
@@ -0,0 +1,153 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Utils/IReferenceCounted.h"
+#include "Utils/aabbox3d.h"
+#include "Utils/line3d.h"
+#include "Mesh/IMesh.h"
+
+#include <atomic>
+#include <vector>
+
+namespace scene
+{
+
+//! Bounding volume hierarchy over the triangles of a mesh
+/** Answers ray casts and box and sphere overlap queries without testing
+every triangle. The hierarchy is built with the surface area heuristic,
+large meshes in parallel on the job system. It is a snapshot of the
+positions at construction, build a new one after changing the mesh.
+Queries are const and can run on several threads at once. */
+class TriangleBVH : public virtual IReferenceCounted
+{
+public:
+	//! Node of the hierarchy, two share a cache line
+	struct SNode
+	{
+		//! Minimum of the bounding box of the triangles below
+		f32 Min[3];
+
+		//! First triangle of a leaf, or first child of an inner node.
+		/** The second child directly follows the first one. */
+		u32 Offset;
+
+		//! Maximum of the bounding box of the triangles below
+		f32 Max[3];
+
+		//! Amount of triangles of a leaf, 0 for inner nodes
+		u16 Count;
+
+		//! Axis an inner node is split along, to visit the nearer child first
+		u16 Axis;
+
+		bool isLeaf() const { return Count != 0; }
+	};
+
+	//! Triangle hit by a ray
+	struct SHit
+	{
+		//! Position along the ray, 0 at its start and 1 at its end
+		f32 Fraction = 1.f;
+
+		//! Point hit
+		core::vector3df Point;
+
+		//! Index of the triangle, see getTriangle()
+		u32 Triangle = 0;
+	};
+
+	//! Builds the hierarchy over the triangles of a mesh.
+	/** Only mesh buffers of triangle lists are used. Skinned meshes are
+	used in their current pose. */
+	TriangleBVH(const IMesh *mesh);
+
+	//! Returns the amount of triangles
+	u32 getTriangleCount() const { return (u32)Sources.size(); }
+
+	//! Returns the three corners of a triangle
+	const core::vector3df *getTriangle(u32 i) const { return &Positions[i * 3]; }
+
+	//! Returns the mesh buffer of a triangle and its first index in it
+	void getTriangleSource(u32 i, u32 &meshBuffer, u32 &firstIndex) const
+	{
+		meshBuffer = Sources[i].MeshBuffer;
+		firstIndex = Sources[i].FirstIndex;
+	}
+
+	//! Returns the nodes, the root first
+	const std::vector<SNode> &getNodes() const { return Nodes; }
+
+	//! Returns the bounding box of all triangles
+	const core::aabbox3df &getBoundingBox() const { return BoundingBox; }
+
+	//! Finds the triangle hit first by a ray.
+	/** Triangles are hit from both sides.
+	\param ray Ray to cast, only the part from its start to its end is tested.
+	\param hit Receives the hit.
+	\return True if a triangle was hit. */
+	bool getClosestHit(const core::line3df &ray, SHit &hit) const;
+
+	//! Returns true if a ray hits any triangle.
+	/** Stops at the first triangle found, cheaper than getClosestHit(),
+	e.g. for line of sight tests. */
+	bool hasHit(const core::line3df &ray) const;
+
+	//! Appends the indices of the triangles intersecting a box
+	void getTrianglesInBox(const core::aabbox3df &box, std::vector<u32> &triangles) const;
+
+	//! Appends the indices of the triangles intersecting a sphere
+	void getTrianglesInSphere(const core::vector3df &center, f32 radius, std::vector<u32> &triangles) const;
+
+	//! Returns true if any triangle intersects a box
+	bool intersectsBox(const core::aabbox3df &box) const;
+
+	//! Returns true if any triangle intersects a sphere
+	bool intersectsSphere(const core::vector3df &center, f32 radius) const;
+
+	//! Tests a ray against a triangle, from both sides.
+	/** \param fraction Receives the position of the hit along the ray. */
+	static bool rayIntersectsTriangle(const core::line3df &ray, const core::vector3df *triangle, f32 &fraction);
+
+	//! Tests a ray against a box.
+	/** \param fraction Receives the position along the ray where it enters
+	the box, 0 if it starts inside. */
+	static bool rayIntersectsBox(const core::line3df &ray, const core::aabbox3df &box, f32 &fraction);
+
+	//! Tests a box against a triangle with the separating axis theorem
+	static bool boxIntersectsTriangle(const core::aabbox3df &box, const core::vector3df *triangle);
+
+	//! Tests a sphere against a triangle
+	static bool sphereIntersectsTriangle(const core::vector3df &center, f32 radius, const core::vector3df *triangle);
+
+private:
+	//! Bounding box and centroid of each triangle, only needed while building
+	struct SBuildData;
+
+	//! Builds the subtree of node over the triangles [begin, end) of the build order
+	void build(SBuildData &data, u32 node, u32 begin, u32 end, u32 depth);
+
+	//! Calls triangleTest for the triangles of the leaves passing nodeTest
+	/** \return True if stopped by triangleTest returning true. */
+	template <class NodeTest, class TriangleTest>
+	bool findTriangles(const NodeTest &nodeTest, const TriangleTest &triangleTest) const;
+
+	struct STriangleSource
+	{
+		u32 MeshBuffer;
+		u32 FirstIndex;
+	};
+
+	//! Three corners per triangle, in the order of the leaves
+	std::vector<core::vector3df> Positions;
+	std::vector<STriangleSource> Sources;
+
+	std::vector<SNode> Nodes;
+	std::atomic<u32> NodeCount{0};
+
+	core::aabbox3df BoundingBox{{0, 0, 0}};
+};
+
+} // end namespace scene
@@ -12,6 +12,8 @@ struct VertexAttribute
 		FLOAT,
 		UBYTE,
 		INT,
+		SHORT,
+		HALF_FLOAT,
 		COUNT
 	};
 	enum class Mode : u8
@@ -33,6 +33,10 @@ enum E_VERTEX_TYPE
 
 	//! 3D vertex with additional vec3 atrribute
 	EVT_3D_EXT,
+
+	//! 3D vertex with joint indices and weights
+	/** Used by hardware skinned meshes, see SkinnedMesh::setHardwareSkinning(). */
+	EVT_SKINNED,
 };
 
 //! 3D vertex
@@ -114,9 +118,81 @@ struct Vertex3DExt : public Vertex3D
 	static E_VERTEX_TYPE getType() { return EVT_3D_EXT; }
 };
 
+//! 3D vertex skinned by the shaders
+/** Up to 4 joints influence the vertex, unused ones have a weight of 0. */
+struct VertexSkinned : public Vertex3D
+{
+	//! Indices of the joints in the joint palette
+	u8 Joints[4] = {0, 0, 0, 0};
+
+	//! Weights of the joints, summing up to 1
+	f32 Weights[4] = {0.f, 0.f, 0.f, 0.f};
+
+	static const VertexDescriptor FORMAT;
+
+	static E_VERTEX_TYPE getType() { return EVT_SKINNED; }
+};
+
+//! Vertex of type EVT_3D as uploaded by a quantized vertex buffer
+/** Takes 20 instead of 36 bytes. See IVertexBuffer::setQuantized().
+- Positions are normalized 16 bit integers in -1..1 covering the bounding
+  box of the buffer, position = offset + scale * inPosition.
+- Normals, tangents and binormals are unit vectors in octahedral encoding,
+  two normalized 16 bit integers. They are decoded in the shader with
+  n = vec3(e, 1 - abs(e.x) - abs(e.y)); t = max(-n.z, 0);
+  n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0))); normalize(n).
+- Texture coordinates are half floats. */
+struct Vertex3DQuantized
+{
+	//! Position, the fourth component is padding
+	s16 Pos[4];
+
+	s16 Normal[2];
+
+	video::SColor Color{0xffffffff};
+
+	u16 TCoords[2];
+
+	static const VertexDescriptor FORMAT;
+};
+
+//! Vertex of type EVT_2TCOORDS as uploaded by a quantized vertex buffer
+/** Takes 24 instead of 44 bytes. */
+struct Vertex2TCoordsQuantized : public Vertex3DQuantized
+{
+	u16 TCoords2[2];
+
+	static const VertexDescriptor FORMAT;
+};
+
+//! Vertex of type EVT_TANGENTS as uploaded by a quantized vertex buffer
+/** Takes 28 instead of 60 bytes. */
+struct VertexTangentsQuantized : public Vertex3DQuantized
+{
+	s16 Tangent[2];
+
+	s16 Binormal[2];
+
+	static const VertexDescriptor FORMAT;
+};
+
 const VertexDescriptor &getVertexTypeDescription(E_VERTEX_TYPE type);
 u32 getVertexTypeSize(E_VERTEX_TYPE type);
 
+//! Returns the layout of quantized vertices of a type, null if the type can't be quantized
+const VertexDescriptor *getQuantizedVertexTypeDescription(E_VERTEX_TYPE type);
+
+//! Converts vertices into their quantized layout
+/** \param type Type of the vertices, see getQuantizedVertexTypeDescription().
+\param vertices Vertices to convert.
+\param count Amount of vertices.
+\param out Receives the quantized vertices.
+\param scale Receives the scale decoding the positions.
+\param offset Receives the offset decoding the positions.
+\return False if the type can't be quantized. */
+bool quantizeVertices(E_VERTEX_TYPE type, const void *vertices, u32 count,
+		std::vector<u8> &out, core::vector3df &scale, core::vector3df &offset);
+
 bool operator==(const Vertex3D &a, const Vertex3D &b);
 bool operator<(const Vertex3D &a, const Vertex3D &b);
 
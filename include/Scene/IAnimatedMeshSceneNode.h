@@ -8,6 +8,8 @@
 #include "Scene/IBoneSceneNode.h"
 #include "Mesh/IAnimatedMesh.h"
 
+#include <vector>
+
 
 namespace scene
 {
@@ -24,6 +26,32 @@ enum E_JOINT_UPDATE_ON_RENDER
 };
 
 class IAnimatedMeshSceneNode;
+class SkinnedMeshInstance;
+
+//! Animation level of detail of a skinned mesh scene node
+/** Reduces the cost of characters which are small on screen or not visible
+at all. The updates done and skipped are counted in video::SFrameStats. */
+struct SAnimationLOD
+{
+	//! Screen sizes below which the update interval doubles
+	/** The screen size is the radius of the bounding sphere divided by half
+	the height of the view at its distance, so 1 roughly fills the screen.
+	E.g. {0.25f, 0.1f} animates above 0.25 every frame, down to 0.1 every
+	second frame and below every fourth frame. Must be descending, empty
+	animates every frame. */
+	std::vector<f32> ScreenSizes;
+
+	//! Neither animate nor skin the mesh while the node is culled
+	/** Only the joint matrices are updated to move the bounding box
+	conservatively, so the node becomes visible again in time. */
+	bool SkipCulled = true;
+
+	//! Animate the joints on frames skipped by ScreenSizes
+	/** Only skinning is skipped then. Hardware skinned meshes stay fully
+	animated, as the shaders move their vertices, and attached nodes keep
+	following the joints. */
+	bool InterpolateSkipped = false;
+};
 
 //! Callback interface for catching events of ended animations.
 /** Implement this interface and use
@@ -144,15 +172,27 @@ public:
 	virtual void setJointMode(E_JOINT_UPDATE_ON_RENDER mode) = 0;
 
 	//! Sets the transition time in seconds
-	/** Note: This needs to enable joints, and setJointmode set to
-	EJUOR_CONTROL. You must call animateJoints(), or the mesh will
-	not animate. */
+	/** Jumping to another frame with setCurrentFrame() afterwards blends
+	from the previous pose to the new one during this time. The blending
+	happens in the pose of the skinned mesh, no joint nodes are needed. */
 	virtual void setTransitionTime(f32 Time) = 0;
 
 	//! animates the joints in the mesh based on the current frame.
-	/** Also takes in to account transitions. */
+	/** Also takes in to account transitions and animation layers. Only
+	needed to read the joint nodes before the node is rendered. */
 	virtual void animateJoints(bool CalculateAbsolutePositions = true) = 0;
 
+	//! Sets the animation level of detail of skinned meshes
+	virtual void setAnimationLOD(const SAnimationLOD &lod) = 0;
+
+	//! Returns the animation level of detail
+	virtual const SAnimationLOD &getAnimationLOD() const = 0;
+
+	//! Returns the pose of this node, if the mesh is a skinned mesh
+	/** Used to blend animation layers over the current frame. Returns 0
+	for other meshes. */
+	virtual SkinnedMeshInstance *getMeshInstance() = 0;
+
 	//! render mesh ignoring its transformation.
 	/** Culling is unaffected. */
 	virtual void setRenderFromIdentity(bool On) = 0;
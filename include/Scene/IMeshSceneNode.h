@@ -43,6 +43,49 @@ public:
 	/** This flag can be set by setSharedMaterials().
 	\return Whether the materials are shared. */
 	virtual bool isSharedMaterials() const = 0;
+
+	//! Adds a less detailed level to display when the node is small on screen.
+	/** The level is picked when the node is registered for rendering, from
+	the size of its bounding sphere projected by the active camera. The mesh
+	set with setMesh() is level 0, the most detailed one. Setting another
+	mesh removes the levels.
+	\param mesh Mesh with the same mesh buffers as the mesh of the node,
+	e.g. created with MeshManipulator::createSimplifiedMesh(). The materials
+	of the node are used for it.
+	\param screenSize The level is displayed while the node covers less
+	than this fraction of the height of the screen. Has to be smaller than
+	the one of the previous level.
+	\return False if the mesh can't be used as a level. */
+	virtual bool addLODLevel(IMesh *mesh, f32 screenSize) = 0;
+
+	//! Creates levels of detail from the mesh of the node.
+	/** Uses MeshManipulator::createLODChain(). The screen size of each
+	level after the first is the one of the previous level times the
+	square root of the ratio, so the size of the triangles on screen stays
+	about the same.
+	\param levels Amount of levels to create.
+	\param ratio Amount of triangles of each level relative to the previous one.
+	\param screenSize Screen size of the first level, see addLODLevel().
+	\return Amount of levels created. */
+	virtual u32 generateLODLevels(u32 levels, f32 ratio = 0.5f, f32 screenSize = 0.5f) = 0;
+
+	//! Removes all levels of detail, the mesh is always displayed.
+	virtual void clearLODLevels() = 0;
+
+	//! Get the amount of levels of detail, including the mesh of the node.
+	virtual u32 getLODLevelCount() const = 0;
+
+	//! Get the level of detail displayed, 0 for the mesh of the node.
+	virtual u32 getCurrentLODLevel() const = 0;
+
+	//! Sets how far the screen size has to pass the size of a level before switching.
+	/** Avoids switching back and forth when the node stays around the
+	screen size of a level.
+	\param hysteresis Fraction of the screen size of the level, 0.1 by default. */
+	virtual void setLODHysteresis(f32 hysteresis) = 0;
+
+	//! Get how far the screen size has to pass the size of a level before switching.
+	virtual f32 getLODHysteresis() const = 0;
 };
 
 } // end namespace scene
@@ -7,13 +7,44 @@
 #include "Utils/IReferenceCounted.h"
 #include "Utils/position2d.h"
 #include "Utils/line3d.h"
+#include "Utils/aabbox3d.h"
 
+#include <vector>
 
 
 namespace scene
 {
 class ICameraSceneNode;
+class ISceneNode;
+class IMesh;
+class TriangleBVH;
 
+//! Triangle of the scene hit by a ray
+struct SCollisionHit
+{
+	//! Scene node the triangle belongs to
+	ISceneNode *Node = nullptr;
+
+	//! Point hit, in world space
+	core::vector3df Point;
+
+	//! Corners of the triangle, in world space
+	core::vector3df Triangle[3];
+
+	//! Position along the ray, 0 at its start and 1 at its end
+	f32 Fraction = 1.f;
+
+	//! Mesh buffer of the triangle and its first index in it
+	u32 MeshBuffer = 0;
+	u32 FirstIndex = 0;
+};
+
+//! Queries the geometry of the scene
+/** Mesh scene nodes are tested against their triangles, using a
+TriangleBVH per mesh which is built the first time the mesh is queried.
+Nodes whose bounding boxes miss the query are skipped before that. The
+queries descend from a root node, skipping invisible subtrees. Nodes are
+tested if idBitMask is 0 or their id has any of its bits set. */
 class ISceneCollisionManager : public virtual IReferenceCounted
 {
 public:
@@ -26,6 +57,51 @@ public:
 	would be behind the 2d screen coordinates. */
 	virtual core::line3d<f32> getRayFromScreenCoordinates(
 			const core::position2d<s32> &pos, const ICameraSceneNode *camera = 0) = 0;
+
+	//! Returns the bounding volume hierarchy of a mesh, building it on first use.
+	/** The hierarchy is kept until removeTriangleBVH() or clearTriangleBVHs(),
+	remove it after changing the mesh.
+	\return The hierarchy, valid until it is removed. */
+	virtual const TriangleBVH *getTriangleBVH(IMesh *mesh) = 0;
+
+	//! Removes the hierarchy of a mesh, it is built again on the next query.
+	virtual void removeTriangleBVH(IMesh *mesh) = 0;
+
+	//! Removes the hierarchies of all meshes.
+	virtual void clearTriangleBVHs() = 0;
+
+	//! Finds the scene node triangle hit first by a ray.
+	/** Triangles are hit from both sides. Only static mesh scene nodes are
+	tested. Nodes merged by ISceneManager::batchStaticGeometry() are found
+	instead of the merged geometry.
+	\param ray Ray in world space, only the part from its start to its end is tested.
+	\param hit Receives the hit.
+	\param idBitMask Only nodes with an id sharing a bit with it are tested, 0 for all.
+	\param root Subtree to test, the whole scene if null.
+	\param noDebugObjects Skips debug objects.
+	\return The scene node hit, or null. */
+	virtual ISceneNode *getSceneNodeAndCollisionPointFromRay(const core::line3df &ray,
+			SCollisionHit &hit, s32 idBitMask = 0, ISceneNode *root = 0,
+			bool noDebugObjects = false) = 0;
+
+	//! Returns true if a ray hits any triangle of the scene.
+	/** Stops at the first triangle found, e.g. for line of sight tests.
+	See getSceneNodeAndCollisionPointFromRay() for the parameters. */
+	virtual bool isRayObstructed(const core::line3df &ray, s32 idBitMask = 0,
+			ISceneNode *root = 0, bool noDebugObjects = false) = 0;
+
+	//! Appends the scene nodes with triangles intersecting a box.
+	/** \param box Box in world space.
+	See getSceneNodeAndCollisionPointFromRay() for the other parameters. */
+	virtual void getSceneNodesInBox(const core::aabbox3df &box, std::vector<ISceneNode *> &nodes,
+			s32 idBitMask = 0, ISceneNode *root = 0, bool noDebugObjects = false) = 0;
+
+	//! Appends the scene nodes with triangles intersecting a sphere.
+	/** \param center Center of the sphere in world space.
+	See getSceneNodeAndCollisionPointFromRay() for the other parameters. */
+	virtual void getSceneNodesInSphere(const core::vector3df &center, f32 radius,
+			std::vector<ISceneNode *> &nodes, s32 idBitMask = 0, ISceneNode *root = 0,
+			bool noDebugObjects = false) = 0;
 };
 
 } // end namespace scene
@@ -8,9 +8,13 @@
 #include "Utils/irrArray.h"
 #include "Utils/vector3d.h"
 #include "Utils/dimension2d.h"
+#include "Utils/path.h"
 #include "Image/SColor.h"
 #include "Enums/ESceneNodeTypes.h"
 
+#include <functional>
+#include <vector>
+
 
 struct SKeyMap;
 struct SEvent;
@@ -126,6 +130,45 @@ public:
 	 **/
 	virtual IAnimatedMesh *getMesh(io::IReadFile *file) = 0;
 
+	//! Like getMesh(), but keeps a converted copy of the mesh in a cache directory
+	/** The copy is stored in a binary format named after a hash of the
+	contents of the file, so changed files are converted again. Loading the
+	copy only reads the arrays of the mesh instead of parsing the file.
+	Copies written by other engine versions are replaced. Converted meshes
+	are optimized with MeshManipulator::optimizeForGPU() before storing them.
+	\param file File handle of the mesh to load.
+	\param cacheDirectory Existing directory receiving the converted copies.
+	\return Null if failed, otherwise pointer to the mesh.
+	This pointer should not be dropped. See IReferenceCounted::drop() for more information. */
+	virtual IAnimatedMesh *getCachedMesh(io::IReadFile *file, const io::path &cacheDirectory) = 0;
+
+	//! Loads a mesh on the worker threads of the job system.
+	/** The file is read on the calling thread and parsed on a worker if
+	the loader for it is reentrant (see IMeshLoader::isReentrant()), other
+	files are loaded on the calling thread by finishMeshLoads(). Meshes
+	already in the mesh cache don't load again.
+	\param file File handle of the mesh to load, may be dropped after the call.
+	\param onLoaded Called by finishMeshLoads() with the mesh, which is in
+	the mesh cache by then, or with null if loading failed. The mesh should
+	not be dropped. */
+	virtual void getMeshAsync(io::IReadFile *file, std::function<void(IAnimatedMesh *mesh)> onLoaded) = 0;
+
+	//! Finishes the loads started by getMeshAsync().
+	/** Adds the parsed meshes to the mesh cache and calls their callbacks.
+	Call it on the thread which started the loads, e.g. once per frame.
+	\param wait If true, waits for all loads instead of only finishing the
+	ones which are parsed already.
+	\return Amount of loads still running. */
+	virtual u32 finishMeshLoads(bool wait = false) = 0;
+
+	//! Loads several meshes at once and waits for them.
+	/** Like getMesh() for each file, but parses them in parallel with
+	getMeshAsync(). Finishes all other pending loads too.
+	\param files File handles of the meshes to load.
+	\return The meshes in the order of the files, null for failed ones.
+	The pointers should not be dropped. */
+	virtual std::vector<IAnimatedMesh *> getMeshes(const std::vector<io::IReadFile *> &files) = 0;
+
 	//! Get interface to the mesh cache which is shared between all existing scene managers.
 	/** With this interface, it is possible to manually add new loaded
 	meshes (if ISceneManager::getMesh() is not sufficient), to remove them and to iterate
@@ -235,6 +278,34 @@ public:
 	virtual IDummyTransformationSceneNode *addDummyTransformationSceneNode(
 			ISceneNode *parent = 0, s32 id = -1) = 0;
 
+	//! Merges the static mesh scene nodes of a subtree into few large mesh buffers.
+	/** Level geometry made of many mesh scene nodes with the same few materials
+	is drawn with a fraction of the draw calls. Visible mesh scene nodes of
+	static meshes without levels of detail are batched, if all their children
+	are batched, too. Nodes with transparent materials are skipped, as their
+	buffers are sorted by distance one by one. Nodes below nodes which may move, like animated mesh
+	scene nodes, their joints and cameras, are skipped. The mesh buffers are
+	transformed into world space and merged per material, see
+	MeshManipulator::createBatchedMesh(). The merged buffers are split into
+	cubic chunks, each drawn by a mesh scene node of its own, so they are
+	still culled.
+	The batched nodes are removed from the scene, but kept alive by the batch
+	until unbatchStaticGeometry() restores them. Changes to them don't affect
+	the batch.
+	\param root Subtree to batch, including the node itself. Null for the whole scene.
+	\param chunkSize Edge length of the chunks in world units, 0 for a single chunk.
+	\param id Id of the batch node.
+	\return The scene node holding the batch, added to the root scene node, or
+	null if no node could be batched.
+	This pointer should not be dropped. See IReferenceCounted::drop() for more information. */
+	virtual ISceneNode *batchStaticGeometry(ISceneNode *root = 0, f32 chunkSize = 0.f, s32 id = -1) = 0;
+
+	//! Restores the scene nodes batched by batchStaticGeometry() and removes the batch.
+	/** E.g. for editors, to change the batched nodes and batch them again.
+	\param batch Scene node returned by batchStaticGeometry().
+	\return False if the node isn't a batch. */
+	virtual bool unbatchStaticGeometry(ISceneNode *batch) = 0;
+
 	//! Gets the root scene node.
 	/** This is the scene node which is parent
 	of all scene nodes. The root scene node is a special scene node which
@@ -309,6 +380,25 @@ public:
 	virtual u32 registerNodeForRendering(ISceneNode *node,
 			E_SCENE_NODE_RENDER_PASS pass = ESNRP_AUTOMATIC) = 0;
 
+	//! Registers a single mesh buffer of a node for one of the transparent render passes.
+	/** Transparent buffers registered like this are sorted by their own
+	distance to the camera instead of the one of the whole node. The render()
+	method of the node is called once per registered buffer, it has to draw only
+	the buffer returned by getRenderedMeshBuffer() then. No culling is done here,
+	the node should check isCulled() once before registering its buffers.
+	\param node: Node owning the mesh buffer.
+	\param buffer: Index of the mesh buffer in the node's mesh.
+	\param center: Center of the mesh buffer in world space.
+	\param pass: ESNRP_TRANSPARENT or ESNRP_TRANSPARENT_EFFECT. */
+	virtual void registerMeshBufferForRendering(ISceneNode *node, u32 buffer,
+			const core::vector3df &center, E_SCENE_NODE_RENDER_PASS pass = ESNRP_TRANSPARENT) = 0;
+
+	//! Returns the mesh buffer the node currently rendered has to draw.
+	/** \return Index of the mesh buffer registered with
+	registerMeshBufferForRendering(), or -1 if the node registered itself as a
+	whole and has to draw all buffers of the current render pass. */
+	virtual s32 getRenderedMeshBuffer() const = 0;
+
 	//! Clear all nodes which are currently registered for rendering
 	/** Usually you don't have to care about this as drawAll will clear nodes
 	after rendering them. But sometimes you might have to manually reset this.
@@ -322,6 +412,22 @@ public:
 	by existing scene node animators, culling of scene nodes is done, etc. */
 	virtual void drawAll() = 0;
 
+	//! Enables running the animation and registration passes of drawAll() on several threads.
+	/** The subtrees below the root scene node are distributed over the
+	workers of the job system (see os::JobSystem), each registering its nodes
+	into its own render lists. These are merged in the order of the subtrees,
+	so the render order is the same as single threaded. Skinning of the
+	visible animated meshes is also done in parallel before rendering.
+	When enabled, OnAnimate() and OnRegisterSceneNode() of a node must not
+	modify nodes outside of its own subtree. Use addToDeletionQueue() for
+	removing nodes.
+	\param enable True to run the passes in parallel, false for the default
+	single threaded traversal. */
+	virtual void setParallelSceneUpdate(bool enable) = 0;
+
+	//! Returns if the animation and registration passes are run in parallel.
+	virtual bool isParallelSceneUpdateEnabled() const = 0;
+
 	//! Adds an external mesh loader for extending the engine with new file formats.
 	/** If you want the engine to be extended with
 	file formats it currently is not able to load (e.g. .cob), just implement
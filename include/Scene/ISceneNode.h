@@ -10,10 +10,11 @@
 #include "Enums/EDebugSceneTypes.h"
 #include "Video/SMaterial.h"
 #include "Utils/irrArray.h"
+#include "Utils/irrSmallArray.h"
 #include "Utils/aabbox3d.h"
 #include "Utils/matrix4.h"
+#include "Scene/SceneNodeAllocator.h"
 
-#include <list>
 #include <optional>
 #include <string>
 #include <cassert>
@@ -25,7 +26,9 @@ class ISceneNode;
 class ISceneManager;
 
 //! Typedef for list of scene nodes
-typedef std::list<ISceneNode *> ISceneNodeList;
+/** Most nodes only have a handful of children, these are stored inline in the
+node itself without an allocation per child. */
+typedef core::small_array<ISceneNode *, 4> ISceneNodeList;
 
 //! Scene node interface.
 /** A scene node is a node in the hierarchical scene graph. Every scene
@@ -79,9 +82,9 @@ public:
 	virtual void OnRegisterSceneNode()
 	{
 		if (IsVisible) {
-			ISceneNodeList::iterator it = Children.begin();
-			for (; it != Children.end(); ++it)
-				(*it)->OnRegisterSceneNode();
+			// indexed, since children may add further children meanwhile
+			for (u32 i = 0; i < Children.size(); ++i)
+				Children[i]->OnRegisterSceneNode();
 		}
 	}
 
@@ -99,9 +102,8 @@ public:
 
 			// perform the post render process on all children
 
-			ISceneNodeList::iterator it = Children.begin();
-			for (; it != Children.end(); ++it)
-				(*it)->OnAnimate(timeMs);
+			for (u32 i = 0; i < Children.size(); ++i)
+				Children[i]->OnAnimate(timeMs);
 		}
 	}
 
@@ -251,8 +253,9 @@ public:
 
 			child->grab();
 			child->remove(); // remove from old parent
-			// Note: This iterator is not invalidated until we erase it.
-			child->ThisIterator = Children.insert(Children.end(), child);
+			child->ThisIndex = Children.size();
+			if (Children.push_back(child))
+				noteChildListAllocation();
 			child->Parent = this;
 		}
 	}
@@ -267,13 +270,22 @@ public:
 		if (child->Parent != this)
 			return false;
 
-		// The iterator must be set since the parent is not null.
-		assert(child->ThisIterator.has_value());
-		auto it = *child->ThisIterator;
-		child->ThisIterator = std::nullopt;
+		// The index must be set since the parent is not null.
+		assert(child->ThisIndex.has_value());
+		u32 index = *child->ThisIndex;
+		assert(Children[index] == child);
+		child->ThisIndex = std::nullopt;
 		child->Parent = nullptr;
+
+		// the last child takes the free slot, the order isn't kept
+		const u32 last = Children.size() - 1;
+		if (index != last) {
+			Children[index] = Children[last];
+			Children[index]->ThisIndex = index;
+		}
+		Children.erase(last);
+
 		child->drop();
-		Children.erase(it);
 		return true;
 	}
 
@@ -285,7 +297,7 @@ public:
 	{
 		for (auto &child : Children) {
 			child->Parent = nullptr;
-			child->ThisIterator = std::nullopt;
+			child->ThisIndex = std::nullopt;
 			child->drop();
 		}
 		Children.clear();
@@ -454,8 +466,9 @@ public:
 	}
 
 	//! Returns a const reference to the list of all children.
-	/** \return The list of all children of this node. */
-	const std::list<ISceneNode *> &getChildren() const
+	/** Removing a child moves the last one to its place.
+	\return The list of all children of this node. */
+	const ISceneNodeList &getChildren() const
 	{
 		return Children;
 	}
@@ -570,10 +583,10 @@ protected:
 	core::vector3df RelativeScale;
 
 	//! List of all children of this node
-	std::list<ISceneNode *> Children;
+	ISceneNodeList Children;
 
-	//! Iterator pointing to this node in the parent's child list.
-	std::optional<ISceneNodeList::iterator> ThisIterator;
+	//! Index of this node in the parent's child list.
+	std::optional<u32> ThisIndex;
 
 	//! Pointer to the parent
 	ISceneNode *Parent;
@@ -0,0 +1,52 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Utils/irrTypes.h"
+
+
+namespace scene
+{
+
+//! Counters of the memory traffic caused by creating and removing scene nodes.
+/** The built-in scene nodes are allocated from type segregated pools which
+grow in chunks and never give memory back while in use. In a steady state
+(e.g. spawning and removing projectiles every frame) only PoolAllocations and
+PoolDeallocations should keep increasing, while PoolChunkAllocations,
+HeapNodeAllocations and ChildListAllocations stay constant. */
+struct SSceneNodeAllocationStats
+{
+	//! Nodes taken from a pool.
+	u32 PoolAllocations = 0;
+
+	//! Nodes given back to a pool.
+	u32 PoolDeallocations = 0;
+
+	//! Chunks of node memory requested from the heap by the pools.
+	u32 PoolChunkAllocations = 0;
+
+	//! Nodes of classes derived from a built-in node which had to be put on the heap.
+	u32 HeapNodeAllocations = 0;
+
+	//! Child lists which outgrew their inline storage and went to the heap.
+	u32 ChildListAllocations = 0;
+
+	//! Returns the amount of pooled nodes currently alive.
+	u32 getLivePoolNodes() const
+	{
+		return PoolAllocations - PoolDeallocations;
+	}
+};
+
+//! Returns the allocation counters accumulated since start or the last reset.
+SSceneNodeAllocationStats getSceneNodeAllocationStats();
+
+//! Resets all the allocation counters to zero.
+void resetSceneNodeAllocationStats();
+
+//! Called by the scene nodes when their child list had to grow on the heap.
+void noteChildListAllocation();
+
+} // end namespace scene
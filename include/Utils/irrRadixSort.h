@@ -0,0 +1,78 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "Utils/irrTypes.h"
+
+
+namespace core
+{
+
+//! Entry sorted by radixSort(), a packed key and the index of the sorted item.
+struct SRadixSortEntry
+{
+	u64 Key;
+	u32 Index;
+};
+
+//! Sorts entries ascending by key with a stable LSD radix sort.
+/** Runs one pass per byte of the key, but skips all passes of bytes which
+are the same for all entries. So sorting keys which only use some of their bits
+(e.g. 32 bit keys in the lower half) costs nothing extra.
+\param entries Entries to sort.
+\param scratch Temporary storage, resized as needed. Keep it around between
+calls to avoid allocations. */
+inline void radixSort(std::vector<SRadixSortEntry> &entries, std::vector<SRadixSortEntry> &scratch)
+{
+	const size_t count = entries.size();
+	if (count < 2)
+		return;
+
+	// histograms of all bytes in a single run over the keys
+	u32 histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+
+	for (const auto &entry : entries) {
+		u64 key = entry.Key;
+		for (u32 byte = 0; byte < 8; ++byte) {
+			++histograms[byte][key & 0xFF];
+			key >>= 8;
+		}
+	}
+
+	scratch.resize(count);
+	SRadixSortEntry *src = entries.data();
+	SRadixSortEntry *dst = scratch.data();
+
+	for (u32 byte = 0; byte < 8; ++byte) {
+		u32 *histogram = histograms[byte];
+
+		// all keys have the same value in this byte, nothing to do
+		if (histogram[(src[0].Key >> (byte * 8)) & 0xFF] == count)
+			continue;
+
+		// turn the counts into start offsets
+		u32 offset = 0;
+		for (u32 i = 0; i < 256; ++i) {
+			const u32 c = histogram[i];
+			histogram[i] = offset;
+			offset += c;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+			dst[histogram[(src[i].Key >> (byte * 8)) & 0xFF]++] = src[i];
+
+		std::swap(src, dst);
+	}
+
+	// odd amount of passes, the result ended up in the scratch buffer
+	if (src != entries.data())
+		entries.swap(scratch);
+}
+
+} // end namespace core
@@ -0,0 +1,146 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+
+#include "Utils/irrTypes.h"
+
+
+namespace core
+{
+
+//! Array storing its first N elements inline.
+/** Only goes to the heap when more than N elements are stored. Once grown, the
+storage is kept until the array is destroyed, so filling and emptying it again
+doesn't allocate. Meant for short lists of trivially copyable values, like the
+child pointers of a scene node. */
+template <class T, u32 N>
+class small_array
+{
+public:
+	static_assert(std::is_trivially_copyable<T>::value,
+			"core::small_array<T> only supports trivially copyable types.");
+	static_assert(N > 0, "core::small_array<T, N> needs at least one inline element.");
+
+	typedef T *iterator;
+	typedef const T *const_iterator;
+
+	//! Default constructor for empty array.
+	small_array() :
+			Data(Inline), Used(0), Allocated(N)
+	{
+	}
+
+	small_array(const small_array<T, N> &) = delete;
+	small_array<T, N> &operator=(const small_array<T, N> &) = delete;
+
+	//! Destructor
+	~small_array()
+	{
+		if (Data != Inline)
+			delete[] Data;
+	}
+
+	//! Makes sure the array can hold at least newSize elements.
+	/** \return True if this call had to allocate memory on the heap. */
+	bool reserve(u32 newSize)
+	{
+		if (newSize <= Allocated)
+			return false;
+
+		u32 newAllocated = std::max(newSize, Allocated * 2);
+		T *newData = new T[newAllocated];
+		memcpy(newData, Data, Used * sizeof(T));
+
+		if (Data != Inline)
+			delete[] Data;
+
+		Data = newData;
+		Allocated = newAllocated;
+		return true;
+	}
+
+	//! Adds an element at the back of the array.
+	/** \return True if the array had to grow on the heap. */
+	bool push_back(const T &element)
+	{
+		// element might live inside of our own storage
+		const T copy = element;
+		const bool grown = reserve(Used + 1);
+		Data[Used++] = copy;
+		return grown;
+	}
+
+	//! Removes the element at the given position, keeping the order of the others.
+	/** \return Iterator to the element following the removed one. */
+	iterator erase(iterator pos)
+	{
+		assert(pos >= begin() && pos < end());
+		std::copy(pos + 1, end(), pos);
+		--Used;
+		return pos;
+	}
+
+	//! Removes the element at the given index, keeping the order of the others.
+	void erase(u32 index)
+	{
+		assert(index < Used);
+		erase(Data + index);
+	}
+
+	//! Removes all elements, but keeps the allocated memory.
+	void clear()
+	{
+		Used = 0;
+	}
+
+	//! Get number of occupied elements of the array.
+	u32 size() const { return Used; }
+
+	//! Get amount of memory allocated, in elements.
+	u32 allocated_size() const { return Allocated; }
+
+	//! Check if array is empty.
+	bool empty() const { return Used == 0; }
+
+	//! Check if the elements don't fit into the inline storage anymore.
+	bool is_on_heap() const { return Data != Inline; }
+
+	//! Direct access operator
+	T &operator[](u32 index)
+	{
+		assert(index < Used);
+		return Data[index];
+	}
+
+	//! Direct const access operator
+	const T &operator[](u32 index) const
+	{
+		assert(index < Used);
+		return Data[index];
+	}
+
+	T &front() { return (*this)[0]; }
+	const T &front() const { return (*this)[0]; }
+	T &back() { return (*this)[Used - 1]; }
+	const T &back() const { return (*this)[Used - 1]; }
+
+	iterator begin() { return Data; }
+	iterator end() { return Data + Used; }
+	const_iterator begin() const { return Data; }
+	const_iterator end() const { return Data + Used; }
+
+private:
+	T *Data;
+	u32 Used;
+	u32 Allocated;
+	T Inline[N];
+};
+
+} // end namespace core
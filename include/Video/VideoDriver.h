@@ -25,6 +25,7 @@
 #include "Video/RenderTarget.h"
 #include "Video/Texture.h"
 #include "Image/Image.h"
+#include <atomic>
 #include <memory>
 
 namespace io
@@ -143,7 +144,18 @@ public:
 
 	SFrameStats getFrameStats() const
 	{
-		return FrameStats;
+		SFrameStats stats = FrameStats;
+		stats.AnimationsUpdated = AnimationUpdates[EAU_UPDATED];
+		stats.AnimationsSkipped = AnimationUpdates[EAU_SKIPPED];
+		stats.AnimationsCulled = AnimationUpdates[EAU_CULLED];
+		return stats;
+	}
+
+	//! Counts an update of an animated mesh for the frame stats
+	/** Thread safe, scene nodes call it from the job system. */
+	void countAnimationUpdate(E_ANIMATION_UPDATE update)
+	{
+		AnimationUpdates[update].fetch_add(1, std::memory_order_relaxed);
 	}
 
 	const core::dimension2d<u32> &getCurrentRenderTargetSize() const;
@@ -271,6 +283,9 @@ private:
 	bool Transformation3DChanged;
 	io::path OGLES2ShaderPath;
 
+	//! Counters of countAnimationUpdate(), reset by beginScene()
+	std::atomic<u32> AnimationUpdates[EAU_COUNT] = {};
+
 	SDLDevice *Device;
 
 	bool EnableErrorTest;
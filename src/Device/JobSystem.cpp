@@ -0,0 +1,414 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "Device/JobSystem.h"
+#include "Utils/irrMath.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+namespace os {
+
+namespace
+{
+//! Worker of the calling thread
+struct SThreadWorker
+{
+	const JobSystem *Owner = nullptr;
+	u32 Index = JobSystem::NOT_A_WORKER;
+};
+
+thread_local SThreadWorker CurrentWorker;
+
+//! Rounds are spent looking for work before going to sleep
+const u32 SPIN_ROUNDS = 64;
+}
+
+ScratchArena::ScratchArena(size_t blockSize) :
+		BlockSize(blockSize), Current(0), Offset(0)
+{
+}
+
+void *ScratchArena::allocate(size_t size, size_t align)
+{
+	while (true) {
+		if (Current < Blocks.size()) {
+			SBlock &block = Blocks[Current];
+			const uintptr_t base = reinterpret_cast<uintptr_t>(block.Data.get());
+			const size_t start = ((base + Offset + align - 1) & ~(uintptr_t)(align - 1)) - base;
+
+			if (start + size <= block.Size) {
+				Offset = start + size;
+				return block.Data.get() + start;
+			}
+
+			// doesn't fit, continue in the next block
+			++Current;
+			Offset = 0;
+			continue;
+		}
+
+		// oversized requests get a block of their own
+		const size_t blockSize = core::max_(BlockSize, size + align);
+		Blocks.push_back({std::unique_ptr<u8[]>(new u8[blockSize]), blockSize});
+	}
+}
+
+JobSystem::JobSystem(u32 threadCount) :
+		QueuedJobs(0), Sleeps(0), Quit(false)
+{
+	if (threadCount == 0) {
+		const u32 cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 0;
+	}
+
+	for (u32 i = 0; i < threadCount + 1; ++i)
+		Workers.push_back(std::make_unique<SWorker>());
+
+	// the creating thread is worker 0
+	CurrentWorker.Owner = this;
+	CurrentWorker.Index = 0;
+
+	Threads.reserve(threadCount);
+	for (u32 i = 1; i <= threadCount; ++i)
+		Threads.emplace_back(&JobSystem::threadMain, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	// finish everything still queued
+	while (QueuedJobs != 0) {
+		if (!tryRunOne(0))
+			std::this_thread::yield();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(SleepLock);
+		Quit = true;
+	}
+	WakeUp.notify_all();
+
+	for (auto &thread : Threads)
+		thread.join();
+
+	if (CurrentWorker.Owner == this)
+		CurrentWorker = SThreadWorker();
+}
+
+u32 JobSystem::getCurrentWorker() const
+{
+	return CurrentWorker.Owner == this ? CurrentWorker.Index : NOT_A_WORKER;
+}
+
+ScratchArena &JobSystem::getScratchArena()
+{
+	const u32 worker = getCurrentWorker();
+	if (worker != NOT_A_WORKER)
+		return Workers[worker]->Scratch;
+
+	thread_local ScratchArena arena;
+	return arena;
+}
+
+void JobSystem::run(JobFunc &&job, JobCounter *counter)
+{
+	if (counter) {
+		std::lock_guard<std::mutex> lock(counter->Lock);
+		++counter->Pending;
+	}
+
+	schedule({std::move(job), counter});
+}
+
+void JobSystem::runAfter(JobCounter &dependency, JobFunc &&job, JobCounter *counter)
+{
+	if (counter) {
+		std::lock_guard<std::mutex> lock(counter->Lock);
+		++counter->Pending;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(dependency.Lock);
+		if (dependency.Pending != 0) {
+			// started by finish() once the last job of the dependency is done
+			dependency.Continuations.push_back({std::move(job), counter});
+			return;
+		}
+	}
+
+	schedule({std::move(job), counter});
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+	const u32 worker = getCurrentWorker();
+
+	while (!counter.isDone()) {
+		// Other threads only wait, as the jobs they'd steal could expect to
+		// run on a worker (e.g. for using per worker data).
+		if (worker == NOT_A_WORKER || !tryRunOne(worker))
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::parallelFor(u32 begin, u32 end, u32 grainSize, const RangeFunc &func)
+{
+	if (begin >= end)
+		return;
+
+	const u32 count = end - begin;
+	if (grainSize == 0)
+		grainSize = core::max_<u32>(1, count / (getWorkerCount() * 4));
+
+	if (count <= grainSize || (getCurrentWorker() == NOT_A_WORKER && Workers.size() == 1)) {
+		func(begin, end);
+		return;
+	}
+
+	JobCounter counter;
+
+	// the first range is kept for the calling thread
+	for (u32 first = begin + grainSize; first < end; first += grainSize) {
+		const u32 last = core::min_(first + grainSize, end);
+		run([&func, first, last] { func(first, last); }, &counter);
+	}
+
+	func(begin, begin + grainSize);
+
+	wait(counter);
+}
+
+JobSystem::SStats JobSystem::getStats() const
+{
+	SStats stats;
+	for (const auto &worker : Workers) {
+		stats.JobsExecuted += worker->JobsExecuted;
+		stats.JobsStolen += worker->JobsStolen;
+	}
+	stats.Sleeps = Sleeps;
+	return stats;
+}
+
+void JobSystem::schedule(SJob &&job)
+{
+	const u32 worker = getCurrentWorker();
+
+	if (worker != NOT_A_WORKER) {
+		SWorker &own = *Workers[worker];
+		std::lock_guard<std::mutex> lock(own.Lock);
+		own.Queue.push_back(std::move(job));
+	} else {
+		std::lock_guard<std::mutex> lock(ExternalLock);
+		ExternalQueue.push_back(std::move(job));
+	}
+
+	++QueuedJobs;
+
+	// take the lock so a worker about to sleep doesn't miss the job
+	{
+		std::lock_guard<std::mutex> lock(SleepLock);
+	}
+	WakeUp.notify_one();
+}
+
+bool JobSystem::popOwn(u32 worker, SJob &job)
+{
+	SWorker &own = *Workers[worker];
+	std::lock_guard<std::mutex> lock(own.Lock);
+
+	if (own.Head == own.Queue.size())
+		return false;
+
+	// newest first, its data is most likely still in the cache
+	job = std::move(own.Queue.back());
+	own.Queue.pop_back();
+
+	if (own.Head == own.Queue.size()) {
+		own.Queue.clear();
+		own.Head = 0;
+	}
+
+	return true;
+}
+
+bool JobSystem::steal(u32 thief, SJob &job)
+{
+	const u32 count = (u32)Workers.size();
+
+	for (u32 i = 1; i < count; ++i) {
+		SWorker &victim = *Workers[(thief + i) % count];
+		std::lock_guard<std::mutex> lock(victim.Lock);
+
+		if (victim.Head == victim.Queue.size())
+			continue;
+
+		// oldest first, usually the biggest piece of remaining work
+		job = std::move(victim.Queue[victim.Head++]);
+
+		if (victim.Head == victim.Queue.size()) {
+			victim.Queue.clear();
+			victim.Head = 0;
+		}
+
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lock(ExternalLock);
+	if (ExternalHead == ExternalQueue.size())
+		return false;
+
+	job = std::move(ExternalQueue[ExternalHead++]);
+
+	// The calling thread may keep adding jobs so the queue never runs
+	// empty. Dropping the taken ones once they are half of it keeps
+	// taking a job O(1) amortized.
+	if (ExternalHead == ExternalQueue.size()) {
+		ExternalQueue.clear();
+		ExternalHead = 0;
+	} else if (ExternalHead >= 64 && ExternalHead * 2 >= ExternalQueue.size()) {
+		ExternalQueue.erase(ExternalQueue.begin(), ExternalQueue.begin() + ExternalHead);
+		ExternalHead = 0;
+	}
+
+	return true;
+}
+
+bool JobSystem::tryRunOne(u32 worker)
+{
+	SJob job;
+
+	if (popOwn(worker, job)) {
+		execute(worker, job, false);
+		return true;
+	}
+
+	if (steal(worker, job)) {
+		execute(worker, job, true);
+		return true;
+	}
+
+	return false;
+}
+
+void JobSystem::execute(u32 worker, SJob &job, bool stolen)
+{
+	--QueuedJobs;
+
+	job.Func();
+
+	SWorker &own = *Workers[worker];
+	own.JobsExecuted.fetch_add(1, std::memory_order_relaxed);
+	if (stolen)
+		own.JobsStolen.fetch_add(1, std::memory_order_relaxed);
+
+	finish(job.Counter);
+}
+
+void JobSystem::finish(JobCounter *counter)
+{
+	if (!counter)
+		return;
+
+	std::vector<SJob> ready;
+
+	{
+		std::lock_guard<std::mutex> lock(counter->Lock);
+		if (--counter->Pending == 0)
+			ready.swap(counter->Continuations);
+	}
+
+	for (auto &job : ready)
+		schedule(std::move(job));
+}
+
+void JobSystem::threadMain(u32 worker)
+{
+	CurrentWorker.Owner = this;
+	CurrentWorker.Index = worker;
+
+	u32 idleRounds = 0;
+
+	while (true) {
+		if (tryRunOne(worker)) {
+			idleRounds = 0;
+			continue;
+		}
+
+		if (++idleRounds < SPIN_ROUNDS) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(SleepLock);
+		if (Quit)
+			return;
+
+		if (QueuedJobs == 0) {
+			++Sleeps;
+			WakeUp.wait(lock, [this] { return Quit || QueuedJobs != 0; });
+			if (Quit)
+				return;
+		}
+		idleRounds = 0;
+	}
+}
+
+JobSystem::SBenchmarkResult JobSystem::benchmark(u32 jobCount)
+{
+	typedef std::chrono::steady_clock Clock;
+	SBenchmarkResult result;
+
+	// scheduling overhead: empty jobs, mostly stolen by the other workers
+	{
+		JobCounter counter;
+		const auto start = Clock::now();
+
+		for (u32 i = 0; i < jobCount; ++i)
+			run([] {}, &counter);
+		wait(counter);
+
+		const std::chrono::duration<f64, std::nano> time = Clock::now() - start;
+		result.NanosecondsPerEmptyJob = time.count() / core::max_<u32>(jobCount, 1);
+	}
+
+	// scaling: a compute bound loop, serial and split over all workers
+	const u32 elements = 1 << 22;
+	const u32 grain = core::max_<u32>(1, elements / (getWorkerCount() * 64));
+
+	// one sum per range, the last range is shorter if the grain doesn't divide the elements
+	std::vector<f32> sums((elements + grain - 1) / grain, 0.f);
+
+	const auto kernel = [](u32 begin, u32 end) {
+		f32 sum = 0.f;
+		for (u32 i = begin; i < end; ++i)
+			sum += std::sqrt((f32)i) * std::sin((f32)i);
+		return sum;
+	};
+
+	{
+		const auto start = Clock::now();
+		sums[0] = kernel(0, elements);
+		const std::chrono::duration<f64, std::milli> time = Clock::now() - start;
+		result.SerialMilliseconds = time.count();
+	}
+
+	{
+		const auto start = Clock::now();
+		parallelFor(0, elements, grain, [&](u32 begin, u32 end) {
+			sums[begin / grain] = kernel(begin, end);
+		});
+		const std::chrono::duration<f64, std::milli> time = Clock::now() - start;
+		result.ParallelMilliseconds = time.count();
+	}
+
+	if (result.ParallelMilliseconds > 0.0)
+		result.Speedup = result.SerialMilliseconds / result.ParallelMilliseconds;
+
+	return result;
+}
+
+} // end namespace os
+
+os::JobSystem *g_irrjobs = nullptr;
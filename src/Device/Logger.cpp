@@ -30,6 +30,8 @@ void Logger::log(const c8 *text, ELOG_LEVEL ll)
 	if (ll < LogLevel)
 		return;
 
+	std::lock_guard<std::mutex> lock(Lock);
+
 	if (Receiver) {
 		SEvent event;
 		event.EventType = EET_LOG_TEXT_EVENT;
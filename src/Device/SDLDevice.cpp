@@ -11,6 +11,7 @@
 #include "Utils/irrString.h"
 #include "Device/Keycodes.h"
 #include "Scene/ISceneManager.h"
+#include "Device/JobSystem.h"
 
 #include "Video/Common.h"
 #ifdef _IRR_USE_SDL3_
@@ -398,7 +399,7 @@ SDLDevice *SDLDevice::createDeviceEx(const SDLDeviceParameters &params)
 SDLDevice::SDLDevice(const SDLDeviceParameters &param) :
 		VideoDrv(0), GUIEnvironment(0), SceneManager(0),
 		CursorCtrl(0), UserReceiver(param.EventReceiver),
-		Logger(0), ClipBoard(0), FileSystem(0),
+		Logger(0), Jobs(0), ClipBoard(0), FileSystem(0),
 		InputReceivingSceneManager(0),
 		CreationParams(param), Close(false),
 		Window((SDL_Window *)param.WindowId),
@@ -420,6 +421,14 @@ SDLDevice::SDLDevice(const SDLDeviceParameters &param) :
 
 	g_irrlogger = Logger;
 
+	if (g_irrjobs) {
+		g_irrjobs->grab();
+		Jobs = g_irrjobs;
+	} else {
+		Jobs = new os::JobSystem(CreationParams.JobThreadCount);
+		g_irrjobs = Jobs;
+	}
+
 	FileSystem = io::createFileSystem();
 
 	if (++SDLDeviceInstances == 1) {
@@ -557,6 +566,9 @@ SDLDevice::~SDLDevice()
 
 	CursorCtrl = 0;
 
+	if (Jobs->drop())
+		g_irrjobs = nullptr;
+
 	if (Logger->drop())
 		g_irrlogger = nullptr;
 
@@ -1681,6 +1693,12 @@ os::Logger *SDLDevice::getLogger()
 	return Logger;
 }
 
+//! Returns the job system shared by all parts of the engine.
+os::JobSystem *SDLDevice::getJobSystem()
+{
+	return Jobs;
+}
+
 //! Returns the operation system opertator object.
 os::Clipboard *SDLDevice::getOSOperator()
 {
@@ -0,0 +1,379 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CJsonParser.h"
+
+#include <cmath>
+
+namespace io
+{
+
+namespace
+{
+//! Nesting deeper than this is rejected instead of overflowing the stack
+const u32 MAX_JSON_DEPTH = 256;
+
+//! Appends a code point as UTF-8
+void appendUtf8(std::string &out, u32 c)
+{
+	if (c < 0x80) {
+		out += (char)c;
+	} else if (c < 0x800) {
+		out += (char)(0xC0 | (c >> 6));
+		out += (char)(0x80 | (c & 0x3F));
+	} else if (c < 0x10000) {
+		out += (char)(0xE0 | (c >> 12));
+		out += (char)(0x80 | ((c >> 6) & 0x3F));
+		out += (char)(0x80 | (c & 0x3F));
+	} else {
+		out += (char)(0xF0 | (c >> 18));
+		out += (char)(0x80 | ((c >> 12) & 0x3F));
+		out += (char)(0x80 | ((c >> 6) & 0x3F));
+		out += (char)(0x80 | (c & 0x3F));
+	}
+}
+
+s32 hexDigit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+}
+
+const SJsonValue *SJsonValue::get(std::string_view key) const
+{
+	if (Type != EJT_OBJECT)
+		return nullptr;
+
+	for (u32 i = 0; i < Keys.size(); ++i) {
+		if (Keys[i] == key)
+			return &Elements[i];
+	}
+	return nullptr;
+}
+
+const SJsonValue *SJsonValue::at(u32 index) const
+{
+	if (Type != EJT_ARRAY || index >= Elements.size())
+		return nullptr;
+	return &Elements[index];
+}
+
+f64 SJsonValue::getNumber(std::string_view key, f64 fallback) const
+{
+	const SJsonValue *value = get(key);
+	return value && value->isNumber() ? value->Number : fallback;
+}
+
+u32 SJsonValue::toUInt(u32 fallback) const
+{
+	// also false for NaN, which can't be cast either
+	if (!isNumber() || !(Number >= 0.0 && Number <= 4294967295.0))
+		return fallback;
+	return (u32)Number;
+}
+
+u32 SJsonValue::getUInt(std::string_view key, u32 fallback) const
+{
+	const SJsonValue *value = get(key);
+	return value ? value->toUInt(fallback) : fallback;
+}
+
+bool SJsonValue::getBool(std::string_view key, bool fallback) const
+{
+	const SJsonValue *value = get(key);
+	return value && value->Type == EJT_BOOL ? value->Bool : fallback;
+}
+
+std::string SJsonValue::getString(std::string_view key, const std::string &fallback) const
+{
+	const SJsonValue *value = get(key);
+	return value && value->isString() ? value->String : fallback;
+}
+
+//! Parses a document
+bool CJsonParser::parse(std::string_view text, SJsonValue &root)
+{
+	Text = text;
+	Pos = 0;
+	Error.clear();
+	root = SJsonValue();
+
+	if (!parseValue(root, 0))
+		return false;
+
+	skipWhitespace();
+	if (Pos != Text.size())
+		return fail("Unexpected data after the document");
+	return true;
+}
+
+bool CJsonParser::parseValue(SJsonValue &value, u32 depth)
+{
+	if (depth > MAX_JSON_DEPTH)
+		return fail("Nesting too deep");
+
+	skipWhitespace();
+	if (Pos >= Text.size())
+		return fail("Unexpected end of document");
+
+	switch (Text[Pos]) {
+	case '{': {
+		value.Type = EJT_OBJECT;
+		++Pos;
+		skipWhitespace();
+		if (Pos < Text.size() && Text[Pos] == '}') {
+			++Pos;
+			return true;
+		}
+
+		while (true) {
+			skipWhitespace();
+			value.Keys.emplace_back();
+			if (!parseString(value.Keys.back()))
+				return false;
+
+			skipWhitespace();
+			if (Pos >= Text.size() || Text[Pos] != ':')
+				return fail("Expected ':'");
+			++Pos;
+
+			value.Elements.emplace_back();
+			if (!parseValue(value.Elements.back(), depth + 1))
+				return false;
+
+			skipWhitespace();
+			if (Pos < Text.size() && Text[Pos] == ',') {
+				++Pos;
+				continue;
+			}
+			if (Pos < Text.size() && Text[Pos] == '}') {
+				++Pos;
+				return true;
+			}
+			return fail("Expected ',' or '}'");
+		}
+	}
+	case '[': {
+		value.Type = EJT_ARRAY;
+		++Pos;
+		skipWhitespace();
+		if (Pos < Text.size() && Text[Pos] == ']') {
+			++Pos;
+			return true;
+		}
+
+		while (true) {
+			value.Elements.emplace_back();
+			if (!parseValue(value.Elements.back(), depth + 1))
+				return false;
+
+			skipWhitespace();
+			if (Pos < Text.size() && Text[Pos] == ',') {
+				++Pos;
+				continue;
+			}
+			if (Pos < Text.size() && Text[Pos] == ']') {
+				++Pos;
+				return true;
+			}
+			return fail("Expected ',' or ']'");
+		}
+	}
+	case '"':
+		value.Type = EJT_STRING;
+		return parseString(value.String);
+	case 't':
+		value.Type = EJT_BOOL;
+		value.Bool = true;
+		return parseLiteral("true");
+	case 'f':
+		value.Type = EJT_BOOL;
+		value.Bool = false;
+		return parseLiteral("false");
+	case 'n':
+		value.Type = EJT_NULL;
+		return parseLiteral("null");
+	default:
+		value.Type = EJT_NUMBER;
+		return parseNumber(value.Number);
+	}
+}
+
+bool CJsonParser::parseString(std::string &out)
+{
+	if (Pos >= Text.size() || Text[Pos] != '"')
+		return fail("Expected a string");
+	++Pos;
+
+	while (Pos < Text.size()) {
+		const char c = Text[Pos++];
+		if (c == '"')
+			return true;
+
+		if (c != '\\') {
+			out += c;
+			continue;
+		}
+
+		if (Pos >= Text.size())
+			break;
+
+		switch (Text[Pos++]) {
+		case '"':
+			out += '"';
+			break;
+		case '\\':
+			out += '\\';
+			break;
+		case '/':
+			out += '/';
+			break;
+		case 'b':
+			out += '\b';
+			break;
+		case 'f':
+			out += '\f';
+			break;
+		case 'n':
+			out += '\n';
+			break;
+		case 'r':
+			out += '\r';
+			break;
+		case 't':
+			out += '\t';
+			break;
+		case 'u': {
+			const auto readCode = [this](u32 &code) {
+				if (Pos + 4 > Text.size())
+					return false;
+				code = 0;
+				for (u32 i = 0; i < 4; ++i) {
+					const s32 digit = hexDigit(Text[Pos++]);
+					if (digit < 0)
+						return false;
+					code = code * 16 + digit;
+				}
+				return true;
+			};
+
+			u32 code;
+			if (!readCode(code))
+				return fail("Invalid unicode escape");
+
+			// surrogate pair
+			if (code >= 0xD800 && code < 0xDC00 && Pos + 1 < Text.size() &&
+					Text[Pos] == '\\' && Text[Pos + 1] == 'u') {
+				Pos += 2;
+				u32 low;
+				if (!readCode(low) || low < 0xDC00 || low >= 0xE000)
+					return fail("Invalid unicode surrogate pair");
+				code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+			}
+			appendUtf8(out, code);
+			break;
+		}
+		default:
+			return fail("Invalid escape sequence");
+		}
+	}
+	return fail("Unterminated string");
+}
+
+bool CJsonParser::parseNumber(f64 &out)
+{
+	const size_t start = Pos;
+	bool negative = false;
+	if (Pos < Text.size() && Text[Pos] == '-') {
+		negative = true;
+		++Pos;
+	}
+
+	// Digits are collected into an integer, so integers like byte offsets
+	// stay exact, and scaled by a power of ten once.
+	u64 mantissa = 0;
+	s32 exponent = 0;
+	u32 digits = 0;
+
+	while (Pos < Text.size() && Text[Pos] >= '0' && Text[Pos] <= '9') {
+		if (mantissa < 100000000000000000ULL)
+			mantissa = mantissa * 10 + (Text[Pos] - '0');
+		else
+			++exponent;
+		++digits;
+		++Pos;
+	}
+
+	if (Pos < Text.size() && Text[Pos] == '.') {
+		++Pos;
+		while (Pos < Text.size() && Text[Pos] >= '0' && Text[Pos] <= '9') {
+			if (mantissa < 100000000000000000ULL) {
+				mantissa = mantissa * 10 + (Text[Pos] - '0');
+				--exponent;
+			}
+			++digits;
+			++Pos;
+		}
+	}
+
+	if (!digits) {
+		Pos = start;
+		return fail("Invalid value");
+	}
+
+	if (Pos < Text.size() && (Text[Pos] == 'e' || Text[Pos] == 'E')) {
+		++Pos;
+		bool negativeExponent = false;
+		if (Pos < Text.size() && (Text[Pos] == '+' || Text[Pos] == '-'))
+			negativeExponent = Text[Pos++] == '-';
+
+		s32 value = 0;
+		bool any = false;
+		while (Pos < Text.size() && Text[Pos] >= '0' && Text[Pos] <= '9') {
+			if (value < 10000)
+				value = value * 10 + (Text[Pos] - '0');
+			any = true;
+			++Pos;
+		}
+		if (!any)
+			return fail("Invalid exponent");
+		exponent += negativeExponent ? -value : value;
+	}
+
+	out = (f64)mantissa;
+	if (exponent)
+		out *= std::pow(10.0, exponent);
+	if (negative)
+		out = -out;
+	return true;
+}
+
+bool CJsonParser::parseLiteral(std::string_view literal)
+{
+	if (Text.substr(Pos, literal.size()) != literal)
+		return fail("Invalid value");
+	Pos += literal.size();
+	return true;
+}
+
+void CJsonParser::skipWhitespace()
+{
+	while (Pos < Text.size() && (Text[Pos] == ' ' || Text[Pos] == '\t' || Text[Pos] == '\n' || Text[Pos] == '\r'))
+		++Pos;
+}
+
+bool CJsonParser::fail(const char *message)
+{
+	if (Error.empty())
+		Error = std::string(message) + " at offset " + std::to_string(Pos);
+	return false;
+}
+
+} // end namespace io
@@ -0,0 +1,99 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Utils/irrTypes.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace io
+{
+
+//! Type of a JSON value
+enum E_JSON_TYPE
+{
+	EJT_NULL = 0,
+	EJT_BOOL,
+	EJT_NUMBER,
+	EJT_STRING,
+	EJT_ARRAY,
+	EJT_OBJECT
+};
+
+//! Value of a parsed JSON document
+/** Objects keep their members in the order of the document, looking one up
+is a linear search. Made for small documents describing binary data, like the
+ones of glTF. */
+struct SJsonValue
+{
+	E_JSON_TYPE Type = EJT_NULL;
+
+	bool Bool = false;
+	f64 Number = 0.0;
+	std::string String;
+
+	//! Elements of an array, or the values of the members of an object
+	std::vector<SJsonValue> Elements;
+
+	//! Names of the members of an object, parallel to Elements
+	std::vector<std::string> Keys;
+
+	bool isNumber() const { return Type == EJT_NUMBER; }
+	bool isString() const { return Type == EJT_STRING; }
+	bool isArray() const { return Type == EJT_ARRAY; }
+	bool isObject() const { return Type == EJT_OBJECT; }
+
+	//! Returns the value if it is a non-negative integer fitting into 32 bits, else the fallback
+	u32 toUInt(u32 fallback) const;
+
+	//! Returns the amount of elements of an array or members of an object
+	u32 size() const { return Elements.size(); }
+
+	//! Returns a member of an object, or 0 if it is missing
+	const SJsonValue *get(std::string_view key) const;
+
+	//! Returns an element of an array, or 0 if it is missing
+	const SJsonValue *at(u32 index) const;
+
+	//! Returns a member if it is a number, else the fallback
+	f64 getNumber(std::string_view key, f64 fallback = 0.0) const;
+
+	//! Returns a member if it is a non-negative integer, else the fallback
+	u32 getUInt(std::string_view key, u32 fallback = 0) const;
+
+	//! Returns a member if it is a boolean, else the fallback
+	bool getBool(std::string_view key, bool fallback = false) const;
+
+	//! Returns a member if it is a string, else the fallback
+	std::string getString(std::string_view key, const std::string &fallback = "") const;
+};
+
+//! Reads JSON documents into SJsonValues
+class CJsonParser
+{
+public:
+	//! Parses a document
+	/** \return False if the document is invalid, see getError(). */
+	bool parse(std::string_view text, SJsonValue &root);
+
+	//! Returns the reason of the last failure
+	const std::string &getError() const { return Error; }
+
+private:
+	bool parseValue(SJsonValue &value, u32 depth);
+	bool parseString(std::string &out);
+	bool parseNumber(f64 &out);
+	bool parseLiteral(std::string_view literal);
+	void skipWhitespace();
+	bool fail(const char *message);
+
+	std::string_view Text;
+	size_t Pos = 0;
+	std::string Error;
+};
+
+} // end namespace io
@@ -10,12 +10,15 @@
 
 #include "Video/VideoDriver.h"
 #include "IO/IFileSystem.h"
+#include "IO/IReadFile.h"
 #include "Mesh/SkinnedMesh.h"
+#include "Mesh/SB3DStructs.h"
 #include "Utils/coreutil.h"
 #include "Device/Logger.h"
 #include "Device/byteswap.h"
 
 #include <algorithm>
+#include <vector>
 
 #ifdef _DEBUG
 #define _B3D_READER_DEBUG
@@ -25,10 +28,73 @@
 namespace scene
 {
 
+namespace
+{
+//! State of loading one file, so the loader can run on several threads at once
+class CB3DReader
+{
+public:
+	CB3DReader(io::IReadFile *file) :
+			AnimatedMesh(0), B3DFile(file), Pos(0), VerticesStart(0), NormalsInFile(false),
+			HasVertexColors(false), ShowWarning(true)
+	{}
+
+	IAnimatedMesh *read();
+
+private:
+	bool load();
+	bool readChunkNODE(SkinnedMesh::SJoint *InJoint);
+	bool readChunkMESH(SkinnedMesh::SJoint *InJoint);
+	bool readChunkVRTS(SkinnedMesh::SJoint *InJoint);
+	bool readChunkTRIS(scene::SSkinMeshBuffer *MeshBuffer, u32 MeshBufferID, s32 Vertices_Start);
+	bool readChunkBONE(SkinnedMesh::SJoint *InJoint);
+	bool readChunkKEYS(SkinnedMesh::SJoint *InJoint);
+	bool readChunkANIM();
+	bool readChunkTEXS();
+	bool readChunkBRUS();
+
+	std::string readString();
+	//! Copies bytes of the file, zeroes past its end
+	void readData(void *out, size_t size);
+	s32 readInt();
+	void readInts(s32 *vec, size_t count);
+	void readFloats(f32 *vec, size_t count);
+	SB3dChunkHeader readChunkHeader();
+
+	//! End of the innermost chunk, at most the end of the file
+	long getChunkEnd() const;
+	bool seek(long pos);
+
+	core::array<SB3dChunk> B3dStack;
+
+	core::array<SB3dMaterial> Materials;
+	core::array<SB3dTexture> Textures;
+
+	core::array<s32> AnimatedVertices_VertexID;
+
+	core::array<s32> AnimatedVertices_BufferID;
+
+	core::array<scene::Vertex2TCoords> BaseVertices;
+
+	SkinnedMeshBuilder *AnimatedMesh;
+	io::IReadFile *B3DFile;
+
+	//! Contents of B3DFile, so that chunks are decoded from contiguous memory
+	std::vector<u8> Data;
+	long Pos;
+
+	// B3Ds have Vertex ID's local within the mesh I don't want this
+	//  Variable needs to be class member due to recursion in calls
+	u32 VerticesStart;
+
+	bool NormalsInFile;
+	bool HasVertexColors;
+	bool ShowWarning;
+};
+}
+
 //! Constructor
-CB3DMeshFileLoader::CB3DMeshFileLoader(scene::ISceneManager *smgr) :
-		AnimatedMesh(0), B3DFile(0), VerticesStart(0), NormalsInFile(false),
-		HasVertexColors(false), ShowWarning(true)
+CB3DMeshFileLoader::CB3DMeshFileLoader(scene::ISceneManager *smgr)
 {}
 
 //! returns true if the file maybe is able to be loaded by this class
@@ -47,22 +113,31 @@ IAnimatedMesh *CB3DMeshFileLoader::createMesh(io::IReadFile *file)
 	if (!file)
 		return 0;
 
-	B3DFile = file;
+	CB3DReader reader(file);
+	return reader.read();
+}
+
+IAnimatedMesh *CB3DReader::read()
+{
+	// chunks are decoded from memory, the file is read at once
+	Data.resize(B3DFile->getSize() > 0 ? B3DFile->getSize() : 0);
+	Data.resize(B3DFile->read(Data.data(), Data.size()));
+	Pos = 0;
+
 	AnimatedMesh = new scene::SkinnedMeshBuilder(SkinnedMesh::SourceFormat::B3D);
-	ShowWarning = true; // If true a warning is issued if too many textures are used
-	VerticesStart = 0;
 
+	SkinnedMesh *res = nullptr;
 	if (load()) {
-		return AnimatedMesh->finalize();
+		res = AnimatedMesh->finalize();
 	} else {
 		AnimatedMesh->drop();
 		AnimatedMesh = 0;
 	}
 
-	return AnimatedMesh;
+	return res;
 }
 
-bool CB3DMeshFileLoader::load()
+bool CB3DReader::load()
 {
 	B3dStack.clear();
 
@@ -71,11 +146,7 @@ bool CB3DMeshFileLoader::load()
 
 	//------ Get header ------
 
-	SB3dChunkHeader header;
-	B3DFile->read(&header, sizeof(header));
-#ifdef __BIG_ENDIAN__
-	header.size = os::Byteswap::byteswap(header.size);
-#endif
+	SB3dChunkHeader header = readChunkHeader();
 
 	if (strncmp(header.name, "BB3D", 4) != 0) {
 		g_irrlogger->log("File is not a b3d file. Loading failed (No header found)", B3DFile->getFileName(), ELL_ERROR);
@@ -83,23 +154,16 @@ bool CB3DMeshFileLoader::load()
 	}
 
 	// Add main chunk...
-	B3dStack.push_back(SB3dChunk(header, B3DFile->getPos() - 8));
+	B3dStack.push_back(SB3dChunk(header, Pos - 8));
 
 	// Get file version, but ignore it, as it's not important with b3d files...
-	s32 fileVersion;
-	B3DFile->read(&fileVersion, sizeof(fileVersion));
-#ifdef __BIG_ENDIAN__
-	fileVersion = os::Byteswap::byteswap(fileVersion);
-#endif
+	readInt();
 
 	//------ Read main chunk ------
 
-	while ((B3dStack.getLast().startposition + B3dStack.getLast().length) > B3DFile->getPos()) {
-		B3DFile->read(&header, sizeof(header));
-#ifdef __BIG_ENDIAN__
-		header.size = os::Byteswap::byteswap(header.size);
-#endif
-		B3dStack.push_back(SB3dChunk(header, B3DFile->getPos() - 8));
+	while (getChunkEnd() > Pos) {
+		header = readChunkHeader();
+		B3dStack.push_back(SB3dChunk(header, Pos - 8));
 
 		if (strncmp(B3dStack.getLast().name, "TEXS", 4) == 0) {
 			if (!readChunkTEXS())
@@ -112,7 +176,7 @@ bool CB3DMeshFileLoader::load()
 				return false;
 		} else {
 			g_irrlogger->log("Unknown chunk found in mesh base - skipping");
-			if (!B3DFile->seek(B3dStack.getLast().startposition + B3dStack.getLast().length))
+			if (!seek(B3dStack.getLast().startposition + B3dStack.getLast().length))
 				return false;
 			B3dStack.erase(B3dStack.size() - 1);
 		}
@@ -130,7 +194,7 @@ bool CB3DMeshFileLoader::load()
 	return true;
 }
 
-bool CB3DMeshFileLoader::readChunkNODE(SkinnedMesh::SJoint *inJoint)
+bool CB3DReader::readChunkNODE(SkinnedMesh::SJoint *inJoint)
 {
 	SkinnedMesh::SJoint *joint = AnimatedMesh->addJoint(inJoint);
 	joint->Name = readString();
@@ -169,15 +233,11 @@ bool CB3DMeshFileLoader::readChunkNODE(SkinnedMesh::SJoint *inJoint)
 	else
 		joint->GlobalMatrix = joint->LocalMatrix;
 
-	while (B3dStack.getLast().startposition + B3dStack.getLast().length > B3DFile->getPos()) // this chunk repeats
+	while (getChunkEnd() > Pos) // this chunk repeats
 	{
-		SB3dChunkHeader header;
-		B3DFile->read(&header, sizeof(header));
-#ifdef __BIG_ENDIAN__
-		header.size = os::Byteswap::byteswap(header.size);
-#endif
+		const SB3dChunkHeader header = readChunkHeader();
 
-		B3dStack.push_back(SB3dChunk(header, B3DFile->getPos() - 8));
+		B3dStack.push_back(SB3dChunk(header, Pos - 8));
 
 		if (strncmp(B3dStack.getLast().name, "NODE", 4) == 0) {
 			if (!readChunkNODE(joint))
@@ -197,7 +257,7 @@ bool CB3DMeshFileLoader::readChunkNODE(SkinnedMesh::SJoint *inJoint)
 				return false;
 		} else {
 			g_irrlogger->log("Unknown chunk found in node chunk - skipping");
-			if (!B3DFile->seek(B3dStack.getLast().startposition + B3dStack.getLast().length))
+			if (!seek(B3dStack.getLast().startposition + B3dStack.getLast().length))
 				return false;
 			B3dStack.erase(B3dStack.size() - 1);
 		}
@@ -208,7 +268,7 @@ bool CB3DMeshFileLoader::readChunkNODE(SkinnedMesh::SJoint *inJoint)
 	return true;
 }
 
-bool CB3DMeshFileLoader::readChunkMESH(SkinnedMesh::SJoint *inJoint)
+bool CB3DReader::readChunkMESH(SkinnedMesh::SJoint *inJoint)
 {
 #ifdef _B3D_READER_DEBUG
 	core::stringc logStr;
@@ -218,24 +278,16 @@ bool CB3DMeshFileLoader::readChunkMESH(SkinnedMesh::SJoint *inJoint)
 	g_irrlogger->log(logStr.c_str(), ELL_DEBUG);
 #endif
 
-	s32 brushID;
-	B3DFile->read(&brushID, sizeof(brushID));
-#ifdef __BIG_ENDIAN__
-	brushID = os::Byteswap::byteswap(brushID);
-#endif
+	const s32 brushID = readInt();
 
 	NormalsInFile = false;
 	HasVertexColors = false;
 
-	while ((B3dStack.getLast().startposition + B3dStack.getLast().length) > B3DFile->getPos()) // this chunk repeats
+	while (getChunkEnd() > Pos) // this chunk repeats
 	{
-		SB3dChunkHeader header;
-		B3DFile->read(&header, sizeof(header));
-#ifdef __BIG_ENDIAN__
-		header.size = os::Byteswap::byteswap(header.size);
-#endif
+		const SB3dChunkHeader header = readChunkHeader();
 
-		B3dStack.push_back(SB3dChunk(header, B3DFile->getPos() - 8));
+		B3dStack.push_back(SB3dChunk(header, Pos - 8));
 
 		if (strncmp(B3dStack.getLast().name, "VRTS", 4) == 0) {
 			if (!readChunkVRTS(inJoint))
@@ -275,7 +327,7 @@ bool CB3DMeshFileLoader::readChunkMESH(SkinnedMesh::SJoint *inJoint)
 			}
 		} else {
 			g_irrlogger->log("Unknown chunk found in mesh - skipping");
-			if (!B3DFile->seek(B3dStack.getLast().startposition + B3dStack.getLast().length))
+			if (!seek(B3dStack.getLast().startposition + B3dStack.getLast().length))
 				return false;
 			B3dStack.erase(B3dStack.size() - 1);
 		}
@@ -299,7 +351,7 @@ VRTS:
   float tex_coords[tex_coord_sets][tex_coord_set_size]	;tex coords
   }
 */
-bool CB3DMeshFileLoader::readChunkVRTS(SkinnedMesh::SJoint *inJoint)
+bool CB3DReader::readChunkVRTS(SkinnedMesh::SJoint *inJoint)
 {
 #ifdef _B3D_READER_DEBUG
 	core::stringc logStr;
@@ -310,16 +362,9 @@ bool CB3DMeshFileLoader::readChunkVRTS(SkinnedMesh::SJoint *inJoint)
 #endif
 
 	const s32 max_tex_coords = 3;
-	s32 flags, tex_coord_sets, tex_coord_set_size;
-
-	B3DFile->read(&flags, sizeof(flags));
-	B3DFile->read(&tex_coord_sets, sizeof(tex_coord_sets));
-	B3DFile->read(&tex_coord_set_size, sizeof(tex_coord_set_size));
-#ifdef __BIG_ENDIAN__
-	flags = os::Byteswap::byteswap(flags);
-	tex_coord_sets = os::Byteswap::byteswap(tex_coord_sets);
-	tex_coord_set_size = os::Byteswap::byteswap(tex_coord_set_size);
-#endif
+	const s32 flags = readInt();
+	const s32 tex_coord_sets = readInt();
+	const s32 tex_coord_set_size = readInt();
 
 	if (tex_coord_sets < 0 || tex_coord_set_size < 0 ||
 			tex_coord_sets >= max_tex_coords || tex_coord_set_size >= 4) // Something is wrong
@@ -328,8 +373,6 @@ bool CB3DMeshFileLoader::readChunkVRTS(SkinnedMesh::SJoint *inJoint)
 		return false;
 	}
 
-	//------ Allocate Memory, for speed -----------//
-
 	s32 numberOfReads = 3;
 
 	if (flags & 1) {
@@ -343,29 +386,38 @@ bool CB3DMeshFileLoader::readChunkVRTS(SkinnedMesh::SJoint *inJoint)
 
 	numberOfReads += tex_coord_sets * tex_coord_set_size;
 
-	const s32 memoryNeeded = (B3dStack.getLast().length / sizeof(f32)) / numberOfReads;
+	// decode all vertices from one copy of the chunk
+	const u32 vertexCount = (u32)(core::max_(getChunkEnd() - Pos, 0L) / ((s32)sizeof(f32) * numberOfReads));
+	std::vector<f32> values((size_t)vertexCount * numberOfReads);
+	readFloats(values.data(), values.size());
+	seek(getChunkEnd());
 
-	BaseVertices.reallocate(memoryNeeded + BaseVertices.size() + 1);
-	AnimatedVertices_VertexID.reallocate(memoryNeeded + AnimatedVertices_VertexID.size() + 1);
+	BaseVertices.reallocate(vertexCount + BaseVertices.size() + 1);
+	AnimatedVertices_VertexID.reallocate(vertexCount + AnimatedVertices_VertexID.size() + 1);
+	AnimatedVertices_BufferID.reallocate(vertexCount + AnimatedVertices_BufferID.size() + 1);
 
-	//--------------------------------------------//
+	const f32 *value = values.data();
+	for (u32 v = 0; v < vertexCount; ++v) {
+		const f32 *position = value;
+		value += 3;
 
-	while ((B3dStack.getLast().startposition + B3dStack.getLast().length) > B3DFile->getPos()) // this chunk repeats
-	{
-		f32 position[3];
 		f32 normal[3] = {0.f, 0.f, 0.f};
 		f32 color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
 		f32 tex_coords[max_tex_coords][4];
 
-		readFloats(position, 3);
-
-		if (flags & 1)
-			readFloats(normal, 3);
-		if (flags & 2)
-			readFloats(color, 4);
+		if (flags & 1) {
+			memcpy(normal, value, 3 * sizeof(f32));
+			value += 3;
+		}
+		if (flags & 2) {
+			memcpy(color, value, 4 * sizeof(f32));
+			value += 4;
+		}
 
-		for (s32 i = 0; i < tex_coord_sets; ++i)
-			readFloats(tex_coords[i], tex_coord_set_size);
+		for (s32 i = 0; i < tex_coord_sets; ++i) {
+			memcpy(tex_coords[i], value, tex_coord_set_size * sizeof(f32));
+			value += tex_coord_set_size;
+		}
 
 		f32 tu = 0.0f, tv = 0.0f;
 		if (tex_coord_sets >= 1 && tex_coord_set_size >= 2) {
@@ -405,7 +457,7 @@ bool CB3DMeshFileLoader::readChunkVRTS(SkinnedMesh::SJoint *inJoint)
 	return true;
 }
 
-bool CB3DMeshFileLoader::readChunkTRIS(scene::SSkinMeshBuffer *meshBuffer, u32 meshBufferID, s32 vertices_Start)
+bool CB3DReader::readChunkTRIS(scene::SSkinMeshBuffer *meshBuffer, u32 meshBufferID, s32 vertices_Start)
 {
 #ifdef _B3D_READER_DEBUG
 	core::stringc logStr;
@@ -417,11 +469,7 @@ bool CB3DMeshFileLoader::readChunkTRIS(scene::SSkinMeshBuffer *meshBuffer, u32 m
 
 	bool showVertexWarning = false;
 
-	s32 triangle_brush_id; // Note: Irrlicht can't have different brushes for each triangle (using a workaround)
-	B3DFile->read(&triangle_brush_id, sizeof(triangle_brush_id));
-#ifdef __BIG_ENDIAN__
-	triangle_brush_id = os::Byteswap::byteswap(triangle_brush_id);
-#endif
+	const s32 triangle_brush_id = readInt(); // Note: Irrlicht can't have different brushes for each triangle (using a workaround)
 
 	SB3dMaterial *B3dMaterial;
 
@@ -435,19 +483,16 @@ bool CB3DMeshFileLoader::readChunkTRIS(scene::SSkinMeshBuffer *meshBuffer, u32 m
 		meshBuffer->Material = B3dMaterial->Material;
 	}
 
-	const s32 memoryNeeded = B3dStack.getLast().length / sizeof(s32);
-	meshBuffer->Indices->Data.reserve(memoryNeeded + meshBuffer->Indices->Data.size() + 1);
+	// all triangles of the chunk in one copy
+	const u32 triangleCount = (u32)(core::max_(getChunkEnd() - Pos, 0L) / (3 * sizeof(s32)));
+	std::vector<s32> triangles((size_t)triangleCount * 3);
+	readInts(triangles.data(), triangles.size());
+	seek(getChunkEnd());
 
-	while ((B3dStack.getLast().startposition + B3dStack.getLast().length) > B3DFile->getPos()) // this chunk repeats
-	{
-		s32 vertex_id[3];
+	meshBuffer->Indices->Data.reserve(triangles.size() + meshBuffer->Indices->Data.size());
 
-		B3DFile->read(vertex_id, 3 * sizeof(s32));
-#ifdef __BIG_ENDIAN__
-		vertex_id[0] = os::Byteswap::byteswap(vertex_id[0]);
-		vertex_id[1] = os::Byteswap::byteswap(vertex_id[1]);
-		vertex_id[2] = os::Byteswap::byteswap(vertex_id[2]);
-#endif
+	for (u32 t = 0; t < triangleCount; ++t) {
+		s32 *vertex_id = &triangles[t * 3];
 
 		// Make Ids global:
 		vertex_id[0] += vertices_Start;
@@ -521,7 +566,7 @@ bool CB3DMeshFileLoader::readChunkTRIS(scene::SSkinMeshBuffer *meshBuffer, u32 m
 	return true;
 }
 
-bool CB3DMeshFileLoader::readChunkBONE(SkinnedMesh::SJoint *inJoint)
+bool CB3DReader::readChunkBONE(SkinnedMesh::SJoint *inJoint)
 {
 #ifdef _B3D_READER_DEBUG
 	core::stringc logStr;
@@ -532,16 +577,16 @@ bool CB3DMeshFileLoader::readChunkBONE(SkinnedMesh::SJoint *inJoint)
 #endif
 
 	if (B3dStack.getLast().length > 8) {
-		while ((B3dStack.getLast().startposition + B3dStack.getLast().length) > B3DFile->getPos()) // this chunk repeats
-		{
-			u32 globalVertexID;
+		// pairs of vertex id and weight, copied at once and split below
+		const u32 weightCount = (u32)(core::max_(getChunkEnd() - Pos, 0L) / (sizeof(u32) + sizeof(f32)));
+		std::vector<s32> pairs((size_t)weightCount * 2);
+		readInts(pairs.data(), pairs.size());
+		seek(getChunkEnd());
+
+		for (u32 w = 0; w < weightCount; ++w) {
+			u32 globalVertexID = (u32)pairs[w * 2];
 			f32 strength;
-			B3DFile->read(&globalVertexID, sizeof(globalVertexID));
-			B3DFile->read(&strength, sizeof(strength));
-#ifdef __BIG_ENDIAN__
-			globalVertexID = os::Byteswap::byteswap(globalVertexID);
-			strength = os::Byteswap::byteswap(strength);
-#endif
+			memcpy(&strength, &pairs[w * 2 + 1], sizeof(f32));
 			globalVertexID += VerticesStart;
 
 			if (globalVertexID >= AnimatedVertices_VertexID.size()) {
@@ -565,7 +610,7 @@ bool CB3DMeshFileLoader::readChunkBONE(SkinnedMesh::SJoint *inJoint)
 	return true;
 }
 
-bool CB3DMeshFileLoader::readChunkKEYS(SkinnedMesh::SJoint *inJoint)
+bool CB3DReader::readChunkKEYS(SkinnedMesh::SJoint *inJoint)
 {
 #ifdef _B3D_READER_DEBUG
 	// Only print first, that's just too much output otherwise
@@ -578,20 +623,26 @@ bool CB3DMeshFileLoader::readChunkKEYS(SkinnedMesh::SJoint *inJoint)
 	}
 #endif
 
-	s32 flags;
-	B3DFile->read(&flags, sizeof(flags));
-#ifdef __BIG_ENDIAN__
-	flags = os::Byteswap::byteswap(flags);
-#endif
+	const s32 flags = readInt();
 
-	while ((B3dStack.getLast().startposition + B3dStack.getLast().length) > B3DFile->getPos()) // this chunk repeats
-	{
-		s32 frame;
+	// a key is the frame followed by the floats selected by the flags
+	u32 keySize = 1;
+	if (flags & 1)
+		keySize += 3;
+	if (flags & 2)
+		keySize += 3;
+	if (flags & 4)
+		keySize += 4;
 
-		B3DFile->read(&frame, sizeof(frame));
-#ifdef __BIG_ENDIAN__
-		frame = os::Byteswap::byteswap(frame);
-#endif
+	const u32 keyCount = (u32)(core::max_(getChunkEnd() - Pos, 0L) / (keySize * sizeof(f32)));
+	std::vector<f32> keys((size_t)keyCount * keySize);
+	readFloats(keys.data(), keys.size());
+	seek(getChunkEnd());
+
+	for (u32 k = 0; k < keyCount; ++k) {
+		const f32 *key = &keys[k * keySize];
+		s32 frame;
+		memcpy(&frame, key++, sizeof(s32));
 
 		if (frame < 1) {
 			g_irrlogger->log("Illegal frame number found", B3DFile->getFileName(), ELL_ERROR);
@@ -599,26 +650,23 @@ bool CB3DMeshFileLoader::readChunkKEYS(SkinnedMesh::SJoint *inJoint)
 		}
 
 		// Add key frames, frames in Irrlicht are zero-based
-		f32 data[4];
 		if (flags & 1) {
-			readFloats(data, 3);
-			AnimatedMesh->addPositionKey(inJoint, frame - 1, {data[0], data[1], data[2]});
+			AnimatedMesh->addPositionKey(inJoint, frame - 1, {key[0], key[1], key[2]});
+			key += 3;
 		}
 		if (flags & 2) {
-			readFloats(data, 3);
-			AnimatedMesh->addScaleKey(inJoint, frame - 1, {data[0], data[1], data[2]});
-		}
-		if (flags & 4) {
-			readFloats(data, 4);
-			AnimatedMesh->addRotationKey(inJoint, frame - 1, core::quaternion(data[1], data[2], data[3], data[0]));
+			AnimatedMesh->addScaleKey(inJoint, frame - 1, {key[0], key[1], key[2]});
+			key += 3;
 		}
+		if (flags & 4)
+			AnimatedMesh->addRotationKey(inJoint, frame - 1, core::quaternion(key[1], key[2], key[3], key[0]));
 	}
 
 	B3dStack.erase(B3dStack.size() - 1);
 	return true;
 }
 
-bool CB3DMeshFileLoader::readChunkANIM()
+bool CB3DReader::readChunkANIM()
 {
 #ifdef _B3D_READER_DEBUG
 	core::stringc logStr;
@@ -628,27 +676,19 @@ bool CB3DMeshFileLoader::readChunkANIM()
 	g_irrlogger->log(logStr.c_str(), ELL_DEBUG);
 #endif
 
-	s32 animFlags;  // not stored\used
-	s32 animFrames; // not stored\used
-	f32 animFPS;    // not stored\used
-
-	B3DFile->read(&animFlags, sizeof(s32));
-	B3DFile->read(&animFrames, sizeof(s32));
+	readInt(); // flags, not stored\used
+	readInt(); // frames, not stored\used
+	f32 animFPS;
 	readFloats(&animFPS, 1);
 	if (animFPS > 0.f)
 		AnimatedMesh->setAnimationSpeed(animFPS);
 	g_irrlogger->log("FPS", io::path((double)animFPS), ELL_DEBUG);
 
-#ifdef __BIG_ENDIAN__
-	animFlags = os::Byteswap::byteswap(animFlags);
-	animFrames = os::Byteswap::byteswap(animFrames);
-#endif
-
 	B3dStack.erase(B3dStack.size() - 1);
 	return true;
 }
 
-bool CB3DMeshFileLoader::readChunkTEXS()
+bool CB3DReader::readChunkTEXS()
 {
 #ifdef _B3D_READER_DEBUG
 	core::stringc logStr;
@@ -658,7 +698,7 @@ bool CB3DMeshFileLoader::readChunkTEXS()
 	g_irrlogger->log(logStr.c_str(), ELL_DEBUG);
 #endif
 
-	while ((B3dStack.getLast().startposition + B3dStack.getLast().length) > B3DFile->getPos()) // this chunk repeats
+	while (getChunkEnd() > Pos) // this chunk repeats
 	{
 		Textures.push_back(SB3dTexture());
 		SB3dTexture &B3dTexture = Textures.getLast();
@@ -669,21 +709,19 @@ bool CB3DMeshFileLoader::readChunkTEXS()
 		g_irrlogger->log("read Texture", B3dTexture.TextureName.c_str(), ELL_DEBUG);
 #endif
 
-		B3DFile->read(&B3dTexture.Flags, sizeof(s32));
-		B3DFile->read(&B3dTexture.Blend, sizeof(s32));
-#ifdef __BIG_ENDIAN__
-		B3dTexture.Flags = os::Byteswap::byteswap(B3dTexture.Flags);
-		B3dTexture.Blend = os::Byteswap::byteswap(B3dTexture.Blend);
-#endif
+		B3dTexture.Flags = readInt();
+		B3dTexture.Blend = readInt();
 #ifdef _B3D_READER_DEBUG
 		g_irrlogger->log("Flags", core::stringc(B3dTexture.Flags).c_str(), ELL_DEBUG);
 		g_irrlogger->log("Blend", core::stringc(B3dTexture.Blend).c_str(), ELL_DEBUG);
 #endif
-		readFloats(&B3dTexture.Xpos, 1);
-		readFloats(&B3dTexture.Ypos, 1);
-		readFloats(&B3dTexture.Xscale, 1);
-		readFloats(&B3dTexture.Yscale, 1);
-		readFloats(&B3dTexture.Angle, 1);
+		f32 transform[5];
+		readFloats(transform, 5);
+		B3dTexture.Xpos = transform[0];
+		B3dTexture.Ypos = transform[1];
+		B3dTexture.Xscale = transform[2];
+		B3dTexture.Yscale = transform[3];
+		B3dTexture.Angle = transform[4];
 	}
 
 	B3dStack.erase(B3dStack.size() - 1);
@@ -691,7 +729,7 @@ bool CB3DMeshFileLoader::readChunkTEXS()
 	return true;
 }
 
-bool CB3DMeshFileLoader::readChunkBRUS()
+bool CB3DReader::readChunkBRUS()
 {
 #ifdef _B3D_READER_DEBUG
 	core::stringc logStr;
@@ -701,18 +739,14 @@ bool CB3DMeshFileLoader::readChunkBRUS()
 	g_irrlogger->log(logStr.c_str(), ELL_DEBUG);
 #endif
 
-	u32 n_texs;
-	B3DFile->read(&n_texs, sizeof(u32));
-#ifdef __BIG_ENDIAN__
-	n_texs = os::Byteswap::byteswap(n_texs);
-#endif
+	const u32 n_texs = (u32)readInt();
 
 	// number of texture ids read for Irrlicht
 	const u32 num_textures = core::min_(n_texs, video::MATERIAL_MAX_TEXTURES);
 	// number of bytes to skip (for ignored texture ids)
 	const u32 n_texs_offset = (num_textures < n_texs) ? (n_texs - num_textures) : 0;
 
-	while ((B3dStack.getLast().startposition + B3dStack.getLast().length) > B3DFile->getPos()) // this chunk repeats
+	while (getChunkEnd() > Pos) // this chunk repeats
 	{
 		// This is what blitz basic calls a brush, like a Irrlicht Material
 
@@ -723,18 +757,16 @@ bool CB3DMeshFileLoader::readChunkBRUS()
 		Materials.push_back(SB3dMaterial());
 		SB3dMaterial &B3dMaterial = Materials.getLast();
 
-		readFloats(&B3dMaterial.red, 1);
-		readFloats(&B3dMaterial.green, 1);
-		readFloats(&B3dMaterial.blue, 1);
-		readFloats(&B3dMaterial.alpha, 1);
-		readFloats(&B3dMaterial.shininess, 1);
+		f32 color[5];
+		readFloats(color, 5);
+		B3dMaterial.red = color[0];
+		B3dMaterial.green = color[1];
+		B3dMaterial.blue = color[2];
+		B3dMaterial.alpha = color[3];
+		B3dMaterial.shininess = color[4];
 
-		B3DFile->read(&B3dMaterial.blend, sizeof(B3dMaterial.blend));
-		B3DFile->read(&B3dMaterial.fx, sizeof(B3dMaterial.fx));
-#ifdef __BIG_ENDIAN__
-		B3dMaterial.blend = os::Byteswap::byteswap(B3dMaterial.blend);
-		B3dMaterial.fx = os::Byteswap::byteswap(B3dMaterial.fx);
-#endif
+		B3dMaterial.blend = readInt();
+		B3dMaterial.fx = readInt();
 #ifdef _B3D_READER_DEBUG
 		g_irrlogger->log("Blend", core::stringc(B3dMaterial.blend).c_str(), ELL_DEBUG);
 		g_irrlogger->log("FX", core::stringc(B3dMaterial.fx).c_str(), ELL_DEBUG);
@@ -742,11 +774,7 @@ bool CB3DMeshFileLoader::readChunkBRUS()
 
 		u32 i;
 		for (i = 0; i < num_textures; ++i) {
-			s32 texture_id = -1;
-			B3DFile->read(&texture_id, sizeof(s32));
-#ifdef __BIG_ENDIAN__
-			texture_id = os::Byteswap::byteswap(texture_id);
-#endif
+			const s32 texture_id = readInt();
 			//--- Get pointers to the texture, based on the IDs ---
 			if ((u32)texture_id < Textures.size()) {
 				B3dMaterial.Textures[i] = &Textures[texture_id];
@@ -759,11 +787,7 @@ bool CB3DMeshFileLoader::readChunkBRUS()
 		}
 		// skip other texture ids
 		for (i = 0; i < n_texs_offset; ++i) {
-			s32 texture_id = -1;
-			B3DFile->read(&texture_id, sizeof(s32));
-#ifdef __BIG_ENDIAN__
-			texture_id = os::Byteswap::byteswap(texture_id);
-#endif
+			const s32 texture_id = readInt();
 			if (ShowWarning && (texture_id != -1) && (n_texs > video::MATERIAL_MAX_TEXTURES)) {
 				g_irrlogger->log("Too many textures used in one material", B3DFile->getFileName(), ELL_WARNING);
 				ShowWarning = false;
@@ -835,27 +859,80 @@ bool CB3DMeshFileLoader::readChunkBRUS()
 	return true;
 }
 
-std::string CB3DMeshFileLoader::readString()
+std::string CB3DReader::readString()
 {
-	std::string newstring = "";
-	while (true) {
-		c8 character;
-		if (B3DFile->read(&character, sizeof(character)) == 0)
-			break; // eof
-		if (character == 0)
-			break;
-		newstring.push_back(character);
-	}
-	return newstring;
+	if (Pos >= (long)Data.size())
+		return std::string();
+
+	const c8 *begin = reinterpret_cast<const c8 *>(Data.data()) + Pos;
+	const c8 *end = static_cast<const c8 *>(memchr(begin, 0, Data.size() - Pos));
+	const size_t length = end ? end - begin : Data.size() - Pos;
+
+	// skip the terminator too
+	Pos += length + (end ? 1 : 0);
+	return std::string(begin, length);
+}
+
+void CB3DReader::readData(void *out, size_t size)
+{
+	const size_t available = Pos < (long)Data.size() ? Data.size() - Pos : 0;
+	const size_t copied = core::min_(size, available);
+	memcpy(out, Data.data() + Pos, copied);
+	// reading past the end yields zeroes like a short read of the file
+	memset((u8 *)out + copied, 0, size - copied);
+	Pos += size;
+}
+
+s32 CB3DReader::readInt()
+{
+	s32 value;
+	readData(&value, sizeof(value));
+#ifdef __BIG_ENDIAN__
+	value = os::Byteswap::byteswap(value);
+#endif
+	return value;
+}
+
+void CB3DReader::readInts(s32 *vec, size_t count)
+{
+	readData(vec, count * sizeof(s32));
+#ifdef __BIG_ENDIAN__
+	for (size_t n = 0; n < count; ++n)
+		vec[n] = os::Byteswap::byteswap(vec[n]);
+#endif
 }
 
-void CB3DMeshFileLoader::readFloats(f32 *vec, u32 count)
+void CB3DReader::readFloats(f32 *vec, size_t count)
 {
-	B3DFile->read(vec, count * sizeof(f32));
+	readData(vec, count * sizeof(f32));
 #ifdef __BIG_ENDIAN__
-	for (u32 n = 0; n < count; ++n)
+	for (size_t n = 0; n < count; ++n)
 		vec[n] = os::Byteswap::byteswap(vec[n]);
 #endif
 }
 
+SB3dChunkHeader CB3DReader::readChunkHeader()
+{
+	SB3dChunkHeader header;
+	readData(&header, sizeof(header));
+#ifdef __BIG_ENDIAN__
+	header.size = os::Byteswap::byteswap(header.size);
+#endif
+	return header;
+}
+
+long CB3DReader::getChunkEnd() const
+{
+	const SB3dChunk &chunk = B3dStack.getLast();
+	return core::min_(chunk.startposition + chunk.length, (long)Data.size());
+}
+
+bool CB3DReader::seek(long pos)
+{
+	if (pos < 0 || pos > (long)Data.size())
+		return false;
+	Pos = pos;
+	return true;
+}
+
 } // end namespace scene
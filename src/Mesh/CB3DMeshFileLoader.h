@@ -10,9 +10,6 @@
 
 #include "Mesh/IMeshLoader.h"
 #include "Scene/ISceneManager.h"
-#include "Mesh/SkinnedMesh.h"
-#include "Mesh/SB3DStructs.h"
-#include "IO/IReadFile.h"
 
 
 
@@ -36,42 +33,8 @@ public:
 	//! See IReferenceCounted::drop() for more information.
 	IAnimatedMesh *createMesh(io::IReadFile *file) override;
 
-private:
-	bool load();
-	bool readChunkNODE(SkinnedMesh::SJoint *InJoint);
-	bool readChunkMESH(SkinnedMesh::SJoint *InJoint);
-	bool readChunkVRTS(SkinnedMesh::SJoint *InJoint);
-	bool readChunkTRIS(scene::SSkinMeshBuffer *MeshBuffer, u32 MeshBufferID, s32 Vertices_Start);
-	bool readChunkBONE(SkinnedMesh::SJoint *InJoint);
-	bool readChunkKEYS(SkinnedMesh::SJoint *InJoint);
-	bool readChunkANIM();
-	bool readChunkTEXS();
-	bool readChunkBRUS();
-
-	std::string readString();
-	void readFloats(f32 *vec, u32 count);
-
-	core::array<SB3dChunk> B3dStack;
-
-	core::array<SB3dMaterial> Materials;
-	core::array<SB3dTexture> Textures;
-
-	core::array<s32> AnimatedVertices_VertexID;
-
-	core::array<s32> AnimatedVertices_BufferID;
-
-	core::array<scene::Vertex2TCoords> BaseVertices;
-
-	SkinnedMeshBuilder *AnimatedMesh;
-	io::IReadFile *B3DFile;
-
-	// B3Ds have Vertex ID's local within the mesh I don't want this
-	//  Variable needs to be class member due to recursion in calls
-	u32 VerticesStart;
-
-	bool NormalsInFile;
-	bool HasVertexColors;
-	bool ShowWarning;
+	//! The state of a load is kept per call
+	bool isReentrant() const override { return true; }
 };
 
 } // end namespace scene
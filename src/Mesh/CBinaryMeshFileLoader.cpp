@@ -0,0 +1,489 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CBinaryMeshFileLoader.h"
+#include "SBinaryMeshFormat.h"
+
+#include "Mesh/SAnimatedMesh.h"
+#include "Mesh/SMesh.h"
+#include "Mesh/SkinnedMesh.h"
+#include "Mesh/SSkinMeshBuffer.h"
+#include "Video/VideoDriver.h"
+#include "IO/IReadFile.h"
+#include "Utils/coreutil.h"
+#include "Device/Logger.h"
+
+namespace scene
+{
+
+namespace
+{
+//! Reads fields in memory layout, remembers if any read failed
+/** Arrays are checked against the rest of the file before they are
+allocated, so broken files can't request huge allocations. */
+class CReader
+{
+public:
+	CReader(io::IReadFile *file, video::VideoDriver *driver) :
+			File(file), Driver(driver), Ok(true) {}
+
+	bool isOk() const { return Ok; }
+
+	//! Marks the file as invalid
+	void fail() { Ok = false; }
+
+	void readData(void *data, size_t size)
+	{
+		if (Ok && size)
+			Ok = File->read(data, size) == size;
+	}
+
+	template <class T>
+	T read()
+	{
+		T value{};
+		readData(&value, sizeof(T));
+		return value;
+	}
+
+	//! Returns false if less than size bytes are left
+	bool hasBytes(size_t count, size_t size)
+	{
+		const size_t left = (size_t)(File->getSize() - File->getPos());
+		if (Ok && size && count > left / size)
+			Ok = false;
+		return Ok;
+	}
+
+	template <class T>
+	void readArray(std::vector<T> &values)
+	{
+		const u32 count = read<u32>();
+		if (!hasBytes(count, sizeof(T)))
+			return;
+		values.resize(count);
+		readData(values.data(), (size_t)count * sizeof(T));
+	}
+
+	void readWeights(std::vector<SkinnedMesh::SWeight> &weights)
+	{
+		const u32 count = read<u32>();
+		if (!hasBytes(count, sizeof(u16) + sizeof(u32) + sizeof(f32)))
+			return;
+		weights.resize(count);
+		for (auto &weight : weights) {
+			weight.buffer_id = read<u16>();
+			weight.vertex_id = read<u32>();
+			weight.strength = read<f32>();
+		}
+	}
+
+	std::string readString()
+	{
+		const u32 size = read<u32>();
+		if (!hasBytes(size, 1))
+			return "";
+		std::string text(size, '\0');
+		readData(text.data(), size);
+		return text;
+	}
+
+	std::optional<std::string> readName()
+	{
+		if (!read<u8>())
+			return std::nullopt;
+		return readString();
+	}
+
+	core::matrix4 readMatrix()
+	{
+		core::matrix4 m;
+		readData(m.pointer(), 16 * sizeof(f32));
+		return m;
+	}
+
+	core::vector3df readVector()
+	{
+		core::vector3df v;
+		v.X = read<f32>();
+		v.Y = read<f32>();
+		v.Z = read<f32>();
+		return v;
+	}
+
+	core::aabbox3df readBox()
+	{
+		core::aabbox3df box{{0, 0, 0}};
+		box.MinEdge = readVector();
+		box.MaxEdge = readVector();
+		return box;
+	}
+
+	template <class T>
+	void readChannel(SkinnedMesh::Channel<T> &channel)
+	{
+		channel.interpolate = read<u8>() != 0;
+		readArray(channel.frames);
+
+		auto &packed = channel.packed;
+		packed.count = read<u32>();
+		packed.start = read<f32>();
+		packed.interval = read<f32>();
+		readArray(packed.times);
+		readArray(packed.values);
+		packed.min = readVector();
+		packed.extent = readVector();
+
+		if (packed.values.size() != (size_t)packed.count * 3 ||
+				(!packed.times.empty() && packed.times.size() != packed.count))
+			Ok = false;
+	}
+
+	void readMaterial(video::SMaterial &material);
+
+	//! Fields of a buffer preceding its vertices
+	struct SBufferHeader
+	{
+		video::SMaterial Material;
+		u32 TextureSlot = 0;
+		E_PRIMITIVE_TYPE PrimitiveType = EPT_TRIANGLES;
+		E_HARDWARE_MAPPING VertexHint = EHM_NEVER;
+		E_HARDWARE_MAPPING IndexHint = EHM_NEVER;
+		core::aabbox3df Box{{0, 0, 0}};
+		E_VERTEX_TYPE VertexType = EVT_3D;
+		u32 VertexSize = 0;
+		u32 VertexCount = 0;
+	};
+
+	void readBufferHeader(SBufferHeader &header);
+
+	//! Reads the vertices following a buffer header
+	template <class T>
+	void readVertices(const SBufferHeader &header, std::vector<T> &vertices)
+	{
+		if (header.VertexSize != sizeof(T) || !hasBytes(header.VertexCount, sizeof(T))) {
+			Ok = false;
+			return;
+		}
+		vertices.resize(header.VertexCount);
+		readData(vertices.data(), (size_t)header.VertexCount * sizeof(T));
+	}
+
+	void readIndices(const SBufferHeader &header, std::vector<u16> &indices)
+	{
+		readArray(indices);
+		for (u16 index : indices) {
+			if (index >= header.VertexCount) {
+				Ok = false;
+				return;
+			}
+		}
+	}
+
+private:
+	io::IReadFile *File;
+	video::VideoDriver *Driver;
+	bool Ok;
+};
+
+void CReader::readMaterial(video::SMaterial &material)
+{
+	material.MaterialType = (video::E_MATERIAL_TYPE)read<u32>();
+	material.ColorParam = video::SColor(read<u32>());
+	material.Thickness = read<f32>();
+	material.BlendMode = (video::E_BLEND_MODE)read<u32>();
+	material.AlphaSource = read<u8>();
+	material.PolygonOffsetDepthBias = read<f32>();
+	material.PolygonOffsetSlopeScale = read<f32>();
+	material.ZBuffer = (video::E_COMPARISON_FUNC)read<u32>();
+	material.StencilBuffer = (video::E_COMPARISON_FUNC)read<u32>();
+	material.AntiAliasing = (video::E_ANTI_ALIASING_MODE)read<u32>();
+	material.ColorMask = (video::E_COLOR_PLANE)read<u32>();
+	material.Wireframe = read<u8>() != 0;
+	material.PointCloud = read<u8>() != 0;
+	material.ZWriteEnable = (video::E_ZWRITE)read<u32>();
+	material.BackfaceCulling = read<u8>() != 0;
+	material.FrontfaceCulling = read<u8>() != 0;
+	material.FogEnable = read<u8>() != 0;
+	material.UseMipMaps = read<u8>() != 0;
+
+	for (u32 i = 0; i < video::MATERIAL_MAX_TEXTURES; ++i) {
+		video::SMaterialLayer &layer = material.TextureLayers[i];
+
+		const std::string texture = readString();
+		if (!texture.empty() && Driver && Ok)
+			layer.Texture = Driver->getTexture(texture.c_str());
+
+		layer.TextureWrapU = read<u8>();
+		layer.TextureWrapV = read<u8>();
+		layer.TextureWrapW = read<u8>();
+		layer.MinFilter = (video::E_TEXTURE_MIN_FILTER)read<u32>();
+		layer.MagFilter = (video::E_TEXTURE_MAG_FILTER)read<u32>();
+		layer.AnisotropicFilter = read<u8>();
+		layer.LODBias = read<s8>();
+
+		if (read<u8>())
+			layer.setTextureMatrix(readMatrix());
+	}
+}
+
+void CReader::readBufferHeader(SBufferHeader &header)
+{
+	readMaterial(header.Material);
+	header.TextureSlot = read<u32>();
+	header.PrimitiveType = (E_PRIMITIVE_TYPE)read<u32>();
+	header.VertexHint = (E_HARDWARE_MAPPING)read<u8>();
+	header.IndexHint = (E_HARDWARE_MAPPING)read<u8>();
+	header.Box = readBox();
+	header.VertexType = (E_VERTEX_TYPE)read<u32>();
+	header.VertexSize = read<u32>();
+	header.VertexCount = read<u32>();
+}
+
+template <class T>
+IMeshBuffer *readStaticBuffer(CReader &reader, const CReader::SBufferHeader &header)
+{
+	CMeshBuffer<T> *buffer = new CMeshBuffer<T>();
+	reader.readVertices(header, buffer->Vertices->Data);
+	reader.readIndices(header, buffer->Indices->Data);
+	return buffer;
+}
+
+IAnimatedMesh *readStaticMesh(CReader &reader)
+{
+	const E_ANIMATED_MESH_TYPE type = (E_ANIMATED_MESH_TYPE)reader.read<u32>();
+	const f32 fps = reader.read<f32>();
+	const core::aabbox3df box = reader.readBox();
+
+	SMesh *mesh = new SMesh();
+
+	const u32 bufferCount = reader.read<u32>();
+	for (u32 i = 0; i < bufferCount && reader.isOk(); ++i) {
+		CReader::SBufferHeader header;
+		reader.readBufferHeader(header);
+
+		IMeshBuffer *buffer = nullptr;
+		switch (header.VertexType) {
+		case EVT_3D:
+			buffer = readStaticBuffer<Vertex3D>(reader, header);
+			break;
+		case EVT_2TCOORDS:
+			buffer = readStaticBuffer<Vertex2TCoords>(reader, header);
+			break;
+		case EVT_TANGENTS:
+			buffer = readStaticBuffer<VertexTangents>(reader, header);
+			break;
+		default:
+			break;
+		}
+
+		if (!buffer)
+			break;
+
+		buffer->getMaterial() = header.Material;
+		buffer->setPrimitiveType(header.PrimitiveType);
+		buffer->setHardwareMappingHint(header.VertexHint, EBF_VERTEX);
+		buffer->setHardwareMappingHint(header.IndexHint, EBF_INDEX);
+		buffer->setBoundingBox(header.Box);
+
+		mesh->addMeshBuffer(buffer);
+		mesh->setTextureSlot(i, header.TextureSlot);
+		buffer->drop();
+	}
+
+	if (!reader.isOk() || mesh->getMeshBufferCount() != bufferCount) {
+		mesh->drop();
+		return nullptr;
+	}
+
+	mesh->setBoundingBox(box);
+
+	SAnimatedMesh *animatedMesh = new SAnimatedMesh(mesh, type);
+	animatedMesh->setAnimationSpeed(fps);
+	mesh->drop();
+	return animatedMesh;
+}
+
+IAnimatedMesh *readSkinnedMesh(CReader &reader)
+{
+	const u32 format = reader.read<u32>();
+	if (format > (u32)SkinnedMesh::SourceFormat::OTHER)
+		return nullptr;
+
+	SkinnedMeshBuilder *mesh = new SkinnedMeshBuilder((SkinnedMesh::SourceFormat)format);
+	const f32 fps = reader.read<f32>();
+
+	const u32 bufferCount = reader.read<u32>();
+	for (u32 i = 0; i < bufferCount && reader.isOk(); ++i) {
+		CReader::SBufferHeader header;
+		reader.readBufferHeader(header);
+
+		SSkinMeshBuffer *buffer = mesh->addMeshBuffer();
+		buffer->VertexType = header.VertexType;
+		switch (header.VertexType) {
+		case EVT_3D:
+			reader.readVertices(header, buffer->Vertices_Standard->Data);
+			break;
+		case EVT_2TCOORDS:
+			reader.readVertices(header, buffer->Vertices_2TCoords->Data);
+			break;
+		case EVT_TANGENTS:
+			reader.readVertices(header, buffer->Vertices_Tangents->Data);
+			break;
+		default:
+			buffer->VertexType = EVT_3D;
+			reader.fail();
+			break;
+		}
+		reader.readIndices(header, buffer->Indices->Data);
+
+		buffer->Material = header.Material;
+		buffer->PrimitiveType = header.PrimitiveType;
+		buffer->setHardwareMappingHint(header.VertexHint, EBF_VERTEX);
+		buffer->setHardwareMappingHint(header.IndexHint, EBF_INDEX);
+		buffer->BoundingBox = header.Box;
+		buffer->BoundingBoxNeedsRecalculated = false;
+		buffer->Transformation = reader.readMatrix();
+		mesh->setTextureSlot(i, header.TextureSlot);
+	}
+
+	// joints are linked to their children after all exist
+	const u32 jointCount = reader.isOk() ? reader.read<u32>() : 0;
+	if (reader.hasBytes(jointCount, 16 * sizeof(f32))) {
+		for (u32 i = 0; i < jointCount; ++i)
+			mesh->addJoint();
+	}
+
+	const auto &joints = mesh->getAllJoints();
+	std::vector<bool> hasParent(jointCount, false);
+	for (u32 i = 0; i < jointCount && reader.isOk(); ++i) {
+		SkinnedMesh::SJoint *joint = joints[i];
+		joint->Name = reader.readName();
+		joint->LocalMatrix = reader.readMatrix();
+
+		std::vector<u32> children;
+		reader.readArray(children);
+		for (u32 child : children) {
+			if (child >= jointCount || hasParent[child]) {
+				reader.fail();
+				break;
+			}
+			hasParent[child] = true;
+			joint->Children.push_back(joints[child]);
+		}
+
+		reader.readArray(joint->AttachedMeshes);
+		for (u32 buffer : joint->AttachedMeshes) {
+			if (buffer >= bufferCount)
+				reader.fail();
+		}
+
+		reader.readChannel(joint->keys.position);
+		reader.readChannel(joint->keys.rotation);
+		reader.readChannel(joint->keys.scale);
+		reader.readWeights(joint->Weights);
+		for (const auto &weight : joint->Weights) {
+			if (weight.buffer_id >= bufferCount ||
+					weight.vertex_id >= mesh->getMeshBuffer(weight.buffer_id)->getVertexCount())
+				reader.fail();
+		}
+
+		joint->Animatedposition = reader.readVector();
+		joint->Animatedscale = reader.readVector();
+		joint->Animatedrotation = reader.read<core::quaternion>();
+
+		if (reader.read<u8>())
+			joint->GlobalInversedMatrix = reader.readMatrix();
+	}
+
+	// with one parent each, joints not reachable from a root joint form a cycle
+	if (reader.isOk()) {
+		std::vector<SkinnedMesh::SJoint *> stack;
+		for (u32 i = 0; i < jointCount; ++i) {
+			if (!hasParent[i])
+				stack.push_back(joints[i]);
+		}
+
+		u32 reached = 0;
+		while (!stack.empty()) {
+			SkinnedMesh::SJoint *joint = stack.back();
+			stack.pop_back();
+			++reached;
+			stack.insert(stack.end(), joint->Children.begin(), joint->Children.end());
+		}
+		if (reached != jointCount)
+			reader.fail();
+	}
+
+	const u32 targetCount = reader.isOk() ? reader.read<u32>() : 0;
+	for (u32 i = 0; i < targetCount && reader.isOk(); ++i) {
+		std::optional<std::string> name = reader.readName();
+		SkinnedMesh::SMorphTarget *target = mesh->addMorphTarget(reader.read<u32>());
+		target->Name = std::move(name);
+		reader.readArray(target->VertexIds);
+		reader.readArray(target->PositionDeltas);
+		reader.readArray(target->NormalDeltas);
+		if (target->PositionDeltas.size() != (size_t)target->VertexIds.size() * 4 ||
+				(!target->NormalDeltas.empty() && target->NormalDeltas.size() != target->PositionDeltas.size()))
+			reader.fail();
+		reader.readChannel(target->Weights);
+		target->DefaultWeight = reader.read<f32>();
+	}
+
+	if (!reader.isOk() || mesh->getAllJoints().size() != jointCount) {
+		mesh->drop();
+		return nullptr;
+	}
+
+	// morph deltas pointing outside the buffers are dropped by finalize
+	mesh->setAnimationSpeed(fps);
+	return mesh->finalize();
+}
+}
+
+//! Constructor
+CBinaryMeshFileLoader::CBinaryMeshFileLoader(scene::ISceneManager *smgr) :
+		SceneManager(smgr)
+{}
+
+//! returns true if the file maybe is able to be loaded by this class
+//! based on the file extension (e.g. ".bsp")
+bool CBinaryMeshFileLoader::isALoadableFileExtension(const io::path &filename) const
+{
+	return core::hasFileExtension(filename, binarymesh::EXTENSION);
+}
+
+//! creates/loads an animated mesh from the file.
+//! \return Pointer to the created mesh. Returns 0 if loading failed.
+//! If you no longer need the mesh, you should call IAnimatedMesh::drop().
+//! See IReferenceCounted::drop() for more information.
+IAnimatedMesh *CBinaryMeshFileLoader::createMesh(io::IReadFile *file)
+{
+	if (!file)
+		return 0;
+
+	CReader reader(file, SceneManager ? SceneManager->getVideoDriver() : nullptr);
+
+	binarymesh::SHeader header;
+	reader.readData(&header, sizeof(header));
+	if (!reader.isOk() || header.Magic != binarymesh::MAGIC)
+		return 0;
+
+	if (header.ByteOrder != binarymesh::BYTE_ORDER_MARK || header.Version != binarymesh::VERSION) {
+		g_irrlogger->log("Binary mesh was written by another version or machine", file->getFileName(), ELL_WARNING);
+		return 0;
+	}
+
+	IAnimatedMesh *mesh = nullptr;
+	if (header.Kind == binarymesh::EMK_STATIC)
+		mesh = readStaticMesh(reader);
+	else if (header.Kind == binarymesh::EMK_SKINNED)
+		mesh = readSkinnedMesh(reader);
+
+	if (!mesh)
+		g_irrlogger->log("Could not load binary mesh, file is invalid", file->getFileName(), ELL_ERROR);
+	return mesh;
+}
+
+} // end namespace scene
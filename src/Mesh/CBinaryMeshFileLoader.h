@@ -0,0 +1,37 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Mesh/IMeshLoader.h"
+#include "Scene/ISceneManager.h"
+
+namespace scene
+{
+
+//! Meshloader for the binary meshes written by CBinaryMeshWriter
+/** Vertices, indices, keys, weights and morph deltas are read into their
+arrays with a single read each, nothing is parsed or converted per vertex.
+Skinned meshes are finalized like after any other loader. */
+class CBinaryMeshFileLoader : public IMeshLoader
+{
+public:
+	//! Constructor
+	CBinaryMeshFileLoader(scene::ISceneManager *smgr);
+
+	//! returns true if the file maybe is able to be loaded by this class
+	//! based on the file extension (e.g. ".bsp")
+	bool isALoadableFileExtension(const io::path &filename) const override;
+
+	//! creates/loads an animated mesh from the file.
+	//! \return Pointer to the created mesh. Returns 0 if loading failed.
+	//! If you no longer need the mesh, you should call IAnimatedMesh::drop().
+	//! See IReferenceCounted::drop() for more information.
+	IAnimatedMesh *createMesh(io::IReadFile *file) override;
+
+private:
+	scene::ISceneManager *SceneManager;
+};
+
+} // end namespace scene
@@ -0,0 +1,306 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CBinaryMeshWriter.h"
+#include "SBinaryMeshFormat.h"
+
+#include "Mesh/SkinnedMesh.h"
+#include "Mesh/SSkinMeshBuffer.h"
+#include "Video/Texture.h"
+#include "Device/Logger.h"
+
+#include <unordered_map>
+
+namespace scene
+{
+
+namespace
+{
+//! Writes fields in memory layout, remembers if any write failed
+class CWriter
+{
+public:
+	CWriter(io::IWriteFile *file) :
+			File(file), Ok(true) {}
+
+	bool isOk() const { return Ok; }
+
+	void writeData(const void *data, size_t size)
+	{
+		if (Ok && size)
+			Ok = File->write(data, size) == size;
+	}
+
+	template <class T>
+	void write(const T &value)
+	{
+		writeData(&value, sizeof(T));
+	}
+
+	template <class T>
+	void writeArray(const std::vector<T> &values)
+	{
+		write<u32>(values.size());
+		writeData(values.data(), values.size() * sizeof(T));
+	}
+
+	void writeString(const std::string &text)
+	{
+		write<u32>(text.size());
+		writeData(text.data(), text.size());
+	}
+
+	void writeName(const std::optional<std::string> &name)
+	{
+		write<u8>(name.has_value());
+		if (name)
+			writeString(*name);
+	}
+
+	void writeMatrix(const core::matrix4 &m)
+	{
+		writeData(m.pointer(), 16 * sizeof(f32));
+	}
+
+	void writeVector(const core::vector3df &v)
+	{
+		write(v.X);
+		write(v.Y);
+		write(v.Z);
+	}
+
+	void writeBox(const core::aabbox3df &box)
+	{
+		writeVector(box.MinEdge);
+		writeVector(box.MaxEdge);
+	}
+
+	template <class T>
+	void writeChannel(const SkinnedMesh::Channel<T> &channel)
+	{
+		write<u8>(channel.interpolate);
+		writeArray(channel.frames);
+
+		const auto &packed = channel.packed;
+		write(packed.count);
+		write(packed.start);
+		write(packed.interval);
+		writeArray(packed.times);
+		writeArray(packed.values);
+		writeVector(packed.min);
+		writeVector(packed.extent);
+	}
+
+	//! Written field by field, SWeight has padding bytes
+	void writeWeights(const std::vector<SkinnedMesh::SWeight> &weights)
+	{
+		write<u32>(weights.size());
+		for (const auto &weight : weights) {
+			write(weight.buffer_id);
+			write(weight.vertex_id);
+			write(weight.strength);
+		}
+	}
+
+	void writeMaterial(const video::SMaterial &material);
+
+	//! Writes the vertices, indices and material of a buffer
+	/** \return False if the buffer can't be stored. */
+	bool writeBuffer(const IMeshBuffer *buffer, u32 textureSlot);
+
+private:
+	io::IWriteFile *File;
+	bool Ok;
+};
+
+void CWriter::writeMaterial(const video::SMaterial &material)
+{
+	write<u32>(material.MaterialType);
+	write<u32>(material.ColorParam.color);
+	write(material.Thickness);
+	write<u32>(material.BlendMode);
+	write(material.AlphaSource);
+	write(material.PolygonOffsetDepthBias);
+	write(material.PolygonOffsetSlopeScale);
+	write<u32>(material.ZBuffer);
+	write<u32>(material.StencilBuffer);
+	write<u32>(material.AntiAliasing);
+	write<u32>(material.ColorMask);
+	write<u8>(material.Wireframe);
+	write<u8>(material.PointCloud);
+	write<u32>(material.ZWriteEnable);
+	write<u8>(material.BackfaceCulling);
+	write<u8>(material.FrontfaceCulling);
+	write<u8>(material.FogEnable);
+	write<u8>(material.UseMipMaps);
+
+	// textures by name, the driver loads or finds them again
+	for (u32 i = 0; i < video::MATERIAL_MAX_TEXTURES; ++i) {
+		const video::SMaterialLayer &layer = material.TextureLayers[i];
+		writeString(layer.Texture ? layer.Texture->getName().getPath().c_str() : "");
+		write(layer.TextureWrapU);
+		write(layer.TextureWrapV);
+		write(layer.TextureWrapW);
+		write<u32>(layer.MinFilter);
+		write<u32>(layer.MagFilter);
+		write(layer.AnisotropicFilter);
+		write(layer.LODBias);
+
+		const core::matrix4 &matrix = layer.getTextureMatrix();
+		write<u8>(!matrix.isIdentity());
+		if (!matrix.isIdentity())
+			writeMatrix(matrix);
+	}
+}
+
+bool CWriter::writeBuffer(const IMeshBuffer *buffer, u32 textureSlot)
+{
+	const IVertexBuffer *vertices = buffer->getVertexBuffer();
+	const IIndexBuffer *indices = buffer->getIndexBuffer();
+	if (indices->getType() != video::EIT_16BIT) {
+		g_irrlogger->log("Binary mesh writer: Only 16 bit indices are supported", ELL_ERROR);
+		return false;
+	}
+
+	writeMaterial(buffer->getMaterial());
+	write(textureSlot);
+	write<u32>(buffer->getPrimitiveType());
+	write<u8>(vertices->getHardwareMappingHint());
+	write<u8>(indices->getHardwareMappingHint());
+	writeBox(buffer->getBoundingBox());
+
+	const u32 vertexSize = getVertexTypeDescription(vertices->getType()).Size;
+	write<u32>(vertices->getType());
+	write(vertexSize);
+	write(vertices->getCount());
+	writeData(vertices->getData(), (size_t)vertices->getCount() * vertexSize);
+
+	write(indices->getCount());
+	writeData(indices->getData(), (size_t)indices->getCount() * sizeof(u16));
+	return true;
+}
+
+bool writeStaticMesh(CWriter &writer, IAnimatedMesh *animatedMesh)
+{
+	IMesh *mesh = animatedMesh->getMesh(0);
+	if (!mesh)
+		return false;
+
+	writer.write<u32>(animatedMesh->getMeshType());
+	writer.write(animatedMesh->getAnimationSpeed());
+	writer.writeBox(mesh->getBoundingBox());
+
+	writer.write(mesh->getMeshBufferCount());
+	for (u32 i = 0; i < mesh->getMeshBufferCount(); ++i) {
+		const IMeshBuffer *buffer = mesh->getMeshBuffer(i);
+		const E_VERTEX_TYPE type = buffer->getVertexType();
+		if (type != EVT_3D && type != EVT_2TCOORDS && type != EVT_TANGENTS) {
+			g_irrlogger->log("Binary mesh writer: Unsupported vertex type of a static mesh", ELL_ERROR);
+			return false;
+		}
+
+		if (!writer.writeBuffer(buffer, mesh->getTextureSlot(i)))
+			return false;
+	}
+	return true;
+}
+
+bool writeSkinnedMesh(CWriter &writer, SkinnedMesh *mesh)
+{
+	// the buffers may hold a skinned pose
+	mesh->resetAnimation();
+
+	writer.write<u32>((u32)mesh->getSourceFormat());
+	writer.write(mesh->getAnimationSpeed());
+
+	writer.write(mesh->getMeshBufferCount());
+	for (u32 i = 0; i < mesh->getMeshBufferCount(); ++i) {
+		auto *buffer = static_cast<SSkinMeshBuffer *>(mesh->getMeshBuffer(i));
+
+		if (buffer->VertexType == EVT_SKINNED) {
+			// hardware skinning is set up again after loading, store the standard vertices
+			SSkinMeshBuffer standard(*buffer, true);
+			standard.convertToStandard();
+			if (!writer.writeBuffer(&standard, mesh->getTextureSlot(i)))
+				return false;
+		} else if (!writer.writeBuffer(buffer, mesh->getTextureSlot(i))) {
+			return false;
+		}
+		writer.writeMatrix(buffer->Transformation);
+	}
+
+	const auto &joints = mesh->getAllJoints();
+	std::unordered_map<const SkinnedMesh::SJoint *, u32> jointIds;
+	for (u32 i = 0; i < joints.size(); ++i)
+		jointIds[joints[i]] = i;
+
+	writer.write<u32>(joints.size());
+	for (const auto *joint : joints) {
+		writer.writeName(joint->Name);
+		writer.writeMatrix(joint->LocalMatrix);
+
+		std::vector<u32> children;
+		children.reserve(joint->Children.size());
+		for (const auto *child : joint->Children)
+			children.push_back(jointIds.at(child));
+		writer.writeArray(children);
+		writer.writeArray(joint->AttachedMeshes);
+
+		writer.writeChannel(joint->keys.position);
+		writer.writeChannel(joint->keys.rotation);
+		writer.writeChannel(joint->keys.scale);
+		writer.writeWeights(joint->Weights);
+
+		writer.writeVector(joint->Animatedposition);
+		writer.writeVector(joint->Animatedscale);
+		writer.write(joint->Animatedrotation);
+
+		writer.write<u8>(joint->GlobalInversedMatrix.has_value());
+		if (joint->GlobalInversedMatrix)
+			writer.writeMatrix(*joint->GlobalInversedMatrix);
+	}
+
+	const auto &targets = mesh->getMorphTargets();
+	writer.write<u32>(targets.size());
+	for (const auto *target : targets) {
+		writer.writeName(target->Name);
+		writer.write(target->Buffer);
+		writer.writeArray(target->VertexIds);
+		writer.writeArray(target->PositionDeltas);
+		writer.writeArray(target->NormalDeltas);
+		writer.writeChannel(target->Weights);
+		writer.write(target->DefaultWeight);
+	}
+	return true;
+}
+}
+
+//! Writes a mesh to a file
+bool CBinaryMeshWriter::writeMesh(io::IWriteFile *file, IAnimatedMesh *mesh)
+{
+	if (!file || !mesh)
+		return false;
+
+	const bool skinned = mesh->getMeshType() == EAMT_SKINNED;
+
+	CWriter writer(file);
+	binarymesh::SHeader header;
+	header.Magic = binarymesh::MAGIC;
+	header.Version = binarymesh::VERSION;
+	header.ByteOrder = binarymesh::BYTE_ORDER_MARK;
+	header.Kind = skinned ? binarymesh::EMK_SKINNED : binarymesh::EMK_STATIC;
+	writer.write(header);
+
+	const bool written = skinned ?
+			writeSkinnedMesh(writer, static_cast<SkinnedMesh *>(mesh)) :
+			writeStaticMesh(writer, mesh);
+
+	if (!written || !writer.isOk()) {
+		g_irrlogger->log("Binary mesh writer: Could not write mesh", file->getFileName(), ELL_ERROR);
+		return false;
+	}
+	return true;
+}
+
+} // end namespace scene
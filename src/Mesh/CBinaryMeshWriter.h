@@ -0,0 +1,27 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Mesh/IAnimatedMesh.h"
+#include "IO/IWriteFile.h"
+
+namespace scene
+{
+
+//! Writes meshes in the binary format of CBinaryMeshFileLoader
+/** Supports SkinnedMeshes, including their joints, keys, weights and morph
+targets, and static meshes made of CMeshBuffers with 16 bit indices. Textures
+of the materials are stored by their names and looked up by the driver when
+loading. See SBinaryMeshFormat.h for the layout. */
+class CBinaryMeshWriter
+{
+public:
+	//! Writes a mesh to a file
+	/** Skinned meshes are moved to their rest pose first.
+	\return False if the mesh isn't supported or writing failed. */
+	bool writeMesh(io::IWriteFile *file, IAnimatedMesh *mesh);
+};
+
+} // end namespace scene
@@ -0,0 +1,1203 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CGLTFMeshFileLoader.h"
+
+#include "Mesh/MeshManipulator.h"
+#include "Mesh/SkinnedMesh.h"
+#include "Mesh/SSkinMeshBuffer.h"
+#include "Video/VideoDriver.h"
+#include "IO/IFileSystem.h"
+#include "IO/IReadFile.h"
+#include "IO/CJsonParser.h"
+#include "Utils/coreutil.h"
+#include "Device/Logger.h"
+#include "Device/byteswap.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace scene
+{
+
+namespace
+{
+const u32 GLB_MAGIC = 0x46546C67; // "glTF"
+const u32 GLB_CHUNK_JSON = 0x4E4F534A;
+const u32 GLB_CHUNK_BIN = 0x004E4942;
+
+//! glTF keys are in seconds, the frames of the mesh run at this speed
+const f32 GLTF_FRAMES_PER_SECOND = 30.f;
+
+//! Component types of accessors
+enum E_GLTF_COMPONENT
+{
+	EGC_BYTE = 5120,
+	EGC_UNSIGNED_BYTE = 5121,
+	EGC_SHORT = 5122,
+	EGC_UNSIGNED_SHORT = 5123,
+	EGC_UNSIGNED_INT = 5125,
+	EGC_FLOAT = 5126
+};
+
+//! Primitive mode of triangle lists, the only one loaded
+const u32 GLTF_MODE_TRIANGLES = 4;
+
+u32 getComponentSize(u32 componentType)
+{
+	switch (componentType) {
+	case EGC_BYTE:
+	case EGC_UNSIGNED_BYTE:
+		return 1;
+	case EGC_SHORT:
+	case EGC_UNSIGNED_SHORT:
+		return 2;
+	case EGC_UNSIGNED_INT:
+	case EGC_FLOAT:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+u32 getComponentCount(const std::string &type)
+{
+	if (type == "SCALAR")
+		return 1;
+	if (type == "VEC2")
+		return 2;
+	if (type == "VEC3")
+		return 3;
+	if (type == "VEC4" || type == "MAT2")
+		return 4;
+	if (type == "MAT3")
+		return 9;
+	if (type == "MAT4")
+		return 16;
+	return 0;
+}
+
+u32 readLittleEndian(const u8 *src)
+{
+	u32 value;
+	memcpy(&value, src, 4);
+#ifdef __BIG_ENDIAN__
+	value = os::Byteswap::byteswap(value);
+#endif
+	return value;
+}
+
+//! Reads an integer component, e.g. an index
+u32 readIndex(const u8 *src, u32 componentType)
+{
+	switch (componentType) {
+	case EGC_UNSIGNED_BYTE:
+		return *src;
+	case EGC_UNSIGNED_SHORT: {
+		u16 value;
+		memcpy(&value, src, 2);
+#ifdef __BIG_ENDIAN__
+		value = os::Byteswap::byteswap(value);
+#endif
+		return value;
+	}
+	case EGC_UNSIGNED_INT:
+		return readLittleEndian(src);
+	default:
+		return 0;
+	}
+}
+
+//! Reads a component as float, normalized integers are mapped to [0, 1] or [-1, 1]
+f32 readComponent(const u8 *src, u32 componentType, bool normalized)
+{
+	switch (componentType) {
+	case EGC_FLOAT: {
+		const u32 bits = readLittleEndian(src);
+		f32 value;
+		memcpy(&value, &bits, 4);
+		return value;
+	}
+	case EGC_BYTE: {
+		const s8 value = (s8)*src;
+		return normalized ? std::max(value / 127.f, -1.f) : value;
+	}
+	case EGC_SHORT: {
+		const s16 value = (s16)readIndex(src, EGC_UNSIGNED_SHORT);
+		return normalized ? std::max(value / 32767.f, -1.f) : value;
+	}
+	case EGC_UNSIGNED_BYTE:
+		return normalized ? *src / 255.f : *src;
+	case EGC_UNSIGNED_SHORT: {
+		const u32 value = readIndex(src, EGC_UNSIGNED_SHORT);
+		return normalized ? value / 65535.f : value;
+	}
+	case EGC_UNSIGNED_INT:
+		return (f32)readLittleEndian(src);
+	default:
+		return 0.f;
+	}
+}
+
+//! Decodes base64, false on invalid characters
+bool decodeBase64(std::string_view text, std::vector<u8> &out)
+{
+	const auto decode = [](char c) -> s32 {
+		if (c >= 'A' && c <= 'Z')
+			return c - 'A';
+		if (c >= 'a' && c <= 'z')
+			return c - 'a' + 26;
+		if (c >= '0' && c <= '9')
+			return c - '0' + 52;
+		if (c == '+' || c == '-')
+			return 62;
+		if (c == '/' || c == '_')
+			return 63;
+		return -1;
+	};
+
+	out.clear();
+	out.reserve(text.size() / 4 * 3);
+
+	u32 bits = 0;
+	u32 count = 0;
+	for (char c : text) {
+		if (c == '=')
+			break;
+		const s32 value = decode(c);
+		if (value < 0)
+			return false;
+
+		bits = (bits << 6) | value;
+		count += 6;
+		if (count >= 8) {
+			count -= 8;
+			out.push_back((u8)(bits >> count));
+		}
+	}
+	return true;
+}
+
+//! Decodes %XX escapes of relative URIs
+std::string decodeUri(const std::string &uri)
+{
+	std::string out;
+	for (size_t i = 0; i < uri.size(); ++i) {
+		if (uri[i] == '%' && i + 2 < uri.size()) {
+			const std::string hex = uri.substr(i + 1, 2);
+			char *end;
+			const long value = strtol(hex.c_str(), &end, 16);
+			if (end == hex.c_str() + 2) {
+				out += (char)value;
+				i += 2;
+				continue;
+			}
+		}
+		out += uri[i];
+	}
+	return out;
+}
+
+//! Returns an optional byte offset or length, 0 if it is missing
+/** Invalid values become ~0u, which fails the bounds checks. */
+u32 getByteCount(const io::SJsonValue &object, const char *key)
+{
+	return object.get(key) ? object.getUInt(key, ~0u) : 0;
+}
+
+// glTF is right-handed, flipping Z converts it
+
+core::vector3df convertHandedness(const core::vector3df &v)
+{
+	return core::vector3df(v.X, v.Y, -v.Z);
+}
+
+core::quaternion convertHandedness(const core::quaternion &q)
+{
+	// The rotation mirrored on the XY plane is (-x, -y, z, w). The joints
+	// build their matrices with getMatrix_transposed(), which inverts it.
+	return core::quaternion(q.X, q.Y, -q.Z, q.W);
+}
+
+core::matrix4 convertHandedness(const core::matrix4 &m)
+{
+	// F * m * F with F flipping Z
+	core::matrix4 result = m;
+	result[2] = -result[2];
+	result[6] = -result[6];
+	result[8] = -result[8];
+	result[9] = -result[9];
+	result[11] = -result[11];
+	result[14] = -result[14];
+	return result;
+}
+
+//! Loads one glTF file into a SkinnedMesh
+class CGLTFReader
+{
+public:
+	CGLTFReader(ISceneManager *smgr, io::IReadFile *file) :
+			SceneManager(smgr), File(file), Mesh(nullptr) {}
+
+	~CGLTFReader()
+	{
+		if (Mesh)
+			Mesh->drop();
+	}
+
+	//! Returns the finalized mesh, or 0 if loading failed
+	SkinnedMesh *read();
+
+private:
+	//! Bytes of a buffer, within the loaded file or owned by OwnedBuffers
+	struct SBuffer
+	{
+		const u8 *Data = nullptr;
+		size_t Size = 0;
+	};
+
+	//! Range of a buffer view
+	struct SView
+	{
+		const u8 *Data = nullptr;
+		size_t Size = 0;
+		u32 Stride = 0;
+	};
+
+	//! Skinned vertices of a mesh buffer, resolved once all joints exist
+	struct SSkinnedPrimitive
+	{
+		u32 Buffer;
+		u32 Skin;
+		u32 VertexCount;
+
+		//! 4 or 8 joints and weights per vertex
+		u32 Influences;
+		std::vector<f32> Joints;
+		std::vector<f32> Weights;
+	};
+
+	bool parseFile();
+	bool loadBuffers();
+	bool getBufferView(u32 index, SView &view) const;
+
+	//! Reads an accessor into floats
+	/** \param components Gets the amount of components per element. */
+	bool readAccessor(u32 index, std::vector<f32> &out, u32 &components) const;
+
+	//! Reads the indices of a primitive, reversing the winding
+	bool readIndices(u32 index, u32 vertexCount, std::vector<u16> &out) const;
+
+	const io::SJsonValue *getElement(const char *array, u32 index) const;
+
+	void loadNode(u32 index, SkinnedMesh::SJoint *parent, u32 depth);
+	void loadMesh(u32 index, u32 node, SkinnedMesh::SJoint *joint);
+	bool loadPrimitive(const io::SJsonValue &primitive, const io::SJsonValue &mesh,
+			u32 node, SkinnedMesh::SJoint *joint);
+	void loadMaterial(u32 index, u32 buffer);
+	video::GLTexture *loadTexture(u32 index);
+	void loadSkins();
+	void loadAnimation();
+
+	ISceneManager *SceneManager;
+	io::IReadFile *File;
+	SkinnedMeshBuilder *Mesh;
+
+	std::vector<u8> FileData;
+	io::SJsonValue Root;
+
+	std::vector<SBuffer> Buffers;
+	std::vector<std::unique_ptr<std::vector<u8>>> OwnedBuffers;
+
+	//! Binary chunk of a .glb file
+	SBuffer BinaryChunk;
+
+	//! Joint of each node
+	std::vector<SkinnedMesh::SJoint *> NodeJoints;
+
+	//! Morph targets of each node, by the index of the target in the mesh
+	std::vector<std::vector<std::pair<u32, SkinnedMesh::SMorphTarget *>>> NodeMorphTargets;
+
+	std::vector<SSkinnedPrimitive> SkinnedPrimitives;
+	std::vector<video::GLTexture *> Textures;
+	std::vector<bool> TexturesLoaded;
+};
+
+SkinnedMesh *CGLTFReader::read()
+{
+	if (!parseFile() || !loadBuffers())
+		return nullptr;
+
+	const io::SJsonValue *asset = Root.get("asset");
+	if (!asset || asset->getString("version").compare(0, 1, "2") != 0) {
+		g_irrlogger->log("glTF: Only version 2 is supported", File->getFileName(), ELL_ERROR);
+		return nullptr;
+	}
+
+	Mesh = new SkinnedMeshBuilder(SkinnedMesh::SourceFormat::GLTF);
+
+	const io::SJsonValue *nodes = Root.get("nodes");
+	const u32 nodeCount = nodes && nodes->isArray() ? nodes->size() : 0;
+	NodeJoints.assign(nodeCount, nullptr);
+	NodeMorphTargets.resize(nodeCount);
+
+	const io::SJsonValue *textures = Root.get("textures");
+	const u32 textureCount = textures && textures->isArray() ? textures->size() : 0;
+	Textures.assign(textureCount, nullptr);
+	TexturesLoaded.assign(textureCount, false);
+
+	// the default scene, or all root nodes without scenes
+	const io::SJsonValue *scene = getElement("scenes", Root.getUInt("scene", 0));
+	const io::SJsonValue *sceneNodes = scene ? scene->get("nodes") : nullptr;
+	if (sceneNodes && sceneNodes->isArray()) {
+		for (const auto &node : sceneNodes->Elements) {
+			if (node.isNumber())
+				loadNode(node.toUInt(~0u), nullptr, 0);
+		}
+	} else {
+		std::vector<bool> isChild(nodeCount, false);
+		for (u32 i = 0; i < nodeCount; ++i) {
+			const io::SJsonValue *children = nodes->Elements[i].get("children");
+			if (!children || !children->isArray())
+				continue;
+			for (const auto &child : children->Elements) {
+				const u32 index = child.toUInt(~0u);
+				if (index < nodeCount)
+					isChild[index] = true;
+			}
+		}
+		for (u32 i = 0; i < nodeCount; ++i) {
+			if (!isChild[i])
+				loadNode(i, nullptr, 0);
+		}
+	}
+
+	loadSkins();
+	loadAnimation();
+
+	Mesh->setAnimationSpeed(GLTF_FRAMES_PER_SECOND);
+	Mesh->finalize();
+
+	SkinnedMesh *result = Mesh;
+	Mesh = nullptr;
+	return result;
+}
+
+bool CGLTFReader::parseFile()
+{
+	const long size = File->getSize();
+	if (size <= 0)
+		return false;
+
+	FileData.resize(size);
+	if (File->read(FileData.data(), size) != (size_t)size) {
+		g_irrlogger->log("glTF: Could not read the file", File->getFileName(), ELL_ERROR);
+		return false;
+	}
+
+	std::string_view json;
+
+	if (size >= 12 && readLittleEndian(FileData.data()) == GLB_MAGIC) {
+		// binary container: header, JSON chunk, optional BIN chunk
+		if (readLittleEndian(&FileData[4]) != 2) {
+			g_irrlogger->log("glTF: Only version 2 of .glb files is supported", File->getFileName(), ELL_ERROR);
+			return false;
+		}
+
+		const size_t length = std::min<size_t>(readLittleEndian(&FileData[8]), size);
+		size_t offset = 12;
+		while (offset + 8 <= length) {
+			const u32 chunkLength = readLittleEndian(&FileData[offset]);
+			const u32 chunkType = readLittleEndian(&FileData[offset + 4]);
+			offset += 8;
+			if (chunkLength > length - offset) {
+				g_irrlogger->log("glTF: Truncated chunk", File->getFileName(), ELL_ERROR);
+				return false;
+			}
+
+			if (chunkType == GLB_CHUNK_JSON && json.empty())
+				json = std::string_view(reinterpret_cast<const char *>(&FileData[offset]), chunkLength);
+			else if (chunkType == GLB_CHUNK_BIN && !BinaryChunk.Data)
+				BinaryChunk = {&FileData[offset], chunkLength};
+
+			offset += chunkLength;
+		}
+
+		if (json.empty()) {
+			g_irrlogger->log("glTF: No JSON chunk found", File->getFileName(), ELL_ERROR);
+			return false;
+		}
+	} else {
+		json = std::string_view(reinterpret_cast<const char *>(FileData.data()), FileData.size());
+	}
+
+	io::CJsonParser parser;
+	if (!parser.parse(json, Root) || !Root.isObject()) {
+		g_irrlogger->log("glTF: Invalid JSON", parser.getError().c_str(), ELL_ERROR);
+		return false;
+	}
+	return true;
+}
+
+bool CGLTFReader::loadBuffers()
+{
+	const io::SJsonValue *buffers = Root.get("buffers");
+	if (!buffers || !buffers->isArray())
+		return true;
+
+	io::IFileSystem *fs = nullptr;
+	if (SceneManager && SceneManager->getVideoDriver())
+		fs = SceneManager->getVideoDriver()->getFileSystem();
+
+	for (u32 i = 0; i < buffers->size(); ++i) {
+		const io::SJsonValue &buffer = buffers->Elements[i];
+		const size_t length = getByteCount(buffer, "byteLength");
+		const io::SJsonValue *uri = buffer.get("uri");
+
+		SBuffer data;
+		if (!uri) {
+			// the binary chunk, used without copying
+			if (i != 0 || !BinaryChunk.Data) {
+				g_irrlogger->log("glTF: Buffer without uri and binary chunk", File->getFileName(), ELL_ERROR);
+				return false;
+			}
+			data = BinaryChunk;
+		} else if (uri->String.compare(0, 5, "data:") == 0) {
+			const size_t comma = uri->String.find(',');
+			if (comma == std::string::npos || uri->String.rfind(";base64", comma) == std::string::npos) {
+				g_irrlogger->log("glTF: Only base64 data URIs are supported", File->getFileName(), ELL_ERROR);
+				return false;
+			}
+
+			auto owned = std::make_unique<std::vector<u8>>();
+			if (!decodeBase64(std::string_view(uri->String).substr(comma + 1), *owned)) {
+				g_irrlogger->log("glTF: Invalid base64 data", File->getFileName(), ELL_ERROR);
+				return false;
+			}
+			data = {owned->data(), owned->size()};
+			OwnedBuffers.push_back(std::move(owned));
+		} else {
+			if (!fs) {
+				g_irrlogger->log("glTF: No file system to load external buffers", File->getFileName(), ELL_ERROR);
+				return false;
+			}
+
+			const io::path path = fs->getFileDir(File->getFileName()) + "/" + decodeUri(uri->String).c_str();
+			io::IReadFile *external = fs->createAndOpenFile(path);
+			if (!external) {
+				g_irrlogger->log("glTF: Could not open buffer", path, ELL_ERROR);
+				return false;
+			}
+
+			auto owned = std::make_unique<std::vector<u8>>(external->getSize());
+			const size_t read = external->read(owned->data(), owned->size());
+			external->drop();
+			if (read != owned->size()) {
+				g_irrlogger->log("glTF: Could not read buffer", path, ELL_ERROR);
+				return false;
+			}
+			data = {owned->data(), owned->size()};
+			OwnedBuffers.push_back(std::move(owned));
+		}
+
+		if (data.Size < length) {
+			g_irrlogger->log("glTF: Buffer is shorter than its byteLength", File->getFileName(), ELL_ERROR);
+			return false;
+		}
+		Buffers.push_back(data);
+	}
+	return true;
+}
+
+const io::SJsonValue *CGLTFReader::getElement(const char *array, u32 index) const
+{
+	const io::SJsonValue *elements = Root.get(array);
+	return elements ? elements->at(index) : nullptr;
+}
+
+bool CGLTFReader::getBufferView(u32 index, SView &view) const
+{
+	const io::SJsonValue *bufferView = getElement("bufferViews", index);
+	if (!bufferView)
+		return false;
+
+	const u32 buffer = bufferView->getUInt("buffer", Buffers.size());
+	const size_t offset = getByteCount(*bufferView, "byteOffset");
+	const size_t length = getByteCount(*bufferView, "byteLength");
+
+	if (buffer >= Buffers.size() || offset > Buffers[buffer].Size || length > Buffers[buffer].Size - offset) {
+		g_irrlogger->log("glTF: Buffer view out of bounds", File->getFileName(), ELL_ERROR);
+		return false;
+	}
+
+	view.Data = Buffers[buffer].Data + offset;
+	view.Size = length;
+	view.Stride = bufferView->getUInt("byteStride", 0);
+	return true;
+}
+
+bool CGLTFReader::readAccessor(u32 index, std::vector<f32> &out, u32 &components) const
+{
+	const io::SJsonValue *accessor = getElement("accessors", index);
+	if (!accessor)
+		return false;
+
+	const u32 count = accessor->getUInt("count", 0);
+	const u32 componentType = accessor->getUInt("componentType", 0);
+	const u32 size = getComponentSize(componentType);
+	const bool normalized = accessor->getBool("normalized", false);
+	components = getComponentCount(accessor->getString("type"));
+
+	if (!size || !components) {
+		g_irrlogger->log("glTF: Invalid accessor type", File->getFileName(), ELL_ERROR);
+		return false;
+	}
+
+	const u32 elementSize = size * components;
+
+	// the count is checked against the data before allocating anything for it
+	const io::SJsonValue *viewIndex = accessor->get("bufferView");
+	SView view;
+	u32 stride = elementSize;
+	size_t offset = 0;
+	if (viewIndex) {
+		if (!getBufferView(viewIndex->toUInt(~0u), view))
+			return false;
+
+		stride = view.Stride ? view.Stride : elementSize;
+		offset = getByteCount(*accessor, "byteOffset");
+		if (stride < elementSize || (count && (offset > view.Size ||
+				(size_t)stride * (count - 1) + elementSize > view.Size - offset))) {
+			g_irrlogger->log("glTF: Accessor out of bounds", File->getFileName(), ELL_ERROR);
+			return false;
+		}
+	} else {
+		// zeros changed by sparse values, they can't be more than the data of the file
+		size_t dataSize = 0;
+		for (const auto &buffer : Buffers)
+			dataSize += buffer.Size;
+		if ((size_t)count * elementSize > dataSize) {
+			g_irrlogger->log("glTF: Accessor larger than the buffers", File->getFileName(), ELL_ERROR);
+			return false;
+		}
+	}
+
+	out.assign((size_t)count * components, 0.f);
+
+	if (viewIndex) {
+		const u8 *src = view.Data + offset;
+
+#ifndef __BIG_ENDIAN__
+		// tightly packed floats are copied as a whole
+		if (componentType == EGC_FLOAT && stride == elementSize) {
+			memcpy(out.data(), src, (size_t)count * elementSize);
+		} else
+#endif
+		{
+			f32 *dst = out.data();
+			for (u32 i = 0; i < count; ++i, src += stride) {
+				for (u32 c = 0; c < components; ++c)
+					*dst++ = readComponent(src + c * size, componentType, normalized);
+			}
+		}
+	}
+
+	if (const io::SJsonValue *sparse = accessor->get("sparse")) {
+		const u32 sparseCount = sparse->getUInt("count", 0);
+		const io::SJsonValue *indices = sparse->get("indices");
+		const io::SJsonValue *values = sparse->get("values");
+		if (!indices || !values)
+			return false;
+
+		SView indexView, valueView;
+		if (!getBufferView(indices->getUInt("bufferView", ~0u), indexView) ||
+				!getBufferView(values->getUInt("bufferView", ~0u), valueView))
+			return false;
+
+		const u32 indexType = indices->getUInt("componentType", EGC_UNSIGNED_INT);
+		const u32 indexSize = getComponentSize(indexType);
+		const size_t indexOffset = getByteCount(*indices, "byteOffset");
+		const size_t valueOffset = getByteCount(*values, "byteOffset");
+
+		if (!indexSize || indexOffset > indexView.Size || valueOffset > valueView.Size ||
+				(size_t)sparseCount * indexSize > indexView.Size - indexOffset ||
+				(size_t)sparseCount * elementSize > valueView.Size - valueOffset) {
+			g_irrlogger->log("glTF: Sparse accessor out of bounds", File->getFileName(), ELL_ERROR);
+			return false;
+		}
+
+		for (u32 i = 0; i < sparseCount; ++i) {
+			const u32 target = readIndex(indexView.Data + indexOffset + i * indexSize, indexType);
+			if (target >= count)
+				return false;
+
+			const u8 *src = valueView.Data + valueOffset + (size_t)i * elementSize;
+			for (u32 c = 0; c < components; ++c)
+				out[(size_t)target * components + c] = readComponent(src + c * size, componentType, normalized);
+		}
+	}
+	return true;
+}
+
+bool CGLTFReader::readIndices(u32 index, u32 vertexCount, std::vector<u16> &out) const
+{
+	const io::SJsonValue *accessor = getElement("accessors", index);
+	const io::SJsonValue *viewIndex = accessor ? accessor->get("bufferView") : nullptr;
+	if (!viewIndex || !viewIndex->isNumber() || accessor->getString("type") != "SCALAR")
+		return false;
+
+	SView view;
+	if (!getBufferView(viewIndex->toUInt(~0u), view))
+		return false;
+
+	const u32 count = accessor->getUInt("count", 0);
+	const u32 componentType = accessor->getUInt("componentType", 0);
+	const u32 size = getComponentSize(componentType);
+	const u32 stride = view.Stride ? view.Stride : size;
+	const size_t offset = getByteCount(*accessor, "byteOffset");
+
+	if (!size || componentType == EGC_FLOAT || count % 3 != 0 ||
+			(count && (offset > view.Size || (size_t)stride * (count - 1) + size > view.Size - offset))) {
+		g_irrlogger->log("glTF: Invalid index accessor", File->getFileName(), ELL_ERROR);
+		return false;
+	}
+
+	const u8 *src = view.Data + offset;
+	out.resize(count);
+
+#ifndef __BIG_ENDIAN__
+	if (componentType == EGC_UNSIGNED_SHORT && stride == 2) {
+		memcpy(out.data(), src, count * 2);
+	} else
+#endif
+	{
+		for (u32 i = 0; i < count; ++i)
+			out[i] = (u16)readIndex(src + (size_t)i * stride, componentType);
+	}
+
+	if (componentType == EGC_UNSIGNED_INT) {
+		// the values were truncated above, check the originals
+		for (u32 i = 0; i < count; ++i) {
+			if (readIndex(src + (size_t)i * stride, componentType) >= vertexCount)
+				return false;
+		}
+	}
+
+	for (u32 i = 0; i < count; i += 3) {
+		if (out[i] >= vertexCount || out[i + 1] >= vertexCount || out[i + 2] >= vertexCount)
+			return false;
+
+		// counter-clockwise in glTF, flipping Z keeps that on screen
+		std::swap(out[i + 1], out[i + 2]);
+	}
+	return true;
+}
+
+void CGLTFReader::loadNode(u32 index, SkinnedMesh::SJoint *parent, u32 depth)
+{
+	const io::SJsonValue *node = getElement("nodes", index);
+	if (!node || NodeJoints[index] || depth > 1024) {
+		g_irrlogger->log("glTF: Invalid node hierarchy", File->getFileName(), ELL_WARNING);
+		return;
+	}
+
+	SkinnedMesh::SJoint *joint = Mesh->addJoint(parent);
+	NodeJoints[index] = joint;
+
+	if (const io::SJsonValue *name = node->get("name"); name && name->isString())
+		joint->Name = name->String;
+
+	const auto readFloats = [node](const char *key, f32 *out, u32 count) {
+		const io::SJsonValue *value = node->get(key);
+		if (!value || !value->isArray() || value->size() != count)
+			return false;
+		for (u32 i = 0; i < count; ++i)
+			out[i] = (f32)value->Elements[i].Number;
+		return true;
+	};
+
+	f32 matrix[16];
+	if (readFloats("matrix", matrix, 16)) {
+		// same memory layout as core::matrix4
+		core::matrix4 local;
+		memcpy(local.pointer(), matrix, sizeof(matrix));
+		joint->LocalMatrix = convertHandedness(local);
+
+		// nodes with matrices aren't animated
+		joint->Animatedposition = joint->LocalMatrix.getTranslation();
+		joint->Animatedscale = joint->LocalMatrix.getScale();
+	} else {
+		f32 translation[3] = {0.f, 0.f, 0.f};
+		f32 rotation[4] = {0.f, 0.f, 0.f, 1.f};
+		f32 scale[3] = {1.f, 1.f, 1.f};
+		readFloats("translation", translation, 3);
+		readFloats("rotation", rotation, 4);
+		readFloats("scale", scale, 3);
+
+		joint->Animatedposition = convertHandedness(core::vector3df(translation[0], translation[1], translation[2]));
+		joint->Animatedrotation = convertHandedness(core::quaternion(rotation[0], rotation[1], rotation[2], rotation[3]));
+		joint->Animatedscale = core::vector3df(scale[0], scale[1], scale[2]);
+
+		core::matrix4 positionMatrix;
+		positionMatrix.setTranslation(joint->Animatedposition);
+		core::matrix4 scaleMatrix;
+		scaleMatrix.setScale(joint->Animatedscale);
+		core::matrix4 rotationMatrix;
+		joint->Animatedrotation.getMatrix_transposed(rotationMatrix);
+
+		joint->LocalMatrix = positionMatrix * rotationMatrix * scaleMatrix;
+	}
+
+	if (parent)
+		joint->GlobalMatrix = parent->GlobalMatrix * joint->LocalMatrix;
+	else
+		joint->GlobalMatrix = joint->LocalMatrix;
+
+	if (const io::SJsonValue *mesh = node->get("mesh"); mesh && mesh->isNumber())
+		loadMesh(mesh->toUInt(~0u), index, joint);
+
+	if (const io::SJsonValue *children = node->get("children"); children && children->isArray()) {
+		for (const auto &child : children->Elements) {
+			const u32 childIndex = child.toUInt(~0u);
+			if (childIndex < NodeJoints.size())
+				loadNode(childIndex, joint, depth + 1);
+		}
+	}
+}
+
+void CGLTFReader::loadMesh(u32 index, u32 node, SkinnedMesh::SJoint *joint)
+{
+	const io::SJsonValue *mesh = getElement("meshes", index);
+	const io::SJsonValue *primitives = mesh ? mesh->get("primitives") : nullptr;
+	if (!primitives || !primitives->isArray()) {
+		g_irrlogger->log("glTF: Invalid mesh", File->getFileName(), ELL_WARNING);
+		return;
+	}
+
+	for (const auto &primitive : primitives->Elements) {
+		if (!loadPrimitive(primitive, *mesh, node, joint))
+			g_irrlogger->log("glTF: Skipped an invalid primitive", File->getFileName(), ELL_WARNING);
+	}
+}
+
+bool CGLTFReader::loadPrimitive(const io::SJsonValue &primitive, const io::SJsonValue &mesh,
+		u32 node, SkinnedMesh::SJoint *joint)
+{
+	if (primitive.getUInt("mode", GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES) {
+		g_irrlogger->log("glTF: Only triangle primitives are supported", File->getFileName(), ELL_WARNING);
+		return true;
+	}
+
+	const io::SJsonValue *attributes = primitive.get("attributes");
+	if (!attributes || !attributes->get("POSITION"))
+		return false;
+
+	std::vector<f32> positions, normals, tcoords, colors;
+	u32 components;
+
+	if (!readAccessor(attributes->getUInt("POSITION", ~0u), positions, components) || components != 3)
+		return false;
+
+	const u32 vertexCount = positions.size() / 3;
+	if (vertexCount > 65536) {
+		g_irrlogger->log("glTF: Primitives with more than 65536 vertices are not supported", File->getFileName(), ELL_WARNING);
+		return false;
+	}
+
+	const bool hasNormals = attributes->get("NORMAL") &&
+			readAccessor(attributes->getUInt("NORMAL", ~0u), normals, components) &&
+			components == 3 && normals.size() == positions.size();
+
+	const bool hasTCoords = attributes->get("TEXCOORD_0") &&
+			readAccessor(attributes->getUInt("TEXCOORD_0", ~0u), tcoords, components) &&
+			components == 2 && tcoords.size() == vertexCount * 2;
+
+	u32 colorComponents = 0;
+	const bool hasColors = attributes->get("COLOR_0") &&
+			readAccessor(attributes->getUInt("COLOR_0", ~0u), colors, colorComponents) &&
+			(colorComponents == 3 || colorComponents == 4) && colors.size() == vertexCount * colorComponents;
+
+	std::vector<scene::Vertex3D> vertices(vertexCount);
+	for (u32 i = 0; i < vertexCount; ++i) {
+		scene::Vertex3D &vertex = vertices[i];
+		vertex.Pos = convertHandedness(core::vector3df(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]));
+
+		if (hasNormals)
+			vertex.Normal = convertHandedness(core::vector3df(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]));
+
+		if (hasTCoords)
+			vertex.TCoords.set(tcoords[i * 2], tcoords[i * 2 + 1]);
+
+		if (hasColors) {
+			const f32 *c = &colors[i * colorComponents];
+			const f32 alpha = colorComponents == 4 ? c[3] : 1.f;
+			vertex.Color.set(
+					core::clamp<s32>(core::round32(alpha * 255.f), 0, 255),
+					core::clamp<s32>(core::round32(c[0] * 255.f), 0, 255),
+					core::clamp<s32>(core::round32(c[1] * 255.f), 0, 255),
+					core::clamp<s32>(core::round32(c[2] * 255.f), 0, 255));
+		}
+	}
+
+	std::vector<u16> indices;
+	if (const io::SJsonValue *accessor = primitive.get("indices"); accessor && accessor->isNumber()) {
+		if (!readIndices(accessor->toUInt(~0u), vertexCount, indices))
+			return false;
+	} else {
+		if (vertexCount % 3 != 0)
+			return false;
+		indices.resize(vertexCount);
+		for (u32 i = 0; i < vertexCount; i += 3) {
+			indices[i] = i;
+			indices[i + 1] = i + 2;
+			indices[i + 2] = i + 1;
+		}
+	}
+
+	const u32 bufferId = Mesh->getMeshBufferCount();
+	SSkinMeshBuffer *buffer = new SSkinMeshBuffer(std::move(vertices), std::move(indices));
+	Mesh->addMeshBuffer(buffer);
+
+	if (!hasNormals && SceneManager)
+		SceneManager->getMeshManipulator()->recalculateNormals(buffer);
+
+	if (const io::SJsonValue *material = primitive.get("material"); material && material->isNumber())
+		loadMaterial(material->toUInt(~0u), bufferId);
+
+	const io::SJsonValue *node_ = getElement("nodes", node);
+	const io::SJsonValue *skin = node_->get("skin");
+
+	if (skin && skin->isNumber()) {
+		// placed by the joints of the skin instead of the node
+		SSkinnedPrimitive skinned;
+		skinned.Buffer = bufferId;
+		skinned.Skin = skin->toUInt(~0u);
+		skinned.VertexCount = vertexCount;
+		skinned.Influences = 0;
+
+		for (u32 set = 0; set < 2; ++set) {
+			const std::string suffix = std::to_string(set);
+			if (!attributes->get("JOINTS_" + suffix) || !attributes->get("WEIGHTS_" + suffix))
+				break;
+
+			std::vector<f32> joints, weights;
+			u32 jointComponents, weightComponents;
+			if (!readAccessor(attributes->getUInt("JOINTS_" + suffix, ~0u), joints, jointComponents) ||
+					!readAccessor(attributes->getUInt("WEIGHTS_" + suffix, ~0u), weights, weightComponents) ||
+					jointComponents != 4 || weightComponents != 4 ||
+					joints.size() != vertexCount * 4 || weights.size() != vertexCount * 4)
+				break;
+
+			skinned.Joints.insert(skinned.Joints.end(), joints.begin(), joints.end());
+			skinned.Weights.insert(skinned.Weights.end(), weights.begin(), weights.end());
+			skinned.Influences += 4;
+		}
+
+		if (skinned.Influences)
+			SkinnedPrimitives.push_back(std::move(skinned));
+	} else {
+		joint->AttachedMeshes.push_back(bufferId);
+	}
+
+	// morph targets, weighted by the node or the mesh
+	const io::SJsonValue *targets = primitive.get("targets");
+	if (!targets || !targets->isArray())
+		return true;
+
+	const io::SJsonValue *weights = node_->get("weights");
+	if (!weights || !weights->isArray())
+		weights = mesh.get("weights");
+	const io::SJsonValue *extras = mesh.get("extras");
+	const io::SJsonValue *names = extras ? extras->get("targetNames") : nullptr;
+
+	for (u32 t = 0; t < targets->size(); ++t) {
+		const io::SJsonValue &target = targets->Elements[t];
+
+		std::vector<f32> positionDeltas, normalDeltas;
+		if (target.get("POSITION") &&
+				(!readAccessor(target.getUInt("POSITION", ~0u), positionDeltas, components) ||
+						components != 3 || positionDeltas.size() != vertexCount * 3))
+			return false;
+		if (target.get("NORMAL") &&
+				(!readAccessor(target.getUInt("NORMAL", ~0u), normalDeltas, components) ||
+						components != 3 || normalDeltas.size() != vertexCount * 3))
+			normalDeltas.clear();
+
+		SkinnedMesh::SMorphTarget *morph = Mesh->addMorphTarget(bufferId);
+		if (weights && t < weights->size() && weights->Elements[t].isNumber())
+			morph->DefaultWeight = (f32)weights->Elements[t].Number;
+		if (names && t < names->size() && names->Elements[t].isString())
+			morph->Name = names->Elements[t].String;
+
+		// only the moved vertices are kept
+		for (u32 i = 0; i < vertexCount; ++i) {
+			core::vector3df position(0.f), normal(0.f);
+			if (!positionDeltas.empty())
+				position = convertHandedness(core::vector3df(positionDeltas[i * 3], positionDeltas[i * 3 + 1], positionDeltas[i * 3 + 2]));
+			if (!normalDeltas.empty())
+				normal = convertHandedness(core::vector3df(normalDeltas[i * 3], normalDeltas[i * 3 + 1], normalDeltas[i * 3 + 2]));
+
+			if (position != core::vector3df(0.f) || normal != core::vector3df(0.f))
+				Mesh->addMorphDelta(morph, i, position, normal);
+		}
+
+		NodeMorphTargets[node].emplace_back(t, morph);
+	}
+	return true;
+}
+
+void CGLTFReader::loadMaterial(u32 index, u32 buffer)
+{
+	const io::SJsonValue *material = getElement("materials", index);
+	if (!material)
+		return;
+
+	// loaded textures can be replaced by the users of the texture slots
+	Mesh->setTextureSlot(buffer, index);
+
+	video::SMaterial &mat = Mesh->getMeshBuffer(buffer)->getMaterial();
+	mat.BackfaceCulling = !material->getBool("doubleSided", false);
+
+	const std::string alphaMode = material->getString("alphaMode", "OPAQUE");
+	if (alphaMode == "BLEND")
+		mat.MaterialType = video::EMT_TRANSPARENT_ALPHA_CHANNEL;
+	else if (alphaMode == "MASK")
+		mat.MaterialType = video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF;
+
+	const io::SJsonValue *pbr = material->get("pbrMetallicRoughness");
+	const io::SJsonValue *baseColor = pbr ? pbr->get("baseColorTexture") : nullptr;
+	if (baseColor) {
+		if (video::GLTexture *texture = loadTexture(baseColor->getUInt("index", ~0u)))
+			mat.setTexture(0, texture);
+	}
+}
+
+video::GLTexture *CGLTFReader::loadTexture(u32 index)
+{
+	if (index >= Textures.size())
+		return nullptr;
+	if (TexturesLoaded[index])
+		return Textures[index];
+	TexturesLoaded[index] = true;
+
+	video::VideoDriver *driver = SceneManager ? SceneManager->getVideoDriver() : nullptr;
+	const io::SJsonValue *texture = getElement("textures", index);
+	const io::SJsonValue *image = texture ? getElement("images", texture->getUInt("source", ~0u)) : nullptr;
+	if (!driver || !image)
+		return nullptr;
+
+	io::IFileSystem *fs = driver->getFileSystem();
+	const io::path name = File->getFileName() + "#" + io::path(core::stringc(texture->getUInt("source", 0)).c_str());
+
+	// embedded images go through the image loaders, external ones through the driver
+	video::Image *img = nullptr;
+	if (const io::SJsonValue *viewIndex = image->get("bufferView"); viewIndex && viewIndex->isNumber()) {
+		SView view;
+		if (getBufferView(viewIndex->toUInt(~0u), view))
+			img = video::Image::createFromMemory(view.Data, view.Size, name, fs);
+	} else if (const io::SJsonValue *uri = image->get("uri"); uri && uri->isString()) {
+		if (uri->String.compare(0, 5, "data:") == 0) {
+			const size_t comma = uri->String.find(',');
+			std::vector<u8> data;
+			if (comma != std::string::npos && decodeBase64(std::string_view(uri->String).substr(comma + 1), data))
+				img = video::Image::createFromMemory(data.data(), data.size(), name, fs);
+		} else {
+			const io::path path = fs->getFileDir(File->getFileName()) + "/" + decodeUri(uri->String).c_str();
+			Textures[index] = driver->getTexture(path);
+			return Textures[index];
+		}
+	}
+
+	if (!img) {
+		g_irrlogger->log("glTF: Could not load image", name, ELL_WARNING);
+		return nullptr;
+	}
+
+	Textures[index] = driver->addTexture(name, img);
+	img->drop();
+	return Textures[index];
+}
+
+void CGLTFReader::loadSkins()
+{
+	for (const auto &skinned : SkinnedPrimitives) {
+		const io::SJsonValue *skin = getElement("skins", skinned.Skin);
+		const io::SJsonValue *joints = skin ? skin->get("joints") : nullptr;
+		if (!joints || !joints->isArray()) {
+			g_irrlogger->log("glTF: Invalid skin", File->getFileName(), ELL_WARNING);
+			continue;
+		}
+
+		const u32 sets = skinned.Influences / 4;
+		for (u32 v = 0; v < skinned.VertexCount; ++v) {
+			for (u32 set = 0; set < sets; ++set) {
+				const size_t base = (size_t)set * skinned.VertexCount * 4 + (size_t)v * 4;
+				for (u32 k = 0; k < 4; ++k) {
+					const f32 strength = skinned.Weights[base + k];
+					const f32 jointIndex = skinned.Joints[base + k];
+					if (strength <= 0.f || !(jointIndex >= 0.f && jointIndex < joints->size()))
+						continue;
+
+					const u32 node = joints->Elements[(u32)jointIndex].toUInt(~0u);
+					if (node >= NodeJoints.size() || !NodeJoints[node])
+						continue;
+
+					SkinnedMesh::SWeight *weight = Mesh->addWeight(NodeJoints[node]);
+					weight->buffer_id = skinned.Buffer;
+					weight->vertex_id = v;
+					weight->strength = strength;
+				}
+			}
+		}
+	}
+
+	const io::SJsonValue *skins = Root.get("skins");
+	if (!skins || !skins->isArray())
+		return;
+
+	for (const auto &skin : skins->Elements) {
+		const io::SJsonValue *joints = skin.get("joints");
+		if (!joints || !joints->isArray())
+			continue;
+
+		// without inverse bind matrices they are identities
+		std::vector<f32> matrices;
+		u32 components = 16;
+		if (skin.get("inverseBindMatrices") &&
+				(!readAccessor(skin.getUInt("inverseBindMatrices", ~0u), matrices, components) || components != 16)) {
+			g_irrlogger->log("glTF: Invalid inverse bind matrices", File->getFileName(), ELL_WARNING);
+			matrices.clear();
+		}
+
+		for (u32 i = 0; i < joints->size(); ++i) {
+			const u32 node = joints->Elements[i].toUInt(~0u);
+			if (node >= NodeJoints.size() || !NodeJoints[node])
+				continue;
+
+			core::matrix4 inverse;
+			if ((i + 1) * 16 <= matrices.size())
+				memcpy(inverse.pointer(), &matrices[i * 16], 16 * sizeof(f32));
+			NodeJoints[node]->GlobalInversedMatrix = convertHandedness(inverse);
+		}
+	}
+}
+
+void CGLTFReader::loadAnimation()
+{
+	const io::SJsonValue *animations = Root.get("animations");
+	if (!animations || !animations->isArray() || !animations->size())
+		return;
+
+	if (animations->size() > 1)
+		g_irrlogger->log("glTF: Only the first animation is loaded", File->getFileName(), ELL_INFORMATION);
+
+	const io::SJsonValue &animation = animations->Elements[0];
+	const io::SJsonValue *channels = animation.get("channels");
+	const io::SJsonValue *samplers = animation.get("samplers");
+	if (!channels || !samplers)
+		return;
+
+	bool cubicWarning = false;
+
+	for (const auto &channel : channels->Elements) {
+		const io::SJsonValue *sampler = samplers->at(channel.getUInt("sampler", ~0u));
+		const io::SJsonValue *target = channel.get("target");
+		if (!sampler || !target)
+			continue;
+
+		const u32 node = target->getUInt("node", ~0u);
+		if (node >= NodeJoints.size() || !NodeJoints[node])
+			continue;
+		SkinnedMesh::SJoint *joint = NodeJoints[node];
+
+		std::vector<f32> times, values;
+		u32 timeComponents, components;
+		if (!readAccessor(sampler->getUInt("input", ~0u), times, timeComponents) || timeComponents != 1 ||
+				!readAccessor(sampler->getUInt("output", ~0u), values, components)) {
+			g_irrlogger->log("glTF: Invalid animation sampler", File->getFileName(), ELL_WARNING);
+			continue;
+		}
+
+		const std::string interpolation = sampler->getString("interpolation", "LINEAR");
+		const bool step = interpolation == "STEP";
+
+		// cubic splines store in tangent, value and out tangent, only the values are kept
+		const bool cubic = interpolation == "CUBICSPLINE";
+		if (cubic && !cubicWarning) {
+			g_irrlogger->log("glTF: Cubic spline keys are interpolated linearly", File->getFileName(), ELL_INFORMATION);
+			cubicWarning = true;
+		}
+
+		const u32 keyCount = times.size();
+		const u32 elementsPerKey = cubic ? 3 : 1;
+		const u32 valueOffset = cubic ? 1 : 0;
+		if (!keyCount || values.size() % (keyCount * elementsPerKey) != 0)
+			continue;
+		const u32 keySize = values.size() / (keyCount * elementsPerKey);
+
+		const std::string path = target->getString("path");
+		for (u32 k = 0; k < keyCount; ++k) {
+			const f32 frame = times[k] * GLTF_FRAMES_PER_SECOND;
+			const f32 *v = &values[((size_t)k * elementsPerKey + valueOffset) * keySize];
+
+			if (path == "translation" && keySize == 3) {
+				Mesh->addPositionKey(joint, frame, convertHandedness(core::vector3df(v[0], v[1], v[2])));
+			} else if (path == "rotation" && keySize == 4) {
+				core::quaternion rotation(v[0], v[1], v[2], v[3]);
+				rotation.normalize();
+				Mesh->addRotationKey(joint, frame, convertHandedness(rotation));
+			} else if (path == "scale" && keySize == 3) {
+				Mesh->addScaleKey(joint, frame, core::vector3df(v[0], v[1], v[2]));
+			} else if (path == "weights") {
+				for (const auto &morph : NodeMorphTargets[node]) {
+					if (morph.first < keySize)
+						Mesh->addMorphWeightKey(morph.second, frame, v[morph.first]);
+				}
+			}
+		}
+
+		if (step) {
+			if (path == "translation")
+				joint->keys.position.interpolate = false;
+			else if (path == "rotation")
+				joint->keys.rotation.interpolate = false;
+			else if (path == "scale")
+				joint->keys.scale.interpolate = false;
+			else if (path == "weights") {
+				for (const auto &morph : NodeMorphTargets[node])
+					morph.second->Weights.interpolate = false;
+			}
+		}
+	}
+}
+}
+
+//! Constructor
+CGLTFMeshFileLoader::CGLTFMeshFileLoader(scene::ISceneManager *smgr) :
+		SceneManager(smgr)
+{}
+
+//! returns true if the file maybe is able to be loaded by this class
+//! based on the file extension (e.g. ".bsp")
+bool CGLTFMeshFileLoader::isALoadableFileExtension(const io::path &filename) const
+{
+	return core::hasFileExtension(filename, "gltf", "glb");
+}
+
+//! creates/loads an animated mesh from the file.
+//! \return Pointer to the created mesh. Returns 0 if loading failed.
+//! If you no longer need the mesh, you should call IAnimatedMesh::drop().
+//! See IReferenceCounted::drop() for more information.
+IAnimatedMesh *CGLTFMeshFileLoader::createMesh(io::IReadFile *file)
+{
+	if (!file)
+		return 0;
+
+	// all state of a load lives in the reader
+	CGLTFReader reader(SceneManager, file);
+	return reader.read();
+}
+
+} // end namespace scene
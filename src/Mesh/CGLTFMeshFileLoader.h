@@ -0,0 +1,41 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Mesh/IMeshLoader.h"
+#include "Scene/ISceneManager.h"
+
+namespace scene
+{
+
+//! Meshloader for glTF 2.0, as .gltf with JSON or .glb binary files
+/** Loads the default scene into a SkinnedMesh: every node becomes a joint,
+meshes attached to nodes are animated rigidly and skinned meshes through their
+skins. The first animation is loaded, including the weights of morph targets.
+Buffers of .glb files and their accessors are read straight from the loaded
+file, external buffers and images are loaded relative to the .gltf file.
+
+glTF is right-handed, the Z axis is flipped while loading. */
+class CGLTFMeshFileLoader : public IMeshLoader
+{
+public:
+	//! Constructor
+	CGLTFMeshFileLoader(scene::ISceneManager *smgr);
+
+	//! returns true if the file maybe is able to be loaded by this class
+	//! based on the file extension (e.g. ".bsp")
+	bool isALoadableFileExtension(const io::path &filename) const override;
+
+	//! creates/loads an animated mesh from the file.
+	//! \return Pointer to the created mesh. Returns 0 if loading failed.
+	//! If you no longer need the mesh, you should call IAnimatedMesh::drop().
+	//! See IReferenceCounted::drop() for more information.
+	IAnimatedMesh *createMesh(io::IReadFile *file) override;
+
+private:
+	scene::ISceneManager *SceneManager;
+};
+
+} // end namespace scene
@@ -12,6 +12,10 @@
 #include "Utils/fast_atof.h"
 #include "Utils/coreutil.h"
 #include "Device/Logger.h"
+#include "Device/JobSystem.h"
+
+#include <chrono>
+#include <cstring>
 
 
 namespace scene
@@ -21,9 +25,151 @@ namespace scene
 #define _IRR_DEBUG_OBJ_LOADER_
 #endif
 
+namespace
+{
+//! Files are split into chunks of about this size for parallel parsing
+const u32 OBJ_CHUNK_SIZE = 1 << 20;
+
+//! Vertices per mesh buffer addressable by 16 bit indices
+const u32 MAX_BUFFER_VERTICES = 0x10000;
+
+enum E_OBJ_STATEMENT
+{
+	EOS_GROUP,
+	EOS_MATERIAL,
+	EOS_FACE
+};
+
+//! Group or material change, or a face, in the order of the file
+struct SObjStatement
+{
+	E_OBJ_STATEMENT Type;
+
+	//! Index into SObjChunk::Names, or of the first corner of a face
+	u32 First;
+
+	//! Corners of a face
+	u32 Count;
+};
+
+//! Indices of the vectors of a face corner in the whole file, -1 if missing
+struct SObjCorner
+{
+	s32 Pos;
+	s32 TCoord;
+	s32 Normal;
+};
+
+inline u32 hashFloat(u32 hash, f32 value)
+{
+	// -0 and 0 are equal, so they must hash equally
+	value += 0.f;
+	u32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return (hash ^ bits) * 16777619u;
+}
+
+inline u32 hashVertex(const scene::Vertex3D &v)
+{
+	u32 hash = 2166136261u;
+	hash = hashFloat(hash, v.Pos.X);
+	hash = hashFloat(hash, v.Pos.Y);
+	hash = hashFloat(hash, v.Pos.Z);
+	hash = hashFloat(hash, v.Normal.X);
+	hash = hashFloat(hash, v.Normal.Y);
+	hash = hashFloat(hash, v.Normal.Z);
+	hash = hashFloat(hash, v.TCoords.X);
+	hash = hashFloat(hash, v.TCoords.Y);
+	return (hash ^ v.Color.color) * 16777619u;
+}
+
+//! Reads the next float of the line, 0 if there is none
+inline const c8 *readFloat(const c8 *bufPtr, f32 &value, const c8 *const bufEnd)
+{
+	if (bufPtr == bufEnd) {
+		value = 0.f;
+		return bufPtr;
+	}
+	const c8 *end = core::fast_atof_move(bufPtr, value);
+	return end ? end : bufPtr;
+}
+}
+
+struct COBJMeshFileLoader::SObjChunk
+{
+	const c8 *Begin = nullptr;
+	const c8 *End = nullptr;
+
+	//! Vectors in this chunk, see countChunk()
+	u32 PositionCount = 0;
+	u32 TCoordCount = 0;
+	u32 NormalCount = 0;
+
+	//! Vectors in the chunks before this one
+	u32 PositionOffset = 0;
+	u32 TCoordOffset = 0;
+	u32 NormalOffset = 0;
+
+	std::vector<SObjStatement> Statements;
+	std::vector<SObjCorner> Corners;
+	std::vector<core::stringc> Names;
+
+	//! Set with the failing line if the chunk couldn't be parsed
+	const c8 *Error = nullptr;
+	core::stringc ErrorLine;
+};
+
+u32 COBJMeshFileLoader::CVertexWeldMap::findOrAdd(const scene::Vertex3D &v, std::vector<scene::Vertex3D> &vertices)
+{
+	// keep the table at most half full, so probe sequences stay short
+	if ((Count + 1) * 2 > Slots.size())
+		grow();
+
+	const u32 hash = hashVertex(v);
+	const u32 mask = Slots.size() - 1;
+	for (u32 i = hash & mask;; i = (i + 1) & mask) {
+		const u32 slot = Slots[i];
+		if (!slot) {
+			vertices.push_back(v);
+			Slots[i] = vertices.size();
+			Hashes[i] = hash;
+			++Count;
+			return vertices.size() - 1;
+		}
+		if (Hashes[i] == hash && vertices[slot - 1] == v)
+			return slot - 1;
+	}
+}
+
+void COBJMeshFileLoader::CVertexWeldMap::clear()
+{
+	Hashes.clear();
+	Slots.clear();
+	Count = 0;
+}
+
+void COBJMeshFileLoader::CVertexWeldMap::grow()
+{
+	std::vector<u32> oldHashes(core::max_<size_t>(Slots.size() * 2, 64), 0);
+	std::vector<u32> oldSlots(oldHashes.size(), 0);
+	oldHashes.swap(Hashes);
+	oldSlots.swap(Slots);
+
+	const u32 mask = Slots.size() - 1;
+	for (u32 i = 0; i < oldSlots.size(); ++i) {
+		if (!oldSlots[i])
+			continue;
+		u32 j = oldHashes[i] & mask;
+		while (Slots[j])
+			j = (j + 1) & mask;
+		Slots[j] = oldSlots[i];
+		Hashes[j] = oldHashes[i];
+	}
+}
+
 //! Constructor
 COBJMeshFileLoader::COBJMeshFileLoader(scene::ISceneManager *smgr) :
-		SceneManager(smgr)
+		SceneManager(smgr), ParallelParsing(true)
 {}
 
 //! destructor
@@ -43,6 +189,16 @@ bool COBJMeshFileLoader::isALoadableFileExtension(const io::path &filename) cons
 //! If you no longer need the mesh, you should call IAnimatedMesh::drop().
 //! See IReferenceCounted::drop() for more information.
 IAnimatedMesh *COBJMeshFileLoader::createMesh(io::IReadFile *file)
+{
+	return createMesh(file, ParallelParsing);
+}
+
+//! Loads the file in three steps. The file is split into chunks at line
+//! breaks and the vectors of each chunk are counted. Then all chunks are
+//! parsed at once, knowing where their vectors go in the arrays of the whole
+//! file, into a list of faces and group or material changes. At last, the
+//! faces are welded into the mesh buffers in the order of the file.
+IAnimatedMesh *COBJMeshFileLoader::createMesh(io::IReadFile *file, bool parallel)
 {
 	if (!file)
 		return 0;
@@ -51,34 +207,237 @@ IAnimatedMesh *COBJMeshFileLoader::createMesh(io::IReadFile *file)
 	if (!filesize)
 		return 0;
 
-	const u32 WORD_BUFFER_LENGTH = 512;
+	const io::path fullName = file->getFileName();
 
-	core::array<core::vector3df> vertexBuffer(1000);
-	core::array<core::vector3df> normalsBuffer(1000);
-	core::array<core::vector2df> textureCoordBuffer(1000);
+	c8 *buf = new c8[filesize + 1]; // plus null-terminator
+	const long readSize = file->read((void *)buf, filesize);
+	buf[readSize > 0 ? readSize : 0] = 0;
+	const c8 *const bufEnd = buf + (readSize > 0 ? readSize : 0);
+
+	const u32 workers = g_irrjobs ? g_irrjobs->getWorkerCount() : 1;
+	u32 chunkCount = 1;
+	if (parallel && workers > 1)
+		chunkCount = core::clamp<u32>((u32)((bufEnd - buf) / OBJ_CHUNK_SIZE), 1, workers * 4);
+
+	// split at line breaks, each chunk starts at a line like in a serial pass
+	std::vector<SObjChunk> chunks(chunkCount);
+	chunks[0].Begin = buf;
+	for (u32 i = 1; i < chunkCount; ++i) {
+		const c8 *split = buf + (bufEnd - buf) * i / chunkCount;
+		if (split < chunks[i - 1].Begin)
+			split = chunks[i - 1].Begin;
+		while (split != bufEnd && *split != '\n')
+			++split;
+		chunks[i].Begin = goFirstWord(split, bufEnd);
+		if (chunks[i].Begin < chunks[i - 1].Begin)
+			chunks[i].Begin = chunks[i - 1].Begin;
+		chunks[i - 1].End = chunks[i].Begin;
+	}
+	chunks[chunkCount - 1].End = bufEnd;
+
+	auto forEachChunk = [&](const std::function<void(SObjChunk &)> &func) {
+		if (chunkCount > 1)
+			g_irrjobs->parallelFor(0, chunkCount, 1, [&](u32 begin, u32 end) {
+				for (u32 i = begin; i < end; ++i)
+					func(chunks[i]);
+			});
+		else
+			func(chunks[0]);
+	};
+
+	forEachChunk([this](SObjChunk &chunk) { countChunk(chunk); });
+
+	u32 positionCount = 0, tcoordCount = 0, normalCount = 0;
+	for (SObjChunk &chunk : chunks) {
+		chunk.PositionOffset = positionCount;
+		chunk.TCoordOffset = tcoordCount;
+		chunk.NormalOffset = normalCount;
+		positionCount += chunk.PositionCount;
+		tcoordCount += chunk.TCoordCount;
+		normalCount += chunk.NormalCount;
+	}
 
-	SObjMtl *currMtl = new SObjMtl();
-	Materials.push_back(currMtl);
-	u32 smoothingGroup = 0;
+	std::vector<core::vector3df> vertexBuffer(positionCount);
+	std::vector<core::vector2df> textureCoordBuffer(tcoordCount);
+	std::vector<core::vector3df> normalsBuffer(normalCount);
 
-	const io::path fullName = file->getFileName();
+	forEachChunk([&](SObjChunk &chunk) {
+		parseChunk(chunk, vertexBuffer.data(), textureCoordBuffer.data(), normalsBuffer.data());
+	});
 
-	c8 *buf = new c8[filesize + 1]; // plus null-terminator
-	memset(buf, 0, filesize + 1);
-	file->read((void *)buf, filesize);
-	const c8 *const bufEnd = buf + filesize;
+	// the file isn't needed anymore, the names and lines are copied
+	delete[] buf;
+
+	for (const SObjChunk &chunk : chunks) {
+		if (chunk.Error) {
+			g_irrlogger->log(chunk.Error, chunk.ErrorLine.c_str(), ELL_ERROR);
+			return 0;
+		}
+	}
+
+	// kept per load, so that several files can load at once
+	core::array<SObjMtl *> materials;
+	SObjMtl *currMtl = new SObjMtl();
+	materials.push_back(currMtl);
 
-	// Process obj information
-	const c8 *bufPtr = buf;
 	core::stringc grpName, mtlName;
 	bool mtlChanged = false;
-	[[maybe_unused]] u32 lineNr = 1; // only counts non-empty lines, still useful in debugging to locate errors
-	core::array<int> faceCorners;
-	faceCorners.reallocate(32); // should be large enough
-	const core::stringc TAG_OFF = "off";
+	std::vector<u32> faceCorners;
+	faceCorners.reserve(32); // should be large enough
 	u32 degeneratedFaces = 0;
 
-	while (bufPtr != bufEnd) {
+	scene::Vertex3D v;
+	// Assign vertex color from currently active material's diffuse color
+	v.Color = video::SColorf(0.8f, 0.8f, 0.8f, 1.0f).toSColor();
+
+	for (const SObjChunk &chunk : chunks) {
+		for (const SObjStatement &statement : chunk.Statements) {
+			if (statement.Type == EOS_GROUP) {
+				grpName = chunk.Names[statement.First];
+				mtlChanged = true;
+				continue;
+			} else if (statement.Type == EOS_MATERIAL) {
+				mtlName = chunk.Names[statement.First];
+				mtlChanged = true;
+				continue;
+			}
+
+			if (mtlChanged) {
+				// retrieve the material
+				SObjMtl *useMtl = findMtl(materials, mtlName, grpName);
+				// only change material if we found it
+				if (useMtl)
+					currMtl = useMtl;
+				mtlChanged = false;
+			}
+
+			// continue in a new buffer before the 16 bit indices overflow
+			if (currMtl->Meshbuffer->Vertices->Data.size() + statement.Count > MAX_BUFFER_VERTICES) {
+				SMeshBuffer *next = new SMeshBuffer();
+				next->Material = currMtl->Meshbuffer->Material;
+				currMtl->FullBuffers.push_back(currMtl->Meshbuffer);
+				currMtl->Meshbuffer = next;
+				currMtl->WeldMap.clear();
+			}
+
+			auto &Vertices = currMtl->Meshbuffer->Vertices->Data;
+			faceCorners.clear();
+
+			for (u32 i = 0; i < statement.Count; ++i) {
+				const SObjCorner &corner = chunk.Corners[statement.First + i];
+				v.Pos = vertexBuffer[corner.Pos];
+				if (corner.TCoord >= 0)
+					v.TCoords = textureCoordBuffer[corner.TCoord];
+				else
+					v.TCoords.set(0.0f, 0.0f);
+				if (corner.Normal >= 0)
+					v.Normal = normalsBuffer[corner.Normal];
+				else {
+					v.Normal.set(0.0f, 0.0f, 0.0f);
+					currMtl->RecalculateNormals = true;
+				}
+
+				faceCorners.push_back(currMtl->WeldMap.findOrAdd(v, Vertices));
+			}
+
+			// triangulate the face
+			auto &Indices = currMtl->Meshbuffer->Indices->Data;
+			const u32 c = faceCorners[0];
+			for (u32 i = 1; i < faceCorners.size() - 1; ++i) {
+				// Add a triangle
+				const u32 a = faceCorners[i + 1];
+				const u32 b = faceCorners[i];
+				if (a != b && a != c && b != c) { // ignore degenerated faces. We can get them when we weld vertices above.
+					Indices.push_back(a);
+					Indices.push_back(b);
+					Indices.push_back(c);
+				} else {
+					++degeneratedFaces;
+				}
+			}
+		}
+	}
+
+	if (degeneratedFaces > 0) {
+		core::stringc log(degeneratedFaces);
+		log += " degenerated faces removed in ";
+		log += core::stringc(fullName);
+		g_irrlogger->log(log.c_str(), ELL_INFORMATION);
+	}
+
+	SMesh *mesh = new SMesh();
+
+	// Combine all the groups (meshbuffers) into the mesh
+	auto addBuffer = [&](SObjMtl *mtl, SMeshBuffer *buffer) {
+		if (buffer->getIndexCount() > 0) {
+			buffer->recalculateBoundingBox();
+			if (mtl->RecalculateNormals)
+				SceneManager->getMeshManipulator()->recalculateNormals(buffer);
+			mesh->addMeshBuffer(buffer);
+		}
+	};
+	for (u32 m = 0; m < materials.size(); ++m) {
+		for (SMeshBuffer *buffer : materials[m]->FullBuffers)
+			addBuffer(materials[m], buffer);
+		addBuffer(materials[m], materials[m]->Meshbuffer);
+	}
+
+	// Create the Animated mesh if there's anything in the mesh
+	SAnimatedMesh *animMesh = 0;
+	if (0 != mesh->getMeshBufferCount()) {
+		mesh->recalculateBoundingBox();
+		animMesh = new SAnimatedMesh();
+		animMesh->Type = EAMT_OBJ;
+		animMesh->addMesh(mesh);
+		animMesh->recalculateBoundingBox();
+	}
+
+	cleanUp(materials);
+	mesh->drop();
+
+	return animMesh;
+}
+
+//! Walks the lines of the chunk like parseChunk(), only looking at their first characters
+void COBJMeshFileLoader::countChunk(SObjChunk &chunk)
+{
+	const c8 *bufPtr = chunk.Begin;
+	while (bufPtr != chunk.End) {
+		if (bufPtr[0] == 'v') {
+			switch (bufPtr[1]) {
+			case ' ':
+				++chunk.PositionCount;
+				break;
+			case 'n':
+				++chunk.NormalCount;
+				break;
+			case 't':
+				++chunk.TCoordCount;
+				break;
+			}
+		}
+		bufPtr = goNextLine(bufPtr, chunk.End);
+	}
+}
+
+void COBJMeshFileLoader::parseChunk(SObjChunk &chunk, core::vector3df *positions,
+		core::vector2df *tcoords, core::vector3df *normals)
+{
+	const u32 WORD_BUFFER_LENGTH = 512;
+	const c8 *const bufEnd = chunk.End;
+
+	// vectors of the file read so far, for the checks and relative indices of faces
+	u32 vbsize = chunk.PositionOffset;
+	u32 vtsize = chunk.TCoordOffset;
+	u32 vnsize = chunk.NormalOffset;
+
+	u32 smoothingGroup = 0;
+	const core::stringc TAG_OFF = "off";
+
+	// lines are found from their start, exactly like in countChunk()
+	const c8 *lineStart = chunk.Begin;
+	while (lineStart != bufEnd) {
+		const c8 *bufPtr = lineStart;
 		switch (bufPtr[0]) {
 		case 'm': // mtllib (material)
 			break; // not supported
@@ -86,43 +445,34 @@ IAnimatedMesh *COBJMeshFileLoader::createMesh(io::IReadFile *file)
 		case 'v': // v, vn, vt
 			switch (bufPtr[1]) {
 			case ' ': // vertex
-			{
-				core::vector3df vec;
-				bufPtr = readVec3(bufPtr, vec, bufEnd);
-				vertexBuffer.push_back(vec);
-			} break;
+				readVec3(bufPtr, positions[vbsize++], bufEnd);
+				break;
 
 			case 'n': // normal
-			{
-				core::vector3df vec;
-				bufPtr = readVec3(bufPtr, vec, bufEnd);
-				normalsBuffer.push_back(vec);
-			} break;
+				readVec3(bufPtr, normals[vnsize++], bufEnd);
+				break;
 
 			case 't': // texcoord
-			{
-				core::vector2df vec;
-				bufPtr = readUV(bufPtr, vec, bufEnd);
-				textureCoordBuffer.push_back(vec);
-			} break;
+				readUV(bufPtr, tcoords[vtsize++], bufEnd);
+				break;
 			}
 			break;
 
 		case 'g': // group name
 		{
 			c8 grp[WORD_BUFFER_LENGTH];
-			bufPtr = goAndCopyNextWord(grp, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
+			goAndCopyNextWord(grp, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
 #ifdef _IRR_DEBUG_OBJ_LOADER_
 			g_irrlogger->log("Loaded group start", grp, ELL_DEBUG);
 #endif
-			grpName = ('\0' != grp[0]) ? grp : "default";
-			mtlChanged = true;
+			chunk.Statements.push_back({EOS_GROUP, (u32)chunk.Names.size(), 0});
+			chunk.Names.emplace_back(('\0' != grp[0]) ? grp : "default");
 		} break;
 
 		case 's': // smoothing can be a group or off (equiv. to 0)
 		{
 			c8 smooth[WORD_BUFFER_LENGTH];
-			bufPtr = goAndCopyNextWord(smooth, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
+			goAndCopyNextWord(smooth, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
 #ifdef _IRR_DEBUG_OBJ_LOADER_
 			g_irrlogger->log("Loaded smoothing group start", smooth, ELL_DEBUG);
 #endif
@@ -138,42 +488,23 @@ IAnimatedMesh *COBJMeshFileLoader::createMesh(io::IReadFile *file)
 			// get name of material
 			{
 				c8 matName[WORD_BUFFER_LENGTH];
-				bufPtr = goAndCopyNextWord(matName, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
+				goAndCopyNextWord(matName, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
 #ifdef _IRR_DEBUG_OBJ_LOADER_
 				g_irrlogger->log("Loaded material start", matName, ELL_DEBUG);
 #endif
-				mtlName = matName;
-				mtlChanged = true;
+				chunk.Statements.push_back({EOS_MATERIAL, (u32)chunk.Names.size(), 0});
+				chunk.Names.emplace_back(matName);
 			}
 			break;
 
 		case 'f': // face
 		{
 			c8 vertexWord[WORD_BUFFER_LENGTH]; // for retrieving vertex data
-			scene::Vertex3D v;
-			// Assign vertex color from currently active material's diffuse color
-			if (mtlChanged) {
-				// retrieve the material
-				SObjMtl *useMtl = findMtl(mtlName, grpName);
-				// only change material if we found it
-				if (useMtl)
-					currMtl = useMtl;
-				mtlChanged = false;
-			}
-			if (currMtl)
-				v.Color = video::SColorf(0.8f, 0.8f, 0.8f, 1.0f).toSColor();
+			const u32 first = chunk.Corners.size();
 
-			// get all vertices data in this face (current line of obj file)
-			const core::stringc wordBuffer = copyLine(bufPtr, bufEnd);
-			const c8 *linePtr = wordBuffer.c_str();
-			const c8 *const endPtr = linePtr + wordBuffer.size();
-
-			faceCorners.set_used(0); // fast clear
-
-			// read in all vertices
-			auto &Vertices = currMtl->Meshbuffer->Vertices->Data;
-			linePtr = goNextWord(linePtr, endPtr);
-			while (0 != linePtr[0]) {
+			// read in all vertices of this face (current line of obj file)
+			const c8 *linePtr = goNextWord(bufPtr, bufEnd, false);
+			while (linePtr != bufEnd && *linePtr != '\n' && *linePtr != '\r' && *linePtr != 0) {
 				// Array to communicate with retrieveVertexIndices()
 				// sends the buffer sizes and gets the actual indices
 				// if index not set returns -1
@@ -181,66 +512,31 @@ IAnimatedMesh *COBJMeshFileLoader::createMesh(io::IReadFile *file)
 				Idx[0] = Idx[1] = Idx[2] = -1;
 
 				// read in next vertex's data
-				u32 wlength = copyWord(vertexWord, linePtr, WORD_BUFFER_LENGTH, endPtr);
+				u32 wlength = copyWord(vertexWord, linePtr, WORD_BUFFER_LENGTH, bufEnd);
 				// this function will also convert obj's 1-based index to c++'s 0-based index
-				retrieveVertexIndices(vertexWord, Idx, vertexWord + wlength + 1, vertexBuffer.size(), textureCoordBuffer.size(), normalsBuffer.size());
-				if (Idx[0] >= 0 && Idx[0] < (s32)vertexBuffer.size())
-					v.Pos = vertexBuffer[Idx[0]];
-				else {
-					g_irrlogger->log("Invalid vertex index in this line", wordBuffer.c_str(), ELL_ERROR);
-					delete[] buf;
-					cleanUp();
-					return 0;
-				}
-				if (Idx[1] >= 0 && Idx[1] < (s32)textureCoordBuffer.size())
-					v.TCoords = textureCoordBuffer[Idx[1]];
-				else
-					v.TCoords.set(0.0f, 0.0f);
-				if (Idx[2] >= 0 && Idx[2] < (s32)normalsBuffer.size())
-					v.Normal = normalsBuffer[Idx[2]];
-				else {
-					v.Normal.set(0.0f, 0.0f, 0.0f);
-					currMtl->RecalculateNormals = true;
+				retrieveVertexIndices(vertexWord, Idx, vertexWord + wlength + 1, vbsize, vtsize, vnsize);
+				if (Idx[0] < 0 || Idx[0] >= (s32)vbsize) {
+					chunk.Error = "Invalid vertex index in this line";
+					chunk.ErrorLine = copyLine(bufPtr, bufEnd);
+					return;
 				}
-
-				int vertLocation;
-				auto n = currMtl->VertMap.find(v);
-				if (n != currMtl->VertMap.end()) {
-					vertLocation = n->second;
-				} else {
-					Vertices.push_back(v);
-					vertLocation = Vertices.size() - 1;
-					currMtl->VertMap.emplace(v, vertLocation);
-				}
-
-				faceCorners.push_back(vertLocation);
+				if (Idx[1] >= (s32)vtsize)
+					Idx[1] = -1;
+				if (Idx[2] >= (s32)vnsize)
+					Idx[2] = -1;
+				chunk.Corners.push_back({Idx[0], Idx[1], Idx[2]});
 
 				// go to next vertex
-				linePtr = goNextWord(linePtr, endPtr);
-			}
-
-			if (faceCorners.size() < 3) {
-				g_irrlogger->log("Too few vertices in this line", wordBuffer.c_str(), ELL_ERROR);
-				delete[] buf;
-				cleanUp();
-				return 0;
+				linePtr = goNextWord(linePtr, bufEnd, false);
 			}
 
-			// triangulate the face
-			auto &Indices = currMtl->Meshbuffer->Indices->Data;
-			const int c = faceCorners[0];
-			for (u32 i = 1; i < faceCorners.size() - 1; ++i) {
-				// Add a triangle
-				const int a = faceCorners[i + 1];
-				const int b = faceCorners[i];
-				if (a != b && a != c && b != c) { // ignore degenerated faces. We can get them when we merge vertices above in the VertMap.
-					Indices.push_back(a);
-					Indices.push_back(b);
-					Indices.push_back(c);
-				} else {
-					++degeneratedFaces;
-				}
+			const u32 count = chunk.Corners.size() - first;
+			if (count < 3) {
+				chunk.Error = "Too few vertices in this line";
+				chunk.ErrorLine = copyLine(bufPtr, bufEnd);
+				return;
 			}
+			chunk.Statements.push_back({EOS_FACE, first, count});
 		} break;
 
 		case '#': // comment
@@ -248,46 +544,44 @@ IAnimatedMesh *COBJMeshFileLoader::createMesh(io::IReadFile *file)
 			break;
 		} // end switch(bufPtr[0])
 		// eat up rest of line
-		bufPtr = goNextLine(bufPtr, bufEnd);
-		++lineNr;
-	} // end while(bufPtr && (bufPtr-buf<filesize))
-
-	if (degeneratedFaces > 0) {
-		core::stringc log(degeneratedFaces);
-		log += " degenerated faces removed in ";
-		log += core::stringc(fullName);
-		g_irrlogger->log(log.c_str(), ELL_INFORMATION);
+		lineStart = goNextLine(lineStart, bufEnd);
 	}
+}
 
-	SMesh *mesh = new SMesh();
-
-	// Combine all the groups (meshbuffers) into the mesh
-	for (u32 m = 0; m < Materials.size(); ++m) {
-		if (Materials[m]->Meshbuffer->getIndexCount() > 0) {
-			Materials[m]->Meshbuffer->recalculateBoundingBox();
-			if (Materials[m]->RecalculateNormals)
-				SceneManager->getMeshManipulator()->recalculateNormals(Materials[m]->Meshbuffer);
-			mesh->addMeshBuffer(Materials[m]->Meshbuffer);
+COBJMeshFileLoader::SBenchmarkResult COBJMeshFileLoader::benchmark(io::IReadFile *file, u32 runs)
+{
+	SBenchmarkResult result;
+	if (!file || !runs)
+		return result;
+
+	for (u32 mode = 0; mode < 2; ++mode) {
+		f64 milliseconds = 0.0;
+		for (u32 i = 0; i < runs; ++i) {
+			file->seek(0);
+			const auto start = std::chrono::steady_clock::now();
+			IAnimatedMesh *mesh = createMesh(file, mode == 1);
+			milliseconds += std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (!mesh)
+				return result;
+
+			if (mode == 1 && i == 0) {
+				IMesh *frame = mesh->getMesh(0);
+				for (u32 b = 0; b < frame->getMeshBufferCount(); ++b) {
+					result.VertexCount += frame->getMeshBuffer(b)->getVertexCount();
+					result.TriangleCount += frame->getMeshBuffer(b)->getIndexCount() / 3;
+				}
+			}
+			mesh->drop();
 		}
+		(mode == 0 ? result.SerialMilliseconds : result.ParallelMilliseconds) = milliseconds / runs;
 	}
+	file->seek(0);
 
-	// Create the Animated mesh if there's anything in the mesh
-	SAnimatedMesh *animMesh = 0;
-	if (0 != mesh->getMeshBufferCount()) {
-		mesh->recalculateBoundingBox();
-		animMesh = new SAnimatedMesh();
-		animMesh->Type = EAMT_OBJ;
-		animMesh->addMesh(mesh);
-		animMesh->recalculateBoundingBox();
+	if (result.ParallelMilliseconds > 0.0) {
+		result.Speedup = result.SerialMilliseconds / result.ParallelMilliseconds;
+		result.MegabytesPerSecond = file->getSize() / (1024.0 * 1024.0) / (result.ParallelMilliseconds / 1000.0);
 	}
-
-	// Clean up the allocate obj file contents
-	delete[] buf;
-	// more cleaning up
-	cleanUp();
-	mesh->drop();
-
-	return animMesh;
+	return result;
 }
 
 //! Read RGB color
@@ -308,28 +602,19 @@ const c8 *COBJMeshFileLoader::readColor(const c8 *bufPtr, video::SColor &color,
 //! Read 3d vector of floats
 const c8 *COBJMeshFileLoader::readVec3(const c8 *bufPtr, core::vector3df &vec, const c8 *const bufEnd)
 {
-	const u32 WORD_BUFFER_LENGTH = 256;
-	c8 wordBuffer[WORD_BUFFER_LENGTH];
-
-	bufPtr = goAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.X = -core::fast_atof(wordBuffer); // change handedness
-	bufPtr = goAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.Y = core::fast_atof(wordBuffer);
-	bufPtr = goAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.Z = core::fast_atof(wordBuffer);
+	bufPtr = readFloat(goNextWord(bufPtr, bufEnd, false), vec.X, bufEnd);
+	vec.X = -vec.X; // change handedness
+	bufPtr = readFloat(goNextWord(bufPtr, bufEnd, false), vec.Y, bufEnd);
+	bufPtr = readFloat(goNextWord(bufPtr, bufEnd, false), vec.Z, bufEnd);
 	return bufPtr;
 }
 
 //! Read 2d vector of floats
 const c8 *COBJMeshFileLoader::readUV(const c8 *bufPtr, core::vector2df &vec, const c8 *const bufEnd)
 {
-	const u32 WORD_BUFFER_LENGTH = 256;
-	c8 wordBuffer[WORD_BUFFER_LENGTH];
-
-	bufPtr = goAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.X = core::fast_atof(wordBuffer);
-	bufPtr = goAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.Y = 1 - core::fast_atof(wordBuffer); // change handedness
+	bufPtr = readFloat(goNextWord(bufPtr, bufEnd, false), vec.X, bufEnd);
+	bufPtr = readFloat(goNextWord(bufPtr, bufEnd, false), vec.Y, bufEnd);
+	vec.Y = 1 - vec.Y; // change handedness
 	return bufPtr;
 }
 
@@ -344,30 +629,30 @@ const c8 *COBJMeshFileLoader::readBool(const c8 *bufPtr, bool &tf, const c8 *con
 	return bufPtr;
 }
 
-COBJMeshFileLoader::SObjMtl *COBJMeshFileLoader::findMtl(const core::stringc &mtlName, const core::stringc &grpName)
+COBJMeshFileLoader::SObjMtl *COBJMeshFileLoader::findMtl(core::array<SObjMtl *> &materials, const core::stringc &mtlName, const core::stringc &grpName)
 {
 	COBJMeshFileLoader::SObjMtl *defMaterial = 0;
 	// search existing Materials for best match
 	// exact match does return immediately, only name match means a new group
-	for (u32 i = 0; i < Materials.size(); ++i) {
-		if (Materials[i]->Name == mtlName) {
-			if (Materials[i]->Group == grpName)
-				return Materials[i];
+	for (u32 i = 0; i < materials.size(); ++i) {
+		if (materials[i]->Name == mtlName) {
+			if (materials[i]->Group == grpName)
+				return materials[i];
 			else
-				defMaterial = Materials[i];
+				defMaterial = materials[i];
 		}
 	}
 	// we found a partial match
 	if (defMaterial) {
-		Materials.push_back(new SObjMtl(*defMaterial));
-		Materials.getLast()->Group = grpName;
-		return Materials.getLast();
+		materials.push_back(new SObjMtl(*defMaterial));
+		materials.getLast()->Group = grpName;
+		return materials.getLast();
 	}
 	// we found a new group for a non-existent material
 	else if (grpName.size()) {
-		Materials.push_back(new SObjMtl(*Materials[0]));
-		Materials.getLast()->Group = grpName;
-		return Materials.getLast();
+		materials.push_back(new SObjMtl(*materials[0]));
+		materials.getLast()->Group = grpName;
+		return materials.getLast();
 	}
 	return 0;
 }
@@ -516,14 +801,16 @@ bool COBJMeshFileLoader::retrieveVertexIndices(c8 *vertexData, s32 *idx, const c
 	return true;
 }
 
-void COBJMeshFileLoader::cleanUp()
+void COBJMeshFileLoader::cleanUp(core::array<SObjMtl *> &materials)
 {
-	for (u32 i = 0; i < Materials.size(); ++i) {
-		Materials[i]->Meshbuffer->drop();
-		delete Materials[i];
+	for (u32 i = 0; i < materials.size(); ++i) {
+		for (SMeshBuffer *buffer : materials[i]->FullBuffers)
+			buffer->drop();
+		materials[i]->Meshbuffer->drop();
+		delete materials[i];
 	}
 
-	Materials.clear();
+	materials.clear();
 }
 
 } // end namespace scene
@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <map>
+#include <vector>
 #include "Mesh/IMeshLoader.h"
 #include "Scene/ISceneManager.h"
 #include "Utils/irrString.h"
@@ -34,7 +34,55 @@ public:
 	//! See IReferenceCounted::drop() for more information.
 	IAnimatedMesh *createMesh(io::IReadFile *file) override;
 
+	//! The state of a load is kept per call
+	bool isReentrant() const override { return true; }
+
+	//! Parse large files in line aligned chunks on the job system, default true
+	void setParallelParsing(bool on) { ParallelParsing = on; }
+
+	//! Results of benchmark()
+	struct SBenchmarkResult
+	{
+		//! Average time of loading the file on the calling thread only
+		f64 SerialMilliseconds = 0.0;
+
+		//! Average time of loading the file with parallel parsing
+		f64 ParallelMilliseconds = 0.0;
+
+		//! SerialMilliseconds / ParallelMilliseconds
+		f64 Speedup = 0.0;
+
+		//! Size of the file divided by ParallelMilliseconds
+		f64 MegabytesPerSecond = 0.0;
+
+		//! Welded vertices and triangles of the loaded mesh
+		u32 VertexCount = 0;
+		u32 TriangleCount = 0;
+	};
+
+	//! Loads a file serially and in parallel and compares the times
+	/** \param runs Amount of loads of each kind, averaged. */
+	SBenchmarkResult benchmark(io::IReadFile *file, u32 runs = 3);
+
 private:
+	//! Open addressing hash of the vertices of a mesh buffer, for welding equal ones
+	class CVertexWeldMap
+	{
+	public:
+		//! Returns the index of a vertex equal to v, appending v if there is none
+		u32 findOrAdd(const scene::Vertex3D &v, std::vector<scene::Vertex3D> &vertices);
+
+		void clear();
+
+	private:
+		void grow();
+
+		//! Hash and index + 1 of a vertex per slot, 0 for empty slots
+		std::vector<u32> Hashes;
+		std::vector<u32> Slots;
+		u32 Count = 0;
+	};
+
 	struct SObjMtl
 	{
 		SObjMtl() :
@@ -53,8 +101,12 @@ private:
 			Meshbuffer->Material = o.Meshbuffer->Material;
 		}
 
-		std::map<scene::Vertex3D, int, scene::CompareVertex3D> VertMap;
+		CVertexWeldMap WeldMap;
 		scene::SMeshBuffer *Meshbuffer;
+
+		//! Buffers which reached the limit of 16 bit indices
+		std::vector<scene::SMeshBuffer *> FullBuffers;
+
 		core::stringc Name;
 		core::stringc Group;
 		f32 Bumpiness;
@@ -77,7 +129,7 @@ private:
 	const c8 *goAndCopyNextWord(c8 *outBuf, const c8 *inBuf, u32 outBufLength, const c8 *const pBufEnd);
 
 	//! Find and return the material with the given name
-	SObjMtl *findMtl(const core::stringc &mtlName, const core::stringc &grpName);
+	SObjMtl *findMtl(core::array<SObjMtl *> &materials, const core::stringc &mtlName, const core::stringc &grpName);
 
 	//! Read RGB color
 	const c8 *readColor(const c8 *bufPtr, video::SColor &color, const c8 *const pBufEnd);
@@ -93,11 +145,23 @@ private:
 	// indices are changed to 0-based index instead of 1-based from the obj file
 	bool retrieveVertexIndices(c8 *vertexData, s32 *idx, const c8 *bufEnd, u32 vbsize, u32 vtsize, u32 vnsize);
 
-	void cleanUp();
+	//! Statements of a line aligned part of the file, see createMesh()
+	struct SObjChunk;
+
+	//! Counts the positions, texture coordinates and normals of a chunk
+	void countChunk(SObjChunk &chunk);
+
+	//! Parses a chunk, writing its vectors into the arrays of the whole file
+	void parseChunk(SObjChunk &chunk, core::vector3df *positions,
+			core::vector2df *tcoords, core::vector3df *normals);
+
+	IAnimatedMesh *createMesh(io::IReadFile *file, bool parallel);
+
+	void cleanUp(core::array<SObjMtl *> &materials);
 
 	scene::ISceneManager *SceneManager;
 
-	core::array<SObjMtl *> Materials;
+	bool ParallelParsing;
 };
 
 } // end namespace scene
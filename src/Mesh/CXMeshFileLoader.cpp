@@ -29,10 +29,183 @@
 namespace scene
 {
 
+namespace
+{
+//! Copies a token, which points into the file buffer, for names and logging
+inline core::stringc tokenString(std::string_view token)
+{
+	return core::stringc(token.data(), (u32)token.size());
+}
+
+//! State of loading one file, so the loader can run on several threads at once
+class CXReader
+{
+public:
+	CXReader() :
+			AnimatedMesh(0), Buffer(0), P(0), End(0), BinaryNumCount(0), Line(0), ErrorState(false),
+			CurFrame(0), MajorVersion(0), MinorVersion(0), BinaryFormat(false), FloatSize(0)
+	{}
+
+	~CXReader()
+	{
+		delete[] Buffer;
+		for (u32 i = 0; i < Meshes.size(); ++i)
+			delete Meshes[i];
+	}
+
+	IAnimatedMesh *read(io::IReadFile *file);
+
+	struct SXMesh
+	{
+		SXMesh() :
+				MaxSkinWeightsPerVertex(0), MaxSkinWeightsPerFace(0), BoneCount(0), AttachedJointID(-1), HasSkinning(false), HasVertexColors(false) {}
+		// this mesh contains triangulated texture data.
+		// because in an .x file, faces can be made of more than 3
+		// vertices, the indices data structure is triangulated during the
+		// loading process. The IndexCountPerFace array is filled during
+		// this triangulation process and stores how much indices belong to
+		// every face. This data structure can be ignored, because all data
+		// in this structure is triangulated.
+
+		core::stringc Name;
+
+		u32 MaxSkinWeightsPerVertex;
+		u32 MaxSkinWeightsPerFace;
+		u32 BoneCount;
+
+		core::array<u16> IndexCountPerFace; // default 3, but could be more
+
+		core::array<scene::SSkinMeshBuffer *> Buffers;
+
+		core::array<scene::Vertex3D> Vertices;
+		core::array<core::vector2df> TCoords2;
+
+		core::array<u32> Indices;
+
+		core::array<u32> FaceMaterialIndices; // index of material for each face
+
+		core::array<video::SMaterial> Materials; // material array
+
+		core::array<u32> WeightJoint;
+		core::array<u32> WeightNum;
+
+		s32 AttachedJointID;
+
+		bool HasSkinning;
+		bool HasVertexColors;
+	};
+
+private:
+	bool load(io::IReadFile *file);
+
+	bool readFileIntoMemory(io::IReadFile *file);
+
+	bool parseFile();
+
+	bool parseDataObject();
+
+	bool parseDataObjectTemplate();
+
+	bool parseDataObjectFrame(SkinnedMesh::SJoint *parent);
+
+	bool parseDataObjectTransformationMatrix(core::matrix4 &mat);
+
+	bool parseDataObjectMesh(SXMesh &mesh);
+
+	bool parseDataObjectSkinWeights(SXMesh &mesh);
+
+	bool parseDataObjectSkinMeshHeader(SXMesh &mesh);
+
+	bool parseDataObjectMeshNormals(SXMesh &mesh);
+
+	bool parseDataObjectMeshTextureCoords(SXMesh &mesh);
+
+	bool parseDataObjectMeshVertexColors(SXMesh &mesh);
+
+	bool parseDataObjectMeshMaterialList(SXMesh &mesh);
+
+	bool parseDataObjectAnimationSet();
+
+	bool parseDataObjectAnimationTicksPerSecond();
+
+	bool parseDataObjectAnimation();
+
+	bool parseDataObjectAnimationKey(SkinnedMesh::SJoint *joint);
+
+	bool parseDataObjectTextureFilename(core::stringc &texturename);
+
+	bool parseUnknownDataObject();
+
+	//! places pointer to next begin of a token, and ignores comments
+	void findNextNoneWhiteSpace();
+
+	//! places pointer to next begin of a token, which must be a number,
+	// and ignores comments
+	void findNextNoneWhiteSpaceNumber();
+
+	//! returns next parseable token. Returns empty string if no token there
+	/** The token points into Buffer, or to a constant for binary tokens, and
+	stays valid until the file is unloaded. */
+	std::string_view getNextToken();
+
+	//! reads header of dataobject including the opening brace.
+	//! returns false if error happened, and writes name of object
+	//! if there is one
+	bool readHeadOfDataObject(core::stringc *outname = 0);
+
+	//! checks for closing curly brace, returns false if not there
+	bool checkForClosingBrace();
+
+	//! checks for one following semicolons, returns false if not there
+	bool checkForOneFollowingSemicolons();
+
+	//! checks for two following semicolons, returns false if they are not there
+	bool checkForTwoFollowingSemicolons();
+
+	//! reads a x file style string
+	bool getNextTokenAsString(core::stringc &out);
+
+	void readUntilEndOfLine();
+
+	u16 readBinWord();
+	u32 readBinDWord();
+	u32 readInt();
+	f32 readFloat();
+	//! reads count numbers, in binary files as one copy per number list
+	void readInts(u32 *out, u32 count);
+	void readFloats(f32 *out, u32 count);
+	bool readVector2(core::vector2df &vec);
+	bool readVector3(core::vector3df &vec);
+	bool readMatrix(core::matrix4 &mat);
+	bool readRGB(video::SColor &color);
+	bool readRGBA(video::SColor &color);
+
+	SkinnedMeshBuilder *AnimatedMesh;
+
+	c8 *Buffer;
+	const c8 *P;
+	c8 *End;
+	// counter for number arrays in binary format
+	u32 BinaryNumCount;
+	u32 Line;
+	io::path FilePath;
+
+	bool ErrorState;
+
+	SkinnedMesh::SJoint *CurFrame;
+
+	core::array<SXMesh *> Meshes;
+
+	u32 MajorVersion;
+	u32 MinorVersion;
+	bool BinaryFormat;
+	c8 FloatSize;
+};
+}
+
+
 //! Constructor
-CXMeshFileLoader::CXMeshFileLoader(scene::ISceneManager *smgr) :
-		AnimatedMesh(0), Buffer(0), P(0), End(0), BinaryNumCount(0), Line(0), ErrorState(false),
-		CurFrame(0), MajorVersion(0), MinorVersion(0), BinaryFormat(false), FloatSize(0)
+CXMeshFileLoader::CXMeshFileLoader(scene::ISceneManager *smgr)
 {}
 
 //! returns true if the file maybe is able to be loaded by this class
@@ -51,6 +224,12 @@ IAnimatedMesh *CXMeshFileLoader::createMesh(io::IReadFile *file)
 	if (!file)
 		return 0;
 
+	CXReader reader;
+	return reader.read(file);
+}
+
+IAnimatedMesh *CXReader::read(io::IReadFile *file)
+{
 #ifdef _XREADER_DEBUG
 	u32 time = os::Timer::getRealTime();
 #endif
@@ -73,28 +252,11 @@ IAnimatedMesh *CXMeshFileLoader::createMesh(io::IReadFile *file)
 	tmpString += "ms";
 	g_irrlogger->log(tmpString.c_str());
 #endif
-	// Clear up
-
-	MajorVersion = 0;
-	MinorVersion = 0;
-	BinaryFormat = 0;
-	BinaryNumCount = 0;
-	FloatSize = 0;
-	P = 0;
-	End = 0;
-	CurFrame = 0;
-
-	delete[] Buffer;
-	Buffer = 0;
-
-	for (u32 i = 0; i < Meshes.size(); ++i)
-		delete Meshes[i];
-	Meshes.clear();
 
 	return res;
 }
 
-bool CXMeshFileLoader::load(io::IReadFile *file)
+bool CXReader::load(io::IReadFile *file)
 {
 	if (!readFileIntoMemory(file))
 		return false;
@@ -336,7 +498,7 @@ bool CXMeshFileLoader::load(io::IReadFile *file)
 }
 
 //! Reads file into memory
-bool CXMeshFileLoader::readFileIntoMemory(io::IReadFile *file)
+bool CXReader::readFileIntoMemory(io::IReadFile *file)
 {
 	const long size = file->getSize();
 	if (size < 12) {
@@ -402,7 +564,7 @@ bool CXMeshFileLoader::readFileIntoMemory(io::IReadFile *file)
 }
 
 //! Parses the file
-bool CXMeshFileLoader::parseFile()
+bool CXReader::parseFile()
 {
 	while (parseDataObject()) {
 		// loop
@@ -412,16 +574,16 @@ bool CXMeshFileLoader::parseFile()
 }
 
 //! Parses the next Data object in the file
-bool CXMeshFileLoader::parseDataObject()
+bool CXReader::parseDataObject()
 {
-	core::stringc objectName = getNextToken();
+	std::string_view objectName = getNextToken();
 
 	if (objectName.size() == 0)
 		return false;
 
 		// parse specific object
 #ifdef _XREADER_DEBUG
-	g_irrlogger->log("debug DataObject", objectName.c_str(), ELL_DEBUG);
+	g_irrlogger->log("debug DataObject", tokenString(objectName).c_str(), ELL_DEBUG);
 #endif
 
 	if (objectName == "template")
@@ -449,12 +611,12 @@ bool CXMeshFileLoader::parseDataObject()
 		return true;
 	}
 
-	g_irrlogger->log("Unknown data object in animation of .x file", objectName.c_str(), ELL_WARNING);
+	g_irrlogger->log("Unknown data object in animation of .x file", tokenString(objectName).c_str(), ELL_WARNING);
 
 	return parseUnknownDataObject();
 }
 
-bool CXMeshFileLoader::parseDataObjectTemplate()
+bool CXReader::parseDataObjectTemplate()
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: Reading template", ELL_DEBUG);
@@ -475,7 +637,7 @@ bool CXMeshFileLoader::parseDataObjectTemplate()
 
 	// read and ignore data members
 	while (true) {
-		core::stringc s = getNextToken();
+		std::string_view s = getNextToken();
 
 		if (s == "}")
 			break;
@@ -487,7 +649,7 @@ bool CXMeshFileLoader::parseDataObjectTemplate()
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectFrame(SkinnedMesh::SJoint *Parent)
+bool CXReader::parseDataObjectFrame(SkinnedMesh::SJoint *Parent)
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: Reading frame", ELL_DEBUG);
@@ -538,10 +700,10 @@ bool CXMeshFileLoader::parseDataObjectFrame(SkinnedMesh::SJoint *Parent)
 	// read tokens until closing brace is reached.
 
 	while (true) {
-		core::stringc objectName = getNextToken();
+		std::string_view objectName = getNextToken();
 
 #ifdef _XREADER_DEBUG
-		g_irrlogger->log("debug DataObject in frame:", objectName.c_str(), ELL_DEBUG);
+		g_irrlogger->log("debug DataObject in frame:", tokenString(objectName).c_str(), ELL_DEBUG);
 #endif
 
 		if (objectName.size() == 0) {
@@ -576,7 +738,7 @@ bool CXMeshFileLoader::parseDataObjectFrame(SkinnedMesh::SJoint *Parent)
 			if (!parseDataObjectMesh(*mesh))
 				return false;
 		} else {
-			g_irrlogger->log("Unknown data object in frame in x file", objectName.c_str(), ELL_WARNING);
+			g_irrlogger->log("Unknown data object in frame in x file", tokenString(objectName).c_str(), ELL_WARNING);
 			if (!parseUnknownDataObject())
 				return false;
 		}
@@ -585,7 +747,7 @@ bool CXMeshFileLoader::parseDataObjectFrame(SkinnedMesh::SJoint *Parent)
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectTransformationMatrix(core::matrix4 &mat)
+bool CXReader::parseDataObjectTransformationMatrix(core::matrix4 &mat)
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: Reading Transformation Matrix", ELL_DEBUG);
@@ -613,7 +775,7 @@ bool CXMeshFileLoader::parseDataObjectTransformationMatrix(core::matrix4 &mat)
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectMesh(SXMesh &mesh)
+bool CXReader::parseDataObjectMesh(SXMesh &mesh)
 {
 	core::stringc name;
 
@@ -634,9 +796,14 @@ bool CXMeshFileLoader::parseDataObjectMesh(SXMesh &mesh)
 	const u32 nVertices = readInt();
 
 	// read vertices
+	core::array<core::vector3df> positions;
+	positions.set_used(nVertices);
+	if (nVertices)
+		readFloats(&positions[0].X, nVertices * 3);
+
 	mesh.Vertices.set_used(nVertices);
 	for (u32 n = 0; n < nVertices; ++n) {
-		readVector3(mesh.Vertices[n].Pos);
+		mesh.Vertices[n].Pos = positions[n];
 		mesh.Vertices[n].Color = 0xFFFFFFFF;
 		mesh.Vertices[n].Normal = core::vector3df(0.0f);
 	}
@@ -671,8 +838,7 @@ bool CXMeshFileLoader::parseDataObjectMesh(SXMesh &mesh)
 			mesh.Indices.set_used(mesh.Indices.size() + ((triangles - 1) * 3));
 			mesh.IndexCountPerFace[k] = (u16)(triangles * 3);
 
-			for (u32 f = 0; f < fcnt; ++f)
-				polygonfaces[f] = readInt();
+			readInts(polygonfaces.pointer(), fcnt);
 
 			for (u32 jk = 0; jk < triangles; ++jk) {
 				mesh.Indices[currentIndex++] = polygonfaces[0];
@@ -682,9 +848,8 @@ bool CXMeshFileLoader::parseDataObjectMesh(SXMesh &mesh)
 
 			// TODO: change face indices in material list
 		} else {
-			mesh.Indices[currentIndex++] = readInt();
-			mesh.Indices[currentIndex++] = readInt();
-			mesh.Indices[currentIndex++] = readInt();
+			readInts(&mesh.Indices[currentIndex], 3);
+			currentIndex += 3;
 			mesh.IndexCountPerFace[k] = 3;
 		}
 	}
@@ -704,7 +869,7 @@ bool CXMeshFileLoader::parseDataObjectMesh(SXMesh &mesh)
 	// here, other data objects may follow
 
 	while (true) {
-		core::stringc objectName = getNextToken();
+		std::string_view objectName = getNextToken();
 
 		if (objectName.size() == 0) {
 			g_irrlogger->log("Unexpected ending found in Mesh in x file.", ELL_WARNING);
@@ -715,7 +880,7 @@ bool CXMeshFileLoader::parseDataObjectMesh(SXMesh &mesh)
 		}
 
 #ifdef _XREADER_DEBUG
-		g_irrlogger->log("debug DataObject in mesh", objectName.c_str(), ELL_DEBUG);
+		g_irrlogger->log("debug DataObject in mesh", tokenString(objectName).c_str(), ELL_DEBUG);
 #endif
 
 		if (objectName == "MeshNormals") {
@@ -851,8 +1016,7 @@ bool CXMeshFileLoader::parseDataObjectMesh(SXMesh &mesh)
 			}
 			const u32 datasize = readInt();
 			u32 *data = new u32[datasize];
-			for (j = 0; j < datasize; ++j)
-				data[j] = readInt();
+			readInts(data, datasize);
 
 			if (!checkForOneFollowingSemicolons()) {
 				g_irrlogger->log("No finishing semicolon in DeclData found.", ELL_WARNING);
@@ -886,8 +1050,7 @@ bool CXMeshFileLoader::parseDataObjectMesh(SXMesh &mesh)
 			const u32 dataformat = readInt();
 			const u32 datasize = readInt();
 			u32 *data = new u32[datasize];
-			for (u32 j = 0; j < datasize; ++j)
-				data[j] = readInt();
+			readInts(data, datasize);
 			if (dataformat & 0x102) { // 2nd uv set
 				mesh.TCoords2.reallocate(mesh.Vertices.size());
 				u8 *dataptr = (u8 *)data;
@@ -916,7 +1079,7 @@ bool CXMeshFileLoader::parseDataObjectMesh(SXMesh &mesh)
 			if (!parseDataObjectSkinWeights(mesh))
 				return false;
 		} else {
-			g_irrlogger->log("Unknown data object in mesh in x file", objectName.c_str(), ELL_WARNING);
+			g_irrlogger->log("Unknown data object in mesh in x file", tokenString(objectName).c_str(), ELL_WARNING);
 			if (!parseUnknownDataObject())
 				return false;
 		}
@@ -925,7 +1088,7 @@ bool CXMeshFileLoader::parseDataObjectMesh(SXMesh &mesh)
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectSkinWeights(SXMesh &mesh)
+bool CXReader::parseDataObjectSkinWeights(SXMesh &mesh)
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: Reading mesh skin weights", ELL_DEBUG);
@@ -971,6 +1134,11 @@ bool CXMeshFileLoader::parseDataObjectSkinWeights(SXMesh &mesh)
 	mesh.WeightJoint.reallocate(mesh.WeightJoint.size() + nWeights);
 	mesh.WeightNum.reallocate(mesh.WeightNum.size() + nWeights);
 
+	core::array<u32> vertexIds;
+	vertexIds.set_used(nWeights);
+	if (nWeights)
+		readInts(vertexIds.pointer(), nWeights);
+
 	for (i = 0; i < nWeights; ++i) {
 		mesh.WeightJoint.push_back(*n);
 		mesh.WeightNum.push_back(joint->Weights.size()); // id of weight
@@ -979,13 +1147,17 @@ bool CXMeshFileLoader::parseDataObjectSkinWeights(SXMesh &mesh)
 		SkinnedMesh::SWeight *weight = AnimatedMesh->addWeight(joint);
 
 		weight->buffer_id = 0;
-		weight->vertex_id = readInt();
+		weight->vertex_id = vertexIds[i];
 	}
 
 	// read vertex weights
+	core::array<f32> strengths;
+	strengths.set_used(nWeights);
+	if (nWeights)
+		readFloats(strengths.pointer(), nWeights);
 
-	for (i = jointStart; i < jointStart + nWeights; ++i)
-		joint->Weights[i].strength = readFloat();
+	for (i = 0; i < nWeights; ++i)
+		joint->Weights[jointStart + i].strength = strengths[i];
 
 	// read matrix offset
 
@@ -1010,7 +1182,7 @@ bool CXMeshFileLoader::parseDataObjectSkinWeights(SXMesh &mesh)
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectSkinMeshHeader(SXMesh &mesh)
+bool CXReader::parseDataObjectSkinMeshHeader(SXMesh &mesh)
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: Reading skin mesh header", ELL_DEBUG);
@@ -1038,7 +1210,7 @@ bool CXMeshFileLoader::parseDataObjectSkinMeshHeader(SXMesh &mesh)
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectMeshNormals(SXMesh &mesh)
+bool CXReader::parseDataObjectMeshNormals(SXMesh &mesh)
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: reading mesh normals", ELL_DEBUG);
@@ -1056,8 +1228,8 @@ bool CXMeshFileLoader::parseDataObjectMeshNormals(SXMesh &mesh)
 	normals.set_used(nNormals);
 
 	// read normals
-	for (u32 i = 0; i < nNormals; ++i)
-		readVector3(normals[i]);
+	if (nNormals)
+		readFloats(&normals[0].X, nNormals * 3);
 
 	if (!checkForTwoFollowingSemicolons()) {
 		g_irrlogger->log("No finishing semicolon in Mesh Normals Array found in x file", ELL_WARNING);
@@ -1098,8 +1270,7 @@ bool CXMeshFileLoader::parseDataObjectMeshNormals(SXMesh &mesh)
 		} else {
 			polygonfaces.set_used(fcnt);
 			// multiple triangles in this face
-			for (u32 h = 0; h < fcnt; ++h)
-				polygonfaces[h] = readInt();
+			readInts(polygonfaces.pointer(), fcnt);
 
 			for (u32 jk = 0; jk < triangles; ++jk) {
 				mesh.Vertices[mesh.Indices[normalidx++]].Normal.set(normals[polygonfaces[0]]);
@@ -1123,7 +1294,7 @@ bool CXMeshFileLoader::parseDataObjectMeshNormals(SXMesh &mesh)
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectMeshTextureCoords(SXMesh &mesh)
+bool CXReader::parseDataObjectMeshTextureCoords(SXMesh &mesh)
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: reading mesh texture coordinates", ELL_DEBUG);
@@ -1160,7 +1331,7 @@ bool CXMeshFileLoader::parseDataObjectMeshTextureCoords(SXMesh &mesh)
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectMeshVertexColors(SXMesh &mesh)
+bool CXReader::parseDataObjectMeshVertexColors(SXMesh &mesh)
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: reading mesh vertex colors", ELL_DEBUG);
@@ -1199,7 +1370,7 @@ bool CXMeshFileLoader::parseDataObjectMeshVertexColors(SXMesh &mesh)
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectMeshMaterialList(SXMesh &mesh)
+bool CXReader::parseDataObjectMeshMaterialList(SXMesh &mesh)
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: Reading mesh material list", ELL_DEBUG);
@@ -1251,7 +1422,7 @@ bool CXMeshFileLoader::parseDataObjectMeshMaterialList(SXMesh &mesh)
 	// read following data objects
 
 	while (true) {
-		core::stringc objectName = getNextToken();
+		std::string_view objectName = getNextToken();
 
 		if (objectName.size() == 0) {
 			g_irrlogger->log("Unexpected ending found in Mesh Material list in .x file.", ELL_WARNING);
@@ -1271,7 +1442,7 @@ bool CXMeshFileLoader::parseDataObjectMeshMaterialList(SXMesh &mesh)
 		} else if (objectName == ";") {
 			// ignore
 		} else {
-			g_irrlogger->log("Unknown data object in material list in x file", objectName.c_str(), ELL_WARNING);
+			g_irrlogger->log("Unknown data object in material list in x file", tokenString(objectName).c_str(), ELL_WARNING);
 			if (!parseUnknownDataObject())
 				return false;
 		}
@@ -1279,7 +1450,7 @@ bool CXMeshFileLoader::parseDataObjectMeshMaterialList(SXMesh &mesh)
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectAnimationSet()
+bool CXReader::parseDataObjectAnimationSet()
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: Reading animation set", ELL_DEBUG);
@@ -1295,7 +1466,7 @@ bool CXMeshFileLoader::parseDataObjectAnimationSet()
 	g_irrlogger->log("Reading animationset ", AnimationName, ELL_DEBUG);
 
 	while (true) {
-		core::stringc objectName = getNextToken();
+		std::string_view objectName = getNextToken();
 
 		if (objectName.size() == 0) {
 			g_irrlogger->log("Unexpected ending found in Animation set in x file.", ELL_WARNING);
@@ -1307,7 +1478,7 @@ bool CXMeshFileLoader::parseDataObjectAnimationSet()
 			if (!parseDataObjectAnimation())
 				return false;
 		} else {
-			g_irrlogger->log("Unknown data object in animation set in x file", objectName.c_str(), ELL_WARNING);
+			g_irrlogger->log("Unknown data object in animation set in x file", tokenString(objectName).c_str(), ELL_WARNING);
 			if (!parseUnknownDataObject())
 				return false;
 		}
@@ -1315,7 +1486,7 @@ bool CXMeshFileLoader::parseDataObjectAnimationSet()
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectAnimationTicksPerSecond()
+bool CXReader::parseDataObjectAnimationTicksPerSecond()
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: reading AnimationTicksPerSecond", ELL_DEBUG);
@@ -1346,7 +1517,7 @@ bool CXMeshFileLoader::parseDataObjectAnimationTicksPerSecond()
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectAnimation()
+bool CXReader::parseDataObjectAnimation()
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: reading animation", ELL_DEBUG);
@@ -1365,7 +1536,7 @@ bool CXMeshFileLoader::parseDataObjectAnimation()
 	core::stringc FrameName;
 
 	while (true) {
-		core::stringc objectName = getNextToken();
+		std::string_view objectName = getNextToken();
 
 		if (objectName.size() == 0) {
 			g_irrlogger->log("Unexpected ending found in Animation in x file.", ELL_WARNING);
@@ -1382,7 +1553,7 @@ bool CXMeshFileLoader::parseDataObjectAnimation()
 				return false;
 		} else if (objectName == "{") {
 			// read frame name
-			FrameName = getNextToken();
+			FrameName = tokenString(getNextToken());
 
 			if (!checkForClosingBrace()) {
 				g_irrlogger->log("Unexpected ending found in Animation in x file.", ELL_WARNING);
@@ -1390,7 +1561,7 @@ bool CXMeshFileLoader::parseDataObjectAnimation()
 				SET_ERR_AND_RETURN();
 			}
 		} else {
-			g_irrlogger->log("Unknown data object in animation in x file", objectName.c_str(), ELL_WARNING);
+			g_irrlogger->log("Unknown data object in animation in x file", tokenString(objectName).c_str(), ELL_WARNING);
 			if (!parseUnknownDataObject())
 				SET_ERR_AND_RETURN();
 		}
@@ -1420,7 +1591,7 @@ bool CXMeshFileLoader::parseDataObjectAnimation()
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectAnimationKey(SkinnedMesh::SJoint *joint)
+bool CXReader::parseDataObjectAnimationKey(SkinnedMesh::SJoint *joint)
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: reading animation key", ELL_DEBUG);
@@ -1561,7 +1732,7 @@ bool CXMeshFileLoader::parseDataObjectAnimationKey(SkinnedMesh::SJoint *joint)
 	return true;
 }
 
-bool CXMeshFileLoader::parseDataObjectTextureFilename(core::stringc &texturename)
+bool CXReader::parseDataObjectTextureFilename(core::stringc &texturename)
 {
 #ifdef _XREADER_DEBUG
 	g_irrlogger->log("CXFileReader: reading texture filename", ELL_DEBUG);
@@ -1588,11 +1759,11 @@ bool CXMeshFileLoader::parseDataObjectTextureFilename(core::stringc &texturename
 	return true;
 }
 
-bool CXMeshFileLoader::parseUnknownDataObject()
+bool CXReader::parseUnknownDataObject()
 {
 	// find opening delimiter
 	while (true) {
-		core::stringc t = getNextToken();
+		std::string_view t = getNextToken();
 
 		if (t.size() == 0)
 			return false;
@@ -1606,7 +1777,7 @@ bool CXMeshFileLoader::parseUnknownDataObject()
 	// parse until closing delimiter
 
 	while (counter) {
-		core::stringc t = getNextToken();
+		std::string_view t = getNextToken();
 
 		if (t.size() == 0)
 			return false;
@@ -1621,13 +1792,13 @@ bool CXMeshFileLoader::parseUnknownDataObject()
 }
 
 //! checks for closing curly brace, returns false if not there
-bool CXMeshFileLoader::checkForClosingBrace()
+bool CXReader::checkForClosingBrace()
 {
 	return (getNextToken() == "}");
 }
 
 //! checks for one following semicolon, returns false if not there
-bool CXMeshFileLoader::checkForOneFollowingSemicolons()
+bool CXReader::checkForOneFollowingSemicolons()
 {
 	if (BinaryFormat)
 		return true;
@@ -1641,7 +1812,7 @@ bool CXMeshFileLoader::checkForOneFollowingSemicolons()
 }
 
 //! checks for two following semicolons, returns false if they are not there
-bool CXMeshFileLoader::checkForTwoFollowingSemicolons()
+bool CXReader::checkForTwoFollowingSemicolons()
 {
 	if (BinaryFormat)
 		return true;
@@ -1659,12 +1830,12 @@ bool CXMeshFileLoader::checkForTwoFollowingSemicolons()
 //! reads header of dataobject including the opening brace.
 //! returns false if error happened, and writes name of object
 //! if there is one
-bool CXMeshFileLoader::readHeadOfDataObject(core::stringc *outname)
+bool CXReader::readHeadOfDataObject(core::stringc *outname)
 {
-	core::stringc nameOrBrace = getNextToken();
+	const std::string_view nameOrBrace = getNextToken();
 	if (nameOrBrace != "{") {
 		if (outname)
-			(*outname) = nameOrBrace;
+			(*outname) = tokenString(nameOrBrace);
 
 		if (getNextToken() != "{")
 			return false;
@@ -1674,9 +1845,8 @@ bool CXMeshFileLoader::readHeadOfDataObject(core::stringc *outname)
 }
 
 //! returns next parseable token. Returns empty string if no token there
-core::stringc CXMeshFileLoader::getNextToken()
+std::string_view CXReader::getNextToken()
 {
-	core::stringc s;
 
 	// process binary-formatted file
 	if (BinaryFormat) {
@@ -1685,19 +1855,20 @@ core::stringc CXMeshFileLoader::getNextToken()
 
 		s16 tok = readBinWord();
 		u32 len;
+		std::string_view s;
 
 		// standalone tokens
 		switch (tok) {
 		case 1:
 			// name token
-			len = readBinDWord();
-			s = core::stringc(P, len);
+			len = core::min_(readBinDWord(), (u32)(End - P));
+			s = std::string_view(P, len);
 			P += len;
 			return s;
 		case 2:
 			// string token
-			len = readBinDWord();
-			s = core::stringc(P, len);
+			len = core::min_(readBinDWord(), (u32)(End - P));
+			s = std::string_view(P, len);
 			P += (len + 2);
 			return s;
 		case 3:
@@ -1772,28 +1943,24 @@ core::stringc CXMeshFileLoader::getNextToken()
 	else {
 		findNextNoneWhiteSpace();
 
-		if (P >= End)
-			return s;
-
+		const c8 *begin = P;
 		while ((P < End) && !core::isspace(P[0])) {
 			// either keep token delimiters when already holding a token, or return if first valid char
 			if (P[0] == ';' || P[0] == '}' || P[0] == '{' || P[0] == ',') {
-				if (!s.size()) {
-					s.append(P[0]);
+				if (P == begin)
 					++P;
-				}
 				break; // stop for delimiter
 			}
-			s.append(P[0]);
 			++P;
 		}
+		return std::string_view(begin, P - begin);
 	}
-	return s;
+	return std::string_view();
 }
 
 //! places pointer to next begin of a token, which must be a number,
 // and ignores comments
-void CXMeshFileLoader::findNextNoneWhiteSpaceNumber()
+void CXReader::findNextNoneWhiteSpaceNumber()
 {
 	if (BinaryFormat)
 		return;
@@ -1809,7 +1976,7 @@ void CXMeshFileLoader::findNextNoneWhiteSpaceNumber()
 }
 
 // places pointer to next begin of a token, and ignores comments
-void CXMeshFileLoader::findNextNoneWhiteSpace()
+void CXReader::findNextNoneWhiteSpace()
 {
 	if (BinaryFormat)
 		return;
@@ -1834,10 +2001,10 @@ void CXMeshFileLoader::findNextNoneWhiteSpace()
 }
 
 //! reads a x file style string
-bool CXMeshFileLoader::getNextTokenAsString(core::stringc &out)
+bool CXReader::getNextTokenAsString(core::stringc &out)
 {
 	if (BinaryFormat) {
-		out = getNextToken();
+		out = tokenString(getNextToken());
 		return true;
 	}
 	findNextNoneWhiteSpace();
@@ -1849,10 +2016,10 @@ bool CXMeshFileLoader::getNextTokenAsString(core::stringc &out)
 		return false;
 	++P;
 
-	while (P < End && P[0] != '"') {
-		out.append(P[0]);
+	const c8 *begin = P;
+	while (P < End && P[0] != '"')
 		++P;
-	}
+	out.append(core::stringc(begin, (u32)(P - begin)));
 
 	if (P[1] != ';' || P[0] != '"')
 		return false;
@@ -1861,7 +2028,7 @@ bool CXMeshFileLoader::getNextTokenAsString(core::stringc &out)
 	return true;
 }
 
-void CXMeshFileLoader::readUntilEndOfLine()
+void CXReader::readUntilEndOfLine()
 {
 	if (BinaryFormat)
 		return;
@@ -1877,7 +2044,7 @@ void CXMeshFileLoader::readUntilEndOfLine()
 	}
 }
 
-u16 CXMeshFileLoader::readBinWord()
+u16 CXReader::readBinWord()
 {
 	if (P >= End)
 		return 0;
@@ -1890,7 +2057,7 @@ u16 CXMeshFileLoader::readBinWord()
 	return tmp;
 }
 
-u32 CXMeshFileLoader::readBinDWord()
+u32 CXReader::readBinDWord()
 {
 	if (P >= End)
 		return 0;
@@ -1903,7 +2070,7 @@ u32 CXMeshFileLoader::readBinDWord()
 	return tmp;
 }
 
-u32 CXMeshFileLoader::readInt()
+u32 CXReader::readInt()
 {
 	if (BinaryFormat) {
 		if (!BinaryNumCount) {
@@ -1921,7 +2088,7 @@ u32 CXMeshFileLoader::readInt()
 	}
 }
 
-f32 CXMeshFileLoader::readFloat()
+f32 CXReader::readFloat()
 {
 	if (BinaryFormat) {
 		if (!BinaryNumCount) {
@@ -1960,25 +2127,88 @@ f32 CXMeshFileLoader::readFloat()
 	return ftmp;
 }
 
+//! reads count numbers, in binary files as one copy per number list
+void CXReader::readInts(u32 *out, u32 count)
+{
+#ifndef __BIG_ENDIAN__
+	if (BinaryFormat) {
+		while (count) {
+			if (!BinaryNumCount) {
+				const u16 tmp = readBinWord(); // 0x06 or 0x03
+				if (tmp == 0x06)
+					BinaryNumCount = readBinDWord();
+				else
+					BinaryNumCount = 1; // single int
+			}
+			const u32 n = core::min_(core::min_(count, BinaryNumCount),
+					P < End ? (u32)((End - P) / sizeof(u32)) : 0u);
+			if (!n)
+				break;
+			memcpy(out, P, n * sizeof(u32));
+			P += n * sizeof(u32);
+			out += n;
+			count -= n;
+			BinaryNumCount -= n;
+		}
+		// truncated file
+		for (u32 i = 0; i < count; ++i)
+			out[i] = 0;
+		return;
+	}
+#endif
+	for (u32 i = 0; i < count; ++i)
+		out[i] = readInt();
+}
+
+//! reads count numbers, in binary files as one copy per number list
+void CXReader::readFloats(f32 *out, u32 count)
+{
+#ifndef __BIG_ENDIAN__
+	if (BinaryFormat && FloatSize == 4) {
+		while (count) {
+			if (!BinaryNumCount) {
+				const u16 tmp = readBinWord(); // 0x07 or 0x42
+				if (tmp == 0x07)
+					BinaryNumCount = readBinDWord();
+				else
+					BinaryNumCount = 1; // single float
+			}
+			const u32 n = core::min_(core::min_(count, BinaryNumCount),
+					P < End ? (u32)((End - P) / sizeof(f32)) : 0u);
+			if (!n)
+				break;
+			memcpy(out, P, n * sizeof(f32));
+			P += n * sizeof(f32);
+			out += n;
+			count -= n;
+			BinaryNumCount -= n;
+		}
+		// truncated file
+		for (u32 i = 0; i < count; ++i)
+			out[i] = 0.f;
+		return;
+	}
+#endif
+	for (u32 i = 0; i < count; ++i)
+		out[i] = readFloat();
+}
+
 // read 2-dimensional vector. Stops at semicolon after second value for text file format
-bool CXMeshFileLoader::readVector2(core::vector2df &vec)
+bool CXReader::readVector2(core::vector2df &vec)
 {
-	vec.X = readFloat();
-	vec.Y = readFloat();
+	readFloats(&vec.X, 2);
 	return true;
 }
 
 // read 3-dimensional vector. Stops at semicolon after third value for text file format
-bool CXMeshFileLoader::readVector3(core::vector3df &vec)
+bool CXReader::readVector3(core::vector3df &vec)
 {
-	vec.X = readFloat();
-	vec.Y = readFloat();
-	vec.Z = readFloat();
+	readFloats(&vec.X, 3);
 	return true;
 }
 
 // read color without alpha value. Stops after second semicolon after blue value
-bool CXMeshFileLoader::readRGB(video::SColor &color)
+bool CXReader::readRGB(video::SColor &color)
 {
 	video::SColorf tmpColor;
 	tmpColor.r = readFloat();
@@ -1989,7 +2219,7 @@ bool CXMeshFileLoader::readRGB(video::SColor &color)
 }
 
 // read color with alpha value. Stops after second semicolon after blue value
-bool CXMeshFileLoader::readRGBA(video::SColor &color)
+bool CXReader::readRGBA(video::SColor &color)
 {
 	video::SColorf tmpColor;
 	tmpColor.r = readFloat();
@@ -2001,10 +2231,9 @@ bool CXMeshFileLoader::readRGBA(video::SColor &color)
 }
 
 // read matrix from list of floats
-bool CXMeshFileLoader::readMatrix(core::matrix4 &mat)
+bool CXReader::readMatrix(core::matrix4 &mat)
 {
-	for (u32 i = 0; i < 16; ++i)
-		mat[i] = readFloat();
+	readFloats(mat.pointer(), 16);
 	return checkForOneFollowingSemicolons();
 }
 
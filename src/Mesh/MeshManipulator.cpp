@@ -9,12 +9,23 @@
 #include "Mesh/SAnimatedMesh.h"
 #include "Device/Logger.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <vector>
 
 
 namespace scene
 {
 
+//! Returns true if the triangles of a buffer are blended in the order they are drawn
+/** The same test as VideoDriver::needsTransparentRenderPass(). */
+static inline bool isBlended(const IMeshBuffer *buffer)
+{
+	const video::SMaterial &material = buffer->getMaterial();
+	return material.isTransparent() || material.isAlphaBlendOperation();
+}
+
 static inline core::vector3df getAngleWeight(const core::vector3df &v1,
 		const core::vector3df &v2,
 		const core::vector3df &v3)
@@ -202,6 +213,1060 @@ s32 MeshManipulator::getPolyCount(scene::IAnimatedMesh *mesh) const
 	return 0;
 }
 
+namespace
+{
+//! Marks vertices without a new index
+const u32 NO_VERTEX = 0xFFFFFFFF;
+
+//! All indices of a mesh buffer, empty if any is out of range
+std::vector<u32> getIndices(const IMeshBuffer *buffer)
+{
+	const IIndexBuffer *indexBuffer = buffer->getIndexBuffer();
+	const u32 count = indexBuffer->getCount();
+
+	std::vector<u32> indices(count);
+	if (indexBuffer->getType() == video::EIT_16BIT) {
+		const u16 *data = static_cast<const u16 *>(indexBuffer->getData());
+		std::copy(data, data + count, indices.begin());
+	} else {
+		const u32 *data = static_cast<const u32 *>(indexBuffer->getData());
+		std::copy(data, data + count, indices.begin());
+	}
+
+	const u32 vertexCount = buffer->getVertexCount();
+	for (u32 index : indices) {
+		if (index >= vertexCount) {
+			g_irrlogger->log("Mesh buffer has indices out of range, not optimizing it", ELL_WARNING);
+			return {};
+		}
+	}
+	return indices;
+}
+
+//! Indices of the complete triangles of a mesh buffer, empty for other primitives
+std::vector<u32> getTriangleIndices(const IMeshBuffer *buffer)
+{
+	if (!buffer || buffer->getPrimitiveType() != EPT_TRIANGLES)
+		return {};
+
+	std::vector<u32> indices = getIndices(buffer);
+	indices.resize(indices.size() / 3 * 3);
+	return indices;
+}
+
+//! Overwrites the first indices of a mesh buffer
+void setIndices(IMeshBuffer *buffer, const std::vector<u32> &indices)
+{
+	IIndexBuffer *indexBuffer = buffer->getIndexBuffer();
+	if (indexBuffer->getType() == video::EIT_16BIT) {
+		u16 *data = static_cast<u16 *>(indexBuffer->getData());
+		for (size_t i = 0; i < indices.size(); ++i)
+			data[i] = (u16)indices[i];
+	} else {
+		std::copy(indices.begin(), indices.end(), static_cast<u32 *>(indexBuffer->getData()));
+	}
+	buffer->setDirty(EBF_INDEX);
+}
+
+//! FIFO vertex cache, a vertex is cached while less than Size misses followed it
+class CVertexCache
+{
+public:
+	CVertexCache(u32 vertexCount, u32 size) :
+			Stamps(vertexCount, 0), Size(size), Time(size + 1) {}
+
+	//! Returns true if the vertex had to be transformed
+	bool touch(u32 vertex)
+	{
+		if (Time - Stamps[vertex] <= Size)
+			return false;
+		Stamps[vertex] = Time++;
+		return true;
+	}
+
+	//! Returns the amount of vertices of a triangle which had to be transformed
+	u32 touchTriangle(const u32 *triangle)
+	{
+		return touch(triangle[0]) + touch(triangle[1]) + touch(triangle[2]);
+	}
+
+	//! Empties the cache
+	void flush()
+	{
+		Time += Size + 1;
+	}
+
+private:
+	std::vector<u32> Stamps;
+	u32 Size;
+	u32 Time;
+};
+
+//! Reorders triangles with Tipsify
+/** See Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex
+Locality and Reduced Overdraw", 2007. */
+std::vector<u32> tipsify(const std::vector<u32> &indices, u32 vertexCount, u32 cacheSize)
+{
+	const u32 triangleCount = indices.size() / 3;
+
+	// triangles using each vertex
+	std::vector<u32> offsets(vertexCount + 1, 0);
+	for (u32 index : indices)
+		++offsets[index + 1];
+	for (u32 i = 0; i < vertexCount; ++i)
+		offsets[i + 1] += offsets[i];
+
+	std::vector<u32> adjacency(indices.size());
+	std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+	for (u32 i = 0; i < indices.size(); ++i)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	// triangles left to emit for each vertex
+	std::vector<u32> live(vertexCount);
+	for (u32 i = 0; i < vertexCount; ++i)
+		live[i] = offsets[i + 1] - offsets[i];
+
+	std::vector<u32> stamps(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<u32> deadEnds;
+	std::vector<u32> candidates;
+	std::vector<u32> result;
+	result.reserve(indices.size());
+
+	u32 time = cacheSize + 1;
+	u32 cursor = 0;
+
+	// continues with recently used vertices when the fan has no good successor
+	const auto skipDeadEnd = [&]() -> u32 {
+		while (!deadEnds.empty()) {
+			const u32 vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[vertex])
+				return vertex;
+		}
+		for (; cursor < vertexCount; ++cursor) {
+			if (live[cursor])
+				return cursor;
+		}
+		return NO_VERTEX;
+	};
+
+	u32 fan = skipDeadEnd();
+	while (fan != NO_VERTEX) {
+		candidates.clear();
+
+		for (u32 a = offsets[fan]; a < offsets[fan + 1]; ++a) {
+			const u32 triangle = adjacency[a];
+			if (emitted[triangle])
+				continue;
+			emitted[triangle] = true;
+
+			for (u32 k = 0; k < 3; ++k) {
+				const u32 vertex = indices[triangle * 3 + k];
+				result.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				--live[vertex];
+				if (time - stamps[vertex] > cacheSize)
+					stamps[vertex] = time++;
+			}
+		}
+
+		// prefer the vertex which stays in the cache longest while fanning around it
+		u32 next = NO_VERTEX;
+		s64 bestPriority = -1;
+		for (u32 vertex : candidates) {
+			if (!live[vertex])
+				continue;
+
+			s64 priority = 0;
+			if (time - stamps[vertex] + 2 * live[vertex] <= cacheSize)
+				priority = time - stamps[vertex];
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+
+		fan = next != NO_VERTEX ? next : skipDeadEnd();
+	}
+
+	return result;
+}
+}
+
+//! Simulates the vertex cache for the triangles of a mesh buffer.
+MeshManipulator::SVertexCacheStats MeshManipulator::getVertexCacheStats(const IMeshBuffer *buffer, u32 cacheSize) const
+{
+	SVertexCacheStats stats;
+
+	const std::vector<u32> indices = getTriangleIndices(buffer);
+	if (indices.empty())
+		return stats;
+
+	const u32 vertexCount = buffer->getVertexCount();
+	CVertexCache cache(vertexCount, core::max_<u32>(cacheSize, 3));
+	std::vector<bool> used(vertexCount, false);
+
+	for (u32 index : indices) {
+		stats.Transformed += cache.touch(index);
+		if (!used[index]) {
+			used[index] = true;
+			++stats.Vertices;
+		}
+	}
+
+	stats.Triangles = indices.size() / 3;
+	stats.ACMR = (f32)stats.Transformed / stats.Triangles;
+	stats.ATVR = (f32)stats.Transformed / stats.Vertices;
+	return stats;
+}
+
+//! Simulates the vertex cache for all mesh buffers of a mesh.
+MeshManipulator::SVertexCacheStats MeshManipulator::getVertexCacheStats(IMesh *mesh, u32 cacheSize) const
+{
+	SVertexCacheStats stats;
+	if (!mesh)
+		return stats;
+
+	for (u32 b = 0; b < mesh->getMeshBufferCount(); ++b) {
+		const SVertexCacheStats bufferStats = getVertexCacheStats(mesh->getMeshBuffer(b), cacheSize);
+		stats.Transformed += bufferStats.Transformed;
+		stats.Vertices += bufferStats.Vertices;
+		stats.Triangles += bufferStats.Triangles;
+	}
+
+	if (stats.Triangles) {
+		stats.ACMR = (f32)stats.Transformed / stats.Triangles;
+		stats.ATVR = (f32)stats.Transformed / stats.Vertices;
+	}
+	return stats;
+}
+
+//! Reorders the triangles of a mesh buffer for the vertex cache.
+void MeshManipulator::optimizeVertexCache(IMeshBuffer *buffer, u32 cacheSize) const
+{
+	const std::vector<u32> indices = getTriangleIndices(buffer);
+	if (indices.size() < 6)
+		return;
+
+	setIndices(buffer, tipsify(indices, buffer->getVertexCount(), core::max_<u32>(cacheSize, 3)));
+}
+
+//! Reorders clusters of triangles to reduce overdraw.
+void MeshManipulator::optimizeOverdraw(IMeshBuffer *buffer, f32 threshold, u32 cacheSize) const
+{
+	// drawing blended triangles in another order changes the result
+	if (isBlended(buffer))
+		return;
+
+	const std::vector<u32> indices = getTriangleIndices(buffer);
+	if (indices.size() < 6)
+		return;
+
+	const u32 vertexCount = buffer->getVertexCount();
+	const u32 triangleCount = indices.size() / 3;
+	cacheSize = core::max_<u32>(cacheSize, 3);
+
+	// the cache is cold at triangles missing all their vertices, the order
+	// around them doesn't matter for the cache
+	std::vector<u32> misses(triangleCount);
+	std::vector<u32> hardClusters;
+	u32 transformed = 0;
+	{
+		CVertexCache cache(vertexCount, cacheSize);
+		for (u32 t = 0; t < triangleCount; ++t) {
+			misses[t] = cache.touchTriangle(&indices[t * 3]);
+			transformed += misses[t];
+			if (t == 0 || misses[t] == 3)
+				hardClusters.push_back(t);
+		}
+	}
+	hardClusters.push_back(triangleCount);
+
+	// clusters also end as soon as their own ACMR is good enough, they
+	// start with an empty cache as they may be drawn in any order
+	const f32 maxACMR = threshold * transformed / triangleCount;
+	std::vector<u32> clusters;
+	CVertexCache cache(vertexCount, cacheSize);
+	for (u32 c = 0; c + 1 < hardClusters.size(); ++c) {
+		const u32 end = hardClusters[c + 1];
+		u32 start = hardClusters[c];
+		u32 clusterMisses = 0;
+
+		clusters.push_back(start);
+		cache.flush();
+		for (u32 t = start; t < end; ++t) {
+			clusterMisses += cache.touchTriangle(&indices[t * 3]);
+			if (t + 1 < end && clusterMisses <= maxACMR * (t + 1 - start)) {
+				start = t + 1;
+				clusterMisses = 0;
+				clusters.push_back(start);
+				cache.flush();
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	// area weighted centroids and normals
+	const u32 clusterCount = clusters.size() - 1;
+	std::vector<core::vector3df> centroids(clusterCount);
+	std::vector<core::vector3df> normals(clusterCount);
+	core::vector3df meshCentroid;
+	f32 meshArea = 0.f;
+
+	for (u32 c = 0; c < clusterCount; ++c) {
+		f32 clusterArea = 0.f;
+		for (u32 t = clusters[c]; t < clusters[c + 1]; ++t) {
+			const core::vector3df &v1 = buffer->getPosition(indices[t * 3 + 0]);
+			const core::vector3df &v2 = buffer->getPosition(indices[t * 3 + 1]);
+			const core::vector3df &v3 = buffer->getPosition(indices[t * 3 + 2]);
+			const core::vector3df normal = (v2 - v1).crossProduct(v3 - v1);
+			const f32 area = normal.getLength();
+
+			centroids[c] += (v1 + v2 + v3) * area;
+			normals[c] += normal;
+			clusterArea += area;
+		}
+
+		meshCentroid += centroids[c];
+		meshArea += clusterArea;
+		if (clusterArea > 0.f)
+			centroids[c] /= clusterArea * 3.f;
+		normals[c].normalize();
+	}
+	if (meshArea > 0.f)
+		meshCentroid /= meshArea * 3.f;
+
+	// clusters facing away from the center occlude the others, draw them first
+	std::vector<f32> keys(clusterCount);
+	std::vector<u32> order(clusterCount);
+	for (u32 c = 0; c < clusterCount; ++c) {
+		keys[c] = (centroids[c] - meshCentroid).dotProduct(normals[c]);
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&keys](u32 a, u32 b) {
+		return keys[a] > keys[b];
+	});
+
+	std::vector<u32> result;
+	result.reserve(indices.size());
+	for (u32 c : order)
+		result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+
+	setIndices(buffer, result);
+}
+
+//! Reorders the vertices in the order the indices use them.
+void MeshManipulator::optimizeVertexFetch(IMeshBuffer *buffer) const
+{
+	if (!buffer)
+		return;
+
+	std::vector<u32> indices = getIndices(buffer);
+	if (indices.empty())
+		return;
+
+	const u32 vertexCount = buffer->getVertexCount();
+	std::vector<u32> remap(vertexCount, NO_VERTEX);
+	u32 next = 0;
+	for (u32 index : indices) {
+		if (remap[index] == NO_VERTEX)
+			remap[index] = next++;
+	}
+	for (u32 &index : remap) {
+		if (index == NO_VERTEX)
+			index = next++;
+	}
+
+	bool changed = false;
+	for (u32 i = 0; i < vertexCount && !changed; ++i)
+		changed = remap[i] != i;
+	if (!changed)
+		return;
+
+	const u32 vertexSize = getVertexTypeSize(buffer->getVertexType());
+	u8 *data = static_cast<u8 *>(buffer->getVertices());
+	const std::vector<u8> source(data, data + (size_t)vertexCount * vertexSize);
+	for (u32 i = 0; i < vertexCount; ++i)
+		memcpy(data + (size_t)remap[i] * vertexSize, source.data() + (size_t)i * vertexSize, vertexSize);
+
+	for (u32 &index : indices)
+		index = remap[index];
+
+	setIndices(buffer, indices);
+	buffer->setDirty(EBF_VERTEX);
+}
+
+//! Optimizes all mesh buffers of a mesh for rendering.
+void MeshManipulator::optimizeForGPU(IMesh *mesh, u32 cacheSize, f32 overdrawThreshold) const
+{
+	if (!mesh)
+		return;
+
+	const SVertexCacheStats before = getVertexCacheStats(mesh, cacheSize);
+
+	// the joints of skinned meshes refer to the vertices by their index
+	const bool reorderVertices = mesh->getMeshType() != EAMT_SKINNED;
+
+	for (u32 b = 0; b < mesh->getMeshBufferCount(); ++b) {
+		IMeshBuffer *buffer = mesh->getMeshBuffer(b);
+		if (!isBlended(buffer)) {
+			optimizeVertexCache(buffer, cacheSize);
+			optimizeOverdraw(buffer, overdrawThreshold, cacheSize);
+		}
+		if (reorderVertices)
+			optimizeVertexFetch(buffer);
+	}
+
+	const SVertexCacheStats after = getVertexCacheStats(mesh, cacheSize);
+
+	c8 text[128];
+	snprintf(text, sizeof(text), "Optimized mesh for the vertex cache, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+			before.ACMR, after.ACMR, before.ATVR, after.ATVR);
+	g_irrlogger->log(text, ELL_DEBUG);
+}
+
+//! Uploads the vertices of a mesh buffer in their quantized format.
+bool MeshManipulator::quantize(IMeshBuffer *buffer, bool quantized) const
+{
+	if (!buffer)
+		return false;
+
+	// only the built-in 3D materials have shaders decoding the quantized vertices
+	if (quantized && buffer->getMaterial().MaterialType > video::EMT_ONETEXTURE_BLEND)
+		return false;
+
+	return buffer->setQuantized(quantized);
+}
+
+//! Uploads the vertices of all mesh buffers of a mesh in their quantized format.
+u32 MeshManipulator::quantize(IMesh *mesh, bool quantized) const
+{
+	if (!mesh)
+		return 0;
+
+	u32 converted = 0;
+	for (u32 b = 0; b < mesh->getMeshBufferCount(); ++b)
+		converted += quantize(mesh->getMeshBuffer(b), quantized);
+	return converted;
+}
+
+namespace
+{
+//! Sum of the squared distances to a set of weighted planes
+struct SQuadric
+{
+	f64 A00 = 0, A01 = 0, A02 = 0, A11 = 0, A12 = 0, A22 = 0;
+	f64 B0 = 0, B1 = 0, B2 = 0;
+	f64 C = 0;
+
+	//! Sum of the weights of the planes
+	f64 Weight = 0;
+
+	//! Adds the plane of the points p with normal * p + d = 0
+	void addPlane(const core::vector3df &normal, f32 d, f64 weight)
+	{
+		const f64 a = normal.X, b = normal.Y, c = normal.Z;
+		A00 += weight * a * a;
+		A01 += weight * a * b;
+		A02 += weight * a * c;
+		A11 += weight * b * b;
+		A12 += weight * b * c;
+		A22 += weight * c * c;
+		B0 += weight * a * d;
+		B1 += weight * b * d;
+		B2 += weight * c * d;
+		C += weight * d * d;
+		Weight += weight;
+	}
+
+	void add(const SQuadric &other)
+	{
+		A00 += other.A00;
+		A01 += other.A01;
+		A02 += other.A02;
+		A11 += other.A11;
+		A12 += other.A12;
+		A22 += other.A22;
+		B0 += other.B0;
+		B1 += other.B1;
+		B2 += other.B2;
+		C += other.C;
+		Weight += other.Weight;
+	}
+
+	//! Weighted mean of the squared distances of a point to the planes
+	f64 getError(const core::vector3df &p) const
+	{
+		if (Weight <= 0)
+			return 0;
+
+		const f64 x = p.X, y = p.Y, z = p.Z;
+		const f64 error = A00 * x * x + A11 * y * y + A22 * z * z +
+				2 * (A01 * x * y + A02 * x * z + A12 * y * z) +
+				2 * (B0 * x + B1 * y + B2 * z) + C;
+		return core::max_(error, 0.0) / Weight;
+	}
+};
+
+//! Triangles using each vertex, as rows of a compressed table
+struct SVertexTriangles
+{
+	std::vector<u32> Offsets;
+	std::vector<u32> Triangles;
+
+	void build(const std::vector<u32> &indices, u32 vertexCount)
+	{
+		Offsets.assign(vertexCount + 1, 0);
+		for (u32 index : indices)
+			++Offsets[index + 1];
+		for (u32 i = 0; i < vertexCount; ++i)
+			Offsets[i + 1] += Offsets[i];
+
+		Triangles.resize(indices.size());
+		std::vector<u32> fill(Offsets.begin(), Offsets.end() - 1);
+		for (u32 i = 0; i < indices.size(); ++i)
+			Triangles[fill[indices[i]]++] = i / 3;
+	}
+};
+
+//! Edge collapse simplification with quadric error metrics
+/** See Garland and Heckbert, "Surface Simplification Using Quadric Error
+Metrics", 1997. Only half edge collapses are done, vertices move onto one
+of their neighbours, so no new vertices with interpolated attributes are
+needed. */
+class CSimplifier
+{
+public:
+	CSimplifier(const IMeshBuffer *buffer, std::vector<u32> &&indices) :
+			Buffer(buffer), Indices(std::move(indices)),
+			VertexCount(buffer->getVertexCount())
+	{
+		lockVertices();
+		computeQuadrics();
+	}
+
+	//! Collapses edges until at most the given amount of triangles is left
+	/** \return Largest distance of a moved vertex to the original surface. */
+	f32 simplify(u32 targetTriangles);
+
+	const std::vector<u32> &getIndices() const { return Indices; }
+
+private:
+	struct SCollapse
+	{
+		u32 Vertex;
+		u32 Target;
+		f64 Cost;
+	};
+
+	//! Locks the vertices on borders and seams
+	void lockVertices();
+
+	void computeQuadrics();
+
+	//! Returns the cost of moving a vertex onto another
+	f64 getCost(u32 vertex, u32 target) const;
+
+	//! Returns true if moving a vertex onto another flips any of its triangles
+	bool flips(u32 vertex, u32 target) const;
+
+	const IMeshBuffer *Buffer;
+	std::vector<u32> Indices;
+	u32 VertexCount;
+
+	std::vector<bool> Locked;
+	std::vector<SQuadric> Quadrics;
+	SVertexTriangles Adjacency;
+
+	//! Cost of differences in normals and texture coordinates, in squared distance units
+	f64 AttributeWeight = 0;
+};
+
+void CSimplifier::lockVertices()
+{
+	Locked.assign(VertexCount, false);
+
+	// vertices of the same position, which have to stay together
+	std::vector<u32> order(VertexCount);
+	for (u32 i = 0; i < VertexCount; ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [this](u32 a, u32 b) {
+		const core::vector3df &pa = Buffer->getPosition(a);
+		const core::vector3df &pb = Buffer->getPosition(b);
+		if (pa.X != pb.X)
+			return pa.X < pb.X;
+		if (pa.Y != pb.Y)
+			return pa.Y < pb.Y;
+		return pa.Z < pb.Z;
+	});
+
+	std::vector<u32> positionIds(VertexCount);
+	for (u32 i = 0, id = 0; i < VertexCount; ++i) {
+		if (i > 0 && Buffer->getPosition(order[i]) != Buffer->getPosition(order[i - 1])) {
+			++id;
+		} else if (i > 0) {
+			Locked[order[i]] = true;
+			Locked[order[i - 1]] = true;
+		}
+		positionIds[order[i]] = id;
+	}
+
+	// edges of a single triangle are on a border, edges of more than two
+	// on a non manifold part, both are kept as they are
+	std::vector<u64> edges;
+	edges.reserve(Indices.size());
+	for (u32 t = 0; t < Indices.size(); t += 3) {
+		for (u32 k = 0; k < 3; ++k) {
+			const u32 a = positionIds[Indices[t + k]];
+			const u32 b = positionIds[Indices[t + (k + 1) % 3]];
+			edges.push_back(((u64)core::min_(a, b) << 32) | core::max_(a, b));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+
+	std::vector<bool> lockedPositions(VertexCount, false);
+	for (size_t i = 0; i < edges.size();) {
+		size_t end = i + 1;
+		while (end < edges.size() && edges[end] == edges[i])
+			++end;
+		if (end - i != 2) {
+			lockedPositions[edges[i] >> 32] = true;
+			lockedPositions[edges[i] & 0xFFFFFFFF] = true;
+		}
+		i = end;
+	}
+
+	for (u32 i = 0; i < VertexCount; ++i) {
+		if (lockedPositions[positionIds[i]])
+			Locked[i] = true;
+	}
+}
+
+void CSimplifier::computeQuadrics()
+{
+	Quadrics.assign(VertexCount, SQuadric());
+	if (Indices.empty())
+		return;
+
+	core::aabbox3df box(Buffer->getPosition(Indices[0]));
+	for (u32 t = 0; t < Indices.size(); t += 3) {
+		const core::vector3df &v1 = Buffer->getPosition(Indices[t + 0]);
+		const core::vector3df &v2 = Buffer->getPosition(Indices[t + 1]);
+		const core::vector3df &v3 = Buffer->getPosition(Indices[t + 2]);
+		box.addInternalPoint(v1);
+		box.addInternalPoint(v2);
+		box.addInternalPoint(v3);
+
+		core::vector3df normal = (v2 - v1).crossProduct(v3 - v1);
+		const f32 area = normal.getLength() * 0.5f;
+		if (area <= 0.f)
+			continue;
+		normal /= area * 2.f;
+
+		// larger triangles matter more
+		for (u32 k = 0; k < 3; ++k)
+			Quadrics[Indices[t + k]].addPlane(normal, -normal.dotProduct(v1), area);
+	}
+
+	// a completely different normal costs like moving 5% of the size of the mesh
+	const f64 scale = box.getExtent().getLength() * 0.05;
+	AttributeWeight = scale * scale * 0.25;
+}
+
+f64 CSimplifier::getCost(u32 vertex, u32 target) const
+{
+	const f64 normal = Buffer->getNormal(vertex).getDistanceFromSQ(Buffer->getNormal(target));
+	const f64 tcoords = Buffer->getTCoords(vertex).getDistanceFromSQ(Buffer->getTCoords(target));
+	return Quadrics[vertex].getError(Buffer->getPosition(target)) + AttributeWeight * (normal + tcoords);
+}
+
+bool CSimplifier::flips(u32 vertex, u32 target) const
+{
+	const core::vector3df &moved = Buffer->getPosition(target);
+
+	for (u32 a = Adjacency.Offsets[vertex]; a < Adjacency.Offsets[vertex + 1]; ++a) {
+		const u32 *triangle = &Indices[Adjacency.Triangles[a] * 3];
+		if (triangle[0] == target || triangle[1] == target || triangle[2] == target)
+			continue; // removed by the collapse
+
+		core::vector3df p[3];
+		core::vector3df q[3];
+		for (u32 k = 0; k < 3; ++k) {
+			p[k] = Buffer->getPosition(triangle[k]);
+			q[k] = triangle[k] == vertex ? moved : p[k];
+		}
+
+		const core::vector3df before = (p[1] - p[0]).crossProduct(p[2] - p[0]);
+		const core::vector3df after = (q[1] - q[0]).crossProduct(q[2] - q[0]);
+		if (before.dotProduct(after) <= 0.f)
+			return true;
+	}
+	return false;
+}
+
+f32 CSimplifier::simplify(u32 targetTriangles)
+{
+	f64 maxError = 0;
+	std::vector<SCollapse> collapses;
+	std::vector<u32> remap(VertexCount);
+	std::vector<bool> touched(VertexCount);
+
+	while (Indices.size() / 3 > targetTriangles) {
+		Adjacency.build(Indices, VertexCount);
+
+		collapses.clear();
+		for (u32 i = 0; i < Indices.size(); ++i) {
+			const u32 vertex = Indices[i];
+			if (Locked[vertex])
+				continue;
+
+			const u32 triangle = i - i % 3;
+			for (u32 k = 0; k < 3; ++k) {
+				const u32 target = Indices[triangle + k];
+				if (target != vertex)
+					collapses.push_back({vertex, target, getCost(vertex, target)});
+			}
+		}
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const SCollapse &a, const SCollapse &b) {
+			return a.Cost < b.Cost;
+		});
+
+		// Each vertex takes part in one collapse per pass, later collapses
+		// around it would use outdated costs. The cheaper half of the
+		// collapses is done, the others are priced again in the next pass.
+		const f64 maxCost = collapses[collapses.size() / 2].Cost;
+		const u32 excess = Indices.size() / 3 - targetTriangles;
+		u32 removed = 0;
+
+		for (u32 i = 0; i < VertexCount; ++i)
+			remap[i] = i;
+		std::fill(touched.begin(), touched.end(), false);
+
+		for (const SCollapse &collapse : collapses) {
+			if (removed >= excess || (removed > 0 && collapse.Cost > maxCost))
+				break;
+			if (touched[collapse.Vertex] || touched[collapse.Target] || flips(collapse.Vertex, collapse.Target))
+				continue;
+
+			remap[collapse.Vertex] = collapse.Target;
+			Quadrics[collapse.Target].add(Quadrics[collapse.Vertex]);
+			maxError = core::max_(maxError, Quadrics[collapse.Vertex].getError(Buffer->getPosition(collapse.Target)));
+
+			const u32 vertex = collapse.Vertex;
+			for (u32 a = Adjacency.Offsets[vertex]; a < Adjacency.Offsets[vertex + 1]; ++a) {
+				const u32 *triangle = &Indices[Adjacency.Triangles[a] * 3];
+				for (u32 k = 0; k < 3; ++k) {
+					touched[triangle[k]] = true;
+					if (triangle[k] == collapse.Target)
+						++removed;
+				}
+			}
+		}
+		if (!removed)
+			break;
+
+		// drop the triangles which became degenerate
+		u32 kept = 0;
+		for (u32 t = 0; t < Indices.size(); t += 3) {
+			const u32 a = remap[Indices[t + 0]];
+			const u32 b = remap[Indices[t + 1]];
+			const u32 c = remap[Indices[t + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			Indices[kept++] = a;
+			Indices[kept++] = b;
+			Indices[kept++] = c;
+		}
+		Indices.resize(kept);
+	}
+
+	return (f32)sqrt(maxError);
+}
+
+//! Creates a mesh buffer with the vertices used by the indices
+template <class T>
+IMeshBuffer *createCompactedBuffer(const IMeshBuffer *source, const std::vector<u32> &indices)
+{
+	std::vector<u32> remap(source->getVertexCount(), NO_VERTEX);
+	u32 vertexCount = 0;
+	for (u32 index : indices) {
+		if (remap[index] == NO_VERTEX)
+			remap[index] = vertexCount++;
+	}
+	if (vertexCount > 0x10000) {
+		g_irrlogger->log("Simplified mesh buffer has too many vertices for 16 bit indices", ELL_ERROR);
+		return nullptr;
+	}
+
+	auto *buffer = new CMeshBuffer<T>();
+	buffer->Material = source->getMaterial();
+	buffer->setHardwareMappingHint(source->getVertexBuffer()->getHardwareMappingHint(), EBF_VERTEX);
+	buffer->setHardwareMappingHint(source->getIndexBuffer()->getHardwareMappingHint(), EBF_INDEX);
+
+	const T *vertices = static_cast<const T *>(source->getVertices());
+	buffer->Vertices->Data.resize(vertexCount);
+	for (u32 i = 0; i < remap.size(); ++i) {
+		if (remap[i] != NO_VERTEX)
+			buffer->Vertices->Data[remap[i]] = vertices[i];
+	}
+
+	buffer->Indices->Data.reserve(indices.size());
+	for (u32 index : indices)
+		buffer->Indices->Data.push_back((u16)remap[index]);
+
+	buffer->recalculateBoundingBox();
+	return buffer;
+}
+}
+
+//! Creates a copy of a mesh buffer with less triangles.
+IMeshBuffer *MeshManipulator::createSimplifiedMeshBuffer(const IMeshBuffer *buffer, f32 ratio, f32 *error) const
+{
+	if (error)
+		*error = 0.f;
+	if (!buffer)
+		return nullptr;
+
+	const E_VERTEX_TYPE type = buffer->getVertexType();
+	if (buffer->getPrimitiveType() != EPT_TRIANGLES ||
+			(type != EVT_3D && type != EVT_2TCOORDS && type != EVT_TANGENTS)) {
+		g_irrlogger->log("Can only simplify static mesh buffers made of triangles", ELL_ERROR);
+		return nullptr;
+	}
+
+	std::vector<u32> indices = getTriangleIndices(buffer);
+	const u32 vertexCount = buffer->getVertexCount();
+
+	const auto compact = [buffer, type](const std::vector<u32> &result) -> IMeshBuffer * {
+		switch (type) {
+		case EVT_3D:
+			return createCompactedBuffer<Vertex3D>(buffer, result);
+		case EVT_2TCOORDS:
+			return createCompactedBuffer<Vertex2TCoords>(buffer, result);
+		default:
+			return createCompactedBuffer<VertexTangents>(buffer, result);
+		}
+	};
+
+	// without a triangle there is nothing to collapse, the result is a copy
+	if (indices.size() < 3 || vertexCount < 3)
+		return compact(indices);
+
+	const u32 targetTriangles = (u32)(indices.size() / 3 * core::clamp(ratio, 0.f, 1.f));
+
+	CSimplifier simplifier(buffer, std::move(indices));
+	const f32 simplifiedError = simplifier.simplify(targetTriangles);
+	if (error)
+		*error = simplifiedError;
+
+	return compact(simplifier.getIndices());
+}
+
+//! Creates a copy of a static mesh with less triangles.
+SMesh *MeshManipulator::createSimplifiedMesh(IMesh *mesh, f32 ratio, f32 *error) const
+{
+	if (error)
+		*error = 0.f;
+	if (!mesh)
+		return nullptr;
+
+	SMesh *clone = new SMesh();
+	for (u32 b = 0; b < mesh->getMeshBufferCount(); ++b) {
+		f32 bufferError = 0.f;
+		IMeshBuffer *buffer = createSimplifiedMeshBuffer(mesh->getMeshBuffer(b), ratio, &bufferError);
+		if (!buffer) {
+			clone->drop();
+			return nullptr;
+		}
+
+		clone->addMeshBuffer(buffer);
+		clone->setTextureSlot(b, mesh->getTextureSlot(b));
+		buffer->drop();
+
+		if (error)
+			*error = core::max_(*error, bufferError);
+	}
+
+	clone->recalculateBoundingBox();
+	return clone;
+}
+
+//! Creates a chain of levels of detail for a static mesh.
+std::vector<SMesh *> MeshManipulator::createLODChain(IMesh *mesh, u32 levels, f32 ratio) const
+{
+	std::vector<SMesh *> chain;
+
+	IMesh *previous = mesh;
+	for (u32 i = 0; i < levels; ++i) {
+		SMesh *level = createSimplifiedMesh(previous, ratio);
+		if (!level)
+			break;
+
+		// nothing left to collapse
+		if (getPolyCount(level) >= getPolyCount(previous)) {
+			level->drop();
+			break;
+		}
+
+		chain.push_back(level);
+		previous = level;
+	}
+
+	return chain;
+}
+
+//! Returns true if createBatchedMesh() can merge a mesh buffer
+bool MeshManipulator::isBatchable(const IMeshBuffer *buffer) const
+{
+	switch (buffer->getVertexType()) {
+	case EVT_3D:
+	case EVT_2TCOORDS:
+	case EVT_TANGENTS:
+		break;
+	default:
+		return false;
+	}
+
+	return buffer->getPrimitiveType() == EPT_TRIANGLES &&
+			buffer->getVertexCount() <= 0x10000;
+}
+
+namespace
+{
+//! Appends the transformed triangles of a mesh buffer
+template <class T>
+void appendTransformed(CMeshBuffer<T> *dst, const IMeshBuffer *src,
+		const std::vector<u32> &indices, const core::matrix4 &transformation)
+{
+	// normals are transformed with the inverse transposed matrix, so they
+	// stay perpendicular to the surface under non uniform scaling
+	core::matrix4 inverse;
+	if (!transformation.getInverse(inverse))
+		inverse.makeIdentity();
+	const core::matrix4 normalTransformation = inverse.getTransposed();
+
+	// mirroring transformations turn the triangles inside out
+	const core::vector3df x = transformation.rotateAndScaleVect(core::vector3df(1.f, 0.f, 0.f));
+	const core::vector3df y = transformation.rotateAndScaleVect(core::vector3df(0.f, 1.f, 0.f));
+	const core::vector3df z = transformation.rotateAndScaleVect(core::vector3df(0.f, 0.f, 1.f));
+	const bool flip = x.crossProduct(y).dotProduct(z) < 0.f;
+
+	const T *vertices = static_cast<const T *>(src->getVertices());
+	const u32 base = dst->getVertexCount();
+
+	std::vector<T> &data = dst->Vertices->Data;
+	data.reserve(data.size() + src->getVertexCount());
+	for (u32 i = 0; i < src->getVertexCount(); ++i) {
+		T v = vertices[i];
+		transformation.transformVect(v.Pos);
+		v.Normal = normalTransformation.rotateAndScaleVect(v.Normal);
+		v.Normal.normalize();
+		if constexpr (std::is_same<T, VertexTangents>::value) {
+			v.Tangent = transformation.rotateAndScaleVect(v.Tangent);
+			v.Tangent.normalize();
+			v.Binormal = transformation.rotateAndScaleVect(v.Binormal);
+			v.Binormal.normalize();
+		}
+		data.push_back(v);
+	}
+
+	std::vector<u16> &dstIndices = dst->Indices->Data;
+	dstIndices.reserve(dstIndices.size() + indices.size());
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		dstIndices.push_back((u16)(base + indices[i]));
+		dstIndices.push_back((u16)(base + indices[flip ? i + 2 : i + 1]));
+		dstIndices.push_back((u16)(base + indices[flip ? i + 1 : i + 2]));
+	}
+}
+
+//! Creates an empty mesh buffer of a vertex type
+IMeshBuffer *createMeshBuffer(E_VERTEX_TYPE type)
+{
+	switch (type) {
+	case EVT_3D:
+		return new SMeshBuffer();
+	case EVT_2TCOORDS:
+		return new SMeshBufferLightMap();
+	case EVT_TANGENTS:
+		return new SMeshBufferTangents();
+	default:
+		return nullptr;
+	}
+}
+}
+
+//! Merges many mesh buffers into few large ones.
+SMesh *MeshManipulator::createBatchedMesh(const std::vector<SBatchedBuffer> &buffers) const
+{
+	SMesh *mesh = new SMesh();
+
+	// the buffer of each material and vertex type which is appended to
+	struct SGroup
+	{
+		const video::SMaterial *Material;
+		IMeshBuffer *Buffer;
+	};
+	std::vector<SGroup> groups;
+
+	for (const SBatchedBuffer &batched : buffers) {
+		const IMeshBuffer *src = batched.Buffer;
+		if (!src || !isBatchable(src))
+			continue;
+
+		const std::vector<u32> indices = getTriangleIndices(src);
+		if (indices.empty())
+			continue;
+
+		const E_VERTEX_TYPE type = src->getVertexType();
+
+		auto group = std::find_if(groups.begin(), groups.end(), [&](const SGroup &group) {
+			return group.Buffer->getVertexType() == type && *group.Material == *batched.Material;
+		});
+
+		IMeshBuffer *dst = nullptr;
+		if (group != groups.end() && group->Buffer->getVertexCount() + src->getVertexCount() <= 0x10000)
+			dst = group->Buffer;
+
+		if (!dst) {
+			dst = createMeshBuffer(type);
+			dst->getMaterial() = *batched.Material;
+			dst->setHardwareMappingHint(EHM_STATIC);
+			mesh->addMeshBuffer(dst);
+			dst->drop();
+
+			// a full buffer isn't appended to anymore
+			if (group != groups.end())
+				group->Buffer = dst;
+			else
+				groups.push_back({batched.Material, dst});
+		}
+
+		switch (type) {
+		case EVT_3D:
+			appendTransformed(static_cast<SMeshBuffer *>(dst), src, indices, batched.Transformation);
+			break;
+		case EVT_2TCOORDS:
+			appendTransformed(static_cast<SMeshBufferLightMap *>(dst), src, indices, batched.Transformation);
+			break;
+		default:
+			appendTransformed(static_cast<SMeshBufferTangents *>(dst), src, indices, batched.Transformation);
+			break;
+		}
+	}
+
+	for (IMeshBuffer *buffer : mesh->MeshBuffers)
+		buffer->recalculateBoundingBox();
+	mesh->recalculateBoundingBox();
+
+	return mesh;
+}
+
 //! create a new AnimatedMesh and adds the mesh to it
 IAnimatedMesh *MeshManipulator::createAnimatedMesh(scene::IMesh *mesh, scene::E_ANIMATED_MESH_TYPE type) const
 {
@@ -0,0 +1,56 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Utils/irrTypes.h"
+
+namespace scene
+{
+
+//! Layout of the binary mesh files written by CBinaryMeshWriter
+/** The file is a header followed by the mesh, written field by field in
+the byte order of the machine writing it. Arrays are a u32 count followed by
+their elements exactly as they are stored in memory, e.g. the vertices as in
+CVertexBuffer::Data, so loading them is one read per array. Elements with
+padding bytes, like the joint weights, are written field by field instead,
+so the files only depend on the mesh.
+
+The files are meant as a cache of converted assets on the machine which
+wrote them, not for distribution. Files of another byte order, version or
+with other vertex sizes are rejected and have to be converted again. */
+namespace binarymesh
+{
+//! "IRBM"
+const u32 MAGIC = 0x4D425249;
+
+//! Increased with every change of the layout
+const u32 VERSION = 2;
+
+//! Written as is, reads differently on machines of the other byte order
+const u32 BYTE_ORDER_MARK = 0x01020304;
+
+//! Kind of mesh following the header
+enum E_MESH_KIND
+{
+	//! A SAnimatedMesh with a single SMesh made of CMeshBuffers
+	EMK_STATIC = 0,
+
+	//! A SkinnedMesh
+	EMK_SKINNED
+};
+
+//! Extension of the files, used by the loader and the cache of the scene manager
+const c8 *const EXTENSION = "irrb";
+
+struct SHeader
+{
+	u32 Magic;
+	u32 Version;
+	u32 ByteOrder;
+	u32 Kind;
+};
+} // end namespace binarymesh
+
+} // end namespace scene
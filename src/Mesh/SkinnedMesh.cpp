@@ -8,19 +8,266 @@
 #include "Scene/IAnimatedMeshSceneNode.h"
 #include "Mesh/SSkinMeshBuffer.h"
 #include "Device/Logger.h"
+#include "Device/JobSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
 #include <vector>
 #include <cassert>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define IRR_SKINNING_SSE
+#endif
+
 
 namespace scene
 {
 
+namespace
+{
+//! Vertices skinned by a single job
+const u32 SKINNING_RANGE_SIZE = 2048;
+
+//! Vertices morphed by a single job
+const u32 MORPH_RANGE_SIZE = 4096;
+
+//! Floats stored per joint and sample by bakeAnimation()
+const u32 BAKED_MATRIX_SIZE = 12;
+
+//! Everything the skinning kernel reads and writes
+struct SSkinningStreams
+{
+	const u32 *VertexIds;
+	const f32 *PosX, *PosY, *PosZ;
+	const f32 *NormalX, *NormalY, *NormalZ;
+	const u16 *Joints;
+	const f32 *Weights;
+
+	const core::matrix4 *Palette;
+
+	//! Morphed rest pose indexed by vertex id, 4 floats per vertex, or 0
+	const f32 *MorphedPositions;
+	const f32 *MorphedNormals;
+
+	u8 *Vertices;
+	u32 Stride;
+	bool Normals;
+};
+
+//! Blends the joint matrices of each vertex and transforms its rest pose once.
+/** N is the amount of influences per vertex. The weights are sorted, so the
+loop stops at the first unused slot. If Bounds is set, the bounding box of the
+skinned positions is collected on the way. */
+template <u32 N, bool Bounds>
+void skinVertexRange(const SSkinningStreams &s, u32 begin, u32 end, core::aabbox3df &box)
+{
+#ifdef IRR_SKINNING_SSE
+	__m128 boxMin = _mm_set1_ps(FLT_MAX);
+	__m128 boxMax = _mm_set1_ps(-FLT_MAX);
+#else
+	box.reset(FLT_MAX, FLT_MAX, FLT_MAX);
+	box.MaxEdge.set(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+#endif
+
+	for (u32 v = begin; v < end; ++v) {
+		const u16 *joints = s.Joints + v * N;
+		const f32 *weights = s.Weights + v * N;
+
+		const u32 id = s.VertexIds[v];
+		scene::Vertex3D *vertex = reinterpret_cast<scene::Vertex3D *>(s.Vertices + id * s.Stride);
+
+		f32 x, y, z, nx, ny, nz;
+		if (s.MorphedPositions) {
+			const f32 *p = s.MorphedPositions + id * 4;
+			const f32 *n = s.MorphedNormals + id * 4;
+			x = p[0], y = p[1], z = p[2];
+			nx = n[0], ny = n[1], nz = n[2];
+		} else {
+			x = s.PosX[v], y = s.PosY[v], z = s.PosZ[v];
+			nx = s.NormalX[v], ny = s.NormalY[v], nz = s.NormalZ[v];
+		}
+
+#ifdef IRR_SKINNING_SSE
+		// columns of the blended matrix, one per SSE register
+		const f32 *m = s.Palette[joints[0]].pointer();
+		__m128 w = _mm_set1_ps(weights[0]);
+		__m128 c0 = _mm_mul_ps(w, _mm_loadu_ps(m));
+		__m128 c1 = _mm_mul_ps(w, _mm_loadu_ps(m + 4));
+		__m128 c2 = _mm_mul_ps(w, _mm_loadu_ps(m + 8));
+		__m128 c3 = _mm_mul_ps(w, _mm_loadu_ps(m + 12));
+
+		for (u32 i = 1; i < N && weights[i] != 0.f; ++i) {
+			m = s.Palette[joints[i]].pointer();
+			w = _mm_set1_ps(weights[i]);
+			c0 = _mm_add_ps(c0, _mm_mul_ps(w, _mm_loadu_ps(m)));
+			c1 = _mm_add_ps(c1, _mm_mul_ps(w, _mm_loadu_ps(m + 4)));
+			c2 = _mm_add_ps(c2, _mm_mul_ps(w, _mm_loadu_ps(m + 8)));
+			c3 = _mm_add_ps(c3, _mm_mul_ps(w, _mm_loadu_ps(m + 12)));
+		}
+
+		f32 out[4];
+
+		__m128 pos = _mm_add_ps(c3, _mm_mul_ps(c0, _mm_set1_ps(x)));
+		pos = _mm_add_ps(pos, _mm_mul_ps(c1, _mm_set1_ps(y)));
+		pos = _mm_add_ps(pos, _mm_mul_ps(c2, _mm_set1_ps(z)));
+		if (Bounds) {
+			boxMin = _mm_min_ps(boxMin, pos);
+			boxMax = _mm_max_ps(boxMax, pos);
+		}
+		_mm_storeu_ps(out, pos);
+		vertex->Pos.set(out[0], out[1], out[2]);
+
+		if (s.Normals) {
+			__m128 normal = _mm_mul_ps(c0, _mm_set1_ps(nx));
+			normal = _mm_add_ps(normal, _mm_mul_ps(c1, _mm_set1_ps(ny)));
+			normal = _mm_add_ps(normal, _mm_mul_ps(c2, _mm_set1_ps(nz)));
+			_mm_storeu_ps(out, normal);
+			vertex->Normal.set(out[0], out[1], out[2]);
+			vertex->Normal.normalize(); // must renormalize after potentially scaling
+		}
+#else
+		// upper 3x4 part of the blended matrix
+		f32 c[12] = {};
+		for (u32 i = 0; i < N && weights[i] != 0.f; ++i) {
+			const f32 *m = s.Palette[joints[i]].pointer();
+			const f32 w = weights[i];
+			for (u32 col = 0; col < 4; ++col) {
+				c[col * 3 + 0] += w * m[col * 4 + 0];
+				c[col * 3 + 1] += w * m[col * 4 + 1];
+				c[col * 3 + 2] += w * m[col * 4 + 2];
+			}
+		}
+
+		vertex->Pos.set(
+				c[0] * x + c[3] * y + c[6] * z + c[9],
+				c[1] * x + c[4] * y + c[7] * z + c[10],
+				c[2] * x + c[5] * y + c[8] * z + c[11]);
+		if (Bounds)
+			box.addInternalPoint(vertex->Pos);
+
+		if (s.Normals) {
+			vertex->Normal.set(
+					c[0] * nx + c[3] * ny + c[6] * nz,
+					c[1] * nx + c[4] * ny + c[7] * nz,
+					c[2] * nx + c[5] * ny + c[8] * nz);
+			vertex->Normal.normalize(); // must renormalize after potentially scaling
+		}
+#endif
+	}
+
+#ifdef IRR_SKINNING_SSE
+	f32 out[4];
+	_mm_storeu_ps(out, boxMin);
+	box.MinEdge.set(out[0], out[1], out[2]);
+	_mm_storeu_ps(out, boxMax);
+	box.MaxEdge.set(out[0], out[1], out[2]);
+#endif
+}
+
+//! Adds the weighted deltas of a morph target to 4 float vectors
+/** \param out Vectors indexed by vertex id.
+\param ids Vertex ids of the deltas. */
+void accumulateMorphDeltas(f32 *out, const u32 *ids, const f32 *deltas, u32 count, f32 weight)
+{
+#ifdef IRR_SKINNING_SSE
+	const __m128 w = _mm_set1_ps(weight);
+	for (u32 i = 0; i < count; ++i) {
+		f32 *dst = out + ids[i] * 4;
+		_mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_mul_ps(w, _mm_loadu_ps(deltas + i * 4))));
+	}
+#else
+	for (u32 i = 0; i < count; ++i) {
+		f32 *dst = out + ids[i] * 4;
+		const f32 *delta = deltas + i * 4;
+		dst[0] += weight * delta[0];
+		dst[1] += weight * delta[1];
+		dst[2] += weight * delta[2];
+	}
+#endif
+}
+
+//! Builds a local joint matrix from its animated components
+/** \param scaled Apply the scale, only done for joints with scale keys. */
+void composeLocalMatrix(const core::vector3df &position, const core::quaternion &rotation,
+		const core::vector3df &scale, bool scaled, core::matrix4 &local)
+{
+	// IRR_TEST_BROKEN_QUATERNION_USE: TODO - switched to getMatrix_transposed instead of getMatrix for downward compatibility.
+	//								   Not tested so far if this was correct or wrong before quaternion fix!
+	// Note that using getMatrix_transposed inverts the rotation.
+	rotation.getMatrix_transposed(local);
+
+	// --- local *= rotation.getMatrix() ---
+	f32 *m1 = local.pointer();
+	const core::vector3df &Pos = position;
+	m1[0] += Pos.X * m1[3];
+	m1[1] += Pos.Y * m1[3];
+	m1[2] += Pos.Z * m1[3];
+	m1[4] += Pos.X * m1[7];
+	m1[5] += Pos.Y * m1[7];
+	m1[6] += Pos.Z * m1[7];
+	m1[8] += Pos.X * m1[11];
+	m1[9] += Pos.Y * m1[11];
+	m1[10] += Pos.Z * m1[11];
+	m1[12] += Pos.X * m1[15];
+	m1[13] += Pos.Y * m1[15];
+	m1[14] += Pos.Z * m1[15];
+	// -----------------------------------
+
+	if (scaled) {
+		// -------- local *= scaleMatrix -----------------
+		core::matrix4 &mat = local;
+		mat[0] *= scale.X;
+		mat[1] *= scale.X;
+		mat[2] *= scale.X;
+		mat[3] *= scale.X;
+		mat[4] *= scale.Y;
+		mat[5] *= scale.Y;
+		mat[6] *= scale.Y;
+		mat[7] *= scale.Y;
+		mat[8] *= scale.Z;
+		mat[9] *= scale.Z;
+		mat[10] *= scale.Z;
+		mat[11] *= scale.Z;
+		// -----------------------------------
+	}
+}
+
+//! Weight of a joint in a blend, the blend weight times its mask entry
+inline f32 maskedWeight(f32 weight, const std::vector<f32> *mask, u32 joint)
+{
+	if (mask && joint < mask->size())
+		return weight * (*mask)[joint];
+	return weight;
+}
+
+//! Bounding box of mesh buffers placed by their transformations
+void calculateBoundingBox(const std::vector<SSkinMeshBuffer *> &buffers, core::aabbox3df &box)
+{
+	box.reset(0, 0, 0);
+
+	for (auto *buffer : buffers) {
+		buffer->recalculateBoundingBox();
+		core::aabbox3df bb = buffer->BoundingBox;
+		buffer->Transformation.transformBoxEx(bb);
+
+		box.addInternalBox(bb);
+	}
+}
+}
+
 //! destructor
 SkinnedMesh::~SkinnedMesh()
 {
 	for (auto *joint : AllJoints)
 		delete joint;
 
+	for (auto *target : MorphTargets)
+		delete target;
+
 	for (auto *buffer : LocalBuffers) {
 		if (buffer)
 			buffer->drop();
@@ -66,111 +313,489 @@ IMesh *SkinnedMesh::getMesh(f32 frame)
 //! Animates joints based on frame input
 void SkinnedMesh::animateMesh(f32 frame)
 {
-	if (!HasAnimation || LastAnimatedFrame == frame)
+	animatePose(Pose, frame);
+}
+
+//! Animates the local joint matrices of a pose based on frame input
+void SkinnedMesh::animatePose(SPose &pose, f32 frame) const
+{
+	if (!HasAnimation || pose.Frame == frame)
 		return;
 
-	LastAnimatedFrame = frame;
-	SkinnedLastFrame = false;
+	if (pose.LocalMatrices.size() != AllJoints.size() || pose.MorphWeights.size() != MorphTargets.size())
+		resetPose(pose);
 
-	for (auto *joint : AllJoints) {
-		// The joints can be animated here with no input from their
-		// parents, but for setAnimationMode extra checks are needed
-		// to their parents
-		joint->keys.updateTransform(frame,
-				joint->Animatedposition,
-				joint->Animatedrotation,
-				joint->Animatedscale);
+	pose.Frame = frame;
+	pose.Skinned = false;
+
+	if (Baked.SampleCount)
+		buildBakedLocalMatrices(pose, frame);
+	else
+		buildAllLocalAnimatedMatrices(pose, frame);
+
+	sampleMorphWeights(pose, frame);
+}
+
+//! Samples the weight keys of the morph targets into a pose
+void SkinnedMesh::sampleMorphWeights(SPose &pose, f32 frame) const
+{
+	if (pose.MorphWeights.size() != MorphTargets.size())
+		resetPose(pose);
+
+	for (u32 i = 0; i < MorphTargets.size(); ++i) {
+		const SMorphTarget *target = MorphTargets[i];
+		if (target->Weights.empty())
+			continue;
+
+		if (auto weight = target->Weights.get(frame, pose.MorphCursors[i]))
+			pose.MorphWeights[i] = *weight;
 	}
+}
 
-	// Note:
-	// LocalAnimatedMatrix needs to be built at some point, but this function may be called lots of times for
-	// one render (to play two animations at the same time) LocalAnimatedMatrix only needs to be built once.
-	// a call to buildAllLocalAnimatedMatrices is needed before skinning the mesh, and before the user gets the joints to move
+//! Sets a pose to the rest pose of the mesh
+void SkinnedMesh::resetPose(SPose &pose) const
+{
+	const u32 count = AllJoints.size();
+
+	pose.LocalMatrices.resize(count);
+	pose.GlobalMatrices.resize(count);
+	pose.SkinningMatrices.assign(count, core::IdentityMatrix);
+	pose.GlobalSkinningSpace.assign(count, 0);
+	pose.RangeBoxes.assign(SkinningRanges.size(), core::aabbox3df{{0, 0, 0}});
+	pose.KeyCursors.assign(count * 3, 0);
+
+	for (u32 i = 0; i < count; ++i) {
+		pose.LocalMatrices[i] = AllJoints[i]->LocalMatrix;
+		pose.GlobalMatrices[i] = AllJoints[i]->GlobalMatrix;
+	}
+
+	pose.MorphWeights.resize(MorphTargets.size());
+	for (u32 i = 0; i < MorphTargets.size(); ++i)
+		pose.MorphWeights[i] = MorphTargets[i]->DefaultWeight;
+	pose.MorphCursors.assign(MorphTargets.size(), 0);
 
-	//----------------
-	// Temp!
-	buildAllLocalAnimatedMatrices();
-	//-----------------
+	// nothing accumulated yet
+	pose.AppliedMorphWeights.assign(MorphTargets.size(), std::numeric_limits<f32>::quiet_NaN());
+	pose.MorphedPositions.resize(MorphBuffers.size());
+	pose.MorphedNormals.resize(MorphBuffers.size());
 
-	updateBoundingBox();
+	pose.Frame = -1.f;
+	pose.Skinned = false;
 }
 
-void SkinnedMesh::buildAllLocalAnimatedMatrices()
+void SkinnedMesh::buildAllLocalAnimatedMatrices(SPose &pose, f32 frame) const
 {
-	for (auto *joint : AllJoints) {
-		// Could be faster:
+	for (u32 i = 0; i < AllJoints.size(); ++i) {
+		const SJoint *joint = AllJoints[i];
+		core::matrix4 &local = pose.LocalMatrices[i];
 
 		if (!joint->keys.empty()) {
-			joint->GlobalSkinningSpace = false;
-
-			// IRR_TEST_BROKEN_QUATERNION_USE: TODO - switched to getMatrix_transposed instead of getMatrix for downward compatibility.
-			//								   Not tested so far if this was correct or wrong before quaternion fix!
-			// Note that using getMatrix_transposed inverts the rotation.
-			joint->Animatedrotation.getMatrix_transposed(joint->LocalAnimatedMatrix);
-
-			// --- joint->LocalAnimatedMatrix *= joint->Animatedrotation.getMatrix() ---
-			f32 *m1 = joint->LocalAnimatedMatrix.pointer();
-			core::vector3df &Pos = joint->Animatedposition;
-			m1[0] += Pos.X * m1[3];
-			m1[1] += Pos.Y * m1[3];
-			m1[2] += Pos.Z * m1[3];
-			m1[4] += Pos.X * m1[7];
-			m1[5] += Pos.Y * m1[7];
-			m1[6] += Pos.Z * m1[7];
-			m1[8] += Pos.X * m1[11];
-			m1[9] += Pos.Y * m1[11];
-			m1[10] += Pos.Z * m1[11];
-			m1[12] += Pos.X * m1[15];
-			m1[13] += Pos.Y * m1[15];
-			m1[14] += Pos.Z * m1[15];
-			// -----------------------------------
-
-			if (!joint->keys.scale.empty()) {
-				/*
-				core::matrix4 scaleMatrix;
-				scaleMatrix.setScale(joint->Animatedscale);
-				joint->LocalAnimatedMatrix *= scaleMatrix;
-				*/
-
-				// -------- joint->LocalAnimatedMatrix *= scaleMatrix -----------------
-				core::matrix4 &mat = joint->LocalAnimatedMatrix;
-				mat[0] *= joint->Animatedscale.X;
-				mat[1] *= joint->Animatedscale.X;
-				mat[2] *= joint->Animatedscale.X;
-				mat[3] *= joint->Animatedscale.X;
-				mat[4] *= joint->Animatedscale.Y;
-				mat[5] *= joint->Animatedscale.Y;
-				mat[6] *= joint->Animatedscale.Y;
-				mat[7] *= joint->Animatedscale.Y;
-				mat[8] *= joint->Animatedscale.Z;
-				mat[9] *= joint->Animatedscale.Z;
-				mat[10] *= joint->Animatedscale.Z;
-				mat[11] *= joint->Animatedscale.Z;
-				// -----------------------------------
+			pose.GlobalSkinningSpace[i] = false;
+
+			// The joints can be animated here with no input from their
+			// parents, channels without keys keep the values of the loader.
+			core::vector3df position = joint->Animatedposition;
+			core::quaternion rotation = joint->Animatedrotation;
+			core::vector3df scale = joint->Animatedscale;
+			joint->keys.updateTransform(frame, position, rotation, scale, &pose.KeyCursors[i * 3]);
+
+			composeLocalMatrix(position, rotation, scale, !joint->keys.scale.empty(), local);
+		} else {
+			local = joint->LocalMatrix;
+		}
+	}
+}
+
+//! Samples the keys of all joints with keys at a frame
+void SkinnedMesh::sampleTransforms(SJointTransforms &transforms, f32 frame,
+		std::vector<u32> *cursors) const
+{
+	const u32 count = AllJoints.size();
+	if (transforms.Positions.size() != count) {
+		transforms.Positions.resize(count);
+		transforms.Rotations.resize(count);
+		transforms.Scales.resize(count);
+	}
+	if (cursors && cursors->size() != count * 3)
+		cursors->assign(count * 3, 0);
+
+	for (u32 i : AnimatedJoints) {
+		const SJoint *joint = AllJoints[i];
+
+		// channels without keys keep the values of the loader
+		core::vector3df &position = transforms.Positions[i];
+		core::quaternion &rotation = transforms.Rotations[i];
+		core::vector3df &scale = transforms.Scales[i];
+		position = joint->Animatedposition;
+		rotation = joint->Animatedrotation;
+		scale = joint->Animatedscale;
+
+		joint->keys.updateTransform(frame, position, rotation, scale,
+				cursors ? &(*cursors)[i * 3] : nullptr);
+	}
+}
+
+//! Blends src over dst
+void SkinnedMesh::blendTransforms(SJointTransforms &dst, const SJointTransforms &src,
+		f32 weight, const std::vector<f32> *mask, E_ROTATION_BLEND rotationBlend) const
+{
+	for (u32 i : AnimatedJoints) {
+		const f32 w = maskedWeight(weight, mask, i);
+		if (w <= 0.f)
+			continue;
+
+		if (w >= 1.f) {
+			dst.Positions[i] = src.Positions[i];
+			dst.Rotations[i] = src.Rotations[i];
+			dst.Scales[i] = src.Scales[i];
+			continue;
+		}
+
+		dst.Positions[i] += (src.Positions[i] - dst.Positions[i]) * w;
+		dst.Scales[i] += (src.Scales[i] - dst.Scales[i]) * w;
+
+		core::quaternion &rotation = dst.Rotations[i];
+		core::quaternion target = src.Rotations[i];
+		if (rotationBlend == ERB_SLERP) {
+			rotation.slerp(rotation, target, w);
+		} else {
+			// take the short way, q and -q are the same rotation
+			if (rotation.dotProduct(target) < 0.f)
+				target *= -1.f;
+			rotation.lerpN(rotation, target, w);
+		}
+	}
+}
+
+//! Adds the difference of src to reference on top of dst
+void SkinnedMesh::addTransforms(SJointTransforms &dst, const SJointTransforms &src,
+		const SJointTransforms &reference, f32 weight, const std::vector<f32> *mask) const
+{
+	for (u32 i : AnimatedJoints) {
+		const f32 w = maskedWeight(weight, mask, i);
+		if (w == 0.f)
+			continue;
+
+		dst.Positions[i] += (src.Positions[i] - reference.Positions[i]) * w;
+
+		const core::vector3df &scale = reference.Scales[i];
+		const core::vector3df ratio(
+				scale.X != 0.f ? src.Scales[i].X / scale.X : 1.f,
+				scale.Y != 0.f ? src.Scales[i].Y / scale.Y : 1.f,
+				scale.Z != 0.f ? src.Scales[i].Z / scale.Z : 1.f);
+		dst.Scales[i] *= core::vector3df(1.f) + (ratio - core::vector3df(1.f)) * w;
+
+		// rotation taking reference to src, applied in the same order
+		// as the keys were, then scaled by the weight
+		core::quaternion inverse = reference.Rotations[i];
+		inverse.makeInverse();
+		core::quaternion delta = inverse * src.Rotations[i];
+		if (delta.W < 0.f)
+			delta *= -1.f;
+		if (w != 1.f)
+			delta.lerpN(core::quaternion(), delta, w);
+
+		dst.Rotations[i] = dst.Rotations[i] * delta;
+		dst.Rotations[i].normalize();
+	}
+}
+
+//! Sets the local matrices of a pose from transforms
+void SkinnedMesh::buildLocalMatrices(SPose &pose, const SJointTransforms &transforms) const
+{
+	if (pose.LocalMatrices.size() != AllJoints.size())
+		resetPose(pose);
+
+	for (u32 i = 0; i < AllJoints.size(); ++i) {
+		if (AllJoints[i]->keys.empty())
+			pose.LocalMatrices[i] = AllJoints[i]->LocalMatrix;
+	}
+
+	for (u32 i : AnimatedJoints) {
+		pose.GlobalSkinningSpace[i] = false;
+		composeLocalMatrix(transforms.Positions[i], transforms.Rotations[i],
+				transforms.Scales[i], !AllJoints[i]->keys.scale.empty(),
+				pose.LocalMatrices[i]);
+	}
+
+	// set from outside of the animation, see animatePose()
+	pose.Frame = -1.f;
+	pose.Skinned = false;
+}
+
+void SkinnedMesh::buildBakedLocalMatrices(SPose &pose, f32 frame) const
+{
+	const f32 position = core::clamp(frame * Baked.SamplesPerFrame, 0.f, (f32)(Baked.SampleCount - 1));
+	u32 sample = (u32)position;
+	f32 blend = position - sample;
+
+	if (!Baked.Interpolate) {
+		if (blend >= 0.5f)
+			++sample;
+		blend = 0.f;
+	}
+
+	const u32 next = std::min(sample + 1, Baked.SampleCount - 1);
+	const u32 stride = Baked.Joints.size() * BAKED_MATRIX_SIZE;
+	const bool quantized = !Baked.Quantized.empty();
+
+	for (u32 i = 0; i < AllJoints.size(); ++i) {
+		if (AllJoints[i]->keys.empty())
+			pose.LocalMatrices[i] = AllJoints[i]->LocalMatrix;
+	}
+
+	for (u32 j = 0; j < Baked.Joints.size(); ++j) {
+		const u32 i = Baked.Joints[j];
+		pose.GlobalSkinningSpace[i] = false;
+
+		const u32 offset = j * BAKED_MATRIX_SIZE;
+		f32 *m = pose.LocalMatrices[i].pointer();
+
+		if (quantized) {
+			const u16 *from = &Baked.Quantized[sample * stride + offset];
+			const u16 *to = &Baked.Quantized[next * stride + offset];
+			const f32 *range = &Baked.Ranges[offset * 2];
+
+			for (u32 column = 0; column < 4; ++column) {
+				for (u32 k = 0; k < 3; ++k) {
+					const u32 e = column * 3 + k;
+					const f32 a = from[e];
+					m[column * 4 + k] = range[e * 2] + (a + (to[e] - a) * blend) * range[e * 2 + 1];
+				}
 			}
 		} else {
-			joint->LocalAnimatedMatrix = joint->LocalMatrix;
+			const f32 *from = &Baked.Matrices[sample * stride + offset];
+			const f32 *to = &Baked.Matrices[next * stride + offset];
+
+			for (u32 column = 0; column < 4; ++column) {
+				for (u32 k = 0; k < 3; ++k) {
+					const f32 a = from[column * 3 + k];
+					m[column * 4 + k] = a + (to[column * 3 + k] - a) * blend;
+				}
+			}
 		}
+		m[3] = m[7] = m[11] = 0.f;
+		m[15] = 1.f;
 	}
-	SkinnedLastFrame = false;
 }
 
-void SkinnedMesh::buildAllGlobalAnimatedMatrices(SJoint *joint, SJoint *parentJoint)
+size_t SkinnedMesh::compressAnimation(const SCompressionSettings &settings)
 {
-	if (!joint) {
-		for (auto *rootJoint : RootJoints)
-			buildAllGlobalAnimatedMatrices(rootJoint, 0);
-		return;
-	} else {
-		// Find global matrix...
-		if (!parentJoint || joint->GlobalSkinningSpace)
-			joint->GlobalAnimatedMatrix = joint->LocalAnimatedMatrix;
+	for (auto *joint : AllJoints) {
+		Keys &keys = joint->keys;
+
+		keys.position.reduce(settings.PositionTolerance);
+		keys.rotation.reduce(settings.RotationTolerance);
+		keys.scale.reduce(settings.ScaleTolerance);
+
+		keys.position.compress();
+		keys.rotation.compress();
+		keys.scale.compress();
+	}
+
+	for (auto *target : MorphTargets) {
+		target->Weights.reduce(settings.WeightTolerance);
+		target->Weights.compress();
+	}
+
+	Pose.Frame = -1.f;
+	return getAnimationDataSize();
+}
+
+size_t SkinnedMesh::getAnimationDataSize() const
+{
+	size_t size = 0;
+	for (const auto *joint : AllJoints)
+		size += joint->keys.getDataSize();
+	for (const auto *target : MorphTargets)
+		size += target->Weights.getDataSize();
+	return size;
+}
+
+size_t SkinnedMesh::bakeAnimation(const SBakeSettings &settings)
+{
+	clearBakedAnimation();
+
+	if (!HasAnimation || settings.SamplesPerFrame <= 0.f)
+		return 0;
+
+	for (u32 i = 0; i < AllJoints.size(); ++i) {
+		if (!AllJoints[i]->keys.empty())
+			Baked.Joints.push_back(i);
+	}
+
+	if (Baked.Joints.empty())
+		return 0;
+
+	Baked.SamplesPerFrame = settings.SamplesPerFrame;
+	Baked.Interpolate = settings.Interpolate;
+
+	const u32 sampleCount = (u32)std::ceil(EndFrame * settings.SamplesPerFrame) + 1;
+	Baked.Matrices.resize(sampleCount * Baked.Joints.size() * BAKED_MATRIX_SIZE);
+
+	SPose pose;
+	resetPose(pose);
+
+	f32 *out = Baked.Matrices.data();
+	for (u32 sample = 0; sample < sampleCount; ++sample) {
+		buildAllLocalAnimatedMatrices(pose, sample / settings.SamplesPerFrame);
+
+		for (u32 i : Baked.Joints) {
+			const f32 *m = pose.LocalMatrices[i].pointer();
+			for (u32 column = 0; column < 4; ++column) {
+				for (u32 k = 0; k < 3; ++k)
+					*out++ = m[column * 4 + k];
+			}
+		}
+	}
+
+	if (settings.Quantize) {
+		const u32 stride = Baked.Joints.size() * BAKED_MATRIX_SIZE;
+		Baked.Ranges.resize(stride * 2);
+		Baked.Quantized.resize(Baked.Matrices.size());
+
+		for (u32 e = 0; e < stride; ++e) {
+			f32 min = Baked.Matrices[e];
+			f32 max = min;
+			for (u32 sample = 1; sample < sampleCount; ++sample) {
+				const f32 value = Baked.Matrices[sample * stride + e];
+				min = std::min(min, value);
+				max = std::max(max, value);
+			}
+
+			const f32 step = (max - min) / 65535.f;
+			Baked.Ranges[e * 2] = min;
+			Baked.Ranges[e * 2 + 1] = step;
+
+			for (u32 sample = 0; sample < sampleCount; ++sample) {
+				const f32 value = Baked.Matrices[sample * stride + e];
+				Baked.Quantized[sample * stride + e] = step > 0.f ?
+						(u16)core::clamp(std::round((value - min) / step), 0.f, 65535.f) : 0;
+			}
+		}
+
+		Baked.Matrices.clear();
+		Baked.Matrices.shrink_to_fit();
+	}
+
+	// set last, poses are animated from the keys until the table is complete
+	Baked.SampleCount = sampleCount;
+	Pose.Frame = -1.f;
+
+	return Baked.Matrices.size() * sizeof(f32) +
+			Baked.Quantized.size() * sizeof(u16) + Baked.Ranges.size() * sizeof(f32);
+}
+
+void SkinnedMesh::clearBakedAnimation()
+{
+	Baked = SBakedAnimation();
+	Pose.Frame = -1.f;
+}
+
+SkinnedMesh::SAnimationBenchmarkResult SkinnedMesh::benchmarkAnimation(u32 poseCount, const SBakeSettings &settings)
+{
+	typedef std::chrono::steady_clock Clock;
+	SAnimationBenchmarkResult result;
+
+	if (!HasAnimation || poseCount == 0)
+		return result;
+
+	// keep a table baked by the user
+	SBakedAnimation previous;
+	std::swap(previous, Baked);
+
+	result.TableSize = bakeAnimation(settings);
+	if (result.TableSize != 0) {
+		// frames between the samples, where blending is needed
+		std::vector<f32> frames(poseCount);
+		for (u32 i = 0; i < poseCount; ++i)
+			frames[i] = EndFrame * (i + 0.37f) / poseCount;
+
+		SPose live, baked;
+		resetPose(live);
+		resetPose(baked);
+
+		{
+			const auto start = Clock::now();
+			for (f32 frame : frames)
+				buildAllLocalAnimatedMatrices(live, frame);
+			const std::chrono::duration<f64, std::micro> time = Clock::now() - start;
+			result.LiveMicroseconds = time.count() / poseCount;
+		}
+
+		{
+			const auto start = Clock::now();
+			for (f32 frame : frames)
+				buildBakedLocalMatrices(baked, frame);
+			const std::chrono::duration<f64, std::micro> time = Clock::now() - start;
+			result.BakedMicroseconds = time.count() / poseCount;
+		}
+
+		if (result.BakedMicroseconds > 0.0)
+			result.Speedup = result.LiveMicroseconds / result.BakedMicroseconds;
+
+		for (f32 frame : frames) {
+			buildAllLocalAnimatedMatrices(live, frame);
+			buildBakedLocalMatrices(baked, frame);
+
+			for (u32 i : Baked.Joints) {
+				for (u32 k = 0; k < 16; ++k)
+					result.MaxError = std::max(result.MaxError,
+							std::fabs(live.LocalMatrices[i][k] - baked.LocalMatrices[i][k]));
+			}
+		}
+	}
+
+	std::swap(previous, Baked);
+	Pose.Frame = -1.f;
+	return result;
+}
+
+void SkinnedMesh::buildAllGlobalAnimatedMatrices(SPose &pose) const
+{
+	// parents come first, so their global matrix is always ready
+	for (u32 i : JointOrder) {
+		const s32 parent = JointParents[i];
+
+		if (parent < 0 || pose.GlobalSkinningSpace[i])
+			pose.GlobalMatrices[i] = pose.LocalMatrices[i];
 		else
-			joint->GlobalAnimatedMatrix = parentJoint->GlobalAnimatedMatrix * joint->LocalAnimatedMatrix;
+			pose.GlobalMatrices[i] = pose.GlobalMatrices[parent] * pose.LocalMatrices[i];
 	}
+}
 
-	for (auto *childJoint : joint->Children)
-		buildAllGlobalAnimatedMatrices(childJoint, joint);
+void SkinnedMesh::buildJointHierarchy()
+{
+	JointParents.assign(AllJoints.size(), -1);
+	JointOrder.clear();
+
+	std::unordered_map<const SJoint *, u32> indices;
+	for (u32 i = 0; i < AllJoints.size(); ++i)
+		indices[AllJoints[i]] = i;
+
+	// depth first from the roots
+	std::vector<u32> stack;
+	for (auto it = RootJoints.rbegin(); it != RootJoints.rend(); ++it) {
+		const auto found = indices.find(*it);
+		if (found != indices.end())
+			stack.push_back(found->second);
+	}
+
+	while (!stack.empty()) {
+		const u32 i = stack.back();
+		stack.pop_back();
+		JointOrder.push_back(i);
+
+		const auto &children = AllJoints[i]->Children;
+		for (auto it = children.rbegin(); it != children.rend(); ++it) {
+			const auto found = indices.find(*it);
+			if (found == indices.end())
+				continue;
+
+			JointParents[found->second] = i;
+			stack.push_back(found->second);
+		}
+	}
 }
 
 //--------------------------------------------------------------------------
@@ -180,84 +805,583 @@ void SkinnedMesh::buildAllGlobalAnimatedMatrices(SJoint *joint, SJoint *parentJo
 //! Preforms a software skin on this mesh based of joint positions
 void SkinnedMesh::skinMesh()
 {
-	if (!HasAnimation || SkinnedLastFrame)
+	skinPose(Pose, LocalBuffers, BoundingBox);
+}
+
+//! Updates the global and skinning matrices of a pose and skins mesh buffers with it
+void SkinnedMesh::skinPose(SPose &pose, const std::vector<SSkinMeshBuffer *> &buffers,
+		core::aabbox3df &box) const
+{
+	if (!HasAnimation || pose.Skinned)
 		return;
 
-	//----------------
-	// This is marked as "Temp!".  A shiny dubloon to whomever can tell me why.
-	buildAllGlobalAnimatedMatrices();
-	//-----------------
+	if (pose.LocalMatrices.size() != AllJoints.size() || pose.MorphWeights.size() != MorphTargets.size())
+		resetPose(pose);
+
+	buildAllGlobalAnimatedMatrices(pose);
+	buildJointTransformations(pose, buffers);
+
+	// the rest pose of the skinning
+	morphPose(pose, buffers);
+
+	pose.Skinned = true;
 
-	SkinnedLastFrame = true;
 	if (!HardwareSkinning) {
-		// rigid animation
-		for (auto *joint : AllJoints) {
-			for (u32 attachedMeshIdx : joint->AttachedMeshes) {
-				SSkinMeshBuffer *Buffer = (*SkinningBuffers)[attachedMeshIdx];
-				Buffer->Transformation = joint->GlobalAnimatedMatrix;
+		const auto skinRanges = [&](u32 begin, u32 end) {
+			for (u32 i = begin; i < end; ++i) {
+				const SSkinningRange &range = SkinningRanges[i];
+				const SSkinLayout &layout = SkinLayouts[range.Layout];
+				pose.RangeBoxes[i] = skinVertices(layout, pose, buffers[layout.Buffer], range.Begin, range.End);
+			}
+		};
+
+		if (g_irrjobs && SkinningRanges.size() > 1)
+			g_irrjobs->parallelFor(0, SkinningRanges.size(), 1, skinRanges);
+		else
+			skinRanges(0, SkinningRanges.size());
+
+		if (ConservativeBounds) {
+			for (const auto &layout : SkinLayouts) {
+				SSkinMeshBuffer *buffer = buffers[layout.Buffer];
+				buffer->BoundingBox = getConservativeBox(layout, pose);
+				buffer->BoundingBoxNeedsRecalculated = false;
+			}
+		} else {
+			// merge the boxes of the ranges, the ranges of a layout are consecutive
+			for (u32 i = 0; i < SkinningRanges.size(); ++i) {
+				const SSkinningRange &range = SkinningRanges[i];
+				const SSkinLayout &layout = SkinLayouts[range.Layout];
+				SSkinMeshBuffer *buffer = buffers[layout.Buffer];
+
+				if (range.Begin == 0) {
+					buffer->BoundingBox = pose.RangeBoxes[i];
+
+					// vertices without weights keep their rest position
+					if (layout.HasUnweighted)
+						buffer->BoundingBox.addInternalBox(layout.UnweightedBox);
+				} else {
+					buffer->BoundingBox.addInternalBox(pose.RangeBoxes[i]);
+				}
+				buffer->BoundingBoxNeedsRecalculated = false;
 			}
 		}
 
-		// clear skinning helper array
-		for (std::vector<char> &buf : Vertices_Moved)
-			std::fill(buf.begin(), buf.end(), false);
+		// buffers without weights may share their vertices with the mesh
+		for (const auto &layout : SkinLayouts)
+			buffers[layout.Buffer]->setDirty(EBF_VERTEX);
+	} else {
+		// The shaders move the vertices, so only the bounding boxes are updated.
+		for (const auto &layout : SkinLayouts) {
+			SSkinMeshBuffer *buffer = buffers[layout.Buffer];
+			buffer->BoundingBox = getConservativeBox(layout, pose);
+			buffer->BoundingBoxNeedsRecalculated = false;
+		}
+	}
 
-		// skin starting with the root joints
-		for (auto *rootJoint : RootJoints)
-			skinJoint(rootJoint, 0);
+	calculateBoundingBox(buffers, box);
+}
 
-		for (auto *buffer : *SkinningBuffers)
-			buffer->setDirty(EBF_VERTEX);
+//! Updates the joint matrices of a pose and a bounding box enclosing it, without skinning
+void SkinnedMesh::boundPose(SPose &pose, const std::vector<SSkinMeshBuffer *> &buffers,
+		core::aabbox3df &box) const
+{
+	if (!HasAnimation || pose.Skinned)
+		return;
+
+	if (pose.LocalMatrices.size() != AllJoints.size() || pose.MorphWeights.size() != MorphTargets.size())
+		resetPose(pose);
+
+	buildAllGlobalAnimatedMatrices(pose);
+	buildJointTransformations(pose, buffers);
+
+	// The vertices are left alone, so the boxes of the buffers are kept as well.
+	// Morph targets aren't accumulated either, the boxes include their range.
+	box.reset(0, 0, 0);
+	for (u32 i = 0; i < buffers.size(); ++i) {
+		SSkinMeshBuffer *buffer = buffers[i];
+		core::aabbox3df bb{{0, 0, 0}};
+
+		if (const SSkinLayout *layout = getSkinLayout(i)) {
+			bb = getConservativeBox(*layout, pose);
+		} else if (const SMorphBuffer *morph = getMorphBuffer(i)) {
+			bb = morph->Bounds;
+		} else {
+			buffer->recalculateBoundingBox();
+			bb = buffer->BoundingBox;
+		}
+
+		buffer->Transformation.transformBoxEx(bb);
+		box.addInternalBox(bb);
+	}
+}
+
+//! Sets the transformations of rigidly animated buffers and the skinning matrices
+void SkinnedMesh::buildJointTransformations(SPose &pose, const std::vector<SSkinMeshBuffer *> &buffers) const
+{
+	// rigid animation
+	for (u32 i = 0; i < AllJoints.size(); ++i) {
+		for (u32 attachedMeshIdx : AllJoints[i]->AttachedMeshes)
+			buffers[attachedMeshIdx]->Transformation = pose.GlobalMatrices[i];
+	}
+
+	// Find each joints pull on vertices...
+	// Note: It is assumed that the global inversed matrix has been calculated at this point.
+	for (u32 i = 0; i < AllJoints.size(); ++i) {
+		const SJoint *joint = AllJoints[i];
+		if (!joint->Weights.empty())
+			pose.SkinningMatrices[i] = pose.GlobalMatrices[i] * joint->GlobalInversedMatrix.value();
 	}
-	updateBoundingBox();
 }
 
-void SkinnedMesh::skinJoint(SJoint *joint, SJoint *parentJoint)
+//! Returns a box enclosing the vertices of a layout skinned with a pose
+core::aabbox3df SkinnedMesh::getConservativeBox(const SSkinLayout &layout, const SPose &pose) const
 {
-	if (joint->Weights.size()) {
-		// Find this joints pull on vertices...
-		// Note: It is assumed that the global inversed matrix has been calculated at this point.
-		core::matrix4 jointVertexPull = joint->GlobalAnimatedMatrix * joint->GlobalInversedMatrix.value();
+	// A skinned vertex is a weighted average of its position transformed by
+	// each of its joints, so it stays within the convex hull of the joint
+	// boxes containing it, placed by the global matrices of the joints.
+	core::aabbox3df box = layout.UnweightedBox;
+
+	for (u32 i = 0; i < layout.UsedJoints.size(); ++i) {
+		core::aabbox3df jointBox = layout.JointBoxes[i];
+		pose.GlobalMatrices[layout.UsedJoints[i]].transformBoxEx(jointBox);
+
+		// vertices without weights keep their rest position
+		if (i == 0 && !layout.HasUnweighted)
+			box = jointBox;
+		else
+			box.addInternalBox(jointBox);
+	}
+	return box;
+}
 
-		core::vector3df thisVertexMove, thisNormalMove;
+const SkinnedMesh::SSkinLayout *SkinnedMesh::getSkinLayout(u32 buffer) const
+{
+	for (const auto &layout : SkinLayouts) {
+		if (layout.Buffer == buffer)
+			return &layout;
+	}
+	return nullptr;
+}
+
+//! Builds MorphBuffers from the morph targets and the vertices
+void SkinnedMesh::buildMorphBuffers()
+{
+	MorphBuffers.clear();
 
-		auto &buffersUsed = *SkinningBuffers;
+	for (u32 t = 0; t < MorphTargets.size(); ++t) {
+		const u32 bufferId = MorphTargets[t]->Buffer;
+		auto it = std::find_if(MorphBuffers.begin(), MorphBuffers.end(),
+				[bufferId](const SMorphBuffer &morph) { return morph.Buffer == bufferId; });
 
-		// Skin Vertices Positions and Normals...
-		for (const auto &weight : joint->Weights) {
-			// Pull this vertex...
-			jointVertexPull.transformVect(thisVertexMove, weight.StaticPos);
+		if (it == MorphBuffers.end()) {
+			MorphBuffers.emplace_back();
+			it = MorphBuffers.end() - 1;
+			it->Buffer = bufferId;
+		}
+		it->Targets.push_back(t);
+	}
+
+	for (auto &morph : MorphBuffers) {
+		SSkinMeshBuffer *buffer = LocalBuffers[morph.Buffer];
+		const u32 count = buffer->getVertexCount();
+
+		morph.RestPositions.assign(count * 4, 0.f);
+		morph.RestNormals.assign(count * 4, 0.f);
+		morph.DeltaMin.assign(count * 4, 0.f);
+		morph.DeltaMax.assign(count * 4, 0.f);
+
+		for (u32 id = 0; id < count; ++id) {
+			const scene::Vertex3D *vertex = buffer->getVertex(id);
+			f32 *pos = &morph.RestPositions[id * 4];
+			f32 *normal = &morph.RestNormals[id * 4];
+			pos[0] = vertex->Pos.X, pos[1] = vertex->Pos.Y, pos[2] = vertex->Pos.Z;
+			normal[0] = vertex->Normal.X, normal[1] = vertex->Normal.Y, normal[2] = vertex->Normal.Z;
+		}
+
+		// each target moves a vertex at most by its whole delta
+		for (u32 t : morph.Targets) {
+			const SMorphTarget *target = MorphTargets[t];
+			for (u32 i = 0; i < target->VertexIds.size(); ++i) {
+				const u32 id = target->VertexIds[i];
+				for (u32 c = 0; c < 3; ++c) {
+					const f32 delta = target->PositionDeltas[i * 4 + c];
+					morph.DeltaMin[id * 4 + c] += std::min(delta, 0.f);
+					morph.DeltaMax[id * 4 + c] += std::max(delta, 0.f);
+				}
+			}
+		}
+
+		morph.Bounds.reset(0, 0, 0);
+		for (u32 id = 0; id < count; ++id) {
+			const f32 *pos = &morph.RestPositions[id * 4];
+			const f32 *min = &morph.DeltaMin[id * 4];
+			const f32 *max = &morph.DeltaMax[id * 4];
+			const core::vector3df low(pos[0] + min[0], pos[1] + min[1], pos[2] + min[2]);
+			const core::vector3df high(pos[0] + max[0], pos[1] + max[1], pos[2] + max[2]);
+
+			if (id == 0)
+				morph.Bounds.reset(low);
+			else
+				morph.Bounds.addInternalPoint(low);
+			morph.Bounds.addInternalPoint(high);
+		}
+	}
+}
+
+const SkinnedMesh::SMorphBuffer *SkinnedMesh::getMorphBuffer(u32 buffer) const
+{
+	for (const auto &morph : MorphBuffers) {
+		if (morph.Buffer == buffer)
+			return &morph;
+	}
+	return nullptr;
+}
+
+//! Accumulates the active morph targets of a pose into its morphed vertices
+void SkinnedMesh::morphPose(SPose &pose, const std::vector<SSkinMeshBuffer *> &buffers) const
+{
+	struct SActiveTarget
+	{
+		const SMorphTarget *Target;
+		f32 Weight;
+	};
+	std::vector<SActiveTarget> active;
+
+	for (u32 b = 0; b < MorphBuffers.size(); ++b) {
+		const SMorphBuffer &morph = MorphBuffers[b];
+
+		bool changed = false;
+		for (u32 t : morph.Targets)
+			changed |= pose.MorphWeights[t] != pose.AppliedMorphWeights[t];
+		if (!changed)
+			continue;
+
+		const u32 vertexCount = morph.RestPositions.size() / 4;
+
+		// targets without weight cost nothing
+		active.clear();
+		size_t work = vertexCount;
+		for (u32 t : morph.Targets) {
+			const f32 weight = pose.MorphWeights[t];
+			pose.AppliedMorphWeights[t] = weight;
+
+			if (std::fabs(weight) > 1e-6f) {
+				active.push_back({MorphTargets[t], weight});
+				work += MorphTargets[t]->VertexIds.size();
+			}
+		}
+
+		std::vector<f32> &positions = pose.MorphedPositions[b];
+		std::vector<f32> &normals = pose.MorphedNormals[b];
+		positions.resize(morph.RestPositions.size());
+		normals.resize(morph.RestNormals.size());
+
+		const auto morphRange = [&](u32 begin, u32 end) {
+			std::copy(morph.RestPositions.begin() + begin * 4, morph.RestPositions.begin() + end * 4,
+					positions.begin() + begin * 4);
+			std::copy(morph.RestNormals.begin() + begin * 4, morph.RestNormals.begin() + end * 4,
+					normals.begin() + begin * 4);
+
+			for (const auto &entry : active) {
+				const SMorphTarget *target = entry.Target;
+				const auto &ids = target->VertexIds;
+
+				// the deltas are sorted by vertex id
+				const u32 first = std::lower_bound(ids.begin(), ids.end(), begin) - ids.begin();
+				const u32 last = std::lower_bound(ids.begin() + first, ids.end(), end) - ids.begin();
+				if (first == last)
+					continue;
+
+				accumulateMorphDeltas(positions.data(), &ids[first], &target->PositionDeltas[first * 4],
+						last - first, entry.Weight);
+				if (!target->NormalDeltas.empty())
+					accumulateMorphDeltas(normals.data(), &ids[first], &target->NormalDeltas[first * 4],
+							last - first, entry.Weight);
+			}
+		};
+
+		if (g_irrjobs && work > MORPH_RANGE_SIZE * 2)
+			g_irrjobs->parallelFor(0, vertexCount, MORPH_RANGE_SIZE, morphRange);
+		else
+			morphRange(0, vertexCount);
+
+		// Vertices skinned on the CPU read the morphed arrays, the others
+		// show the morphed rest pose.
+		const SSkinLayout *layout = getSkinLayout(morph.Buffer);
+		if (layout && !HardwareSkinning && !layout->HasUnweighted)
+			continue;
+
+		SSkinMeshBuffer *buffer = buffers[morph.Buffer];
+		for (u32 id = 0; id < vertexCount; ++id) {
+			scene::Vertex3D *vertex = buffer->getVertex(id);
+			const f32 *pos = &positions[id * 4];
+			vertex->Pos.set(pos[0], pos[1], pos[2]);
 
 			if (AnimateNormals) {
-				thisNormalMove = jointVertexPull.rotateAndScaleVect(weight.StaticNormal);
-				thisNormalMove.normalize(); // must renormalize after potentially scaling
+				const f32 *normal = &normals[id * 4];
+				vertex->Normal.set(normal[0], normal[1], normal[2]);
+				vertex->Normal.normalize();
+			}
+		}
+
+		buffer->boundingBoxNeedsRecalculated();
+		buffer->setDirty(EBF_VERTEX);
+	}
+}
+
+core::aabbox3df SkinnedMesh::skinVertices(const SSkinLayout &layout, const SPose &pose,
+		SSkinMeshBuffer *buffer, u32 begin, u32 end) const
+{
+	SSkinningStreams streams;
+	streams.VertexIds = layout.VertexIds.data();
+	streams.PosX = layout.PosX.data();
+	streams.PosY = layout.PosY.data();
+	streams.PosZ = layout.PosZ.data();
+	streams.NormalX = layout.NormalX.data();
+	streams.NormalY = layout.NormalY.data();
+	streams.NormalZ = layout.NormalZ.data();
+	streams.Joints = layout.Joints.data();
+	streams.Weights = layout.Weights.data();
+	streams.Palette = pose.SkinningMatrices.data();
+	streams.MorphedPositions = nullptr;
+	streams.MorphedNormals = nullptr;
+	if (const SMorphBuffer *morph = getMorphBuffer(layout.Buffer)) {
+		const size_t index = morph - MorphBuffers.data();
+		streams.MorphedPositions = pose.MorphedPositions[index].data();
+		streams.MorphedNormals = pose.MorphedNormals[index].data();
+	}
+	streams.Vertices = reinterpret_cast<u8 *>(buffer->getVertex(0));
+	streams.Stride = getVertexTypeDescription(buffer->VertexType).Size;
+	streams.Normals = AnimateNormals;
+
+	core::aabbox3df box{{0, 0, 0}};
+	if (ConservativeBounds) {
+		if (layout.InfluenceCount == 4)
+			skinVertexRange<4, false>(streams, begin, end, box);
+		else
+			skinVertexRange<MAX_SKIN_INFLUENCES, false>(streams, begin, end, box);
+	} else {
+		if (layout.InfluenceCount == 4)
+			skinVertexRange<4, true>(streams, begin, end, box);
+		else
+			skinVertexRange<MAX_SKIN_INFLUENCES, true>(streams, begin, end, box);
+	}
+	return box;
+}
+
+void SkinnedMesh::buildSkinLayouts()
+{
+	SkinLayouts.clear();
+
+	struct SInfluence
+	{
+		u16 Buffer;
+		u32 Vertex;
+		u16 Joint;
+		f32 Weight;
+	};
+
+	std::vector<SInfluence> influences;
+	for (u32 j = 0; j < AllJoints.size(); ++j) {
+		for (const auto &weight : AllJoints[j]->Weights)
+			influences.push_back({weight.buffer_id, weight.vertex_id, (u16)j, weight.strength});
+	}
+
+	// group by vertex, strongest influence first
+	std::sort(influences.begin(), influences.end(), [](const SInfluence &a, const SInfluence &b) {
+		if (a.Buffer != b.Buffer)
+			return a.Buffer < b.Buffer;
+		if (a.Vertex != b.Vertex)
+			return a.Vertex < b.Vertex;
+		return a.Weight > b.Weight;
+	});
+
+	// returns the end of the influences of the vertex starting at i
+	const auto vertexEnd = [&influences](size_t i) {
+		size_t next = i + 1;
+		while (next < influences.size() && influences[next].Buffer == influences[i].Buffer &&
+				influences[next].Vertex == influences[i].Vertex)
+			++next;
+		return next;
+	};
+
+	bool truncated = false;
+
+	for (size_t first = 0; first < influences.size();) {
+		const u16 bufferId = influences[first].Buffer;
+
+		// the most influences of a vertex decide the layout of the buffer
+		size_t last = first;
+		size_t maxCount = 0;
+		while (last < influences.size() && influences[last].Buffer == bufferId) {
+			const size_t next = vertexEnd(last);
+			maxCount = std::max(maxCount, next - last);
+			last = next;
+		}
+
+		SSkinLayout layout;
+		layout.Buffer = bufferId;
+		layout.InfluenceCount = maxCount > 4 ? MAX_SKIN_INFLUENCES : 4;
+		truncated |= maxCount > MAX_SKIN_INFLUENCES;
+
+		SSkinMeshBuffer *buffer = LocalBuffers[bufferId];
+
+		for (size_t i = first; i < last;) {
+			const size_t next = vertexEnd(i);
+			const u32 count = std::min<u32>(next - i, layout.InfluenceCount);
+
+			f32 total = 0.f;
+			for (u32 k = 0; k < count; ++k)
+				total += influences[i + k].Weight;
+
+			// exporters write vertices with only zero weights, they follow their first joint
+			const bool unweighted = !(total > 0.f);
+
+			// truncated vertices get their kept weights scaled to a sum of 1,
+			// the others use their weights as given
+			const f32 scale = next - i > count ? 1.f / total : 1.f;
+
+			const u32 vertexId = influences[i].Vertex;
+			const scene::Vertex3D *vertex = buffer->getVertex(vertexId);
+
+			layout.VertexIds.push_back(vertexId);
+			layout.PosX.push_back(vertex->Pos.X);
+			layout.PosY.push_back(vertex->Pos.Y);
+			layout.PosZ.push_back(vertex->Pos.Z);
+			layout.NormalX.push_back(vertex->Normal.X);
+			layout.NormalY.push_back(vertex->Normal.Y);
+			layout.NormalZ.push_back(vertex->Normal.Z);
+
+			for (u32 k = 0; k < layout.InfluenceCount; ++k) {
+				f32 weight = 0.f;
+				if (k < count)
+					weight = unweighted ? (k == 0 ? 1.f : 0.f) : influences[i + k].Weight * scale;
+
+				layout.Joints.push_back(k < count ? influences[i + k].Joint : 0);
+				layout.Weights.push_back(weight);
 			}
 
-			if (!(*(weight.Moved))) {
-				*(weight.Moved) = true;
+			i = next;
+		}
 
-				buffersUsed[weight.buffer_id]->getVertex(weight.vertex_id)->Pos = thisVertexMove * weight.strength;
+		for (u32 k = 0; k < layout.Joints.size(); ++k) {
+			if (layout.Weights[k] != 0.f)
+				layout.UsedJoints.push_back(layout.Joints[k]);
+		}
+		std::sort(layout.UsedJoints.begin(), layout.UsedJoints.end());
+		layout.UsedJoints.erase(std::unique(layout.UsedJoints.begin(), layout.UsedJoints.end()), layout.UsedJoints.end());
 
-				if (AnimateNormals)
-					buffersUsed[weight.buffer_id]->getVertex(weight.vertex_id)->Normal = thisNormalMove * weight.strength;
+		buffer->boundingBoxNeedsRecalculated();
+		buffer->recalculateBoundingBox();
+		layout.RestBox = buffer->BoundingBox;
 
-				//*(weight._Pos) = thisVertexMove * weight.strength;
-			} else {
-				buffersUsed[weight.buffer_id]->getVertex(weight.vertex_id)->Pos += thisVertexMove * weight.strength;
+		SkinLayouts.push_back(std::move(layout));
+		first = last;
+	}
 
-				if (AnimateNormals)
-					buffersUsed[weight.buffer_id]->getVertex(weight.vertex_id)->Normal += thisNormalMove * weight.strength;
+	// split the layouts into vertex ranges, which are independent of each other
+	SkinningRanges.clear();
+	for (u32 i = 0; i < SkinLayouts.size(); ++i) {
+		const u32 count = SkinLayouts[i].VertexIds.size();
+		for (u32 begin = 0; begin < count; begin += SKINNING_RANGE_SIZE)
+			SkinningRanges.push_back({i, begin, std::min(begin + SKINNING_RANGE_SIZE, count)});
+	}
 
-				//*(weight._Pos) += thisVertexMove * weight.strength;
+	if (truncated)
+		g_irrlogger->log("Skinned Mesh: Vertices with more than 8 weights only keep the strongest ones", ELL_WARNING);
+}
+
+//! Builds the joint boxes of the layouts from their rest pose
+void SkinnedMesh::buildJointBounds()
+{
+	// Morphed vertices are bounded by their rest position plus the deltas
+	// of their targets, so the boxes hold for weights within [0, 1].
+	const auto morphRange = [](const SMorphBuffer *morph, u32 id, const core::vector3df &pos) {
+		core::aabbox3df range(pos);
+		if (morph) {
+			const f32 *min = &morph->DeltaMin[id * 4];
+			const f32 *max = &morph->DeltaMax[id * 4];
+			range.reset(pos + core::vector3df(min[0], min[1], min[2]));
+			range.addInternalPoint(pos + core::vector3df(max[0], max[1], max[2]));
+		}
+		return range;
+	};
+
+	for (auto &layout : SkinLayouts) {
+		SSkinMeshBuffer *buffer = LocalBuffers[layout.Buffer];
+		const SMorphBuffer *morph = getMorphBuffer(layout.Buffer);
+		const u32 stride = layout.InfluenceCount;
+
+		std::vector<bool> used(layout.UsedJoints.size(), false);
+		layout.JointBoxes.assign(layout.UsedJoints.size(), core::aabbox3df{{0, 0, 0}});
+
+		for (u32 v = 0; v < layout.VertexIds.size(); ++v) {
+			const core::vector3df pos(layout.PosX[v], layout.PosY[v], layout.PosZ[v]);
+			const core::aabbox3df range = morphRange(morph, layout.VertexIds[v], pos);
+
+			for (u32 k = 0; k < stride && layout.Weights[v * stride + k] != 0.f; ++k) {
+				const u16 joint = layout.Joints[v * stride + k];
+				const u32 i = std::lower_bound(layout.UsedJoints.begin(), layout.UsedJoints.end(), joint) -
+						layout.UsedJoints.begin();
+
+				// rest position in the space of the joint
+				core::aabbox3df local = range;
+				if (morph) {
+					AllJoints[joint]->GlobalInversedMatrix->transformBoxEx(local);
+				} else {
+					AllJoints[joint]->GlobalInversedMatrix->transformVect(local.MinEdge);
+					local.MaxEdge = local.MinEdge;
+				}
+
+				if (used[i])
+					layout.JointBoxes[i].addInternalBox(local);
+				else
+					layout.JointBoxes[i] = local;
+				used[i] = true;
 			}
+		}
 
-			buffersUsed[weight.buffer_id]->boundingBoxNeedsRecalculated();
+		// vertices without weights are never moved
+		std::vector<bool> weighted(buffer->getVertexCount(), false);
+		for (u32 id : layout.VertexIds)
+			weighted[id] = true;
+
+		layout.HasUnweighted = false;
+		layout.UnweightedBox.reset(0, 0, 0);
+		for (u32 id = 0; id < weighted.size(); ++id) {
+			if (weighted[id])
+				continue;
+
+			const core::aabbox3df range = morphRange(morph, id, buffer->getVertex(id)->Pos);
+			if (layout.HasUnweighted)
+				layout.UnweightedBox.addInternalBox(range);
+			else
+				layout.UnweightedBox = range;
+			layout.HasUnweighted = true;
 		}
 	}
+}
 
-	// Skin all children
-	for (auto *childJoint : joint->Children)
-		skinJoint(childJoint, joint);
+//! Uses boxes built from the joints for skinned buffers, instead of their vertices
+void SkinnedMesh::setConservativeBounds(bool on)
+{
+	ConservativeBounds = on;
+	Pose.Skinned = false;
+}
+
+void SkinnedMesh::copyRestPoseToBuffers()
+{
+	for (const auto &layout : SkinLayouts) {
+		SSkinMeshBuffer *buffer = LocalBuffers[layout.Buffer];
+
+		for (u32 v = 0; v < layout.VertexIds.size(); ++v) {
+			scene::Vertex3D *vertex = buffer->getVertex(layout.VertexIds[v]);
+			vertex->Pos.set(layout.PosX[v], layout.PosY[v], layout.PosZ[v]);
+			vertex->Normal.set(layout.NormalX[v], layout.NormalY[v], layout.NormalZ[v]);
+		}
+
+		buffer->boundingBoxNeedsRecalculated();
+	}
 }
 
 //! Gets joint count.
@@ -287,6 +1411,17 @@ std::optional<u32> SkinnedMesh::getJointNumber(const std::string &name) const
 	return std::nullopt;
 }
 
+//! Returns the index of a morph target by its name
+std::optional<u32> SkinnedMesh::getMorphTargetNumber(const std::string &name) const
+{
+	for (u32 i = 0; i < MorphTargets.size(); ++i) {
+		if (MorphTargets[i]->Name == name)
+			return i;
+	}
+
+	return std::nullopt;
+}
+
 //! returns amount of mesh buffers.
 u32 SkinnedMesh::getMeshBufferCount() const
 {
@@ -335,55 +1470,120 @@ void SkinnedMesh::setDirty(u8 buffer)
 		LocalBuffers[i]->setDirty(buffer);
 }
 
-//! (This feature is not implemented in irrlicht yet)
+bool SkinnedMesh::hasSkinnedVertices(u32 nr) const
+{
+	if (getMorphBuffer(nr))
+		return true;
+
+	if (HardwareSkinning)
+		return false;
+
+	return getSkinLayout(nr) != nullptr;
+}
+
+//! Moves the skinning of the vertices into the shaders
 bool SkinnedMesh::setHardwareSkinning(bool on)
 {
-	if (HardwareSkinning != on) {
-		if (on) {
+	if (HardwareSkinning == on)
+		return HardwareSkinning;
 
-			// set mesh to static pose...
-			for (auto *joint : AllJoints) {
-				for (const auto &weight : joint->Weights) {
-					const u16 buffer_id = weight.buffer_id;
-					const u32 vertex_id = weight.vertex_id;
-					LocalBuffers[buffer_id]->getVertex(vertex_id)->Pos = weight.StaticPos;
-					LocalBuffers[buffer_id]->getVertex(vertex_id)->Normal = weight.StaticNormal;
-					LocalBuffers[buffer_id]->boundingBoxNeedsRecalculated();
+	if (on) {
+		if (AllJoints.size() > MAX_HARDWARE_SKINNING_JOINTS) {
+			g_irrlogger->log("Skinned Mesh: Too many joints for hardware skinning", ELL_WARNING);
+			return false;
+		}
+
+		for (const auto &layout : SkinLayouts) {
+			if (LocalBuffers[layout.Buffer]->getVertexType() != EVT_3D) {
+				g_irrlogger->log("Skinned Mesh: Hardware skinning needs buffers with standard vertices", ELL_WARNING);
+				return false;
+			}
+		}
+
+		// set mesh to static pose...
+		copyRestPoseToBuffers();
+
+		bool truncated = false;
+
+		// store the strongest joints in the vertices
+		for (const auto &layout : SkinLayouts) {
+			SSkinMeshBuffer *buffer = LocalBuffers[layout.Buffer];
+			buffer->convertToSkinned();
+
+			const u32 stride = layout.InfluenceCount;
+			const u32 count = std::min<u32>(stride, 4);
+
+			for (u32 v = 0; v < layout.VertexIds.size(); ++v) {
+				scene::VertexSkinned &vertex = buffer->Vertices_Skinned->Data[layout.VertexIds[v]];
+				const u16 *joints = &layout.Joints[v * stride];
+				const f32 *weights = &layout.Weights[v * stride];
+
+				// like in the layouts, only the weights of truncated vertices are rescaled
+				const bool dropped = stride > 4 && weights[4] != 0.f;
+				truncated |= dropped;
+
+				f32 total = 0.f;
+				for (u32 k = 0; k < count; ++k)
+					total += weights[k];
+
+				const f32 scale = dropped ? 1.f / total : 1.f;
+				for (u32 k = 0; k < count; ++k) {
+					vertex.Joints[k] = (u8)joints[k];
+					vertex.Weights[k] = weights[k] * scale;
 				}
 			}
+
+			buffer->setDirty(EBF_VERTEX);
 		}
 
-		HardwareSkinning = on;
+		if (truncated)
+			g_irrlogger->log("Skinned Mesh: Hardware skinning only uses the 4 strongest weights of a vertex", ELL_WARNING);
+	} else {
+		for (const auto &layout : SkinLayouts) {
+			LocalBuffers[layout.Buffer]->convertToStandard();
+			LocalBuffers[layout.Buffer]->setDirty(EBF_VERTEX);
+		}
 	}
+
+	HardwareSkinning = on;
+	Pose.Skinned = false;
+
+	// the buffers were reset to the rest pose, morph them again
+	Pose.AppliedMorphWeights.assign(MorphTargets.size(), std::numeric_limits<f32>::quiet_NaN());
+	++Revision;
 	return HardwareSkinning;
 }
 
 void SkinnedMesh::refreshJointCache()
 {
 	// copy cache from the mesh...
-	for (auto *joint : AllJoints) {
-		for (auto &weight : joint->Weights) {
-			const u16 buffer_id = weight.buffer_id;
-			const u32 vertex_id = weight.vertex_id;
-			weight.StaticPos = LocalBuffers[buffer_id]->getVertex(vertex_id)->Pos;
-			weight.StaticNormal = LocalBuffers[buffer_id]->getVertex(vertex_id)->Normal;
+	for (auto &layout : SkinLayouts) {
+		SSkinMeshBuffer *buffer = LocalBuffers[layout.Buffer];
+
+		for (u32 v = 0; v < layout.VertexIds.size(); ++v) {
+			const scene::Vertex3D *vertex = buffer->getVertex(layout.VertexIds[v]);
+			layout.PosX[v] = vertex->Pos.X;
+			layout.PosY[v] = vertex->Pos.Y;
+			layout.PosZ[v] = vertex->Pos.Z;
+			layout.NormalX[v] = vertex->Normal.X;
+			layout.NormalY[v] = vertex->Normal.Y;
+			layout.NormalZ[v] = vertex->Normal.Z;
 		}
+
+		buffer->boundingBoxNeedsRecalculated();
+		buffer->recalculateBoundingBox();
+		layout.RestBox = buffer->BoundingBox;
 	}
+	buildMorphBuffers();
+	buildJointBounds();
+	++Revision;
 }
 
 void SkinnedMesh::resetAnimation()
 {
 	// copy from the cache to the mesh...
-	for (auto *joint : AllJoints) {
-		for (const auto &weight : joint->Weights) {
-			const u16 buffer_id = weight.buffer_id;
-			const u32 vertex_id = weight.vertex_id;
-			LocalBuffers[buffer_id]->getVertex(vertex_id)->Pos = weight.StaticPos;
-			LocalBuffers[buffer_id]->getVertex(vertex_id)->Normal = weight.StaticNormal;
-		}
-	}
-	SkinnedLastFrame = false;
-	LastAnimatedFrame = -1;
+	copyRestPoseToBuffers();
+	resetPose(Pose);
 }
 
 void SkinnedMesh::calculateGlobalMatrices(SJoint *joint, SJoint *parentJoint)
@@ -403,9 +1603,6 @@ void SkinnedMesh::calculateGlobalMatrices(SJoint *joint, SJoint *parentJoint)
 	else
 		joint->GlobalMatrix = parentJoint->GlobalMatrix * joint->LocalMatrix;
 
-	joint->LocalAnimatedMatrix = joint->LocalMatrix;
-	joint->GlobalAnimatedMatrix = joint->GlobalMatrix;
-
 	if (!joint->GlobalInversedMatrix.has_value()) { // might be pre calculated
 		joint->GlobalInversedMatrix = joint->GlobalMatrix;
 		joint->GlobalInversedMatrix->makeInverse(); // slow
@@ -413,7 +1610,6 @@ void SkinnedMesh::calculateGlobalMatrices(SJoint *joint, SJoint *parentJoint)
 
 	for (auto *childJoint : joint->Children)
 		calculateGlobalMatrices(childJoint, joint);
-	SkinnedLastFrame = false;
 }
 
 void SkinnedMesh::checkForAnimation()
@@ -437,11 +1633,17 @@ void SkinnedMesh::checkForAnimation()
 		}
 	}
 
+	// morph targets are changed through their weights, even without keys
+	if (!MorphTargets.empty())
+		HasAnimation = true;
+
 	if (HasAnimation) {
 		EndFrame = 0.0f;
 		for (const auto *joint : AllJoints) {
 			EndFrame = std::max(EndFrame, joint->keys.getEndFrame());
 		}
+		for (const auto *target : MorphTargets)
+			EndFrame = std::max(EndFrame, target->Weights.getEndFrame());
 	}
 
 	if (HasAnimation && !PreparedForSkinning) {
@@ -464,31 +1666,12 @@ void SkinnedMesh::checkForAnimation()
 			}
 		}
 
-		// An array used in skinning
-
-		for (u32 i = 0; i < Vertices_Moved.size(); ++i)
-			for (u32 j = 0; j < Vertices_Moved[i].size(); ++j)
-				Vertices_Moved[i][j] = false;
-
-		// For skinning: cache weight values for speed
-
-		for (auto *joint : AllJoints) {
-			for (auto &weight : joint->Weights) {
-				const u16 buffer_id = weight.buffer_id;
-				const u32 vertex_id = weight.vertex_id;
-
-				weight.Moved = &Vertices_Moved[buffer_id][vertex_id];
-				weight.StaticPos = LocalBuffers[buffer_id]->getVertex(vertex_id)->Pos;
-				weight.StaticNormal = LocalBuffers[buffer_id]->getVertex(vertex_id)->Normal;
-
-				// weight._Pos=&Buffers[buffer_id]->getVertex(vertex_id)->Pos;
-			}
-		}
-
 		// normalize weights
 		normalizeWeights();
+
+		// For skinning: cache the rest pose and the weights vertex by vertex
+		buildSkinLayouts();
 	}
-	SkinnedLastFrame = false;
 }
 
 //! called by loader after populating with mesh and bone data
@@ -496,10 +1679,6 @@ SkinnedMesh *SkinnedMeshBuilder::finalize()
 {
 	g_irrlogger->log("Skinned Mesh - finalize", ELL_DEBUG);
 
-	// Make sure we recalc the next frame
-	LastAnimatedFrame = -1;
-	SkinnedLastFrame = false;
-
 	// calculate bounding box
 	for (auto *buffer : LocalBuffers) {
 		buffer->recalculateBoundingBox();
@@ -527,11 +1706,9 @@ SkinnedMesh *SkinnedMeshBuilder::finalize()
 		}
 	}
 
-	// Set array sizes...
+	buildJointHierarchy();
 
-	for (u32 i = 0; i < LocalBuffers.size(); ++i) {
-		Vertices_Moved.emplace_back(LocalBuffers[i]->getVertexCount());
-	}
+	prepareMorphTargets();
 
 	checkForAnimation();
 
@@ -539,18 +1716,31 @@ SkinnedMesh *SkinnedMeshBuilder::finalize()
 		for (auto *joint : AllJoints) {
 			joint->keys.cleanup();
 		}
+		for (auto *target : MorphTargets)
+			target->Weights.cleanup();
+	}
+
+	AnimatedJoints.clear();
+	for (u32 i = 0; i < AllJoints.size(); ++i) {
+		if (!AllJoints[i]->keys.empty())
+			AnimatedJoints.push_back(i);
 	}
 
 	// Needed for animation and skinning...
 
 	calculateGlobalMatrices(0, 0);
 
+	// needs the inverse bind matrices and the morph ranges
+	buildMorphBuffers();
+	buildJointBounds();
+
+	// Make sure we recalc the next frame
+	resetPose(Pose);
+
 	// rigid animation for non animated meshes
 	for (auto *joint : AllJoints) {
-		for (u32 attachedMeshIdx : joint->AttachedMeshes) {
-			SSkinMeshBuffer *Buffer = (*SkinningBuffers)[attachedMeshIdx];
-			Buffer->Transformation = joint->GlobalAnimatedMatrix;
-		}
+		for (u32 attachedMeshIdx : joint->AttachedMeshes)
+			LocalBuffers[attachedMeshIdx]->Transformation = joint->GlobalMatrix;
 	}
 
 	// calculate bounding box
@@ -574,18 +1764,7 @@ SkinnedMesh *SkinnedMeshBuilder::finalize()
 
 void SkinnedMesh::updateBoundingBox()
 {
-	if (!SkinningBuffers)
-		return;
-
-	BoundingBox.reset(0, 0, 0);
-
-	for (auto *buffer : *SkinningBuffers) {
-		buffer->recalculateBoundingBox();
-		core::aabbox3df bb = buffer->BoundingBox;
-		buffer->Transformation.transformBoxEx(bb);
-
-		BoundingBox.addInternalBox(bb);
-	}
+	calculateBoundingBox(LocalBuffers, BoundingBox);
 }
 
 scene::SSkinMeshBuffer *SkinnedMeshBuilder::addMeshBuffer()
@@ -644,6 +1823,98 @@ SkinnedMesh::SWeight *SkinnedMeshBuilder::addWeight(SJoint *joint)
 	return &joint->Weights.back();
 }
 
+SkinnedMesh::SMorphTarget *SkinnedMeshBuilder::addMorphTarget(u32 buffer)
+{
+	SMorphTarget *target = new SMorphTarget;
+	target->Buffer = buffer;
+	MorphTargets.push_back(target);
+	return target;
+}
+
+void SkinnedMeshBuilder::addMorphDelta(SMorphTarget *target, u32 vertex,
+		const core::vector3df &position, const core::vector3df &normal)
+{
+	assert(target);
+	target->VertexIds.push_back(vertex);
+	target->PositionDeltas.insert(target->PositionDeltas.end(), {position.X, position.Y, position.Z, 0.f});
+
+	// normal deltas are only stored once a target has one
+	const bool hasNormal = normal != core::vector3df(0.f);
+	if (hasNormal && target->NormalDeltas.empty())
+		target->NormalDeltas.assign((target->VertexIds.size() - 1) * 4, 0.f);
+	if (!target->NormalDeltas.empty())
+		target->NormalDeltas.insert(target->NormalDeltas.end(), {normal.X, normal.Y, normal.Z, 0.f});
+}
+
+void SkinnedMeshBuilder::addMorphWeightKey(SMorphTarget *target, f32 frame, f32 weight)
+{
+	assert(target);
+	target->Weights.pushBack(frame, weight);
+}
+
+//! Checks the morph targets and sorts their deltas by vertex id
+void SkinnedMesh::prepareMorphTargets()
+{
+	for (auto it = MorphTargets.begin(); it != MorphTargets.end();) {
+		SMorphTarget *target = *it;
+
+		if (target->Buffer >= LocalBuffers.size()) {
+			g_irrlogger->log("Skinned Mesh: Morph target buffer id too large", ELL_WARNING);
+			delete target;
+			it = MorphTargets.erase(it);
+			continue;
+		}
+
+		const u32 vertexCount = LocalBuffers[target->Buffer]->getVertexCount();
+		const bool normals = !target->NormalDeltas.empty();
+
+		std::vector<u32> order(target->VertexIds.size());
+		for (u32 i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [target](u32 a, u32 b) {
+			return target->VertexIds[a] < target->VertexIds[b];
+		});
+
+		SMorphTarget sorted;
+		bool invalid = false;
+		for (u32 i : order) {
+			const u32 id = target->VertexIds[i];
+			if (id >= vertexCount) {
+				invalid = true;
+				continue;
+			}
+
+			// deltas of the same vertex are added up
+			if (!sorted.VertexIds.empty() && sorted.VertexIds.back() == id) {
+				f32 *pos = &sorted.PositionDeltas[sorted.PositionDeltas.size() - 4];
+				for (u32 c = 0; c < 3; ++c)
+					pos[c] += target->PositionDeltas[i * 4 + c];
+				if (normals) {
+					f32 *normal = &sorted.NormalDeltas[sorted.NormalDeltas.size() - 4];
+					for (u32 c = 0; c < 3; ++c)
+						normal[c] += target->NormalDeltas[i * 4 + c];
+				}
+				continue;
+			}
+
+			sorted.VertexIds.push_back(id);
+			sorted.PositionDeltas.insert(sorted.PositionDeltas.end(),
+					target->PositionDeltas.begin() + i * 4, target->PositionDeltas.begin() + i * 4 + 4);
+			if (normals)
+				sorted.NormalDeltas.insert(sorted.NormalDeltas.end(),
+						target->NormalDeltas.begin() + i * 4, target->NormalDeltas.begin() + i * 4 + 4);
+		}
+
+		if (invalid)
+			g_irrlogger->log("Skinned Mesh: Morph target vertex id too large", ELL_WARNING);
+
+		target->VertexIds = std::move(sorted.VertexIds);
+		target->PositionDeltas = std::move(sorted.PositionDeltas);
+		target->NormalDeltas = std::move(sorted.NormalDeltas);
+		++it;
+	}
+}
+
 void SkinnedMesh::normalizeWeights()
 {
 	// note: unsure if weights ids are going to be used.
@@ -682,34 +1953,37 @@ void SkinnedMesh::normalizeWeights()
 	}
 }
 
-void SkinnedMesh::recoverJointsFromMesh(std::vector<IBoneSceneNode *> &jointChildSceneNodes)
+void SkinnedMesh::recoverJoints(const SPose &pose, std::vector<IBoneSceneNode *> &jointChildSceneNodes) const
 {
-	for (u32 i = 0; i < AllJoints.size(); ++i) {
+	for (u32 i = 0; i < pose.LocalMatrices.size(); ++i) {
 		IBoneSceneNode *node = jointChildSceneNodes[i];
-		SJoint *joint = AllJoints[i];
-		node->setPosition(joint->LocalAnimatedMatrix.getTranslation());
-		node->setRotation(joint->LocalAnimatedMatrix.getRotationDegrees());
-		node->setScale(joint->LocalAnimatedMatrix.getScale());
+		const core::matrix4 &local = pose.LocalMatrices[i];
+		node->setPosition(local.getTranslation());
+		node->setRotation(local.getRotationDegrees());
+		node->setScale(local.getScale());
 
 		node->updateAbsolutePosition();
 	}
 }
 
-void SkinnedMesh::transferJointsToMesh(const std::vector<IBoneSceneNode *> &jointChildSceneNodes)
+void SkinnedMesh::transferJoints(SPose &pose, const std::vector<IBoneSceneNode *> &jointChildSceneNodes) const
 {
+	if (pose.LocalMatrices.size() != AllJoints.size())
+		resetPose(pose);
+
 	for (u32 i = 0; i < AllJoints.size(); ++i) {
 		const IBoneSceneNode *const node = jointChildSceneNodes[i];
-		SJoint *joint = AllJoints[i];
+		core::matrix4 &local = pose.LocalMatrices[i];
 
-		joint->LocalAnimatedMatrix.setRotationDegrees(node->getRotation());
-		joint->LocalAnimatedMatrix.setTranslation(node->getPosition());
-		joint->LocalAnimatedMatrix *= core::matrix4().setScale(node->getScale());
+		local.setRotationDegrees(node->getRotation());
+		local.setTranslation(node->getPosition());
+		local *= core::matrix4().setScale(node->getScale());
 
-		joint->GlobalSkinningSpace = (node->getSkinningSpace() == EBSS_GLOBAL);
+		pose.GlobalSkinningSpace[i] = (node->getSkinningSpace() == EBSS_GLOBAL);
 	}
 	// Make sure we recalc the next frame
-	LastAnimatedFrame = -1;
-	SkinnedLastFrame = false;
+	pose.Frame = -1.f;
+	pose.Skinned = false;
 }
 
 void SkinnedMesh::addJoints(std::vector<IBoneSceneNode *> &jointChildSceneNodes,
@@ -722,21 +1996,7 @@ void SkinnedMesh::addJoints(std::vector<IBoneSceneNode *> &jointChildSceneNodes,
 
 	// Match up parents
 	for (u32 i = 0; i < jointChildSceneNodes.size(); ++i) {
-		const SJoint *const joint = AllJoints[i]; // should be fine
-
-		s32 parentID = -1;
-
-		for (u32 j = 0; (parentID == -1) && (j < AllJoints.size()); ++j) {
-			if (i != j) {
-				const SJoint *const parentTest = AllJoints[j];
-				for (u32 n = 0; n < parentTest->Children.size(); ++n) {
-					if (parentTest->Children[n] == joint) {
-						parentID = j;
-						break;
-					}
-				}
-			}
-		}
+		const s32 parentID = JointParents[i];
 
 		IBoneSceneNode *bone = jointChildSceneNodes[i];
 		if (parentID != -1)
@@ -746,11 +2006,12 @@ void SkinnedMesh::addJoints(std::vector<IBoneSceneNode *> &jointChildSceneNodes,
 
 		bone->drop();
 	}
-	SkinnedLastFrame = false;
 }
 
 void SkinnedMesh::convertMeshToTangents()
 {
+	++Revision;
+
 	// now calculate tangents
 	for (u32 b = 0; b < LocalBuffers.size(); ++b) {
 		if (LocalBuffers[b]) {
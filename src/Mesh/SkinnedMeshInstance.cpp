@@ -0,0 +1,226 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "Mesh/SkinnedMeshInstance.h"
+#include "Mesh/SSkinMeshBuffer.h"
+
+#include <limits>
+
+namespace scene
+{
+
+//! constructor
+SkinnedMeshInstance::SkinnedMeshInstance(SkinnedMesh *mesh) :
+		Mesh(mesh), TransitionBlend(1.f), Transiting(false), TransformsValid(false),
+		Frame(0.f), Revision(0)
+{
+	Mesh->grab();
+	Mesh->resetPose(Pose);
+	createBuffers();
+}
+
+//! destructor
+SkinnedMeshInstance::~SkinnedMeshInstance()
+{
+	dropBuffers();
+	Mesh->drop();
+}
+
+//! Animates the joints of the pose based on frame input
+void SkinnedMeshInstance::animate(f32 frame)
+{
+	if (Mesh->isStatic())
+		return;
+
+	if (Layers.empty() && !Transiting) {
+		// skips the work if the frame didn't change
+		Mesh->animatePose(Pose, frame);
+		TransformsValid = false;
+	} else {
+		blendPose(frame);
+		Mesh->sampleMorphWeights(Pose, frame);
+	}
+
+	Frame = frame;
+}
+
+void SkinnedMeshInstance::blendPose(f32 frame)
+{
+	Mesh->sampleTransforms(Transforms, frame, &Pose.KeyCursors);
+
+	for (u32 i = 0; i < Layers.size(); ++i) {
+		const SAnimationLayer &layer = Layers[i];
+		SLayerState &state = LayerStates[i];
+		if (layer.Weight == 0.f)
+			continue;
+
+		Mesh->sampleTransforms(LayerTransforms, layer.Frame, &state.Cursors);
+
+		if (layer.Mode == EALM_ADDITIVE) {
+			if (state.ReferenceFrame != layer.ReferenceFrame) {
+				Mesh->sampleTransforms(state.Reference, layer.ReferenceFrame);
+				state.ReferenceFrame = layer.ReferenceFrame;
+			}
+			Mesh->addTransforms(Transforms, LayerTransforms, state.Reference,
+					layer.Weight, &layer.Mask);
+		} else {
+			Mesh->blendTransforms(Transforms, LayerTransforms, layer.Weight,
+					&layer.Mask, layer.RotationBlend);
+		}
+	}
+
+	if (Transiting)
+		Mesh->blendTransforms(Transforms, TransitionStart, 1.f - TransitionBlend);
+
+	Mesh->buildLocalMatrices(Pose, Transforms);
+	TransformsValid = true;
+}
+
+//! Adds a layer blended over the base frame, in the order of adding
+u32 SkinnedMeshInstance::addLayer(const SAnimationLayer &layer)
+{
+	Layers.push_back(layer);
+	LayerStates.emplace_back();
+	return Layers.size() - 1;
+}
+
+void SkinnedMeshInstance::removeLayer(u32 index)
+{
+	if (index >= Layers.size())
+		return;
+
+	Layers.erase(Layers.begin() + index);
+	LayerStates.erase(LayerStates.begin() + index);
+}
+
+void SkinnedMeshInstance::clearLayers()
+{
+	Layers.clear();
+	LayerStates.clear();
+}
+
+//! Starts a transition from the current pose
+void SkinnedMeshInstance::beginTransition()
+{
+	if (Mesh->isStatic())
+		return;
+
+	// the pose was animated straight into matrices, sample it again
+	if (!TransformsValid)
+		Mesh->sampleTransforms(Transforms, Frame);
+
+	TransitionStart = Transforms;
+	TransitionBlend = 0.f;
+	Transiting = true;
+}
+
+//! Sets the progress of a transition, 0 is the start and 1 ends it
+void SkinnedMeshInstance::setTransitionBlend(f32 blend)
+{
+	TransitionBlend = blend;
+	if (blend >= 1.f)
+		Transiting = false;
+}
+
+//! Skins the mesh buffers of the instance for the current pose
+void SkinnedMeshInstance::skin()
+{
+	checkRevision();
+	Mesh->skinPose(Pose, Buffers, BoundingBox);
+}
+
+//! Updates the joint matrices and the bounding box, but not the vertices
+void SkinnedMeshInstance::bound()
+{
+	checkRevision();
+	Mesh->boundPose(Pose, Buffers, BoundingBox);
+}
+
+void SkinnedMeshInstance::recoverJoints(std::vector<IBoneSceneNode *> &jointChildSceneNodes) const
+{
+	Mesh->recoverJoints(Pose, jointChildSceneNodes);
+}
+
+void SkinnedMeshInstance::transferJoints(const std::vector<IBoneSceneNode *> &jointChildSceneNodes)
+{
+	Mesh->transferJoints(Pose, jointChildSceneNodes);
+	TransformsValid = false;
+}
+
+//! returns amount of mesh buffers.
+u32 SkinnedMeshInstance::getMeshBufferCount() const
+{
+	return Buffers.size();
+}
+
+//! returns pointer to a mesh buffer
+IMeshBuffer *SkinnedMeshInstance::getMeshBuffer(u32 nr) const
+{
+	if (nr < Buffers.size())
+		return Buffers[nr];
+	else
+		return 0;
+}
+
+//! Returns pointer to a mesh buffer which fits a material
+IMeshBuffer *SkinnedMeshInstance::getMeshBuffer(const video::SMaterial &material) const
+{
+	for (auto *buffer : Buffers) {
+		if (buffer->getMaterial() == material)
+			return buffer;
+	}
+	return 0;
+}
+
+u32 SkinnedMeshInstance::getTextureSlot(u32 meshbufNr) const
+{
+	return Mesh->getTextureSlot(meshbufNr);
+}
+
+//! set the hardware mapping hint, for driver
+void SkinnedMeshInstance::setHardwareMappingHint(E_HARDWARE_MAPPING newMappingHint, u8 buffer)
+{
+	for (auto *mb : Buffers)
+		mb->setHardwareMappingHint(newMappingHint, buffer);
+}
+
+//! flags the meshbuffer as changed, reloads hardware buffers
+void SkinnedMeshInstance::setDirty(u8 buffer)
+{
+	for (auto *mb : Buffers)
+		mb->setDirty(buffer);
+}
+
+void SkinnedMeshInstance::createBuffers()
+{
+	for (u32 i = 0; i < Mesh->getMeshBufferCount(); ++i) {
+		auto *source = static_cast<SSkinMeshBuffer *>(Mesh->getMeshBuffer(i));
+		Buffers.push_back(new SSkinMeshBuffer(*source, Mesh->hasSkinnedVertices(i)));
+	}
+
+	BoundingBox = Mesh->getBoundingBox();
+	Revision = Mesh->getRevision();
+}
+
+void SkinnedMeshInstance::checkRevision()
+{
+	// the vertices of the mesh were changed, e.g. by recalculating the normals
+	if (Revision != Mesh->getRevision()) {
+		dropBuffers();
+		createBuffers();
+		Pose.Skinned = false;
+
+		// the new buffers aren't morphed yet
+		Pose.AppliedMorphWeights.assign(Pose.AppliedMorphWeights.size(), std::numeric_limits<f32>::quiet_NaN());
+	}
+}
+
+void SkinnedMeshInstance::dropBuffers()
+{
+	for (auto *buffer : Buffers)
+		buffer->drop();
+	Buffers.clear();
+}
+
+} // end namespace scene
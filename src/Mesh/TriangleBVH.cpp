@@ -0,0 +1,600 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "Mesh/TriangleBVH.h"
+#include "Mesh/IMeshBuffer.h"
+#include "Device/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace scene
+{
+
+static_assert(sizeof(TriangleBVH::SNode) == 32, "BVH nodes should stay 32 bytes");
+
+namespace
+{
+//! Buckets the centroids are sorted into when searching a split
+const u32 BIN_COUNT = 16;
+
+//! Leaves have at most this many triangles
+const u32 MAX_LEAF_SIZE = 8;
+
+//! Cost of visiting an inner node relative to testing a triangle
+const f32 TRAVERSAL_COST = 1.f;
+
+//! Below this depth nodes are split in the middle, keeps the traversal stack small
+const u32 MAX_SAH_DEPTH = 64;
+
+//! Size of the traversal stack, enough for MAX_SAH_DEPTH levels and median splits of 2^32 triangles
+const u32 STACK_SIZE = 128;
+
+//! Subtrees with at least this many triangles are built on another job
+const u32 PARALLEL_BUILD_SIZE = 4096;
+
+//! Axis aligned bounds which start empty
+struct SBounds
+{
+	core::vector3df Min{std::numeric_limits<f32>::max()};
+	core::vector3df Max{-std::numeric_limits<f32>::max()};
+
+	void add(const core::vector3df &p)
+	{
+		Min.X = std::min(Min.X, p.X);
+		Min.Y = std::min(Min.Y, p.Y);
+		Min.Z = std::min(Min.Z, p.Z);
+		Max.X = std::max(Max.X, p.X);
+		Max.Y = std::max(Max.Y, p.Y);
+		Max.Z = std::max(Max.Z, p.Z);
+	}
+
+	void add(const SBounds &other)
+	{
+		add(other.Min);
+		add(other.Max);
+	}
+
+	//! Half the surface area, enough to compare costs
+	f32 getArea() const
+	{
+		if (Min.X > Max.X)
+			return 0.f;
+		const core::vector3df e = Max - Min;
+		return e.X * e.Y + e.Y * e.Z + e.Z * e.X;
+	}
+};
+
+f32 getAxis(const core::vector3df &v, u32 axis)
+{
+	return axis == 0 ? v.X : (axis == 1 ? v.Y : v.Z);
+}
+
+//! Returns true if the ray enters the node box before maxFraction
+/** \param entry Receives where the ray enters the box, 0 if it starts inside. */
+inline bool rayIntersectsNode(const TriangleBVH::SNode &node, const core::vector3df &start,
+		const core::vector3df &invDir, f32 maxFraction, f32 &entry)
+{
+	f32 tmin = 0.f, tmax = maxFraction;
+	for (u32 axis = 0; axis < 3; ++axis) {
+		const f32 origin = getAxis(start, axis);
+		const f32 inv = getAxis(invDir, axis);
+		f32 t0 = (node.Min[axis] - origin) * inv;
+		f32 t1 = (node.Max[axis] - origin) * inv;
+		if (inv < 0.f)
+			std::swap(t0, t1);
+		tmin = std::max(t0, tmin);
+		tmax = std::min(t1, tmax);
+		if (tmin > tmax)
+			return false;
+	}
+	entry = tmin;
+	return true;
+}
+
+//! Returns the inverse of the direction, huge values for zero components
+core::vector3df getInverseDirection(const core::vector3df &dir)
+{
+	auto inverse = [](f32 v) {
+		return v != 0.f ? 1.f / v : std::numeric_limits<f32>::max();
+	};
+	return core::vector3df(inverse(dir.X), inverse(dir.Y), inverse(dir.Z));
+}
+
+core::aabbox3df getNodeBox(const TriangleBVH::SNode &node)
+{
+	return core::aabbox3df(node.Min[0], node.Min[1], node.Min[2],
+			node.Max[0], node.Max[1], node.Max[2]);
+}
+
+//! Squared distance from a point to a box, 0 inside
+f32 getDistanceSQ(const core::vector3df &p, const f32 *min, const f32 *max)
+{
+	f32 distance = 0.f;
+	for (u32 axis = 0; axis < 3; ++axis) {
+		const f32 v = getAxis(p, axis);
+		if (v < min[axis])
+			distance += (min[axis] - v) * (min[axis] - v);
+		else if (v > max[axis])
+			distance += (v - max[axis]) * (v - max[axis]);
+	}
+	return distance;
+}
+
+//! Closest point to p on a triangle
+core::vector3df getClosestPointOnTriangle(const core::vector3df &p, const core::vector3df *t)
+{
+	const core::vector3df &a = t[0], &b = t[1], &c = t[2];
+	const core::vector3df ab = b - a, ac = c - a, ap = p - a;
+
+	// vertex and edge regions, see Ericson, Real-Time Collision Detection 5.1.5
+	const f32 d1 = ab.dotProduct(ap), d2 = ac.dotProduct(ap);
+	if (d1 <= 0.f && d2 <= 0.f)
+		return a;
+
+	const core::vector3df bp = p - b;
+	const f32 d3 = ab.dotProduct(bp), d4 = ac.dotProduct(bp);
+	if (d3 >= 0.f && d4 <= d3)
+		return b;
+
+	const f32 vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+		return a + ab * (d1 / (d1 - d3));
+
+	const core::vector3df cp = p - c;
+	const f32 d5 = ab.dotProduct(cp), d6 = ac.dotProduct(cp);
+	if (d6 >= 0.f && d5 <= d6)
+		return c;
+
+	const f32 vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+		return a + ac * (d2 / (d2 - d6));
+
+	const f32 va = d3 * d6 - d5 * d4;
+	if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f)
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	// inside the face
+	const f32 denom = 1.f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+}
+
+struct TriangleBVH::SBuildData
+{
+	std::vector<SBounds> Bounds;
+	std::vector<core::vector3df> Centroids;
+
+	//! Triangles in the order of the leaves
+	std::vector<u32> Order;
+};
+
+//! Builds the hierarchy over the triangles of a mesh.
+TriangleBVH::TriangleBVH(const IMesh *mesh)
+{
+	std::vector<core::vector3df> positions;
+
+	for (u32 b = 0; mesh && b < mesh->getMeshBufferCount(); ++b) {
+		const IMeshBuffer *buffer = mesh->getMeshBuffer(b);
+		if (buffer->getPrimitiveType() != EPT_TRIANGLES)
+			continue;
+
+		const IIndexBuffer *indexBuffer = buffer->getIndexBuffer();
+		const u32 indexCount = indexBuffer->getCount() / 3 * 3;
+		const u32 vertexCount = buffer->getVertexCount();
+		const bool shortIndices = indexBuffer->getType() == video::EIT_16BIT;
+
+		for (u32 i = 0; i < indexCount; i += 3) {
+			u32 index[3];
+			for (u32 k = 0; k < 3; ++k) {
+				index[k] = shortIndices ?
+						static_cast<const u16 *>(indexBuffer->getData())[i + k] :
+						static_cast<const u32 *>(indexBuffer->getData())[i + k];
+			}
+			if (index[0] >= vertexCount || index[1] >= vertexCount || index[2] >= vertexCount)
+				continue;
+
+			for (u32 k = 0; k < 3; ++k)
+				positions.push_back(buffer->getPosition(index[k]));
+			Sources.push_back({b, i});
+		}
+	}
+
+	const u32 count = getTriangleCount();
+	if (!count)
+		return;
+
+	SBuildData data;
+	data.Bounds.resize(count);
+	data.Centroids.resize(count);
+	data.Order.resize(count);
+
+	SBounds meshBounds;
+	for (u32 i = 0; i < count; ++i) {
+		SBounds &bounds = data.Bounds[i];
+		for (u32 k = 0; k < 3; ++k)
+			bounds.add(positions[i * 3 + k]);
+		data.Centroids[i] = (bounds.Min + bounds.Max) * 0.5f;
+		data.Order[i] = i;
+		meshBounds.add(bounds);
+	}
+	BoundingBox = core::aabbox3df(meshBounds.Min, meshBounds.Max);
+
+	// a binary tree with at least one triangle per leaf
+	Nodes.resize(count * 2 - 1);
+	NodeCount = 1;
+	build(data, 0, 0, count, 0);
+	Nodes.resize(NodeCount);
+
+	// store the triangles in the order of the leaves, so leaves read them linearly
+	Positions.resize(count * 3);
+	std::vector<STriangleSource> sources(count);
+	for (u32 i = 0; i < count; ++i) {
+		const u32 triangle = data.Order[i];
+		for (u32 k = 0; k < 3; ++k)
+			Positions[i * 3 + k] = positions[triangle * 3 + k];
+		sources[i] = Sources[triangle];
+	}
+	Sources.swap(sources);
+}
+
+//! Builds the subtree of node over the triangles [begin, end) of the build order
+void TriangleBVH::build(SBuildData &data, u32 node, u32 begin, u32 end, u32 depth)
+{
+	const u32 count = end - begin;
+
+	SBounds bounds, centroidBounds;
+	for (u32 i = begin; i < end; ++i) {
+		const u32 triangle = data.Order[i];
+		bounds.add(data.Bounds[triangle]);
+		centroidBounds.add(data.Centroids[triangle]);
+	}
+
+	SNode &n = Nodes[node];
+	n.Min[0] = bounds.Min.X;
+	n.Min[1] = bounds.Min.Y;
+	n.Min[2] = bounds.Min.Z;
+	n.Max[0] = bounds.Max.X;
+	n.Max[1] = bounds.Max.Y;
+	n.Max[2] = bounds.Max.Z;
+
+	auto makeLeaf = [&]() {
+		n.Offset = begin;
+		n.Count = (u16)count;
+		n.Axis = 0;
+	};
+
+	if (count == 1) {
+		makeLeaf();
+		return;
+	}
+
+	// find the cheapest split between bins of the centroids along any axis
+	f32 bestCost = std::numeric_limits<f32>::max();
+	u32 bestAxis = 0, bestBin = 0;
+
+	if (depth < MAX_SAH_DEPTH) {
+		for (u32 axis = 0; axis < 3; ++axis) {
+			const f32 min = getAxis(centroidBounds.Min, axis);
+			const f32 extent = getAxis(centroidBounds.Max, axis) - min;
+			if (extent <= 0.f)
+				continue;
+
+			SBounds binBounds[BIN_COUNT];
+			u32 binCounts[BIN_COUNT] = {};
+			const f32 scale = BIN_COUNT / extent;
+			for (u32 i = begin; i < end; ++i) {
+				const u32 triangle = data.Order[i];
+				const u32 bin = std::min(BIN_COUNT - 1, (u32)((getAxis(data.Centroids[triangle], axis) - min) * scale));
+				binBounds[bin].add(data.Bounds[triangle]);
+				++binCounts[bin];
+			}
+
+			// costs of the right sides, then sweep from the left
+			f32 rightCosts[BIN_COUNT];
+			SBounds right;
+			u32 rightCount = 0;
+			for (u32 bin = BIN_COUNT - 1; bin > 0; --bin) {
+				right.add(binBounds[bin]);
+				rightCount += binCounts[bin];
+				rightCosts[bin] = rightCount ? right.getArea() * rightCount : -1.f;
+			}
+
+			SBounds left;
+			u32 leftCount = 0;
+			for (u32 bin = 1; bin < BIN_COUNT; ++bin) {
+				left.add(binBounds[bin - 1]);
+				leftCount += binCounts[bin - 1];
+				if (!leftCount || rightCosts[bin] < 0.f)
+					continue;
+
+				const f32 cost = left.getArea() * leftCount + rightCosts[bin];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = bin;
+				}
+			}
+		}
+	}
+
+	const f32 area = bounds.getArea();
+	const bool found = bestCost < std::numeric_limits<f32>::max();
+	if (count <= MAX_LEAF_SIZE && (!found || area * count <= area * TRAVERSAL_COST + bestCost)) {
+		makeLeaf();
+		return;
+	}
+
+	u32 *order = data.Order.data();
+	u32 mid;
+	if (found) {
+		const f32 min = getAxis(centroidBounds.Min, bestAxis);
+		const f32 scale = BIN_COUNT / (getAxis(centroidBounds.Max, bestAxis) - min);
+		mid = (u32)(std::partition(order + begin, order + end, [&](u32 triangle) {
+			return std::min(BIN_COUNT - 1, (u32)((getAxis(data.Centroids[triangle], bestAxis) - min) * scale)) < bestBin;
+		}) - order);
+	} else {
+		// too deep or all centroids in one point, split in the middle
+		const core::vector3df extent = centroidBounds.Max - centroidBounds.Min;
+		bestAxis = extent.X >= extent.Y && extent.X >= extent.Z ? 0 : (extent.Y >= extent.Z ? 1 : 2);
+		mid = begin + count / 2;
+		std::nth_element(order + begin, order + mid, order + end, [&](u32 a, u32 b) {
+			return getAxis(data.Centroids[a], bestAxis) < getAxis(data.Centroids[b], bestAxis);
+		});
+	}
+
+	// children are allocated in pairs, concurrently built subtrees take their own
+	const u32 child = NodeCount.fetch_add(2);
+	n.Offset = child;
+	n.Count = 0;
+	n.Axis = (u16)bestAxis;
+
+	if (g_irrjobs && count >= PARALLEL_BUILD_SIZE) {
+		os::JobCounter done;
+		g_irrjobs->run([this, &data, child, begin, mid, depth]() {
+			build(data, child, begin, mid, depth + 1);
+		}, &done);
+		build(data, child + 1, mid, end, depth + 1);
+		g_irrjobs->wait(done);
+	} else {
+		build(data, child, begin, mid, depth + 1);
+		build(data, child + 1, mid, end, depth + 1);
+	}
+}
+
+//! Finds the triangle hit first by a ray.
+bool TriangleBVH::getClosestHit(const core::line3df &ray, SHit &hit) const
+{
+	if (Nodes.empty())
+		return false;
+
+	const core::vector3df dir = ray.end - ray.start;
+	const core::vector3df invDir = getInverseDirection(dir);
+
+	f32 best = 1.f, entry;
+	bool found = false;
+
+	u32 stack[STACK_SIZE];
+	u32 stackSize = 0;
+	u32 node = 0;
+	while (true) {
+		const SNode &n = Nodes[node];
+		if (rayIntersectsNode(n, ray.start, invDir, best, entry)) {
+			if (n.isLeaf()) {
+				for (u32 i = n.Offset; i < n.Offset + n.Count; ++i) {
+					f32 fraction;
+					if (rayIntersectsTriangle(ray, getTriangle(i), fraction) && fraction <= best) {
+						best = fraction;
+						hit.Triangle = i;
+						found = true;
+					}
+				}
+			} else {
+				// visit the child on the side the ray comes from first
+				const bool backwards = getAxis(dir, n.Axis) < 0.f;
+				stack[stackSize++] = n.Offset + !backwards;
+				node = n.Offset + backwards;
+				continue;
+			}
+		}
+
+		if (!stackSize)
+			break;
+		node = stack[--stackSize];
+	}
+
+	if (found) {
+		hit.Fraction = best;
+		hit.Point = ray.start + dir * best;
+	}
+	return found;
+}
+
+//! Returns true if a ray hits any triangle.
+bool TriangleBVH::hasHit(const core::line3df &ray) const
+{
+	const core::vector3df invDir = getInverseDirection(ray.end - ray.start);
+
+	return findTriangles(
+			[&](const SNode &n) {
+				f32 entry;
+				return rayIntersectsNode(n, ray.start, invDir, 1.f, entry);
+			},
+			[&](u32 i) {
+				f32 fraction;
+				return rayIntersectsTriangle(ray, getTriangle(i), fraction);
+			});
+}
+
+//! Appends the indices of the triangles intersecting a box
+void TriangleBVH::getTrianglesInBox(const core::aabbox3df &box, std::vector<u32> &triangles) const
+{
+	findTriangles(
+			[&](const SNode &n) {
+				return box.intersectsWithBox(getNodeBox(n));
+			},
+			[&](u32 i) {
+				if (boxIntersectsTriangle(box, getTriangle(i)))
+					triangles.push_back(i);
+				return false;
+			});
+}
+
+//! Appends the indices of the triangles intersecting a sphere
+void TriangleBVH::getTrianglesInSphere(const core::vector3df &center, f32 radius, std::vector<u32> &triangles) const
+{
+	findTriangles(
+			[&](const SNode &n) {
+				return getDistanceSQ(center, n.Min, n.Max) <= radius * radius;
+			},
+			[&](u32 i) {
+				if (sphereIntersectsTriangle(center, radius, getTriangle(i)))
+					triangles.push_back(i);
+				return false;
+			});
+}
+
+//! Returns true if any triangle intersects a box
+bool TriangleBVH::intersectsBox(const core::aabbox3df &box) const
+{
+	return findTriangles(
+			[&](const SNode &n) {
+				return box.intersectsWithBox(getNodeBox(n));
+			},
+			[&](u32 i) {
+				return boxIntersectsTriangle(box, getTriangle(i));
+			});
+}
+
+//! Returns true if any triangle intersects a sphere
+bool TriangleBVH::intersectsSphere(const core::vector3df &center, f32 radius) const
+{
+	return findTriangles(
+			[&](const SNode &n) {
+				return getDistanceSQ(center, n.Min, n.Max) <= radius * radius;
+			},
+			[&](u32 i) {
+				return sphereIntersectsTriangle(center, radius, getTriangle(i));
+			});
+}
+
+//! Calls triangleTest for the triangles of the leaves passing nodeTest
+template <class NodeTest, class TriangleTest>
+bool TriangleBVH::findTriangles(const NodeTest &nodeTest, const TriangleTest &triangleTest) const
+{
+	if (Nodes.empty())
+		return false;
+
+	u32 stack[STACK_SIZE];
+	u32 stackSize = 0;
+	u32 node = 0;
+	while (true) {
+		const SNode &n = Nodes[node];
+		if (nodeTest(n)) {
+			if (n.isLeaf()) {
+				for (u32 i = n.Offset; i < n.Offset + n.Count; ++i) {
+					if (triangleTest(i))
+						return true;
+				}
+			} else {
+				stack[stackSize++] = n.Offset + 1;
+				node = n.Offset;
+				continue;
+			}
+		}
+
+		if (!stackSize)
+			return false;
+		node = stack[--stackSize];
+	}
+}
+
+//! Tests a ray against a triangle, from both sides.
+bool TriangleBVH::rayIntersectsTriangle(const core::line3df &ray, const core::vector3df *triangle, f32 &fraction)
+{
+	// Moeller-Trumbore
+	const core::vector3df dir = ray.end - ray.start;
+	const core::vector3df e1 = triangle[1] - triangle[0];
+	const core::vector3df e2 = triangle[2] - triangle[0];
+
+	const core::vector3df p = dir.crossProduct(e2);
+	const f32 det = e1.dotProduct(p);
+	if (det == 0.f)
+		return false;
+
+	const f32 invDet = 1.f / det;
+	const core::vector3df s = ray.start - triangle[0];
+	const f32 u = s.dotProduct(p) * invDet;
+	if (u < 0.f || u > 1.f)
+		return false;
+
+	const core::vector3df q = s.crossProduct(e1);
+	const f32 v = dir.dotProduct(q) * invDet;
+	if (v < 0.f || u + v > 1.f)
+		return false;
+
+	fraction = e2.dotProduct(q) * invDet;
+	return fraction >= 0.f && fraction <= 1.f;
+}
+
+//! Tests a ray against a box.
+bool TriangleBVH::rayIntersectsBox(const core::line3df &ray, const core::aabbox3df &box, f32 &fraction)
+{
+	SNode node;
+	node.Min[0] = box.MinEdge.X;
+	node.Min[1] = box.MinEdge.Y;
+	node.Min[2] = box.MinEdge.Z;
+	node.Max[0] = box.MaxEdge.X;
+	node.Max[1] = box.MaxEdge.Y;
+	node.Max[2] = box.MaxEdge.Z;
+
+	return rayIntersectsNode(node, ray.start, getInverseDirection(ray.end - ray.start), 1.f, fraction);
+}
+
+//! Tests a box against a triangle with the separating axis theorem
+bool TriangleBVH::boxIntersectsTriangle(const core::aabbox3df &box, const core::vector3df *triangle)
+{
+	// see Akenine-Moeller, Fast 3D Triangle-Box Overlap Testing
+	const core::vector3df center = box.getCenter();
+	const core::vector3df half = box.getExtent() * 0.5f;
+	const core::vector3df v[3] = {triangle[0] - center, triangle[1] - center, triangle[2] - center};
+
+	// the axes of the box
+	for (u32 axis = 0; axis < 3; ++axis) {
+		const f32 a = getAxis(v[0], axis), b = getAxis(v[1], axis), c = getAxis(v[2], axis);
+		const f32 h = getAxis(half, axis);
+		if (std::min({a, b, c}) > h || std::max({a, b, c}) < -h)
+			return false;
+	}
+
+	// the plane of the triangle
+	const core::vector3df edges[3] = {v[1] - v[0], v[2] - v[1], v[0] - v[2]};
+	const core::vector3df normal = edges[0].crossProduct(edges[1]);
+	const f32 radius = half.X * fabsf(normal.X) + half.Y * fabsf(normal.Y) + half.Z * fabsf(normal.Z);
+	if (fabsf(normal.dotProduct(v[0])) > radius)
+		return false;
+
+	// the cross products of the edges with the axes of the box
+	const core::vector3df axes[3] = {{1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, 0.f, 1.f}};
+	for (const core::vector3df &edge : edges) {
+		for (const core::vector3df &boxAxis : axes) {
+			const core::vector3df axis = boxAxis.crossProduct(edge);
+			const f32 a = axis.dotProduct(v[0]), b = axis.dotProduct(v[1]), c = axis.dotProduct(v[2]);
+			const f32 r = half.X * fabsf(axis.X) + half.Y * fabsf(axis.Y) + half.Z * fabsf(axis.Z);
+			if (std::min({a, b, c}) > r || std::max({a, b, c}) < -r)
+				return false;
+		}
+	}
+	return true;
+}
+
+//! Tests a sphere against a triangle
+bool TriangleBVH::sphereIntersectsTriangle(const core::vector3df &center, f32 radius, const core::vector3df *triangle)
+{
+	return getClosestPointOnTriangle(center, triangle).getDistanceFromSQ(center) <= radius * radius;
+}
+
+} // end namespace scene
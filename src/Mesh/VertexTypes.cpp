@@ -1,4 +1,7 @@
 #include "Mesh/VertexTypes.h"
+#include "Utils/aabbox3d.h"
+
+#include <cstring>
 
 namespace scene
 {
@@ -62,6 +65,51 @@ const VertexDescriptor Vertex3DExt::FORMAT = {
 	},
 };
 
+const VertexDescriptor VertexSkinned::FORMAT = {
+	sizeof(VertexSkinned),
+	{
+		{"inPosition", 3, VertexAttribute::Type::FLOAT, VertexAttribute::Mode::REGULAR, get_offset(&VertexSkinned::Pos)},
+		{"inNormal", 3, VertexAttribute::Type::FLOAT, VertexAttribute::Mode::REGULAR, get_offset(&VertexSkinned::Normal)},
+		{"inColor", 4, VertexAttribute::Type::UBYTE, VertexAttribute::Mode::NORMALIZED, get_offset(&VertexSkinned::Color)},
+		{"inTexCoord0", 2, VertexAttribute::Type::FLOAT, VertexAttribute::Mode::REGULAR, get_offset(&VertexSkinned::TCoords)},
+		{"inJoints", 4, VertexAttribute::Type::UBYTE, VertexAttribute::Mode::INTEGER, get_offset(&VertexSkinned::Joints)},
+		{"inWeights", 4, VertexAttribute::Type::FLOAT, VertexAttribute::Mode::REGULAR, get_offset(&VertexSkinned::Weights)}
+	},
+};
+
+const VertexDescriptor Vertex3DQuantized::FORMAT = {
+	sizeof(Vertex3DQuantized),
+	{
+		{"inPosition", 3, VertexAttribute::Type::SHORT, VertexAttribute::Mode::NORMALIZED, get_offset(&Vertex3DQuantized::Pos)},
+		{"inNormal", 2, VertexAttribute::Type::SHORT, VertexAttribute::Mode::NORMALIZED, get_offset(&Vertex3DQuantized::Normal)},
+		{"inColor", 4, VertexAttribute::Type::UBYTE, VertexAttribute::Mode::NORMALIZED, get_offset(&Vertex3DQuantized::Color)},
+		{"inTexCoord0", 2, VertexAttribute::Type::HALF_FLOAT, VertexAttribute::Mode::REGULAR, get_offset(&Vertex3DQuantized::TCoords)}
+	},
+};
+
+const VertexDescriptor Vertex2TCoordsQuantized::FORMAT = {
+	sizeof(Vertex2TCoordsQuantized),
+	{
+		{"inPosition", 3, VertexAttribute::Type::SHORT, VertexAttribute::Mode::NORMALIZED, get_offset(&Vertex2TCoordsQuantized::Pos)},
+		{"inNormal", 2, VertexAttribute::Type::SHORT, VertexAttribute::Mode::NORMALIZED, get_offset(&Vertex2TCoordsQuantized::Normal)},
+		{"inColor", 4, VertexAttribute::Type::UBYTE, VertexAttribute::Mode::NORMALIZED, get_offset(&Vertex2TCoordsQuantized::Color)},
+		{"inTexCoord0", 2, VertexAttribute::Type::HALF_FLOAT, VertexAttribute::Mode::REGULAR, get_offset(&Vertex2TCoordsQuantized::TCoords)},
+		{"inTexCoord1", 2, VertexAttribute::Type::HALF_FLOAT, VertexAttribute::Mode::REGULAR, get_offset(&Vertex2TCoordsQuantized::TCoords2)}
+	},
+};
+
+const VertexDescriptor VertexTangentsQuantized::FORMAT = {
+	sizeof(VertexTangentsQuantized),
+	{
+		{"inPosition", 3, VertexAttribute::Type::SHORT, VertexAttribute::Mode::NORMALIZED, get_offset(&VertexTangentsQuantized::Pos)},
+		{"inNormal", 2, VertexAttribute::Type::SHORT, VertexAttribute::Mode::NORMALIZED, get_offset(&VertexTangentsQuantized::Normal)},
+		{"inColor", 4, VertexAttribute::Type::UBYTE, VertexAttribute::Mode::NORMALIZED, get_offset(&VertexTangentsQuantized::Color)},
+		{"inTexCoord0", 2, VertexAttribute::Type::HALF_FLOAT, VertexAttribute::Mode::REGULAR, get_offset(&VertexTangentsQuantized::TCoords)},
+		{"inTagent", 2, VertexAttribute::Type::SHORT, VertexAttribute::Mode::NORMALIZED, get_offset(&VertexTangentsQuantized::Tangent)},
+		{"inBinormal", 2, VertexAttribute::Type::SHORT, VertexAttribute::Mode::NORMALIZED, get_offset(&VertexTangentsQuantized::Binormal)}
+	},
+};
+
 const VertexDescriptor &getVertexTypeDescription(E_VERTEX_TYPE type)
 {
 	switch (type) {
@@ -75,6 +123,8 @@ const VertexDescriptor &getVertexTypeDescription(E_VERTEX_TYPE type)
 	  return Vertex2D::FORMAT;
 	case EVT_3D_EXT:
 	  return Vertex3DExt::FORMAT;
+	case EVT_SKINNED:
+		return VertexSkinned::FORMAT;
 	default:
 		return Vertex3D::FORMAT;
 	}
@@ -86,6 +136,155 @@ u32 getVertexTypeSize(E_VERTEX_TYPE type)
 
 }
 
+const VertexDescriptor *getQuantizedVertexTypeDescription(E_VERTEX_TYPE type)
+{
+	switch (type) {
+	case EVT_3D:
+		return &Vertex3DQuantized::FORMAT;
+	case EVT_2TCOORDS:
+		return &Vertex2TCoordsQuantized::FORMAT;
+	case EVT_TANGENTS:
+		return &VertexTangentsQuantized::FORMAT;
+	default:
+		return nullptr;
+	}
+}
+
+namespace
+{
+//! Converts a value in -1..1 to a normalized 16 bit integer
+s16 toSnorm16(f32 value)
+{
+	return (s16)core::round32(core::clamp(value, -1.f, 1.f) * 32767.f);
+}
+
+//! Converts a float to a half float, rounding to nearest
+u16 toHalf(f32 value)
+{
+	u32 bits;
+	memcpy(&bits, &value, 4);
+
+	const u32 sign = (bits >> 16) & 0x8000;
+	const u32 abs = bits & 0x7FFFFFFF;
+
+	if (abs >= 0x7F800000) // inf and nan
+		return sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 : 0);
+	if (abs >= 0x477FF000) // too large, rounds to inf
+		return sign | 0x7C00;
+	if (abs < 0x38800000) { // denormal or 0
+		f32 magnitude;
+		memcpy(&magnitude, &abs, 4);
+		return sign | (u16)core::round32(magnitude * 16777216.f);
+	}
+
+	// rebias the exponent and round the mantissa to nearest
+	return sign | (u16)((abs - 0x38000000 + 0xFFF + ((abs >> 13) & 1)) >> 13);
+}
+
+//! Encodes a unit vector in octahedral encoding
+void toOctahedral(core::vector3df v, s16 *out)
+{
+	const f32 length = fabsf(v.X) + fabsf(v.Y) + fabsf(v.Z);
+	if (length <= 0.f) {
+		out[0] = out[1] = 0;
+		return;
+	}
+	v /= length;
+
+	// fold the lower half over the diagonals
+	if (v.Z < 0.f) {
+		const f32 x = v.X;
+		v.X = (1.f - fabsf(v.Y)) * (x >= 0.f ? 1.f : -1.f);
+		v.Y = (1.f - fabsf(x)) * (v.Y >= 0.f ? 1.f : -1.f);
+	}
+
+	out[0] = toSnorm16(v.X);
+	out[1] = toSnorm16(v.Y);
+}
+
+void quantize(const Vertex3D &v, Vertex3DQuantized &q,
+		const core::vector3df &scale, const core::vector3df &offset)
+{
+	const core::vector3df p = (v.Pos - offset) / scale;
+	q.Pos[0] = toSnorm16(p.X);
+	q.Pos[1] = toSnorm16(p.Y);
+	q.Pos[2] = toSnorm16(p.Z);
+	q.Pos[3] = 0;
+	toOctahedral(v.Normal, q.Normal);
+	q.Color = v.Color;
+	q.TCoords[0] = toHalf(v.TCoords.X);
+	q.TCoords[1] = toHalf(v.TCoords.Y);
+}
+
+template <class T, class Q>
+void quantizeArray(const T *vertices, u32 count, std::vector<u8> &out,
+		const core::vector3df &scale, const core::vector3df &offset)
+{
+	out.resize((size_t)count * sizeof(Q));
+	for (u32 i = 0; i < count; ++i) {
+		Q q;
+		quantize(vertices[i], q, scale, offset);
+		if constexpr (std::is_same<T, Vertex2TCoords>::value) {
+			q.TCoords2[0] = toHalf(vertices[i].TCoords2.X);
+			q.TCoords2[1] = toHalf(vertices[i].TCoords2.Y);
+		} else if constexpr (std::is_same<T, VertexTangents>::value) {
+			toOctahedral(vertices[i].Tangent, q.Tangent);
+			toOctahedral(vertices[i].Binormal, q.Binormal);
+		}
+		memcpy(out.data() + (size_t)i * sizeof(Q), &q, sizeof(Q));
+	}
+}
+
+//! Returns the bounding box of the positions of vertices
+template <class T>
+core::aabbox3df getBoundingBox(const T *vertices, u32 count)
+{
+	core::aabbox3df box(count ? vertices[0].Pos : core::vector3df());
+	for (u32 i = 1; i < count; ++i)
+		box.addInternalPoint(vertices[i].Pos);
+	return box;
+}
+}
+
+bool quantizeVertices(E_VERTEX_TYPE type, const void *vertices, u32 count,
+		std::vector<u8> &out, core::vector3df &scale, core::vector3df &offset)
+{
+	core::aabbox3df box(core::vector3df(0.f));
+	switch (type) {
+	case EVT_3D:
+		box = getBoundingBox(static_cast<const Vertex3D *>(vertices), count);
+		break;
+	case EVT_2TCOORDS:
+		box = getBoundingBox(static_cast<const Vertex2TCoords *>(vertices), count);
+		break;
+	case EVT_TANGENTS:
+		box = getBoundingBox(static_cast<const VertexTangents *>(vertices), count);
+		break;
+	default:
+		return false;
+	}
+
+	// flat boxes still need a scale to divide by
+	offset = box.getCenter();
+	scale = box.getExtent() * 0.5f;
+	scale.X = core::max_(scale.X, 1e-20f);
+	scale.Y = core::max_(scale.Y, 1e-20f);
+	scale.Z = core::max_(scale.Z, 1e-20f);
+
+	switch (type) {
+	case EVT_3D:
+		quantizeArray<Vertex3D, Vertex3DQuantized>(static_cast<const Vertex3D *>(vertices), count, out, scale, offset);
+		break;
+	case EVT_2TCOORDS:
+		quantizeArray<Vertex2TCoords, Vertex2TCoordsQuantized>(static_cast<const Vertex2TCoords *>(vertices), count, out, scale, offset);
+		break;
+	default:
+		quantizeArray<VertexTangents, VertexTangentsQuantized>(static_cast<const VertexTangents *>(vertices), count, out, scale, offset);
+		break;
+	}
+	return true;
+}
+
 bool operator==(const Vertex3D &a, const Vertex3D &b)
 {
 	return ((a.Pos == b.Pos) &&
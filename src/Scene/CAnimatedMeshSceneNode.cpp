@@ -8,8 +8,10 @@
 #include "Mesh/VertexTypes.h"
 #include "Device/Logger.h"
 #include "Mesh/SkinnedMesh.h"
+#include "Mesh/SkinnedMeshInstance.h"
 #include "Scene/IDummyTransformationSceneNode.h"
 #include "Scene/IBoneSceneNode.h"
+#include "Scene/ICameraSceneNode.h"
 #include "Video/MaterialRenderer.h"
 #include "Mesh/IMesh.h"
 #include "Mesh/IMeshCache.h"
@@ -33,9 +35,10 @@ CAnimatedMeshSceneNode::CAnimatedMeshSceneNode(IAnimatedMesh *mesh,
 		StartFrame(0), EndFrame(0), FramesPerSecond(0.025f),
 		CurrentFrameNr(0.f), LastTimeMs(0),
 		TransitionTime(0), Transiting(0.f), TransitingBlend(0.f),
-		JointMode(EJUOR_NONE), JointsUsed(false),
+		JointMode(EJUOR_NONE), JointsUsed(false), JointsDirty(false),
 		Looping(true), ReadOnlyMaterials(false), RenderFromIdentity(false),
-		LoopCallBack(0), PassCount(0)
+		LoopCallBack(0), PassCount(0), PreparedMesh(0), MeshInstance(0),
+		LODInterval(1), FramesSinceUpdate(0), PoseUpdated(false), Rendered(false)
 {
 	setMesh(mesh);
 }
@@ -45,6 +48,8 @@ CAnimatedMeshSceneNode::~CAnimatedMeshSceneNode()
 {
 	if (LoopCallBack)
 		LoopCallBack->drop();
+	if (MeshInstance)
+		MeshInstance->drop();
 	if (Mesh)
 		Mesh->drop();
 }
@@ -54,6 +59,7 @@ void CAnimatedMeshSceneNode::setCurrentFrame(f32 frame)
 {
 	// if you pass an out of range value, we just clamp it
 	CurrentFrameNr = core::clamp(frame, (f32)StartFrame, (f32)EndFrame);
+	PoseUpdated = false;
 
 	beginTransition(); // transit to this frame if enabled
 }
@@ -140,13 +146,33 @@ void CAnimatedMeshSceneNode::OnRegisterSceneNode()
 				break;
 		}
 
+		// Culling uses the bounding box of the last rendered frame. Nodes
+		// which weren't rendered move it with their joints instead.
+		if (MeshInstance && AnimationLOD.SkipCulled && !Rendered)
+			updateBoundsOnly();
+		Rendered = false;
+
+		if (MeshInstance)
+			LODInterval = getAnimationLODInterval();
+
 		// register according to material types counted
 
+		u32 taken = 0;
 		if (solidCount)
-			SceneManager->registerNodeForRendering(this, scene::ESNRP_SOLID);
+			taken += SceneManager->registerNodeForRendering(this, scene::ESNRP_SOLID);
 
 		if (transparentCount)
-			SceneManager->registerNodeForRendering(this, scene::ESNRP_TRANSPARENT);
+			taken += SceneManager->registerNodeForRendering(this, scene::ESNRP_TRANSPARENT);
+
+		if (MeshInstance && !taken) {
+			if (AnimationLOD.SkipCulled) {
+				driver->countAnimationUpdate(video::EAU_CULLED);
+			} else {
+				// keep culled nodes animated, so their box is exact
+				IMesh *m = getMeshForCurrentFrame();
+				Box = m->getBoundingBox();
+			}
+		}
 
 		ISceneNode::OnRegisterSceneNode();
 	}
@@ -157,38 +183,57 @@ IMesh *CAnimatedMeshSceneNode::getMeshForCurrentFrame()
 	if (Mesh->getMeshType() != EAMT_SKINNED) {
 		return Mesh->getMesh(getFrameNr());
 	} else {
-		// As multiple scene nodes may be sharing the same skinned mesh, we have to
-		// re-animate it every frame to ensure that this node gets the mesh that it needs.
+		// Multiple scene nodes may be sharing the same skinned mesh, so the
+		// pose and the skinned buffers are kept in the instance of this node.
 
-		SkinnedMesh *skinnedMesh = static_cast<SkinnedMesh *>(Mesh);
+		video::VideoDriver *driver = SceneManager->getVideoDriver();
 
-		if (JointMode == EJUOR_CONTROL) // write to mesh
-			skinnedMesh->transferJointsToMesh(JointChildSceneNodes);
-		else
-			skinnedMesh->animateMesh(getFrameNr());
+		if (JointMode == EJUOR_CONTROL) { // write to mesh
+			MeshInstance->transferJoints(JointChildSceneNodes);
+		} else {
+			// already done for this frame, e.g. by another render pass
+			if (PoseUpdated)
+				return MeshInstance;
+			PoseUpdated = true;
+
+			if (++FramesSinceUpdate < LODInterval) {
+				// skipped by the animation LOD, the buffers keep the last skinned pose
+				if (AnimationLOD.InterpolateSkipped) {
+					animatePose();
+					JointsDirty = JointsUsed;
+
+					if (MeshInstance->getSkinnedMesh()->isHardwareSkinned())
+						MeshInstance->skin();
+					else
+						MeshInstance->bound();
+				}
 
-		// Update the skinned mesh for the current joint transforms.
-		skinnedMesh->skinMesh();
+				driver->countAnimationUpdate(video::EAU_SKIPPED);
+				return MeshInstance;
+			}
+			FramesSinceUpdate = 0;
 
-		if (JointMode == EJUOR_READ) { // read from mesh
-			skinnedMesh->recoverJointsFromMesh(JointChildSceneNodes);
+			animatePose();
 
-			//---slow---
-			for (u32 n = 0; n < JointChildSceneNodes.size(); ++n)
-				if (JointChildSceneNodes[n]->getParent() == this) {
-					JointChildSceneNodes[n]->updateAbsolutePositionOfAllChildren(); // temp, should be an option
-				}
+			// Bone nodes are only touched on the main thread, see updateJointNodes()
+			JointsDirty = JointsUsed;
 		}
 
-		if (JointMode == EJUOR_CONTROL) {
-			// For meshes other than EJUOR_CONTROL, this is done by calling animateMesh()
-			skinnedMesh->updateBoundingBox();
-		}
+		// Update the skinned buffers for the current joint transforms.
+		MeshInstance->skin();
+		driver->countAnimationUpdate(video::EAU_UPDATED);
 
-		return skinnedMesh;
+		return MeshInstance;
 	}
 }
 
+//! Animates and skins the mesh for the current frame ahead of rendering.
+void CAnimatedMeshSceneNode::prepareMeshForCurrentFrame()
+{
+	if (Mesh)
+		PreparedMesh = getMeshForCurrentFrame();
+}
+
 //! OnAnimate() is called just before rendering the whole scene.
 void CAnimatedMeshSceneNode::OnAnimate(u32 timeMs)
 {
@@ -199,6 +244,8 @@ void CAnimatedMeshSceneNode::OnAnimate(u32 timeMs)
 	// set CurrentFrameNr
 	buildFrameNr(timeMs - LastTimeMs);
 	LastTimeMs = timeMs;
+	PreparedMesh = 0;
+	PoseUpdated = false;
 
 	IAnimatedMeshSceneNode::OnAnimate(timeMs);
 }
@@ -216,7 +263,11 @@ void CAnimatedMeshSceneNode::render()
 
 	++PassCount;
 
-	scene::IMesh *m = getMeshForCurrentFrame();
+	scene::IMesh *m = PreparedMesh ? PreparedMesh : getMeshForCurrentFrame();
+	Rendered = true;
+
+	if (JointMode == EJUOR_READ) // read from mesh
+		updateJointNodes(true);
 
 	if (m) {
 		Box = m->getBoundingBox();
@@ -229,6 +280,11 @@ void CAnimatedMeshSceneNode::render()
 
 	driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
 
+	// joint palette for the buffers skinned by the shaders
+	const std::vector<core::matrix4> *joints = nullptr;
+	if (MeshInstance && MeshInstance->getSkinnedMesh()->isHardwareSkinned())
+		joints = &MeshInstance->getSkinningMatrices();
+
 	for (u32 i = 0; i < m->getMeshBufferCount(); ++i) {
 		const bool transparent = driver->needsTransparentRenderPass(Materials[i]);
 
@@ -236,14 +292,21 @@ void CAnimatedMeshSceneNode::render()
 		// and solid only in solid pass
 		if (transparent == isTransparentPass) {
 			scene::IMeshBuffer *mb = m->getMeshBuffer(i);
-			const video::SMaterial &material = ReadOnlyMaterials ? mb->getMaterial() : Materials[i];
+			const video::SMaterial &material = ReadOnlyMaterials ? Mesh->getMeshBuffer(i)->getMaterial() : Materials[i];
 			if (RenderFromIdentity)
 				driver->setTransform(video::ETS_WORLD, core::IdentityMatrix);
 			else if (Mesh->getMeshType() == EAMT_SKINNED)
 				driver->setTransform(video::ETS_WORLD, AbsoluteTransformation * ((SSkinMeshBuffer *)mb)->Transformation);
 
+			const bool skinned = joints && mb->getVertexType() == EVT_SKINNED;
+			if (skinned)
+				driver->setJointTransforms(joints->data(), joints->size());
+
 			driver->setMaterial(material);
 			driver->drawMeshBuffer(mb);
+
+			if (skinned)
+				driver->setJointTransforms(nullptr, 0);
 		}
 	}
 
@@ -291,13 +354,16 @@ void CAnimatedMeshSceneNode::render()
 
 		// show skeleton
 		if (DebugDataVisible & scene::EDS_SKELETON) {
-			if (Mesh->getMeshType() == EAMT_SKINNED) {
+			if (MeshInstance) {
 				// draw skeleton
-
-				for (auto *joint : ((SkinnedMesh *)Mesh)->getAllJoints()) {
-					for (const auto *childJoint : joint->Children) {
-						driver->draw3DLine(joint->GlobalAnimatedMatrix.getTranslation(),
-								childJoint->GlobalAnimatedMatrix.getTranslation(),
+				const SkinnedMesh *skinnedMesh = MeshInstance->getSkinnedMesh();
+				const auto &globals = MeshInstance->getPose().GlobalMatrices;
+
+				for (u32 i = 0; i < globals.size(); ++i) {
+					const s32 parent = skinnedMesh->getJointParent(i);
+					if (parent != -1) {
+						driver->draw3DLine(globals[parent].getTranslation(),
+								globals[i].getTranslation(),
 								video::SColor(255, 51, 66, 255));
 					}
 				}
@@ -396,6 +462,7 @@ IBoneSceneNode *CAnimatedMeshSceneNode::getJointNode(const c8 *jointName)
 	}
 
 	checkJoints();
+	updateJointNodes(false);
 
 	auto *skinnedMesh = (SkinnedMesh *)Mesh;
 
@@ -424,6 +491,7 @@ IBoneSceneNode *CAnimatedMeshSceneNode::getJointNode(u32 jointID)
 	}
 
 	checkJoints();
+	updateJointNodes(false);
 
 	if (JointChildSceneNodes.size() <= jointID) {
 		g_irrlogger->log("Joint not loaded into node", ELL_WARNING);
@@ -519,6 +587,17 @@ void CAnimatedMeshSceneNode::setMesh(IAnimatedMesh *mesh)
 
 		// grab the mesh (it's non-null!)
 		Mesh->grab();
+
+		if (MeshInstance) {
+			MeshInstance->drop();
+			MeshInstance = 0;
+		}
+		if (Mesh->getMeshType() == EAMT_SKINNED)
+			MeshInstance = new SkinnedMeshInstance(static_cast<SkinnedMesh *>(Mesh));
+		PreparedMesh = 0;
+		PoseUpdated = false;
+		FramesSinceUpdate = 0;
+		Rendered = false;
 	}
 
 	// get materials and bounding box
@@ -562,18 +641,10 @@ void CAnimatedMeshSceneNode::setJointMode(E_JOINT_UPDATE_ON_RENDER mode)
 	JointMode = mode;
 }
 
-//! Sets the transition time in seconds (note: This needs to enable joints, and setJointmode maybe set to 2)
-//! you must call animateJoints(), or the mesh will not animate
+//! Sets the transition time in seconds
 void CAnimatedMeshSceneNode::setTransitionTime(f32 time)
 {
-	const u32 ttime = (u32)core::floor32(time * 1000.0f);
-	if (TransitionTime == ttime)
-		return;
-	TransitionTime = ttime;
-	if (ttime != 0)
-		setJointMode(EJUOR_CONTROL);
-	else
-		setJointMode(EJUOR_NONE);
+	TransitionTime = (u32)core::floor32(time * 1000.0f);
 }
 
 //! render mesh ignoring its transformation. Used with ragdolls. (culling is unaffected)
@@ -587,64 +658,82 @@ void CAnimatedMeshSceneNode::animateJoints(bool CalculateAbsolutePositions)
 {
 	if (Mesh && Mesh->getMeshType() == EAMT_SKINNED) {
 		checkJoints();
-		const f32 frame = getFrameNr(); // old?
 
-		SkinnedMesh *skinnedMesh = static_cast<SkinnedMesh *>(Mesh);
+		// transitions are blended in the pose, the bone nodes only receive the result
+		animatePose();
+		JointsDirty = true;
+		updateJointNodes(CalculateAbsolutePositions);
+	}
+}
 
-		skinnedMesh->animateMesh(frame);
-		skinnedMesh->recoverJointsFromMesh(JointChildSceneNodes);
+//! Animates the pose of the mesh instance for the current frame and transition
+void CAnimatedMeshSceneNode::animatePose()
+{
+	if (Transiting != 0.f)
+		MeshInstance->setTransitionBlend(TransitingBlend);
+	else if (MeshInstance->isTransiting())
+		MeshInstance->setTransitionBlend(1.f);
 
-		//-----------------------------------------
-		//		Transition
-		//-----------------------------------------
+	MeshInstance->animate(getFrameNr());
+}
 
-		if (Transiting != 0.f) {
-			// Init additional matrices
-			if (PretransitingSave.size() < JointChildSceneNodes.size()) {
-				for (u32 n = PretransitingSave.size(); n < JointChildSceneNodes.size(); ++n)
-					PretransitingSave.push_back(core::matrix4());
-			}
+//! Moves the bounding box with the joints, without skinning
+void CAnimatedMeshSceneNode::updateBoundsOnly()
+{
+	if (JointMode != EJUOR_CONTROL) {
+		animatePose();
+		JointsDirty = JointsUsed;
+	}
 
-			for (u32 n = 0; n < JointChildSceneNodes.size(); ++n) {
-				//------Position------
+	MeshInstance->bound();
+	Box = MeshInstance->getBoundingBox();
+}
 
-				JointChildSceneNodes[n]->setPosition(
-						core::lerp(
-								PretransitingSave[n].getTranslation(),
-								JointChildSceneNodes[n]->getPosition(),
-								TransitingBlend));
+//! Returns after how many frames the animation LOD updates the pose
+u32 CAnimatedMeshSceneNode::getAnimationLODInterval() const
+{
+	const auto &sizes = AnimationLOD.ScreenSizes;
+	const ICameraSceneNode *camera = SceneManager->getActiveCamera();
+	if (sizes.empty() || !camera)
+		return 1;
 
-				//------Rotation------
+	const core::aabbox3df box = getTransformedBoundingBox();
+	const f32 radius = box.getRadius();
+	const f32 distance = (box.getCenter() - camera->getAbsolutePosition()).getLength();
+	if (distance <= radius)
+		return 1;
 
-				// Code is slow, needs to be fixed up
+	// radius relative to half the height of the view at the distance
+	const f32 screenSize = radius / (distance * tanf(camera->getFOV() * 0.5f));
 
-				const core::quaternion RotationStart(PretransitingSave[n].getRotationRadians());
-				const core::quaternion RotationEnd(JointChildSceneNodes[n]->getRotation() * core::DEGTORAD);
+	u32 level = 0;
+	while (level < sizes.size() && level < 16 && screenSize < sizes[level])
+		++level;
 
-				core::quaternion QRotation;
-				QRotation.slerp(RotationStart, RotationEnd, TransitingBlend);
+	return 1 << level;
+}
 
-				core::vector3df tmpVector;
-				QRotation.toEuler(tmpVector);
-				tmpVector *= core::RADTODEG; // convert from radians back to degrees
-				JointChildSceneNodes[n]->setRotation(tmpVector);
+//! Sets the animation level of detail of skinned meshes
+void CAnimatedMeshSceneNode::setAnimationLOD(const SAnimationLOD &lod)
+{
+	AnimationLOD = lod;
+	LODInterval = 1;
+}
 
-				//------Scale------
+//! Sets the bone nodes to the pose if it changed since they were last set
+void CAnimatedMeshSceneNode::updateJointNodes(bool calculateAbsolutePositions)
+{
+	if (!JointsDirty || !MeshInstance)
+		return;
 
-				// JointChildSceneNodes[n]->setScale(
-				//		core::lerp(
-				//			PretransitingSave[n].getScale(),
-				//			JointChildSceneNodes[n]->getScale(),
-				//			TransitingBlend));
-			}
-		}
+	JointsDirty = false;
+	MeshInstance->recoverJoints(JointChildSceneNodes);
 
-		if (CalculateAbsolutePositions) {
-			//---slow---
-			for (u32 n = 0; n < JointChildSceneNodes.size(); ++n) {
-				if (JointChildSceneNodes[n]->getParent() == this) {
-					JointChildSceneNodes[n]->updateAbsolutePositionOfAllChildren(); // temp, should be an option
-				}
+	if (calculateAbsolutePositions) {
+		//---slow---
+		for (u32 n = 0; n < JointChildSceneNodes.size(); ++n) {
+			if (JointChildSceneNodes[n] && JointChildSceneNodes[n]->getParent() == this) {
+				JointChildSceneNodes[n]->updateAbsolutePositionOfAllChildren(); // temp, should be an option
 			}
 		}
 	}
@@ -664,7 +753,7 @@ void CAnimatedMeshSceneNode::checkJoints()
 
 		// Create joints for SkinnedMesh
 		((SkinnedMesh *)Mesh)->addJoints(JointChildSceneNodes, this, SceneManager);
-		((SkinnedMesh *)Mesh)->recoverJointsFromMesh(JointChildSceneNodes);
+		MeshInstance->recoverJoints(JointChildSceneNodes);
 
 		JointsUsed = true;
 		JointMode = EJUOR_READ;
@@ -675,19 +764,12 @@ void CAnimatedMeshSceneNode::checkJoints()
  */
 void CAnimatedMeshSceneNode::beginTransition()
 {
-	if (!JointsUsed)
+	if (!MeshInstance)
 		return;
 
 	if (TransitionTime != 0) {
-		// Check the array is big enough
-		if (PretransitingSave.size() < JointChildSceneNodes.size()) {
-			for (u32 n = PretransitingSave.size(); n < JointChildSceneNodes.size(); ++n)
-				PretransitingSave.push_back(core::matrix4());
-		}
-
-		// Copy the position of joints
-		for (u32 n = 0; n < JointChildSceneNodes.size(); ++n)
-			PretransitingSave[n] = JointChildSceneNodes[n]->getRelativeTransformation();
+		// Keep the current pose to blend from
+		MeshInstance->beginTransition();
 
 		Transiting = core::reciprocal((f32)TransitionTime);
 	}
@@ -733,8 +815,8 @@ ISceneNode *CAnimatedMeshSceneNode::clone(ISceneNode *newParent, ISceneManager *
 		newNode->LoopCallBack->grab();
 	newNode->PassCount = PassCount;
 	newNode->JointChildSceneNodes = JointChildSceneNodes;
-	newNode->PretransitingSave = PretransitingSave;
 	newNode->RenderFromIdentity = RenderFromIdentity;
+	newNode->AnimationLOD = AnimationLOD;
 
 	return newNode;
 }
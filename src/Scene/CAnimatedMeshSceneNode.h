@@ -8,14 +8,18 @@
 #include "Mesh/IAnimatedMesh.h"
 
 #include "Utils/matrix4.h"
+#include "CSceneNodePool.h"
 
 
 namespace scene
 {
 class IDummyTransformationSceneNode;
+class SkinnedMeshInstance;
 
 class CAnimatedMeshSceneNode : public IAnimatedMeshSceneNode
 {
+	IRR_POOLED_SCENE_NODE(CAnimatedMeshSceneNode)
+
 public:
 	//! constructor
 	CAnimatedMeshSceneNode(IAnimatedMesh *mesh, ISceneNode *parent, ISceneManager *mgr, s32 id,
@@ -119,8 +123,7 @@ public:
 	//! Set the joint update mode (0-unused, 1-get joints only, 2-set joints only, 3-move and set)
 	void setJointMode(E_JOINT_UPDATE_ON_RENDER mode) override;
 
-	//! Sets the transition time in seconds (note: This needs to enable joints, and setJointmode maybe set to 2)
-	//! you must call animateJoints(), or the mesh will not animate
+	//! Sets the transition time in seconds
 	void setTransitionTime(f32 Time) override;
 
 	//! updates the joint positions of this mesh
@@ -129,12 +132,27 @@ public:
 	//! render mesh ignoring its transformation. Used with ragdolls. (culling is unaffected)
 	void setRenderFromIdentity(bool On) override;
 
+	//! Sets the animation level of detail of skinned meshes
+	void setAnimationLOD(const SAnimationLOD &lod) override;
+
+	//! Returns the animation level of detail
+	const SAnimationLOD &getAnimationLOD() const override { return AnimationLOD; }
+
+	//! Returns the pose of this node, if the mesh is a skinned mesh
+	SkinnedMeshInstance *getMeshInstance() override { return MeshInstance; }
+
 	//! Creates a clone of this scene node and its children.
 	/** \param newParent An optional new parent.
 	\param newManager An optional new scene manager.
 	\return The newly created clone of this node. */
 	ISceneNode *clone(ISceneNode *newParent = 0, ISceneManager *newManager = 0) override;
 
+	//! Animates and skins the mesh for the current frame ahead of rendering.
+	/** Used by the scene manager to skin meshes on worker threads. Skinned
+	meshes are animated in a pose of this node, so nodes sharing a mesh can
+	be prepared at the same time. */
+	void prepareMeshForCurrentFrame();
+
 private:
 	//! Get a static mesh for the current frame of this animated mesh
 	IMesh *getMeshForCurrentFrame();
@@ -143,6 +161,18 @@ private:
 	void checkJoints();
 	void beginTransition();
 
+	//! Animates the pose of the mesh instance for the current frame and transition
+	void animatePose();
+
+	//! Sets the bone nodes to the pose if it changed since they were last set
+	void updateJointNodes(bool calculateAbsolutePositions);
+
+	//! Moves the bounding box with the joints, without skinning
+	void updateBoundsOnly();
+
+	//! Returns after how many frames the animation LOD updates the pose
+	u32 getAnimationLODInterval() const;
+
 	core::array<video::SMaterial> Materials;
 	core::aabbox3d<f32> Box{{0.0f, 0.0f, 0.0f}};
 	IAnimatedMesh *Mesh;
@@ -161,6 +191,9 @@ private:
 	E_JOINT_UPDATE_ON_RENDER JointMode;
 	bool JointsUsed;
 
+	//! The pose changed since the bone nodes were set to it
+	bool JointsDirty;
+
 	bool Looping;
 	bool ReadOnlyMaterials;
 	bool RenderFromIdentity;
@@ -168,8 +201,25 @@ private:
 	IAnimationEndCallBack *LoopCallBack;
 	s32 PassCount;
 
+	//! Mesh skinned by prepareMeshForCurrentFrame(), valid until the next OnAnimate()
+	IMesh *PreparedMesh;
+
+	//! Pose and skinned buffers of this node, if the mesh is a skinned mesh
+	SkinnedMeshInstance *MeshInstance;
+
+	SAnimationLOD AnimationLOD;
+
+	//! Frames between two updates chosen by the animation LOD
+	u32 LODInterval;
+	u32 FramesSinceUpdate;
+
+	//! The pose was updated for the current frame
+	bool PoseUpdated;
+
+	//! The node was rendered since it was last registered
+	bool Rendered;
+
 	std::vector<IBoneSceneNode *> JointChildSceneNodes;
-	core::array<core::matrix4> PretransitingSave;
 };
 
 } // end namespace scene
@@ -6,6 +6,7 @@
 
 #include "Scene/IBillboardSceneNode.h"
 #include "Mesh/SMeshBuffer.h"
+#include "CSceneNodePool.h"
 
 
 namespace scene
@@ -15,6 +16,8 @@ namespace scene
 //! which always looks to the camera.
 class CBillboardSceneNode : virtual public IBillboardSceneNode
 {
+	IRR_POOLED_SCENE_NODE(CBillboardSceneNode)
+
 public:
 	//! constructor
 	CBillboardSceneNode(ISceneNode *parent, ISceneManager *mgr, s32 id,
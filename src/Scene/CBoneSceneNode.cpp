@@ -60,9 +60,8 @@ void CBoneSceneNode::OnAnimate(u32 timeMs)
 		// updateAbsolutePosition();
 
 		// perform the post render process on all children
-		ISceneNodeList::iterator it = Children.begin();
-		for (; it != Children.end(); ++it)
-			(*it)->OnAnimate(timeMs);
+		for (u32 i = 0; i < Children.size(); ++i)
+			Children[i]->OnAnimate(timeMs);
 	}
 }
 
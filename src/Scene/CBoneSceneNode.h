@@ -7,6 +7,7 @@
 // Used with SkinnedMesh and IAnimatedMeshSceneNode, for boned meshes
 
 #include "Scene/IBoneSceneNode.h"
+#include "CSceneNodePool.h"
 
 #include <optional>
 
@@ -16,6 +17,8 @@ namespace scene
 
 class CBoneSceneNode : public IBoneSceneNode
 {
+	IRR_POOLED_SCENE_NODE(CBoneSceneNode)
+
 public:
 	//! constructor
 	CBoneSceneNode(ISceneNode *parent, ISceneManager *mgr,
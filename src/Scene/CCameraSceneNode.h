@@ -6,6 +6,7 @@
 
 #include "Scene/ICameraSceneNode.h"
 #include "Video/SViewFrustum.h"
+#include "CSceneNodePool.h"
 
 
 namespace scene
@@ -13,6 +14,8 @@ namespace scene
 
 class CCameraSceneNode : public ICameraSceneNode
 {
+	IRR_POOLED_SCENE_NODE(CCameraSceneNode)
+
 public:
 	//! constructor
 	CCameraSceneNode(ISceneNode *parent, ISceneManager *mgr, s32 id,
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "Scene/IDummyTransformationSceneNode.h"
+#include "CSceneNodePool.h"
 
 
 namespace scene
@@ -12,6 +13,8 @@ namespace scene
 
 class CDummyTransformationSceneNode : public IDummyTransformationSceneNode
 {
+	IRR_POOLED_SCENE_NODE(CDummyTransformationSceneNode)
+
 public:
 	//! constructor
 	CDummyTransformationSceneNode(ISceneNode *parent, ISceneManager *mgr, s32 id);
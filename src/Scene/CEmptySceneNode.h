@@ -5,6 +5,7 @@
 #pragma once
 
 #include "Scene/ISceneNode.h"
+#include "CSceneNodePool.h"
 
 
 namespace scene
@@ -12,6 +13,8 @@ namespace scene
 
 class CEmptySceneNode : public ISceneNode
 {
+	IRR_POOLED_SCENE_NODE(CEmptySceneNode)
+
 public:
 	//! constructor
 	CEmptySceneNode(ISceneNode *parent, ISceneManager *mgr, s32 id);
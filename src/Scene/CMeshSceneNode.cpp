@@ -9,6 +9,11 @@
 #include "Mesh/IMeshBuffer.h"
 #include "Video/MaterialRenderer.h"
 #include "IO/IFileSystem.h"
+#include "Scene/ICameraSceneNode.h"
+#include "Mesh/MeshManipulator.h"
+#include "Device/Logger.h"
+
+#include <cmath>
 
 
 namespace scene
@@ -20,6 +25,7 @@ CMeshSceneNode::CMeshSceneNode(IMesh *mesh, ISceneNode *parent, ISceneManager *m
 		const core::vector3df &scale) :
 		IMeshSceneNode(parent, mgr, id, position, rotation, scale),
 		Mesh(0),
+		CurrentLODLevel(0), LODHysteresis(0.1f),
 		PassCount(0), SharedMaterials(false)
 {
 	setMesh(mesh);
@@ -28,6 +34,8 @@ CMeshSceneNode::CMeshSceneNode(IMesh *mesh, ISceneNode *parent, ISceneManager *m
 //! destructor
 CMeshSceneNode::~CMeshSceneNode()
 {
+	clearLODLevels();
+
 	if (Mesh)
 		Mesh->drop();
 }
@@ -43,6 +51,9 @@ void CMeshSceneNode::OnRegisterSceneNode()
 
 		video::VideoDriver *driver = SceneManager->getVideoDriver();
 
+		selectLODLevel();
+		IMesh *mesh = getLODMesh();
+
 		PassCount = 0;
 		int transparentCount = 0;
 		int solidCount = 0;
@@ -66,8 +77,23 @@ void CMeshSceneNode::OnRegisterSceneNode()
 		if (solidCount)
 			SceneManager->registerNodeForRendering(this, scene::ESNRP_SOLID);
 
-		if (transparentCount)
-			SceneManager->registerNodeForRendering(this, scene::ESNRP_TRANSPARENT);
+		// transparent buffers are sorted on their own, so overlapping buffers
+		// of one node are blended in the right order
+		if (transparentCount && !SceneManager->isCulled(this)) {
+			for (u32 i = 0; i < mesh->getMeshBufferCount(); ++i) {
+				scene::IMeshBuffer *mb = mesh->getMeshBuffer(i);
+				if (!mb)
+					continue;
+
+				const auto &material = SharedMaterials ? Mesh->getMeshBuffer(i)->getMaterial() : Materials[i];
+				if (!driver->needsTransparentRenderPass(material))
+					continue;
+
+				core::vector3df center = mb->getBoundingBox().getCenter();
+				AbsoluteTransformation.transformVect(center);
+				SceneManager->registerMeshBufferForRendering(this, i, center);
+			}
+		}
 
 		ISceneNode::OnRegisterSceneNode();
 	}
@@ -89,10 +115,19 @@ void CMeshSceneNode::render()
 	driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
 	Box = Mesh->getBoundingBox();
 
-	for (u32 i = 0; i < Mesh->getMeshBufferCount(); ++i) {
-		scene::IMeshBuffer *mb = Mesh->getMeshBuffer(i);
+	// the levels of detail have the same buffers, the materials are the ones of the mesh
+	IMesh *mesh = getLODMesh();
+
+	// a single buffer registered with registerMeshBufferForRendering()
+	const s32 onlyBuffer = isTransparentPass ? SceneManager->getRenderedMeshBuffer() : -1;
+
+	for (u32 i = 0; i < mesh->getMeshBufferCount(); ++i) {
+		if (onlyBuffer >= 0 && (s32)i != onlyBuffer)
+			continue;
+
+		scene::IMeshBuffer *mb = mesh->getMeshBuffer(i);
 		if (mb) {
-			const auto &material = SharedMaterials ? mb->getMaterial() : Materials[i];
+			const auto &material = SharedMaterials ? Mesh->getMeshBuffer(i)->getMaterial() : Materials[i];
 
 			const bool transparent = driver->needsTransparentRenderPass(material);
 
@@ -113,9 +148,9 @@ void CMeshSceneNode::render()
 		driver->setMaterial(m);
 
 		if (DebugDataVisible & scene::EDS_BBOX_BUFFERS) {
-			for (u32 g = 0; g < Mesh->getMeshBufferCount(); ++g) {
+			for (u32 g = 0; g < mesh->getMeshBufferCount(); ++g) {
 				driver->draw3DBox(
-						Mesh->getMeshBuffer(g)->getBoundingBox(),
+						mesh->getMeshBuffer(g)->getBoundingBox(),
 						video::SColor(255, 190, 128, 128));
 			}
 		}
@@ -128,10 +163,10 @@ void CMeshSceneNode::render()
 			// draw normals
 			const f32 debugNormalLength = 1.f;
 			const video::SColor debugNormalColor = video::SColor(255, 34, 221, 221);
-			const u32 count = Mesh->getMeshBufferCount();
+			const u32 count = mesh->getMeshBufferCount();
 
 			for (u32 i = 0; i != count; ++i) {
-				driver->drawMeshBufferNormals(Mesh->getMeshBuffer(i), debugNormalLength, debugNormalColor);
+				driver->drawMeshBufferNormals(mesh->getMeshBuffer(i), debugNormalLength, debugNormalColor);
 			}
 		}
 
@@ -140,8 +175,8 @@ void CMeshSceneNode::render()
 			m.Wireframe = true;
 			driver->setMaterial(m);
 
-			for (u32 g = 0; g < Mesh->getMeshBufferCount(); ++g) {
-				driver->drawMeshBuffer(Mesh->getMeshBuffer(g));
+			for (u32 g = 0; g < mesh->getMeshBufferCount(); ++g) {
+				driver->drawMeshBuffer(mesh->getMeshBuffer(g));
 			}
 		}
 	}
@@ -192,11 +227,89 @@ void CMeshSceneNode::setMesh(IMesh *mesh)
 		if (Mesh)
 			Mesh->drop();
 
+		// the levels of detail were made for the previous mesh
+		if (mesh != Mesh)
+			clearLODLevels();
+
 		Mesh = mesh;
 		copyMaterials();
 	}
 }
 
+//! Adds a less detailed level to display when the node is small on screen.
+bool CMeshSceneNode::addLODLevel(IMesh *mesh, f32 screenSize)
+{
+	if (!Mesh || !mesh || mesh->getMeshBufferCount() != Mesh->getMeshBufferCount()) {
+		g_irrlogger->log("Level of detail needs the mesh buffers of the mesh of the node", ELL_WARNING);
+		return false;
+	}
+	if (!LODLevels.empty() && screenSize >= LODLevels.back().ScreenSize) {
+		g_irrlogger->log("Levels of detail have to be added in order of decreasing screen size", ELL_WARNING);
+		return false;
+	}
+
+	mesh->grab();
+	LODLevels.push_back({mesh, screenSize});
+	return true;
+}
+
+//! Creates levels of detail from the mesh of the node.
+u32 CMeshSceneNode::generateLODLevels(u32 levels, f32 ratio, f32 screenSize)
+{
+	if (!Mesh)
+		return 0;
+
+	const std::vector<SMesh *> chain = SceneManager->getMeshManipulator()->createLODChain(Mesh, levels, ratio);
+
+	u32 added = 0;
+	const f32 step = sqrtf(core::clamp(ratio, 0.f, 1.f));
+	for (SMesh *level : chain) {
+		if (addLODLevel(level, screenSize))
+			++added;
+		level->drop();
+		screenSize *= step;
+	}
+	return added;
+}
+
+//! Removes all levels of detail.
+void CMeshSceneNode::clearLODLevels()
+{
+	for (const SLODLevel &level : LODLevels)
+		level.Mesh->drop();
+	LODLevels.clear();
+	CurrentLODLevel = 0;
+}
+
+//! Picks the level of detail for the size of the node on screen
+void CMeshSceneNode::selectLODLevel()
+{
+	const ICameraSceneNode *camera = SceneManager->getActiveCamera();
+	if (LODLevels.empty() || !camera) {
+		CurrentLODLevel = 0;
+		return;
+	}
+
+	core::aabbox3df box = Mesh->getBoundingBox();
+	AbsoluteTransformation.transformBoxEx(box);
+	const f32 radius = box.getExtent().getLength() * 0.5f;
+
+	// fraction of the screen height covered by the bounding sphere,
+	// element 5 of the projection is the scale of the y axis
+	f32 screenSize = radius * fabsf(camera->getProjectionMatrix()[5]);
+	if (!camera->isOrthogonal()) {
+		const f32 distance = camera->getAbsolutePosition().getDistanceFrom(box.getCenter());
+		screenSize = distance > radius ? screenSize / distance : FLT_MAX;
+	}
+
+	u32 level = CurrentLODLevel;
+	while (level < LODLevels.size() && screenSize < LODLevels[level].ScreenSize * (1.f - LODHysteresis))
+		++level;
+	while (level > 0 && screenSize > LODLevels[level - 1].ScreenSize * (1.f + LODHysteresis))
+		--level;
+	CurrentLODLevel = level;
+}
+
 void CMeshSceneNode::copyMaterials()
 {
 	Materials.clear();
@@ -246,6 +359,10 @@ ISceneNode *CMeshSceneNode::clone(ISceneNode *newParent, ISceneManager *newManag
 	nb->cloneMembers(this, newManager);
 	nb->SharedMaterials = SharedMaterials;
 	nb->Materials = Materials;
+	nb->LODLevels = LODLevels;
+	for (const SLODLevel &level : LODLevels)
+		level.Mesh->grab();
+	nb->LODHysteresis = LODHysteresis;
 
 	if (newParent)
 		nb->drop();
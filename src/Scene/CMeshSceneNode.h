@@ -6,6 +6,7 @@
 
 #include "Scene/IMeshSceneNode.h"
 #include "Mesh/IMesh.h"
+#include "CSceneNodePool.h"
 
 
 namespace scene
@@ -13,6 +14,8 @@ namespace scene
 
 class CMeshSceneNode : public IMeshSceneNode
 {
+	IRR_POOLED_SCENE_NODE(CMeshSceneNode)
+
 public:
 	//! constructor
 	CMeshSceneNode(IMesh *mesh, ISceneNode *parent, ISceneManager *mgr, s32 id,
@@ -62,6 +65,27 @@ public:
 	\return Whether the materials are shared. */
 	bool isSharedMaterials() const override;
 
+	//! Adds a less detailed level to display when the node is small on screen.
+	bool addLODLevel(IMesh *mesh, f32 screenSize) override;
+
+	//! Creates levels of detail from the mesh of the node.
+	u32 generateLODLevels(u32 levels, f32 ratio = 0.5f, f32 screenSize = 0.5f) override;
+
+	//! Removes all levels of detail.
+	void clearLODLevels() override;
+
+	//! Get the amount of levels of detail, including the mesh of the node.
+	u32 getLODLevelCount() const override { return LODLevels.size() + 1; }
+
+	//! Get the level of detail displayed, 0 for the mesh of the node.
+	u32 getCurrentLODLevel() const override { return CurrentLODLevel; }
+
+	//! Sets how far the screen size has to pass the size of a level before switching.
+	void setLODHysteresis(f32 hysteresis) override { LODHysteresis = hysteresis; }
+
+	//! Get how far the screen size has to pass the size of a level before switching.
+	f32 getLODHysteresis() const override { return LODHysteresis; }
+
 	//! Creates a clone of this scene node and its children.
 	ISceneNode *clone(ISceneNode *newParent = 0, ISceneManager *newManager = 0) override;
 
@@ -73,11 +97,31 @@ public:
 protected:
 	void copyMaterials();
 
+	//! Picks the level of detail for the size of the node on screen
+	void selectLODLevel();
+
+	//! Returns the mesh of the current level of detail
+	IMesh *getLODMesh() const
+	{
+		return CurrentLODLevel ? LODLevels[CurrentLODLevel - 1].Mesh : Mesh;
+	}
+
 	std::vector<video::SMaterial> Materials;
 	core::aabbox3d<f32> Box{{0, 0, 0}};
 
 	IMesh *Mesh;
 
+	struct SLODLevel
+	{
+		IMesh *Mesh;
+		f32 ScreenSize;
+	};
+
+	//! Levels after the mesh of the node, in order of decreasing detail
+	std::vector<SLODLevel> LODLevels;
+	u32 CurrentLODLevel;
+	f32 LODHysteresis;
+
 	s32 PassCount;
 	bool SharedMaterials;
 };
@@ -4,10 +4,14 @@
 
 #include "CSceneCollisionManager.h"
 #include "Scene/ICameraSceneNode.h"
+#include "Scene/IMeshSceneNode.h"
+#include "CStaticBatchSceneNode.h"
 #include "Video/SViewFrustum.h"
 
 #include "Utils/irrMath.h"
 
+#include <algorithm>
+
 
 namespace scene
 {
@@ -23,6 +27,8 @@ CSceneCollisionManager::CSceneCollisionManager(ISceneManager *smanager, video::V
 //! destructor
 CSceneCollisionManager::~CSceneCollisionManager()
 {
+	clearTriangleBVHs();
+
 	if (Driver)
 		Driver->drop();
 }
@@ -64,4 +70,247 @@ core::line3d<f32> CSceneCollisionManager::getRayFromScreenCoordinates(
 	return ln;
 }
 
+//! Returns the bounding volume hierarchy of a mesh, building it on first use.
+const TriangleBVH *CSceneCollisionManager::getTriangleBVH(IMesh *mesh)
+{
+	const TriangleBVH *bvh = grabTriangleBVH(mesh);
+
+	// still held by the cache
+	if (bvh)
+		bvh->drop();
+	return bvh;
+}
+
+//! Returns the hierarchy of a mesh grabbed, so removing it meanwhile doesn't delete it
+const TriangleBVH *CSceneCollisionManager::grabTriangleBVH(IMesh *mesh)
+{
+	if (!mesh)
+		return nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(BVHLock);
+		auto it = BVHs.find(mesh);
+		if (it != BVHs.end()) {
+			it->second->grab();
+			return it->second;
+		}
+	}
+
+	// built unlocked, the build waits for jobs which may query meanwhile
+	TriangleBVH *bvh = new TriangleBVH(mesh);
+
+	std::lock_guard<std::mutex> lock(BVHLock);
+	auto inserted = BVHs.emplace(mesh, bvh);
+	if (!inserted.second) {
+		// built by another thread meanwhile
+		bvh->drop();
+		inserted.first->second->grab();
+		return inserted.first->second;
+	}
+
+	mesh->grab();
+	bvh->grab();
+	return bvh;
+}
+
+//! Removes the hierarchy of a mesh.
+void CSceneCollisionManager::removeTriangleBVH(IMesh *mesh)
+{
+	std::lock_guard<std::mutex> lock(BVHLock);
+	auto it = BVHs.find(mesh);
+	if (it == BVHs.end())
+		return;
+
+	it->second->drop();
+	it->first->drop();
+	BVHs.erase(it);
+}
+
+//! Removes the hierarchies of all meshes.
+void CSceneCollisionManager::clearTriangleBVHs()
+{
+	std::lock_guard<std::mutex> lock(BVHLock);
+	for (auto &it : BVHs) {
+		it.second->drop();
+		it.first->drop();
+	}
+	BVHs.clear();
+}
+
+namespace
+{
+//! Calls visit for a node if it is a mesh scene node passing the filters
+template <class Visit>
+void visitMeshSceneNode(ISceneNode *node, s32 idBitMask, bool noDebugObjects, const Visit &visit)
+{
+	if (node->getType() == ESNT_MESH && (!idBitMask || (node->getID() & idBitMask)) &&
+			!(noDebugObjects && node->isDebugObject())) {
+		IMesh *mesh = static_cast<IMeshSceneNode *>(node)->getMesh();
+		if (mesh)
+			visit(node, mesh);
+	}
+}
+
+//! Calls visit for the mesh scene nodes of a subtree passing the filters
+template <class Visit>
+void forEachMeshSceneNode(ISceneNode *node, s32 idBitMask, bool noDebugObjects, const Visit &visit)
+{
+	if (!node->isVisible())
+		return;
+
+	// Nodes merged into a batch are out of the scene. They are found instead
+	// of the merged chunks, with their ids and absolute transformations at
+	// the time they were batched.
+	if (node->getType() == ESNT_STATIC_BATCH) {
+		auto *batch = static_cast<CStaticBatchSceneNode *>(node);
+		if (batch->getReplacedNodeCount()) {
+			for (u32 i = 0; i < batch->getReplacedNodeCount(); ++i)
+				visitMeshSceneNode(batch->getReplacedNode(i), idBitMask, noDebugObjects, visit);
+			return;
+		}
+	}
+
+	visitMeshSceneNode(node, idBitMask, noDebugObjects, visit);
+
+	for (ISceneNode *child : node->getChildren())
+		forEachMeshSceneNode(child, idBitMask, noDebugObjects, visit);
+}
+
+//! Transforms a triangle of a hierarchy into world space
+void transformTriangle(const core::matrix4 &transformation, const core::vector3df *triangle,
+		core::vector3df *out)
+{
+	for (u32 k = 0; k < 3; ++k)
+		out[k] = transformation.transformVect(triangle[k]);
+}
+}
+
+//! Collects the mesh scene nodes whose bounding box is entered by a ray
+void CSceneCollisionManager::getRayCandidates(const core::line3df &ray, s32 idBitMask,
+		ISceneNode *root, bool noDebugObjects, std::vector<SRayCandidate> &candidates)
+{
+	if (!root)
+		root = SceneManager->getRootSceneNode();
+
+	forEachMeshSceneNode(root, idBitMask, noDebugObjects, [&](ISceneNode *node, IMesh *mesh) {
+		core::matrix4 inverse;
+		if (!node->getAbsoluteTransformation().getInverse(inverse))
+			return;
+
+		// the transformation keeps the fractions along the ray
+		SRayCandidate candidate{node, mesh,
+				core::line3df(inverse.transformVect(ray.start), inverse.transformVect(ray.end)), 0.f};
+		if (TriangleBVH::rayIntersectsBox(candidate.Ray, mesh->getBoundingBox(), candidate.Entry))
+			candidates.push_back(candidate);
+	});
+}
+
+//! Finds the scene node triangle hit first by a ray.
+ISceneNode *CSceneCollisionManager::getSceneNodeAndCollisionPointFromRay(const core::line3df &ray,
+		SCollisionHit &hit, s32 idBitMask, ISceneNode *root, bool noDebugObjects)
+{
+	std::vector<SRayCandidate> candidates;
+	getRayCandidates(ray, idBitMask, root, noDebugObjects, candidates);
+
+	// nearest bounding boxes first, stop at the first one behind the hit
+	std::sort(candidates.begin(), candidates.end(), [](const SRayCandidate &a, const SRayCandidate &b) {
+		return a.Entry < b.Entry;
+	});
+
+	ISceneNode *found = nullptr;
+	for (const SRayCandidate &candidate : candidates) {
+		if (found && candidate.Entry > hit.Fraction)
+			break;
+
+		const TriangleBVH *bvh = grabTriangleBVH(candidate.Mesh);
+		TriangleBVH::SHit bvhHit;
+		if (bvh->getClosestHit(candidate.Ray, bvhHit) && (!found || bvhHit.Fraction < hit.Fraction)) {
+			found = candidate.Node;
+			hit.Node = found;
+			hit.Fraction = bvhHit.Fraction;
+			hit.Point = ray.start + (ray.end - ray.start) * bvhHit.Fraction;
+			transformTriangle(found->getAbsoluteTransformation(), bvh->getTriangle(bvhHit.Triangle), hit.Triangle);
+			bvh->getTriangleSource(bvhHit.Triangle, hit.MeshBuffer, hit.FirstIndex);
+		}
+		bvh->drop();
+	}
+
+	return found;
+}
+
+//! Returns true if a ray hits any triangle of the scene.
+bool CSceneCollisionManager::isRayObstructed(const core::line3df &ray, s32 idBitMask,
+		ISceneNode *root, bool noDebugObjects)
+{
+	std::vector<SRayCandidate> candidates;
+	getRayCandidates(ray, idBitMask, root, noDebugObjects, candidates);
+
+	for (const SRayCandidate &candidate : candidates) {
+		const TriangleBVH *bvh = grabTriangleBVH(candidate.Mesh);
+		const bool obstructed = bvh->hasHit(candidate.Ray);
+		bvh->drop();
+		if (obstructed)
+			return true;
+	}
+	return false;
+}
+
+//! Appends the scene nodes with triangles intersecting a volume
+template <class TriangleTest>
+void CSceneCollisionManager::getSceneNodesInVolume(const core::aabbox3df &bounds,
+		const TriangleTest &triangleTest, std::vector<ISceneNode *> &nodes,
+		s32 idBitMask, ISceneNode *root, bool noDebugObjects)
+{
+	if (!root)
+		root = SceneManager->getRootSceneNode();
+
+	std::vector<u32> triangles;
+	forEachMeshSceneNode(root, idBitMask, noDebugObjects, [&](ISceneNode *node, IMesh *mesh) {
+		if (!node->getTransformedBoundingBox().intersectsWithBox(bounds))
+			return;
+
+		const core::matrix4 &transformation = node->getAbsoluteTransformation();
+		core::matrix4 inverse;
+		if (!transformation.getInverse(inverse))
+			return;
+
+		// the triangles in the bounds in the space of the node, then the exact test in world space
+		core::aabbox3df localBounds = bounds;
+		inverse.transformBoxEx(localBounds);
+
+		const TriangleBVH *bvh = grabTriangleBVH(mesh);
+		triangles.clear();
+		bvh->getTrianglesInBox(localBounds, triangles);
+
+		for (u32 i : triangles) {
+			core::vector3df triangle[3];
+			transformTriangle(transformation, bvh->getTriangle(i), triangle);
+			if (triangleTest(triangle)) {
+				nodes.push_back(node);
+				break;
+			}
+		}
+		bvh->drop();
+	});
+}
+
+//! Appends the scene nodes with triangles intersecting a box.
+void CSceneCollisionManager::getSceneNodesInBox(const core::aabbox3df &box,
+		std::vector<ISceneNode *> &nodes, s32 idBitMask, ISceneNode *root, bool noDebugObjects)
+{
+	getSceneNodesInVolume(box, [&](const core::vector3df *triangle) {
+		return TriangleBVH::boxIntersectsTriangle(box, triangle);
+	}, nodes, idBitMask, root, noDebugObjects);
+}
+
+//! Appends the scene nodes with triangles intersecting a sphere.
+void CSceneCollisionManager::getSceneNodesInSphere(const core::vector3df &center, f32 radius,
+		std::vector<ISceneNode *> &nodes, s32 idBitMask, ISceneNode *root, bool noDebugObjects)
+{
+	const core::aabbox3df bounds(center - core::vector3df(radius), center + core::vector3df(radius));
+	getSceneNodesInVolume(bounds, [&](const core::vector3df *triangle) {
+		return TriangleBVH::sphereIntersectsTriangle(center, radius, triangle);
+	}, nodes, idBitMask, root, noDebugObjects);
+}
+
 } // end namespace scene
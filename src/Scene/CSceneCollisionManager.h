@@ -7,6 +7,10 @@
 #include "Scene/ISceneCollisionManager.h"
 #include "Scene/ISceneManager.h"
 #include "Video/VideoDriver.h"
+#include "Mesh/TriangleBVH.h"
+
+#include <mutex>
+#include <unordered_map>
 
 
 namespace scene
@@ -25,9 +29,67 @@ public:
 	virtual core::line3d<f32> getRayFromScreenCoordinates(
 			const core::position2d<s32> &pos, const ICameraSceneNode *camera = 0) override;
 
+	//! Returns the bounding volume hierarchy of a mesh, building it on first use.
+	const TriangleBVH *getTriangleBVH(IMesh *mesh) override;
+
+	//! Removes the hierarchy of a mesh.
+	void removeTriangleBVH(IMesh *mesh) override;
+
+	//! Removes the hierarchies of all meshes.
+	void clearTriangleBVHs() override;
+
+	//! Finds the scene node triangle hit first by a ray.
+	ISceneNode *getSceneNodeAndCollisionPointFromRay(const core::line3df &ray,
+			SCollisionHit &hit, s32 idBitMask = 0, ISceneNode *root = 0,
+			bool noDebugObjects = false) override;
+
+	//! Returns true if a ray hits any triangle of the scene.
+	bool isRayObstructed(const core::line3df &ray, s32 idBitMask = 0,
+			ISceneNode *root = 0, bool noDebugObjects = false) override;
+
+	//! Appends the scene nodes with triangles intersecting a box.
+	void getSceneNodesInBox(const core::aabbox3df &box, std::vector<ISceneNode *> &nodes,
+			s32 idBitMask = 0, ISceneNode *root = 0, bool noDebugObjects = false) override;
+
+	//! Appends the scene nodes with triangles intersecting a sphere.
+	void getSceneNodesInSphere(const core::vector3df &center, f32 radius,
+			std::vector<ISceneNode *> &nodes, s32 idBitMask = 0, ISceneNode *root = 0,
+			bool noDebugObjects = false) override;
+
 private:
+	//! Returns the hierarchy of a mesh grabbed, so removing it meanwhile doesn't delete it
+	const TriangleBVH *grabTriangleBVH(IMesh *mesh);
+
+	//! A mesh scene node whose bounding box is entered by a ray
+	struct SRayCandidate
+	{
+		ISceneNode *Node;
+		IMesh *Mesh;
+
+		//! The ray in the space of the node
+		core::line3df Ray;
+
+		//! Where the ray enters the bounding box
+		f32 Entry;
+	};
+
+	//! Collects the mesh scene nodes whose bounding box is entered by a ray
+	void getRayCandidates(const core::line3df &ray, s32 idBitMask, ISceneNode *root,
+			bool noDebugObjects, std::vector<SRayCandidate> &candidates);
+
+	//! Appends the scene nodes with triangles intersecting a volume
+	/** \param bounds Bounding box of the volume in world space.
+	\param triangleTest Exact test of a triangle in world space. */
+	template <class TriangleTest>
+	void getSceneNodesInVolume(const core::aabbox3df &bounds, const TriangleTest &triangleTest,
+			std::vector<ISceneNode *> &nodes, s32 idBitMask, ISceneNode *root, bool noDebugObjects);
+
 	ISceneManager *SceneManager;
 	video::VideoDriver *Driver;
+
+	//! Hierarchies of the queried meshes, which are grabbed meanwhile
+	std::unordered_map<IMesh *, TriangleBVH *> BVHs;
+	std::mutex BVHLock;
 };
 
 } // end namespace scene
@@ -4,6 +4,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <map>
+#include <tuple>
 
 #include "CSceneManager.h"
 #include "Video/VideoDriver.h"
@@ -17,17 +20,23 @@
 
 #include "Device/Logger.h"
 #include "Device/Timer.h"
+#include "Device/JobSystem.h"
 
 #include "Mesh/SkinnedMesh.h"
 #include "Mesh/CXMeshFileLoader.h"
 #include "Mesh/COBJMeshFileLoader.h"
 #include "Mesh/CB3DMeshFileLoader.h"
+#include "Mesh/CGLTFMeshFileLoader.h"
+#include "Mesh/CBinaryMeshFileLoader.h"
+#include "Mesh/CBinaryMeshWriter.h"
+#include "Mesh/SBinaryMeshFormat.h"
 #include "CBillboardSceneNode.h"
 #include "CAnimatedMeshSceneNode.h"
 #include "CCameraSceneNode.h"
 #include "CMeshSceneNode.h"
 #include "CDummyTransformationSceneNode.h"
 #include "CEmptySceneNode.h"
+#include "CStaticBatchSceneNode.h"
 
 #include "CSceneCollisionManager.h"
 
@@ -41,6 +50,8 @@ CSceneManager::CSceneManager(video::VideoDriver *driver,
 		ISceneNode(0, 0),
 		Driver(driver),
 		CursorControl(cursorControl),
+		DepthScale(0.f), RenderedMeshBuffer(-1),
+		ParallelUpdate(false),
 		ActiveCamera(0),
 		MeshCache(cache), CurrentRenderPass(ESNRP_NONE)
 {
@@ -71,6 +82,8 @@ CSceneManager::CSceneManager(video::VideoDriver *driver,
 	MeshLoaderList.push_back(new CXMeshFileLoader(this));
 	MeshLoaderList.push_back(new COBJMeshFileLoader(this));
 	MeshLoaderList.push_back(new CB3DMeshFileLoader(this));
+	MeshLoaderList.push_back(new CGLTFMeshFileLoader(this));
+	MeshLoaderList.push_back(new CBinaryMeshFileLoader(this));
 }
 
 //! destructor
@@ -78,6 +91,19 @@ CSceneManager::~CSceneManager()
 {
 	clearDeletionList();
 
+	// the workers may still use the loaders
+	for (auto &load : MeshLoads) {
+		if (g_irrjobs)
+			g_irrjobs->wait(load->Parsed);
+		if (load->File) {
+			// parsed meshes aren't in the cache yet
+			if (load->Mesh)
+				load->Mesh->drop();
+			load->File->drop();
+		}
+	}
+	MeshLoads.clear();
+
 	if (CursorControl)
 		CursorControl->drop();
 
@@ -119,6 +145,87 @@ IAnimatedMesh *CSceneManager::getMesh(io::IReadFile *file)
 	return msh;
 }
 
+//! gets a mesh, using a converted copy in the cache directory if possible
+IAnimatedMesh *CSceneManager::getCachedMesh(io::IReadFile *file, const io::path &cacheDirectory)
+{
+	if (!file)
+		return 0;
+
+	io::path name = file->getFileName();
+	IAnimatedMesh *msh = MeshCache->getMeshByName(name);
+	if (msh)
+		return msh;
+
+	io::IFileSystem *fs = Driver ? Driver->getFileSystem() : nullptr;
+	std::vector<u8> data(file->getSize());
+	file->seek(0);
+	if (!fs || file->read(data.data(), data.size()) != data.size())
+		return getUncachedMesh(file, name, name);
+
+	// FNV-1a of the name and the contents, reading is much cheaper than parsing.
+	// The name is included as textures are found relative to the file.
+	u64 hash = 0xcbf29ce484222325ULL;
+	const auto addBytes = [&hash](const u8 *bytes, size_t size) {
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ULL;
+		}
+	};
+	addBytes(reinterpret_cast<const u8 *>(name.c_str()), name.size());
+	addBytes(data.data(), data.size());
+
+	c8 hashName[17];
+	snprintf(hashName, sizeof(hashName), "%016llx", (unsigned long long)hash);
+	const io::path cachePath = cacheDirectory + "/" + hashName + "." + binarymesh::EXTENSION;
+
+	if (fs->existFile(cachePath)) {
+		io::IReadFile *cached = fs->createAndOpenFile(cachePath);
+		if (cached) {
+			CBinaryMeshFileLoader loader(this);
+			msh = loader.createMesh(cached);
+			cached->drop();
+		}
+
+		if (msh) {
+			MeshCache->addMesh(name, msh);
+			msh->drop();
+			g_irrlogger->log("Loaded mesh from cache", cachePath, ELL_DEBUG);
+			return msh;
+		}
+	}
+
+	msh = getUncachedMesh(file, name, name);
+	if (!msh)
+		return nullptr;
+
+	// baking is done once, so it is worth optimizing the mesh for rendering
+	getMeshManipulator()->optimizeForGPU(msh);
+
+	// Invalid or outdated copies are replaced. The copy is written under
+	// another name first, so a failed write doesn't leave a broken file.
+	const io::path tempPath = cachePath + ".tmp";
+	io::IWriteFile *cacheFile = fs->createAndWriteFile(tempPath);
+	bool written = false;
+	if (cacheFile) {
+		CBinaryMeshWriter writer;
+		written = writer.writeMesh(cacheFile, msh);
+		cacheFile->drop();
+	}
+
+	if (written) {
+		// rename() doesn't replace existing files everywhere
+		std::remove(cachePath.c_str());
+		written = std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+	}
+
+	if (!written) {
+		std::remove(tempPath.c_str());
+		g_irrlogger->log("Could not write mesh to cache", cachePath, ELL_WARNING);
+	}
+
+	return msh;
+}
+
 // load and create a mesh which we know already isn't in the cache and put it in there
 IAnimatedMesh *CSceneManager::getUncachedMesh(io::IReadFile *file, const io::path &filename, const io::path &cachename)
 {
@@ -147,6 +254,120 @@ IAnimatedMesh *CSceneManager::getUncachedMesh(io::IReadFile *file, const io::pat
 	return nullptr;
 }
 
+//! loads a mesh on the job system, see finishMeshLoads()
+void CSceneManager::getMeshAsync(io::IReadFile *file, std::function<void(IAnimatedMesh *mesh)> onLoaded)
+{
+	if (!file) {
+		if (onLoaded)
+			onLoaded(nullptr);
+		return;
+	}
+
+	auto load = std::make_unique<SMeshLoad>();
+	load->Name = file->getFileName();
+	load->OnLoaded = std::move(onLoaded);
+
+	io::IFileSystem *fs = Driver ? Driver->getFileSystem() : nullptr;
+	if (MeshCache->getMeshByName(load->Name) || !fs || !g_irrjobs) {
+		// nothing to do on a worker, the callback is still called by finishMeshLoads()
+		load->Mesh = getMesh(file);
+		MeshLoads.push_back(std::move(load));
+		return;
+	}
+
+	// the caller may drop the file right away and most files aren't thread safe
+	const long size = file->getSize();
+	c8 *data = new c8[core::max_(size, 1L)];
+	file->seek(0);
+	if (file->read(data, size) != (size_t)size) {
+		delete[] data;
+		g_irrlogger->log("Could not read mesh", load->Name, ELL_ERROR);
+		MeshLoads.push_back(std::move(load));
+		return;
+	}
+	load->File = fs->createMemoryReadFile(data, size, load->Name, true);
+
+	// only the loader which getMesh() would try first is used on a worker
+	for (auto it = MeshLoaderList.rbegin(); it != MeshLoaderList.rend(); it++) {
+		if ((*it)->isALoadableFileExtension(load->Name)) {
+			if ((*it)->isReentrant())
+				load->Loader = *it;
+			break;
+		}
+	}
+
+	if (load->Loader) {
+		SMeshLoad *job = load.get();
+		g_irrjobs->run([job]() {
+			job->Mesh = job->Loader->createMesh(job->File);
+		}, &job->Parsed);
+	}
+	MeshLoads.push_back(std::move(load));
+}
+
+//! adds the meshes loaded in the meantime to the cache and calls their callbacks
+u32 CSceneManager::finishMeshLoads(bool wait)
+{
+	// callbacks may start new loads, so they are called after the list is updated
+	std::vector<std::unique_ptr<SMeshLoad>> finished;
+
+	for (auto &load : MeshLoads) {
+		if (!load->Parsed.isDone()) {
+			if (!wait)
+				continue;
+			g_irrjobs->wait(load->Parsed);
+		}
+
+		if (load->File) {
+			if (load->Mesh) {
+				IAnimatedMesh *cached = MeshCache->getMeshByName(load->Name);
+				if (cached) {
+					// loaded twice at the same time, keep the first one
+					load->Mesh->drop();
+					load->Mesh = cached;
+				} else {
+					MeshCache->addMesh(load->Name, load->Mesh);
+					load->Mesh->drop();
+					g_irrlogger->log("Loaded mesh", load->Name, ELL_DEBUG);
+				}
+			} else {
+				// not reentrant or failed, getMesh() tries the other loaders
+				load->File->seek(0);
+				load->Mesh = getMesh(load->File);
+			}
+			load->File->drop();
+			load->File = nullptr;
+		}
+
+		finished.push_back(std::move(load));
+	}
+
+	MeshLoads.erase(std::remove(MeshLoads.begin(), MeshLoads.end(), nullptr), MeshLoads.end());
+
+	for (auto &load : finished) {
+		if (load->OnLoaded)
+			load->OnLoaded(load->Mesh);
+	}
+
+	return MeshLoads.size();
+}
+
+//! loads several meshes in parallel and waits for them
+std::vector<IAnimatedMesh *> CSceneManager::getMeshes(const std::vector<io::IReadFile *> &files)
+{
+	std::vector<IAnimatedMesh *> meshes(files.size(), nullptr);
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		IAnimatedMesh **mesh = &meshes[i];
+		getMeshAsync(files[i], [mesh](IAnimatedMesh *loaded) {
+			*mesh = loaded;
+		});
+	}
+
+	finishMeshLoads(true);
+	return meshes;
+}
+
 //! returns the video driver
 video::VideoDriver *CSceneManager::getVideoDriver()
 {
@@ -254,6 +475,151 @@ IDummyTransformationSceneNode *CSceneManager::addDummyTransformationSceneNode(
 	return node;
 }
 
+namespace
+{
+//! Returns true if the node is a static mesh scene node which can be batched
+bool isBatchableNode(ISceneNode *node, const MeshManipulator *manipulator, const video::VideoDriver *driver)
+{
+	if (node->getType() != ESNT_MESH || node->isDebugObject())
+		return false;
+
+	auto *meshNode = static_cast<IMeshSceneNode *>(node);
+	IMesh *mesh = meshNode->getMesh();
+	if (!mesh || !mesh->getMeshBufferCount() || mesh->getMeshType() == EAMT_SKINNED ||
+			meshNode->getLODLevelCount() > 1)
+		return false;
+
+	// transparent buffers are sorted by the distance of their node, which
+	// a merged buffer can't do
+	for (u32 i = 0; i < mesh->getMeshBufferCount(); ++i) {
+		if (!manipulator->isBatchable(mesh->getMeshBuffer(i)) ||
+				driver->needsTransparentRenderPass(meshNode->getMaterial(i)))
+			return false;
+	}
+	return true;
+}
+
+//! Returns true if nodes of the type don't move themselves or their children
+/** Nodes are moved in OnAnimate(). Animated meshes move their joints, and
+cameras and unknown nodes, e.g. joints or custom nodes, may move too. */
+bool isStaticNodeType(ESCENE_NODE_TYPE type)
+{
+	return type == ESNT_SCENE_MANAGER || type == ESNT_EMPTY || type == ESNT_DUMMY_TRANSFORMATION ||
+			type == ESNT_MESH || type == ESNT_STATIC_BATCH;
+}
+
+//! Collects the batchable nodes of a subtree, children before their parents
+/** Updates the absolute transformations on the way down.
+\param moving True if an ancestor of the node may move.
+\return True if the node and all its children are batchable. */
+bool collectBatchableNodes(ISceneNode *node, const MeshManipulator *manipulator,
+		const video::VideoDriver *driver, bool moving, std::vector<IMeshSceneNode *> &nodes)
+{
+	// hidden subtrees aren't drawn, batches aren't batched again
+	if (!node->isVisible() || node->getType() == ESNT_STATIC_BATCH)
+		return false;
+
+	// merged nodes would stop following a moving parent
+	if (moving || !isStaticNodeType(node->getType()))
+		return false;
+
+	node->updateAbsolutePosition();
+
+	bool batchable = true;
+	for (ISceneNode *child : node->getChildren()) {
+		if (!collectBatchableNodes(child, manipulator, driver, false, nodes))
+			batchable = false;
+	}
+
+	if (!batchable || !isBatchableNode(node, manipulator, driver))
+		return false;
+
+	nodes.push_back(static_cast<IMeshSceneNode *>(node));
+	return true;
+}
+}
+
+//! Merges the static mesh scene nodes of a subtree into few large mesh buffers.
+ISceneNode *CSceneManager::batchStaticGeometry(ISceneNode *root, f32 chunkSize, s32 id)
+{
+	if (!root)
+		root = this;
+
+	// the absolute transformations below depend on the ones of the parents
+	std::vector<ISceneNode *> ancestors;
+	bool moving = false;
+	for (ISceneNode *node = root->getParent(); node; node = node->getParent()) {
+		ancestors.push_back(node);
+		moving = moving || !isStaticNodeType(node->getType());
+	}
+	for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it)
+		(*it)->updateAbsolutePosition();
+
+	MeshManipulator *manipulator = getMeshManipulator();
+
+	std::vector<IMeshSceneNode *> nodes;
+	collectBatchableNodes(root, manipulator, Driver, moving, nodes);
+	if (nodes.empty()) {
+		g_irrlogger->log("No static mesh scene nodes to batch", ELL_INFORMATION);
+		return nullptr;
+	}
+
+	// buffers go to the chunk of the center of their bounding box in world space
+	std::map<std::tuple<s32, s32, s32>, std::vector<MeshManipulator::SBatchedBuffer>> chunks;
+	for (IMeshSceneNode *node : nodes) {
+		IMesh *mesh = node->getMesh();
+		const core::matrix4 &transformation = node->getAbsoluteTransformation();
+
+		for (u32 i = 0; i < mesh->getMeshBufferCount(); ++i) {
+			const IMeshBuffer *buffer = mesh->getMeshBuffer(i);
+
+			std::tuple<s32, s32, s32> chunk{0, 0, 0};
+			if (chunkSize > 0.f) {
+				core::aabbox3df box = buffer->getBoundingBox();
+				transformation.transformBoxEx(box);
+				const core::vector3df center = box.getCenter() / chunkSize;
+				chunk = {core::floor32(center.X), core::floor32(center.Y), core::floor32(center.Z)};
+			}
+
+			chunks[chunk].push_back({buffer, &node->getMaterial(i), transformation});
+		}
+	}
+
+	CStaticBatchSceneNode *batch = new CStaticBatchSceneNode(this, this, id);
+
+	u32 bufferCount = 0;
+	for (const auto &chunk : chunks) {
+		SMesh *mesh = manipulator->createBatchedMesh(chunk.second);
+		if (mesh->getMeshBufferCount()) {
+			batch->addChunk(mesh);
+			bufferCount += mesh->getMeshBufferCount();
+		}
+		mesh->drop();
+	}
+
+	for (IMeshSceneNode *node : nodes)
+		batch->replaceNode(node);
+
+	c8 text[128];
+	snprintf(text, sizeof(text), "Batched %u scene nodes into %u mesh buffers in %u chunks",
+			(u32)nodes.size(), bufferCount, (u32)batch->getChildren().size());
+	g_irrlogger->log(text, ELL_DEBUG);
+
+	batch->drop();
+	return batch;
+}
+
+//! Restores the scene nodes batched by batchStaticGeometry() and removes the batch.
+bool CSceneManager::unbatchStaticGeometry(ISceneNode *batch)
+{
+	if (!batch || batch->getType() != ESNT_STATIC_BATCH)
+		return false;
+
+	static_cast<CStaticBatchSceneNode *>(batch)->restoreReplacedNodes();
+	batch->remove();
+	return true;
+}
+
 //! Returns the root scene node. This is the scene node which is parent
 //! of all scene nodes. The root scene node is a special scene node which
 //! only exists to manage all scene nodes. It is not rendered and cannot
@@ -364,34 +730,35 @@ bool CSceneManager::isCulled(const ISceneNode *node) const
 u32 CSceneManager::registerNodeForRendering(ISceneNode *node, E_SCENE_NODE_RENDER_PASS pass)
 {
 	u32 taken = 0;
+	SRenderLists &lists = getRenderLists();
 
 	switch (pass) {
 		// take camera if it is not already registered
 	case ESNRP_CAMERA: {
-		if (std::find(CameraList.begin(), CameraList.end(), node) == CameraList.end()) {
+		if (std::find(lists.CameraList.begin(), lists.CameraList.end(), node) == lists.CameraList.end()) {
 			taken = 1;
-			CameraList.push_back(node);
+			lists.CameraList.push_back(node);
 		}
 	} break;
 	case ESNRP_SKY_BOX:
-		SkyBoxList.push_back(node);
+		lists.SkyBoxList.push_back(node);
 		taken = 1;
 		break;
 	case ESNRP_SOLID:
 		if (!isCulled(node)) {
-			SolidNodeList.emplace_back(node);
+			lists.SolidNodeList.emplace_back(node, camWorldPos, DepthScale);
 			taken = 1;
 		}
 		break;
 	case ESNRP_TRANSPARENT:
 		if (!isCulled(node)) {
-			TransparentNodeList.emplace_back(node, camWorldPos);
+			lists.TransparentNodeList.emplace_back(node, camWorldPos);
 			taken = 1;
 		}
 		break;
 	case ESNRP_TRANSPARENT_EFFECT:
 		if (!isCulled(node)) {
-			TransparentEffectNodeList.emplace_back(node, camWorldPos);
+			lists.TransparentEffectNodeList.emplace_back(node, camWorldPos);
 			taken = 1;
 		}
 		break;
@@ -403,7 +770,7 @@ u32 CSceneManager::registerNodeForRendering(ISceneNode *node, E_SCENE_NODE_RENDE
 			for (u32 i = 0; i < count; ++i) {
 				if (Driver->needsTransparentRenderPass(node->getMaterial(i))) {
 					// register as transparent node
-					TransparentNodeList.emplace_back(node, camWorldPos);
+					lists.TransparentNodeList.emplace_back(node, camWorldPos);
 					taken = 1;
 					break;
 				}
@@ -411,14 +778,14 @@ u32 CSceneManager::registerNodeForRendering(ISceneNode *node, E_SCENE_NODE_RENDE
 
 			// not transparent, register as solid
 			if (!taken) {
-				SolidNodeList.emplace_back(node);
+				lists.SolidNodeList.emplace_back(node, camWorldPos, DepthScale);
 				taken = 1;
 			}
 		}
 		break;
 	case ESNRP_GUI:
 		if (!isCulled(node)) {
-			GuiNodeList.push_back(node);
+			lists.GuiNodeList.push_back(node);
 			taken = 1;
 		}
 
@@ -429,14 +796,24 @@ u32 CSceneManager::registerNodeForRendering(ISceneNode *node, E_SCENE_NODE_RENDE
 	return taken;
 }
 
+//! Registers a single mesh buffer of a node for one of the transparent render passes.
+void CSceneManager::registerMeshBufferForRendering(ISceneNode *node, u32 buffer,
+		const core::vector3df &center, E_SCENE_NODE_RENDER_PASS pass)
+{
+	SRenderLists &lists = getRenderLists();
+
+	if (pass == ESNRP_TRANSPARENT_EFFECT)
+		lists.TransparentEffectNodeList.emplace_back(node, buffer, center, camWorldPos);
+	else
+		lists.TransparentNodeList.emplace_back(node, buffer, center, camWorldPos);
+}
+
 void CSceneManager::clearAllRegisteredNodesForRendering()
 {
-	CameraList.clear();
-	SkyBoxList.clear();
-	SolidNodeList.clear();
-	TransparentNodeList.clear();
-	TransparentEffectNodeList.clear();
-	GuiNodeList.clear();
+	RenderLists.clear();
+
+	for (auto &lists : RootRenderLists)
+		lists.clear();
 }
 
 //! This method is called just before the rendering process of the whole scene.
@@ -455,21 +832,35 @@ void CSceneManager::drawAll()
 		Driver->setTransform((video::E_TRANSFORMATION_STATE)i, core::IdentityMatrix);
 	Driver->setAllowZWriteOnTransparent(true);
 
+	const u32 timeMs = os::Timer::getTime();
+	const bool parallel = ParallelUpdate && g_irrjobs;
+
 	// do animations and other stuff.
-	OnAnimate(os::Timer::getTime());
+	if (parallel)
+		animateParallel(timeMs);
+	else
+		OnAnimate(timeMs);
 
 	/*!
 		First Scene Node for prerendering should be the active camera
 		consistent Camera is needed for culling
 	*/
 	camWorldPos.set(0, 0, 0);
+	DepthScale = 0.f;
 	if (ActiveCamera) {
 		ActiveCamera->render();
 		camWorldPos = ActiveCamera->getAbsolutePosition();
+
+		if (ActiveCamera->getFarValue() > 0.f)
+			DepthScale = 65535.f / ActiveCamera->getFarValue();
 	}
 
 	// let all nodes register themselves
-	OnRegisterSceneNode();
+	if (parallel) {
+		registerParallel();
+		prepareSkinningParallel();
+	} else
+		OnRegisterSceneNode();
 
 	const auto &render_node = [this] (ISceneNode *node) {
 		u32 flags = node->isDebugDataVisible();
@@ -482,10 +873,10 @@ void CSceneManager::drawAll()
 		CurrentRenderPass = ESNRP_CAMERA;
 		Driver->getOverrideMaterial().Enabled = ((Driver->getOverrideMaterial().EnablePasses & CurrentRenderPass) != 0);
 
-		for (auto *node : CameraList)
+		for (auto *node : RenderLists.CameraList)
 			render_node(node);
 
-		CameraList.clear();
+		RenderLists.CameraList.clear();
 	}
 
 	// render skyboxes
@@ -493,10 +884,10 @@ void CSceneManager::drawAll()
 		CurrentRenderPass = ESNRP_SKY_BOX;
 		Driver->getOverrideMaterial().Enabled = ((Driver->getOverrideMaterial().EnablePasses & CurrentRenderPass) != 0);
 
-		for (auto *node : SkyBoxList)
+		for (auto *node : RenderLists.SkyBoxList)
 			render_node(node);
 
-		SkyBoxList.clear();
+		RenderLists.SkyBoxList.clear();
 	}
 
 	// render default objects
@@ -504,12 +895,12 @@ void CSceneManager::drawAll()
 		CurrentRenderPass = ESNRP_SOLID;
 		Driver->getOverrideMaterial().Enabled = ((Driver->getOverrideMaterial().EnablePasses & CurrentRenderPass) != 0);
 
-		std::sort(SolidNodeList.begin(), SolidNodeList.end());
+		sortRenderList(RenderLists.SolidNodeList);
 
-		for (auto &it : SolidNodeList)
-			render_node(it.Node);
+		for (const auto &entry : SortEntries)
+			render_node(RenderLists.SolidNodeList[entry.Index].Node);
 
-		SolidNodeList.clear();
+		RenderLists.SolidNodeList.clear();
 	}
 
 	// render transparent objects.
@@ -517,12 +908,16 @@ void CSceneManager::drawAll()
 		CurrentRenderPass = ESNRP_TRANSPARENT;
 		Driver->getOverrideMaterial().Enabled = ((Driver->getOverrideMaterial().EnablePasses & CurrentRenderPass) != 0);
 
-		std::sort(TransparentNodeList.begin(), TransparentNodeList.end());
+		sortRenderList(RenderLists.TransparentNodeList);
 
-		for (auto &it : TransparentNodeList)
+		for (const auto &entry : SortEntries) {
+			const auto &it = RenderLists.TransparentNodeList[entry.Index];
+			RenderedMeshBuffer = it.MeshBuffer;
 			render_node(it.Node);
+		}
+		RenderedMeshBuffer = -1;
 
-		TransparentNodeList.clear();
+		RenderLists.TransparentNodeList.clear();
 	}
 
 	// render transparent effect objects.
@@ -530,12 +925,16 @@ void CSceneManager::drawAll()
 		CurrentRenderPass = ESNRP_TRANSPARENT_EFFECT;
 		Driver->getOverrideMaterial().Enabled = ((Driver->getOverrideMaterial().EnablePasses & CurrentRenderPass) != 0);
 
-		std::sort(TransparentEffectNodeList.begin(), TransparentEffectNodeList.end());
+		sortRenderList(RenderLists.TransparentEffectNodeList);
 
-		for (auto &it : TransparentEffectNodeList)
+		for (const auto &entry : SortEntries) {
+			const auto &it = RenderLists.TransparentEffectNodeList[entry.Index];
+			RenderedMeshBuffer = it.MeshBuffer;
 			render_node(it.Node);
+		}
+		RenderedMeshBuffer = -1;
 
-		TransparentEffectNodeList.clear();
+		RenderLists.TransparentEffectNodeList.clear();
 	}
 
 	// render custom gui nodes
@@ -543,16 +942,164 @@ void CSceneManager::drawAll()
 		CurrentRenderPass = ESNRP_GUI;
 		Driver->getOverrideMaterial().Enabled = ((Driver->getOverrideMaterial().EnablePasses & CurrentRenderPass) != 0);
 
-		for (auto *node : GuiNodeList)
+		for (auto *node : RenderLists.GuiNodeList)
 			render_node(node);
 
-		GuiNodeList.clear();
+		RenderLists.GuiNodeList.clear();
 	}
 	clearDeletionList();
 
 	CurrentRenderPass = ESNRP_NONE;
 }
 
+thread_local CSceneManager::SRenderLists *CSceneManager::ThreadRenderLists = nullptr;
+
+void CSceneManager::SRenderLists::clear()
+{
+	CameraList.clear();
+	SkyBoxList.clear();
+	SolidNodeList.clear();
+	TransparentNodeList.clear();
+	TransparentEffectNodeList.clear();
+	GuiNodeList.clear();
+}
+
+void CSceneManager::SRenderLists::append(const SRenderLists &other)
+{
+	for (auto *node : other.CameraList) {
+		if (std::find(CameraList.begin(), CameraList.end(), node) == CameraList.end())
+			CameraList.push_back(node);
+	}
+
+	SkyBoxList.insert(SkyBoxList.end(), other.SkyBoxList.begin(), other.SkyBoxList.end());
+	SolidNodeList.insert(SolidNodeList.end(), other.SolidNodeList.begin(), other.SolidNodeList.end());
+	TransparentNodeList.insert(TransparentNodeList.end(),
+			other.TransparentNodeList.begin(), other.TransparentNodeList.end());
+	TransparentEffectNodeList.insert(TransparentEffectNodeList.end(),
+			other.TransparentEffectNodeList.begin(), other.TransparentEffectNodeList.end());
+	GuiNodeList.insert(GuiNodeList.end(), other.GuiNodeList.begin(), other.GuiNodeList.end());
+}
+
+CSceneManager::SRenderLists &CSceneManager::getRenderLists()
+{
+	return ThreadRenderLists ? *ThreadRenderLists : RenderLists;
+}
+
+template <class T>
+void CSceneManager::sortRenderList(const std::vector<T> &list)
+{
+	SortEntries.resize(list.size());
+	for (u32 i = 0; i < list.size(); ++i)
+		SortEntries[i] = {list[i].Key, i};
+
+	core::radixSort(SortEntries, SortScratch);
+}
+
+//! Enables running the animation and registration passes on several threads.
+void CSceneManager::setParallelSceneUpdate(bool enable)
+{
+	if (enable && !g_irrjobs) {
+		g_irrlogger->log("No job system available, the scene is updated single threaded.", ELL_WARNING);
+		return;
+	}
+
+	ParallelUpdate = enable;
+
+	if (!enable)
+		RootRenderLists.clear();
+}
+
+//! Returns if the animation and registration passes are run in parallel.
+bool CSceneManager::isParallelSceneUpdateEnabled() const
+{
+	return ParallelUpdate;
+}
+
+//! Animates the subtrees of the root node on the worker threads.
+void CSceneManager::animateParallel(u32 timeMs)
+{
+	// same as ISceneNode::OnAnimate(), but with the children of the
+	// root node being independent tasks
+	if (!IsVisible)
+		return;
+
+	updateAbsolutePosition();
+
+	ParallelRoots.assign(Children.begin(), Children.end());
+
+	// one subtree per job, they differ a lot in size
+	g_irrjobs->parallelFor(0, (u32)ParallelRoots.size(), 1, [this, timeMs](u32 begin, u32 end) {
+		for (u32 i = begin; i < end; ++i)
+			ParallelRoots[i]->OnAnimate(timeMs);
+	});
+}
+
+//! Lets the subtrees of the root node register themselves on the worker threads.
+void CSceneManager::registerParallel()
+{
+	if (!IsVisible)
+		return;
+
+	ParallelRoots.assign(Children.begin(), Children.end());
+
+	if (RootRenderLists.size() < ParallelRoots.size())
+		RootRenderLists.resize(ParallelRoots.size());
+
+	g_irrjobs->parallelFor(0, (u32)ParallelRoots.size(), 1, [this](u32 begin, u32 end) {
+		// A node waiting for jobs may run other ranges on this thread in
+		// between, they have to give the lists of this range back.
+		SRenderLists *previous = ThreadRenderLists;
+
+		for (u32 i = begin; i < end; ++i) {
+			ThreadRenderLists = &RootRenderLists[i];
+			ParallelRoots[i]->OnRegisterSceneNode();
+		}
+
+		ThreadRenderLists = previous;
+	});
+
+	// Merged in the order of the children, so the lists are the same as
+	// after a serial OnRegisterSceneNode(). Not all of them are sorted, and
+	// the sort keeps the order of equal keys.
+	for (u32 i = 0; i < ParallelRoots.size(); ++i) {
+		RenderLists.append(RootRenderLists[i]);
+		RootRenderLists[i].clear();
+	}
+}
+
+//! Skins the visible animated meshes on the worker threads.
+void CSceneManager::prepareSkinningParallel()
+{
+	SkinningNodes.clear();
+
+	const auto &collect = [this](ISceneNode *node) {
+		if (node->getType() != ESNT_ANIMATED_MESH)
+			return;
+
+		auto *animated = dynamic_cast<CAnimatedMeshSceneNode *>(node);
+		if (animated && animated->getMesh() && animated->getMesh()->getMeshType() == EAMT_SKINNED)
+			SkinningNodes.push_back(animated);
+	};
+
+	for (auto &entry : RenderLists.SolidNodeList)
+		collect(entry.Node);
+	for (auto &entry : RenderLists.TransparentNodeList)
+		collect(entry.Node);
+	for (auto &entry : RenderLists.TransparentEffectNodeList)
+		collect(entry.Node);
+
+	// Nodes registered for several passes appear multiple times. Each node
+	// skins its own instance of the mesh, so nodes sharing a mesh don't
+	// interfere with each other.
+	std::sort(SkinningNodes.begin(), SkinningNodes.end());
+	SkinningNodes.erase(std::unique(SkinningNodes.begin(), SkinningNodes.end()), SkinningNodes.end());
+
+	g_irrjobs->parallelFor(0, (u32)SkinningNodes.size(), 1, [this](u32 begin, u32 end) {
+		for (u32 i = begin; i < end; ++i)
+			SkinningNodes[i]->prepareMeshForCurrentFrame();
+	});
+}
+
 //! Adds an external mesh loader.
 void CSceneManager::addExternalMeshLoader(IMeshLoader *externalLoader)
 {
@@ -596,6 +1143,9 @@ void CSceneManager::addToDeletionQueue(ISceneNode *node)
 	if (!node)
 		return;
 
+	// may be called by the nodes from the worker threads
+	std::lock_guard<std::mutex> lock(DeletionListLock);
+
 	node->grab();
 	DeletionList.push_back(node);
 }
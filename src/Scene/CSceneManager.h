@@ -11,6 +11,12 @@
 #include "Utils/irrString.h"
 #include "Utils/irrArray.h"
 #include "Mesh/IMeshLoader.h"
+#include "Utils/irrRadixSort.h"
+
+#include "Device/JobSystem.h"
+
+#include <memory>
+#include <mutex>
 
 
 namespace io
@@ -22,6 +28,7 @@ namespace scene
 class IMeshCache;
 
 class SkinnedMesh;
+class CAnimatedMeshSceneNode;
 
 /*!
 	The Scene Manager manages scene nodes, mesh resources, cameras and all the other stuff.
@@ -38,6 +45,18 @@ public:
 	//! gets an animateable mesh. loads it if needed. returned pointer must not be dropped.
 	IAnimatedMesh *getMesh(io::IReadFile *file) override;
 
+	//! gets a mesh, using a converted copy in the cache directory if possible
+	IAnimatedMesh *getCachedMesh(io::IReadFile *file, const io::path &cacheDirectory) override;
+
+	//! loads a mesh on the job system, see finishMeshLoads()
+	void getMeshAsync(io::IReadFile *file, std::function<void(IAnimatedMesh *mesh)> onLoaded) override;
+
+	//! adds the meshes loaded in the meantime to the cache and calls their callbacks
+	u32 finishMeshLoads(bool wait = false) override;
+
+	//! loads several meshes in parallel and waits for them
+	std::vector<IAnimatedMesh *> getMeshes(const std::vector<io::IReadFile *> &files) override;
+
 	//! Returns an interface to the mesh cache which is shared between all existing scene managers.
 	IMeshCache *getMeshCache() override;
 
@@ -68,12 +87,25 @@ public:
 	//! registers a node for rendering it at a specific time.
 	u32 registerNodeForRendering(ISceneNode *node, E_SCENE_NODE_RENDER_PASS pass = ESNRP_AUTOMATIC) override;
 
+	//! Registers a single mesh buffer of a node for one of the transparent render passes.
+	void registerMeshBufferForRendering(ISceneNode *node, u32 buffer,
+			const core::vector3df &center, E_SCENE_NODE_RENDER_PASS pass = ESNRP_TRANSPARENT) override;
+
+	//! Returns the mesh buffer the node currently rendered has to draw.
+	s32 getRenderedMeshBuffer() const override { return RenderedMeshBuffer; }
+
 	//! Clear all nodes which are currently registered for rendering
 	void clearAllRegisteredNodesForRendering() override;
 
 	//! draws all scene nodes
 	void drawAll() override;
 
+	//! Enables running the animation and registration passes on several threads.
+	void setParallelSceneUpdate(bool enable) override;
+
+	//! Returns if the animation and registration passes are run in parallel.
+	bool isParallelSceneUpdateEnabled() const override;
+
 	//! Adds a camera scene node to the tree and sets it as active camera.
 	//! \param position: Position of the space relative to its parent where the camera will be placed.
 	//! \param lookat: Position where the camera will look at. Also known as target.
@@ -100,6 +132,12 @@ public:
 	//! Adds an empty scene node.
 	ISceneNode *addEmptySceneNode(ISceneNode *parent, s32 id = -1) override;
 
+	//! Merges the static mesh scene nodes of a subtree into few large mesh buffers.
+	ISceneNode *batchStaticGeometry(ISceneNode *root = 0, f32 chunkSize = 0.f, s32 id = -1) override;
+
+	//! Restores the scene nodes batched by batchStaticGeometry() and removes the batch.
+	bool unbatchStaticGeometry(ISceneNode *batch) override;
+
 	//! Returns the root scene node. This is the scene node which is parent
 	//! of all scene nodes. The root scene node is a special scene node which
 	//! only exists to manage all scene nodes. It is not rendered and cannot
@@ -186,31 +224,64 @@ private:
 	// load and create a mesh which we know already isn't in the cache and put it in there
 	IAnimatedMesh *getUncachedMesh(io::IReadFile *file, const io::path &filename, const io::path &cachename);
 
+	//! Mesh loaded by getMeshAsync()
+	struct SMeshLoad
+	{
+		io::path Name;
+
+		//! Copy of the file in memory, null if the mesh was cached
+		io::IReadFile *File = nullptr;
+
+		//! Reentrant loader parsing the file on a worker, null to load in finishMeshLoads()
+		IMeshLoader *Loader = nullptr;
+
+		//! Parsed mesh, not in the cache yet
+		IAnimatedMesh *Mesh = nullptr;
+
+		std::function<void(IAnimatedMesh *mesh)> OnLoaded;
+
+		os::JobCounter Parsed;
+	};
+
 	//! clears the deletion list
 	void clearDeletionList();
 
+	//! Animates the subtrees of the root node on the worker threads.
+	void animateParallel(u32 timeMs);
+
+	//! Lets the subtrees of the root node register themselves on the worker threads.
+	void registerParallel();
+
+	//! Skins the visible animated meshes on the worker threads.
+	void prepareSkinningParallel();
+
+	//! sort on material first, then front to back for early z rejection
 	struct DefaultNodeEntry
 	{
 		DefaultNodeEntry()
 		{
 		}
 
-		DefaultNodeEntry(ISceneNode *n) :
+		DefaultNodeEntry(ISceneNode *n, const core::vector3df &camera, f32 depthScale) :
 				Node(n)
 		{
-			if (n->getMaterialCount())
-				Hash = std::hash<video::SMaterial>{}(n->getMaterial(0));
-		}
+			u32 hash = 0;
+			if (n->getMaterialCount()) {
+				const u64 h = std::hash<video::SMaterial>{}(n->getMaterial(0));
+				hash = (u32)(h ^ (h >> 32));
+			}
 
-		bool operator<(const DefaultNodeEntry &other) const noexcept
-		{
-			return Hash < other.Hash;
+			// coarse linear depth, 16 bits are enough to get the order roughly right
+			const f32 distance = Node->getAbsoluteTransformation().getTranslation().getDistanceFrom(camera);
+			const u32 depth = (u32)core::clamp(distance * depthScale, 0.f, 65535.f);
+
+			Key = ((u64)hash << 16) | depth;
 		}
 
 		ISceneNode *Node = nullptr;
 
-	private:
-		size_t Hash = 0;
+		//! material hash in bits 16-47, depth in bits 0-15
+		u64 Key = 0;
 	};
 
 	//! sort on distance (center) to camera
@@ -223,18 +294,30 @@ private:
 		TransparentNodeEntry(ISceneNode *n, const core::vector3df &camera) :
 				Node(n)
 		{
-			Distance = Node->getAbsoluteTransformation().getTranslation().getDistanceFromSQ(camera);
+			setDistance(Node->getAbsoluteTransformation().getTranslation().getDistanceFromSQ(camera));
 		}
 
-		bool operator<(const TransparentNodeEntry &other) const noexcept
+		TransparentNodeEntry(ISceneNode *n, u32 buffer, const core::vector3df &center, const core::vector3df &camera) :
+				Node(n), MeshBuffer(buffer)
 		{
-			return Distance > other.Distance;
+			setDistance(center.getDistanceFromSQ(camera));
 		}
 
 		ISceneNode *Node = nullptr;
 
+		//! Mesh buffer to render, -1 for the whole node
+		s32 MeshBuffer = -1;
+
+		//! Bits of the positive float distance, inverted to sort back to front
+		u64 Key = 0;
+
 	private:
-		f32 Distance = 0;
+		void setDistance(f32 distanceSQ)
+		{
+			u32 bits;
+			memcpy(&bits, &distanceSQ, sizeof(bits));
+			Key = ~bits;
+		}
 	};
 
 	//! video driver
@@ -247,15 +330,62 @@ private:
 	ISceneCollisionManager *CollisionManager;
 
 	//! render pass lists
-	std::vector<ISceneNode *> CameraList;
-	std::vector<ISceneNode *> SkyBoxList;
-	std::vector<DefaultNodeEntry> SolidNodeList;
-	std::vector<TransparentNodeEntry> TransparentNodeList;
-	std::vector<TransparentNodeEntry> TransparentEffectNodeList;
-	std::vector<ISceneNode *> GuiNodeList;
+	struct SRenderLists
+	{
+		std::vector<ISceneNode *> CameraList;
+		std::vector<ISceneNode *> SkyBoxList;
+		std::vector<DefaultNodeEntry> SolidNodeList;
+		std::vector<TransparentNodeEntry> TransparentNodeList;
+		std::vector<TransparentNodeEntry> TransparentEffectNodeList;
+		std::vector<ISceneNode *> GuiNodeList;
+
+		void clear();
+
+		//! Appends the lists of other, skipping cameras which are already registered.
+		void append(const SRenderLists &other);
+	};
+
+	//! Returns the render lists nodes registered from the calling thread go into.
+	SRenderLists &getRenderLists();
+
+	//! Sorts the entries by their keys into SortEntries
+	template <class T>
+	void sortRenderList(const std::vector<T> &list);
+
+	//! Sorted order of the render list currently drawn
+	std::vector<core::SRadixSortEntry> SortEntries;
+	std::vector<core::SRadixSortEntry> SortScratch;
+
+	//! Converts distances to the camera into 16 bit depth values of the solid sort keys
+	f32 DepthScale;
+
+	//! Mesh buffer of the node currently rendered, -1 for all
+	s32 RenderedMeshBuffer;
+
+	SRenderLists RenderLists;
+
+	//! Render lists of the subtree registered on this thread, null outside of the parallel passes.
+	static thread_local SRenderLists *ThreadRenderLists;
 
 	std::vector<IMeshLoader *> MeshLoaderList;
+
+	//! Loads started by getMeshAsync(), in their order
+	std::vector<std::unique_ptr<SMeshLoad>> MeshLoads;
 	std::vector<ISceneNode *> DeletionList;
+	std::mutex DeletionListLock;
+
+	//! Run the animation and registration passes on the job system
+	bool ParallelUpdate;
+
+	//! Separate render lists for each child of the root node registered in
+	//! parallel, kept between frames to reuse their memory.
+	std::vector<SRenderLists> RootRenderLists;
+
+	//! Children of the root node distributed over the workers this frame.
+	std::vector<ISceneNode *> ParallelRoots;
+
+	//! Animated mesh nodes which can be skinned in parallel this frame.
+	std::vector<CAnimatedMeshSceneNode *> SkinningNodes;
 
 	//! current active camera
 	ICameraSceneNode *ActiveCamera;
@@ -0,0 +1,126 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CSceneNodePool.h"
+
+#include <atomic>
+#include <new>
+
+namespace scene
+{
+
+namespace
+{
+std::atomic<u32> PoolAllocations{0};
+std::atomic<u32> PoolDeallocations{0};
+std::atomic<u32> PoolChunkAllocations{0};
+std::atomic<u32> HeapNodeAllocations{0};
+std::atomic<u32> ChildListAllocations{0};
+}
+
+CSceneNodePool::CSceneNodePool(size_t blockSize, u32 blocksPerChunk) :
+		BlockSize(blockSize), BlocksPerChunk(blocksPerChunk), UsedBlocks(0),
+		FreeList(nullptr)
+{
+	// keep every block aligned like memory coming from operator new
+	const size_t align = alignof(std::max_align_t);
+	if (BlockSize < sizeof(SFreeBlock))
+		BlockSize = sizeof(SFreeBlock);
+	BlockSize = (BlockSize + align - 1) / align * align;
+}
+
+CSceneNodePool::~CSceneNodePool()
+{
+	// Nodes still alive at exit (e.g. leaked by the application) would
+	// otherwise point to freed memory when they are dropped later on.
+	if (UsedBlocks != 0)
+		return;
+
+	for (void *chunk : Chunks)
+		::operator delete(chunk);
+}
+
+void *CSceneNodePool::allocate()
+{
+	std::lock_guard<std::mutex> lock(Lock);
+
+	if (!FreeList) {
+		u8 *chunk = static_cast<u8 *>(::operator new(BlockSize * BlocksPerChunk));
+		Chunks.push_back(chunk);
+		++PoolChunkAllocations;
+
+		// link the blocks back to front so they are handed out in address order
+		for (u32 i = BlocksPerChunk; i > 0; --i) {
+			SFreeBlock *block = reinterpret_cast<SFreeBlock *>(chunk + (i - 1) * BlockSize);
+			block->Next = FreeList;
+			FreeList = block;
+		}
+	}
+
+	SFreeBlock *block = FreeList;
+	FreeList = block->Next;
+	++UsedBlocks;
+	++PoolAllocations;
+
+	return block;
+}
+
+void CSceneNodePool::deallocate(void *ptr)
+{
+	std::lock_guard<std::mutex> lock(Lock);
+
+	SFreeBlock *block = static_cast<SFreeBlock *>(ptr);
+	block->Next = FreeList;
+	FreeList = block;
+	--UsedBlocks;
+	++PoolDeallocations;
+}
+
+void *allocateSceneNode(CSceneNodePool &pool, size_t size)
+{
+	// derived classes adding no or only a few members still fit into the block
+	if (size <= pool.getBlockSize())
+		return pool.allocate();
+
+	++HeapNodeAllocations;
+	return ::operator new(size);
+}
+
+void freeSceneNode(CSceneNodePool &pool, void *ptr, size_t size)
+{
+	if (!ptr)
+		return;
+
+	if (size <= pool.getBlockSize())
+		pool.deallocate(ptr);
+	else
+		::operator delete(ptr);
+}
+
+SSceneNodeAllocationStats getSceneNodeAllocationStats()
+{
+	SSceneNodeAllocationStats stats;
+	stats.PoolAllocations = PoolAllocations;
+	stats.PoolDeallocations = PoolDeallocations;
+	stats.PoolChunkAllocations = PoolChunkAllocations;
+	stats.HeapNodeAllocations = HeapNodeAllocations;
+	stats.ChildListAllocations = ChildListAllocations;
+	return stats;
+}
+
+void resetSceneNodeAllocationStats()
+{
+	PoolAllocations = 0;
+	PoolDeallocations = 0;
+	PoolChunkAllocations = 0;
+	HeapNodeAllocations = 0;
+	ChildListAllocations = 0;
+}
+
+void noteChildListAllocation()
+{
+	++ChildListAllocations;
+}
+
+} // end namespace scene
@@ -0,0 +1,84 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Scene/SceneNodeAllocator.h"
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+
+namespace scene
+{
+
+//! Fixed size block allocator used for the built-in scene node classes.
+/** Memory is requested in chunks of several nodes and freed blocks are kept in
+a free list, so after warming up creating and removing nodes doesn't touch the
+heap at all. */
+class CSceneNodePool
+{
+public:
+	//! constructor
+	CSceneNodePool(size_t blockSize, u32 blocksPerChunk = 32);
+
+	//! destructor
+	~CSceneNodePool();
+
+	//! Returns a block of getBlockSize() bytes.
+	void *allocate();
+
+	//! Gives a block returned by allocate() back to the pool.
+	void deallocate(void *ptr);
+
+	//! Returns the size of the blocks handed out by this pool.
+	size_t getBlockSize() const { return BlockSize; }
+
+private:
+	struct SFreeBlock
+	{
+		SFreeBlock *Next;
+	};
+
+	size_t BlockSize;
+	u32 BlocksPerChunk;
+	u32 UsedBlocks;
+
+	std::vector<void *> Chunks;
+	SFreeBlock *FreeList;
+
+	std::mutex Lock;
+};
+
+//! Returns the pool of the scene node class T.
+template <class T>
+CSceneNodePool &getSceneNodePool()
+{
+	static CSceneNodePool pool(sizeof(T));
+	return pool;
+}
+
+//! Allocates a node from the pool, or from the heap if the node is of a derived class.
+void *allocateSceneNode(CSceneNodePool &pool, size_t size);
+
+//! Frees a node allocated with allocateSceneNode().
+void freeSceneNode(CSceneNodePool &pool, void *ptr, size_t size);
+
+} // end namespace scene
+
+//! Makes a scene node class allocate its instances from its own pool.
+/** Put this into the class declaration of the built-in scene nodes. Classes
+derived from them by the user which don't fit into the blocks of the pool
+silently use the heap instead. */
+#define IRR_POOLED_SCENE_NODE(NodeClass)                                       \
+public:                                                                        \
+	static void *operator new(size_t size)                                     \
+	{                                                                          \
+		return scene::allocateSceneNode(scene::getSceneNodePool<NodeClass>(), size); \
+	}                                                                          \
+	static void operator delete(void *ptr, size_t size)                        \
+	{                                                                          \
+		scene::freeSceneNode(scene::getSceneNodePool<NodeClass>(), ptr, size); \
+	}
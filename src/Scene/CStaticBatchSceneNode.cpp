@@ -0,0 +1,117 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CStaticBatchSceneNode.h"
+#include "Scene/ISceneManager.h"
+
+
+namespace scene
+{
+
+//! constructor
+CStaticBatchSceneNode::CStaticBatchSceneNode(ISceneNode *parent, ISceneManager *mgr, s32 id) :
+		ISceneNode(parent, mgr, id)
+{
+	// the chunks are culled on their own
+	setAutomaticCulling(scene::EAC_OFF);
+}
+
+//! destructor
+CStaticBatchSceneNode::~CStaticBatchSceneNode()
+{
+	dropReplacedNodes();
+}
+
+//! pre render event
+void CStaticBatchSceneNode::OnRegisterSceneNode()
+{
+	if (IsVisible)
+		ISceneNode::OnRegisterSceneNode();
+}
+
+//! render
+void CStaticBatchSceneNode::render()
+{
+	// do nothing
+}
+
+//! returns the axis aligned bounding box of this node
+const core::aabbox3d<f32> &CStaticBatchSceneNode::getBoundingBox() const
+{
+	return Box;
+}
+
+//! Adds a mesh scene node drawing a chunk of merged geometry
+void CStaticBatchSceneNode::addChunk(IMesh *mesh)
+{
+	if (Children.empty())
+		Box = mesh->getBoundingBox();
+	else
+		Box.addInternalBox(mesh->getBoundingBox());
+
+	SceneManager->addMeshSceneNode(mesh, this);
+}
+
+//! Removes a node from the scene and keeps it for restoreReplacedNodes()
+void CStaticBatchSceneNode::replaceNode(ISceneNode *node)
+{
+	ISceneNode *parent = node->getParent();
+
+	// The ancestors of this node own it and outlive it, grabbing them would
+	// be a cycle. Usually the parent is the root scene node, the scene manager.
+	bool ownsParent = parent != nullptr;
+	for (ISceneNode *ancestor = Parent; ancestor && ownsParent; ancestor = ancestor->getParent())
+		ownsParent = ancestor != parent;
+
+	node->grab();
+	if (ownsParent)
+		parent->grab();
+
+	node->remove();
+	Replaced.push_back({node, parent, ownsParent});
+}
+
+//! Adds the replaced nodes to their parents again
+void CStaticBatchSceneNode::restoreReplacedNodes()
+{
+	// parents are added back before their children
+	for (auto it = Replaced.rbegin(); it != Replaced.rend(); ++it) {
+		if (it->Parent)
+			it->Parent->addChild(it->Node);
+	}
+
+	dropReplacedNodes();
+}
+
+//! Drops the replaced nodes without restoring them
+void CStaticBatchSceneNode::dropReplacedNodes()
+{
+	for (SReplacedNode &replaced : Replaced) {
+		replaced.Node->drop();
+		if (replaced.OwnsParent)
+			replaced.Parent->drop();
+	}
+	Replaced.clear();
+}
+
+//! Creates a clone of this scene node and its children.
+ISceneNode *CStaticBatchSceneNode::clone(ISceneNode *newParent, ISceneManager *newManager)
+{
+	if (!newParent)
+		newParent = Parent;
+	if (!newManager)
+		newManager = SceneManager;
+
+	CStaticBatchSceneNode *nb = new CStaticBatchSceneNode(newParent,
+			newManager, ID);
+
+	nb->cloneMembers(this, newManager);
+	nb->Box = Box;
+
+	if (newParent)
+		nb->drop();
+	return nb;
+}
+
+} // end namespace scene
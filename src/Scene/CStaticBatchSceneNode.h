@@ -0,0 +1,84 @@
+// Copyright (C) 2002-2012 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Scene/ISceneNode.h"
+#include "Mesh/IMesh.h"
+#include "CSceneNodePool.h"
+
+#include <vector>
+
+
+namespace scene
+{
+
+//! Holds the merged geometry created by ISceneManager::batchStaticGeometry()
+/** The chunks of merged mesh buffers are mesh scene nodes below this node.
+The scene nodes replaced by the batch are kept out of the scene, but alive,
+until they are restored or this node is deleted. */
+class CStaticBatchSceneNode : public ISceneNode
+{
+	IRR_POOLED_SCENE_NODE(CStaticBatchSceneNode)
+
+public:
+	//! constructor
+	CStaticBatchSceneNode(ISceneNode *parent, ISceneManager *mgr, s32 id);
+
+	//! destructor
+	virtual ~CStaticBatchSceneNode();
+
+	//! returns the axis aligned bounding box of this node
+	const core::aabbox3d<f32> &getBoundingBox() const override;
+
+	//! This method is called just before the rendering process of the whole scene.
+	void OnRegisterSceneNode() override;
+
+	//! does nothing, the chunks render themselves.
+	void render() override;
+
+	//! Returns type of the scene node
+	ESCENE_NODE_TYPE getType() const override { return ESNT_STATIC_BATCH; }
+
+	//! Creates a clone of this scene node and its children.
+	/** The clone doesn't keep the replaced nodes, it can't be restored. */
+	ISceneNode *clone(ISceneNode *newParent = 0, ISceneManager *newManager = 0) override;
+
+	//! Adds a mesh scene node drawing a chunk of merged geometry
+	/** \param mesh Merged geometry in the space of this node. */
+	void addChunk(IMesh *mesh);
+
+	//! Removes a node from the scene and keeps it for restoreReplacedNodes()
+	/** Children have to be replaced before their parents. */
+	void replaceNode(ISceneNode *node);
+
+	//! Returns the amount of replaced nodes
+	u32 getReplacedNodeCount() const { return Replaced.size(); }
+
+	//! Returns a replaced node, children before their parents
+	ISceneNode *getReplacedNode(u32 i) const { return Replaced[i].Node; }
+
+	//! Adds the replaced nodes to their parents again
+	void restoreReplacedNodes();
+
+private:
+	//! Drops the replaced nodes without restoring them
+	void dropReplacedNodes();
+
+	struct SReplacedNode
+	{
+		ISceneNode *Node;
+		ISceneNode *Parent;
+
+		//! False if the parent is an ancestor of this node and not grabbed
+		bool OwnsParent;
+	};
+
+	//! In the order they were replaced
+	std::vector<SReplacedNode> Replaced;
+
+	core::aabbox3d<f32> Box{{0, 0, 0}};
+};
+
+} // end namespace scene
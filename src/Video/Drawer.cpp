@@ -13,6 +13,17 @@ void Drawer::drawMeshBuffer(scene::IMeshBuffer *mb, std::optional<scene::IIndexB
 	if (!mb)
 		return;
 
+	// Without a shader of the material decoding them, the full precision
+	// vertices in memory are drawn instead. The buffer stays quantized for
+	// the other materials drawing it.
+	const scene::IVertexBuffer *vertices = mb->getVertexBuffer();
+	if (vertices->isQuantized() && !Driver->queryVertexQuantization(Driver->Material.MaterialType)) {
+		const scene::IIndexBuffer *indices = replaceIndices ? *replaceIndices : mb->getIndexBuffer();
+		drawVertexPrimitiveList(mb->getVertices(), mb->getVertexCount(), indices->getData(),
+				indices->getCount(), mb->getVertexType(), mb->getPrimitiveType());
+		return;
+	}
+
 	FrameStats.HWBuffersUploaded += mb->reload(Driver, replaceIndices);
 
 	u32 indexCount = replaceIndices ? (*replaceIndices)->getCount() : mb->getIndexCount();
@@ -21,6 +32,13 @@ void Drawer::drawMeshBuffer(scene::IMeshBuffer *mb, std::optional<scene::IIndexB
 	if (!checkMeshData(mb->getPrimitiveType(), vertexCount, indexCount))
 		return;
 
+	core::vector3df scale, offset;
+	const bool quantized = vertices->isQuantized();
+	if (quantized) {
+		vertices->getQuantization(scale, offset);
+		Driver->setVertexQuantization(&scale, &offset);
+	}
+
 	Driver->setRenderStates3DMode();
 
 	mb->bind();
@@ -28,6 +46,9 @@ void Drawer::drawMeshBuffer(scene::IMeshBuffer *mb, std::optional<scene::IIndexB
 	drawGeneric((void*)0, indexCount, mb->getPrimitiveType());
 
 	mb->unbind();
+
+	if (quantized)
+		Driver->setVertexQuantization(nullptr, nullptr);
 }
 
 //! Draws the normals of a mesh buffer
@@ -430,7 +451,9 @@ void Drawer::drawGeneric(
 std::array<GLenum, (u8)scene::VertexAttribute::Type::COUNT> toGLType = {
 	GL_FLOAT,
 	GL_UNSIGNED_BYTE,
-	GL_INT
+	GL_INT,
+	GL_SHORT,
+	GL_HALF_FLOAT
 };
 
 void Drawer::enableAttributeArrays(const scene::VertexDescriptor &vertexDesc, uintptr_t verticesBase)
@@ -30,6 +30,21 @@ struct SFrameStats {
 	u32 HWBuffersUploaded = 0;
 	//! Number of active hardware buffers
 	u32 HWBuffersActive = 0;
+	//! Animated meshes which were animated and skinned
+	u32 AnimationsUpdated = 0;
+	//! Animated meshes whose update was skipped by their animation LOD
+	u32 AnimationsSkipped = 0;
+	//! Culled animated meshes which only updated their bounding box
+	u32 AnimationsCulled = 0;
+};
+
+//! Kinds of animated mesh updates counted in SFrameStats
+enum E_ANIMATION_UPDATE
+{
+	EAU_UPDATED = 0,
+	EAU_SKIPPED,
+	EAU_CULLED,
+	EAU_COUNT
 };
 
 class Drawer
@@ -55,6 +55,19 @@ void MaterialBaseCB::OnSetUniforms(MaterialRenderer *renderer)
 	}
 
     renderer->setUniformFloat("uThickness", Thickness);
+
+	// joint palette of hardware skinned geometry
+	u32 jointCount = 0;
+	const core::matrix4 *joints = driver->getJointTransforms(jointCount);
+	if (joints)
+		renderer->setUniform4x4MatrixArray("uJointMatrices", joints, jointCount);
+
+	// decoding of quantized positions
+	core::vector3df scale, offset;
+	if (driver->getVertexQuantization(scale, offset)) {
+		renderer->setUniform3Float("uPositionScale", scale);
+		renderer->setUniform3Float("uPositionOffset", offset);
+	}
 }
 
 // EMT_SOLID + EMT_TRANSPARENT_ALPHA_CHANNEL + EMT_TRANSPARENT_VERTEX_ALPHA
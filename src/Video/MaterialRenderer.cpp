@@ -259,6 +259,11 @@ void MaterialRenderer::setUniform4x4Matrix(const std::string &name, core::matrix
 	glUniformMatrix4fv(ShaderObj->getUniformLocation(name), 1, GL_FALSE, value.pointer());
 }
 
+void MaterialRenderer::setUniform4x4MatrixArray(const std::string &name, const core::matrix4 *values, u32 count)
+{
+	glUniformMatrix4fv(ShaderObj->getUniformLocation(name), count, GL_FALSE, values[0].pointer());
+}
+
 void MaterialRenderer::setUniformFloatStruct(const std::string &name, const std::unordered_map<std::string, f32> &values)
 {
 	for (const auto &value : values) {
@@ -12,11 +12,97 @@
 #include "Video/MaterialRenderer.h"
 #include "MaterialCallbacks.h"
 #include "Video/Texture.h"
+#include "Mesh/SkinnedMesh.h"
 
 namespace video
 {
 
-u32 MaterialSystem::BuiltinMaterialsNum = 6;
+namespace
+{
+bool isIdentifierChar(c8 c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+//! Finds an identifier in GLSL source, not as part of a longer one
+size_t findWord(const std::string &source, const std::string &word, size_t from = 0)
+{
+	for (size_t pos = source.find(word, from); pos != std::string::npos; pos = source.find(word, pos + 1)) {
+		const size_t end = pos + word.size();
+		if ((pos == 0 || !isIdentifierChar(source[pos - 1])) &&
+				(end == source.size() || !isIdentifierChar(source[end])))
+			return pos;
+	}
+	return std::string::npos;
+}
+
+void replaceWord(std::string &source, const std::string &word, const std::string &replacement)
+{
+	for (size_t pos = findWord(source, word); pos != std::string::npos;
+			pos = findWord(source, word, pos + replacement.size()))
+		source.replace(pos, word.size(), replacement);
+}
+
+//! Derives the skinned variant of the vertex shader Solid.vsh
+/** Its main() is renamed and called by a new one, after the joints moved
+inPosition and inNormal. The code after the declarations reads the moved
+values instead. The integer joint attribute needs GLSL 1.30 or GLSL ES 3.00.
+\return The skinned shader, empty if the source can't be used. */
+std::string deriveSkinnedVertexShader(const std::string &solid)
+{
+	// the old attribute keyword is GLSL ES 1.00, without integer attributes
+	if (solid.empty() || findWord(solid, "attribute") != std::string::npos)
+		return "";
+
+	// the definition, not a mention in a comment
+	size_t mainPos = findWord(solid, "main");
+	while (mainPos != std::string::npos) {
+		const size_t next = solid.find_first_not_of(" \t\r\n", mainPos + 4);
+		if (next != std::string::npos && solid[next] == '(')
+			break;
+		mainPos = findWord(solid, "main", mainPos + 4);
+	}
+	if (mainPos == std::string::npos)
+		return "";
+
+	// split at the line defining main(), after the declarations
+	mainPos = solid.rfind('\n', mainPos);
+	mainPos = mainPos == std::string::npos ? 0 : mainPos + 1;
+
+	std::string declarations = solid.substr(0, mainPos);
+	std::string code = solid.substr(mainPos);
+	if (findWord(declarations, "inPosition") == std::string::npos)
+		return "";
+
+	const bool normals = findWord(declarations, "inNormal") != std::string::npos;
+
+	replaceWord(code, "main", "solidMain");
+	replaceWord(code, "inPosition", "skinnedPosition");
+	if (normals)
+		replaceWord(code, "inNormal", "skinnedNormal");
+
+	declarations += "\nin uvec4 inJoints;\nin vec4 inWeights;\n"
+			"uniform mat4 uJointMatrices[" + std::to_string(scene::SkinnedMesh::MAX_HARDWARE_SKINNING_JOINTS) + "];\n"
+			"vec3 skinnedPosition;\n";
+	if (normals)
+		declarations += "vec3 skinnedNormal;\n";
+	declarations += "\n";
+
+	code += "\nvoid main()\n{\n"
+			"\tmat4 skin = uJointMatrices[inJoints.x] * inWeights.x +\n"
+			"\t\t\tuJointMatrices[inJoints.y] * inWeights.y +\n"
+			"\t\t\tuJointMatrices[inJoints.z] * inWeights.z +\n"
+			"\t\t\tuJointMatrices[inJoints.w] * inWeights.w;\n"
+			"\tif (dot(inWeights, vec4(1.0)) == 0.0)\n"
+			"\t\tskin = mat4(1.0);\n"
+			"\tskinnedPosition = (skin * vec4(inPosition, 1.0)).xyz;\n";
+	if (normals)
+		code += "\tskinnedNormal = mat3(skin) * inNormal;\n";
+	code += "\tsolidMain();\n}\n";
+
+	return declarations + code;
+}
+}
 
 MaterialSystem::MaterialSystem(VideoDriver *driver, io::IFileSystem *filesys, const io::path &shadersPath)
 	: Driver(driver), FileSystem(filesys), ShadersPath(shadersPath)
@@ -33,6 +119,11 @@ MaterialSystem::MaterialSystem(VideoDriver *driver, io::IFileSystem *filesys, co
 		tex.TextureWrapW = ETC_REPEAT;
 	});
 	OverrideMaterial2D = InitMaterial2D;
+
+	for (s32 &renderer : SkinnedMaterialRenderers)
+		renderer = -1;
+	for (s32 &renderer : QuantizedMaterialRenderers)
+		renderer = -1;
 }
 
 MaterialSystem::~MaterialSystem()
@@ -206,7 +297,7 @@ void MaterialSystem::deleteShaderMaterial(s32 material)
 {
 	// Only custom materials are allowed to be deleted
 	const u32 idx = (u32)material;
-	if (idx < MaterialSystem::BuiltinMaterialsNum || idx >= MaterialRenderers.size())
+	if (idx < BuiltinMaterialsNum || idx >= MaterialRenderers.size())
 		return;
 
 	// if this is the last material we can drop it without consequence
@@ -223,6 +314,31 @@ void MaterialSystem::deleteShaderMaterial(s32 material)
 	}
 }
 
+void MaterialSystem::setJointTransforms(const core::matrix4 *matrices, u32 count)
+{
+	JointTransforms = count ? matrices : nullptr;
+	JointTransformCount = JointTransforms ? count : 0;
+}
+
+void MaterialSystem::setVertexQuantization(const core::vector3df *scale, const core::vector3df *offset)
+{
+	QuantizationScale = offset ? scale : nullptr;
+	QuantizationOffset = scale ? offset : nullptr;
+}
+
+u32 MaterialSystem::getMaterialRendererIndex(E_MATERIAL_TYPE type) const
+{
+	const u32 idx = static_cast<u32>(type);
+
+	if (QuantizationScale && idx <= EMT_ONETEXTURE_BLEND && QuantizedMaterialRenderers[idx] >= 0)
+		return QuantizedMaterialRenderers[idx];
+
+	if (JointTransforms && idx <= EMT_ONETEXTURE_BLEND && SkinnedMaterialRenderers[idx] >= 0)
+		return SkinnedMaterialRenderers[idx];
+
+	return idx;
+}
+
 void MaterialSystem::setRenderStates3DMode()
 {
 	if (LockRenderStateMode)
@@ -236,19 +352,23 @@ void MaterialSystem::setRenderStates3DMode()
 		ResetRenderStates = true;
 	}
 
-	if (ResetRenderStates || LastMaterial != Material) {
+	const u32 renderer = getMaterialRendererIndex(Material.MaterialType);
+
+	// skinned and unskinned geometry with the same material use different shaders
+	if (ResetRenderStates || LastMaterial != Material || LastMaterialRenderer != renderer) {
 		// set new material.
-		if (static_cast<u32>(Material.MaterialType) < MaterialRenderers.size())
-			MaterialRenderers[Material.MaterialType]->OnSetMaterial(
+		if (renderer < MaterialRenderers.size())
+			MaterialRenderers[renderer]->OnSetMaterial(
 					Material, LastMaterial, ResetRenderStates);
 
 		LastMaterial = Material;
+		LastMaterialRenderer = renderer;
 
 		ResetRenderStates = false;
 	}
 
-	if (static_cast<u32>(Material.MaterialType) < MaterialRenderers.size())
-		MaterialRenderers[Material.MaterialType]->OnRender(scene::EVT_3D);
+	if (renderer < MaterialRenderers.size())
+		MaterialRenderers[renderer]->OnRender(JointTransforms ? scene::EVT_SKINNED : scene::EVT_3D);
 
 	CurrentRenderMode = ERM_3D;
 }
@@ -369,6 +489,7 @@ void MaterialSystem::setRenderStates2DMode(bool alpha, bool texture, bool alphaC
 
 	MaterialRenderers[MaterialRenderer2DIdx]->OnSetMaterial(Material, LastMaterial, true);
 	LastMaterial = Material;
+	LastMaterialRenderer = MaterialRenderer2DIdx;
 
 	// no alphaChannel without texture
 	alphaChannel &= texture;
@@ -445,6 +566,43 @@ void MaterialSystem::createMaterialRenderers()
 	FragmentShader = ShadersPath + "Renderer2D.fsh";
 	MaterialRenderer2DIdx = addHighLevelShaderMaterialFromFiles(VertexShader, FragmentShader, "", "Renderer2D", Renderer2DCB, scene::Vertex2D::FORMAT);
 
+	// Skinned variants of the 3D materials, used while joint transforms are set.
+	// SolidSkinned.vsh works like Solid.vsh, but additionally reads the attributes
+	// inJoints (uvec4) and inWeights (vec4) and the uniform
+	// mat4 uJointMatrices[SkinnedMesh::MAX_HARDWARE_SKINNING_JOINTS].
+	// Vertices with all weights 0 have to keep their position.
+	// Without the file the variant is derived from Solid.vsh, see
+	// deriveSkinnedVertexShader(). Only if that fails as well, meshes are
+	// skinned in software.
+
+	IShaderConstantSetCallBack *const callbacks[EMT_ONETEXTURE_BLEND + 1] = {
+		SolidCB,
+		TransparentAlphaChannelCB,
+		TransparentAlphaChannelRefCB,
+		TransparentVertexAlphaCB,
+		OneTextureBlendCB,
+	};
+
+	std::string skinnedShader = readShaderFile(ShadersPath + "SolidSkinned.vsh");
+	if (skinnedShader.empty())
+		skinnedShader = deriveSkinnedVertexShader(readShaderFile(ShadersPath + "Solid.vsh"));
+
+	if (!addMaterialVariants(skinnedShader, "Skinned", callbacks, scene::VertexSkinned::FORMAT, SkinnedMaterialRenderers))
+		g_irrlogger->log("Hardware skinning unavailable, no skinned vertex shader", ELL_INFORMATION);
+
+	// Quantized variants of the 3D materials, used while a vertex quantization is set.
+	// SolidQuantized.vsh works like Solid.vsh, but reads the attributes of
+	// Vertex3DQuantized: inPosition decoded with the uniforms vec3 uPositionScale
+	// and vec3 uPositionOffset, inNormal in octahedral encoding.
+	// Optional, without the vertex shader meshes can't be uploaded quantized.
+
+	VertexShader = ShadersPath + "SolidQuantized.vsh";
+	if (!addMaterialVariants(readShaderFile(VertexShader), "Quantized", callbacks, scene::Vertex3DQuantized::FORMAT, QuantizedMaterialRenderers))
+		g_irrlogger->log("Vertex quantization unavailable, missing shader", VertexShader.c_str(), ELL_INFORMATION);
+
+	// custom materials are added after all of these
+	BuiltinMaterialsNum = MaterialRenderers.size();
+
 	// Drop callbacks.
 
 	SolidCB->drop();
@@ -455,6 +613,48 @@ void MaterialSystem::createMaterialRenderers()
 	Renderer2DCB->drop();
 }
 
+bool MaterialSystem::addMaterialVariants(const std::string &vertexShader, const std::string &suffix,
+		IShaderConstantSetCallBack *const *callbacks, const scene::VertexDescriptor &vDesc, s32 *renderers)
+{
+	if (vertexShader.empty())
+		return false;
+
+	// fragment shaders of the built-in 3D materials, in E_MATERIAL_TYPE order
+	const c8 *const names[EMT_ONETEXTURE_BLEND + 1] = {
+		"Solid",
+		"TransparentAlphaChannel",
+		"TransparentAlphaChannelRef",
+		"TransparentVertexAlpha",
+		"OneTextureBlend",
+	};
+
+	for (u32 i = 0; i <= EMT_ONETEXTURE_BLEND; ++i) {
+		const std::string fragmentShader = readShaderFile(ShadersPath + names[i] + ".fsh");
+		renderers[i] = addHighLevelShaderMaterial(vertexShader, fragmentShader, "",
+				std::string(names[i]) + suffix, callbacks[i], vDesc);
+	}
+
+	// the variants are optional, a failed shader only disables them
+	return renderers[EMT_SOLID] >= 0;
+}
+
+std::string MaterialSystem::readShaderFile(const io::path &fileName) const
+{
+	std::string source;
+	if (!FileSystem->existFile(fileName))
+		return source;
+
+	io::IReadFile *file = FileSystem->createAndOpenFile(fileName);
+	if (!file)
+		return source;
+
+	source.resize(file->getSize());
+	if (file->read(&source[0], source.size()) != source.size())
+		source.clear();
+	file->drop();
+	return source;
+}
+
 bool MaterialSystem::setMaterialTexture(u32 layerIdx, const GLTexture *texture)
 {
     Material.TextureLayers[layerIdx].Texture = const_cast<GLTexture *>(texture); // function uses const-pointer for texture because all draw functions use const-pointers already
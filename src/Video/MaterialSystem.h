@@ -41,7 +41,25 @@ class MaterialSystem
     core::array<MaterialRenderer *> MaterialRenderers;
 	s32 MaterialRenderer2DIdx;
 
-	static u32 BuiltinMaterialsNum;
+	//! Variants of the built-in 3D materials for hardware skinned geometry, -1 if unavailable
+	s32 SkinnedMaterialRenderers[EMT_ONETEXTURE_BLEND + 1];
+
+	//! Variants of the built-in 3D materials for quantized vertices, -1 if unavailable
+	s32 QuantizedMaterialRenderers[EMT_ONETEXTURE_BLEND + 1];
+
+	//! Renderer which got the last OnSetMaterial() call
+	u32 LastMaterialRenderer = 0xFFFFFFFF;
+
+	//! Joint palette of the hardware skinned geometry drawn next
+	const core::matrix4 *JointTransforms = nullptr;
+	u32 JointTransformCount = 0;
+
+	//! Decoding of the quantized positions drawn next
+	const core::vector3df *QuantizationScale = nullptr;
+	const core::vector3df *QuantizationOffset = nullptr;
+
+	//! Materials added by createMaterialRenderers(), which can't be deleted
+	u32 BuiltinMaterialsNum = 6;
 
 	SOverrideMaterial OverrideMaterial;
 	SMaterial OverrideMaterial2D;
@@ -107,6 +125,59 @@ public:
 
 	void deleteShaderMaterial(s32 material);
 
+	//! Sets the joint matrices of the hardware skinned geometry drawn next.
+	/** While set, the built-in materials are drawn with their skinned variants,
+	which expect EVT_SKINNED vertices. They are uploaded to the uniform
+	uJointMatrices, custom shaders can read them with getJointTransforms().
+	\param matrices Joint matrices, must stay valid until reset. Null to draw
+	unskinned geometry again.
+	\param count Amount of matrices, at most SkinnedMesh::MAX_HARDWARE_SKINNING_JOINTS. */
+	void setJointTransforms(const core::matrix4 *matrices, u32 count);
+
+	//! Returns the joint matrices set with setJointTransforms(), or null.
+	const core::matrix4 *getJointTransforms(u32 &count) const
+	{
+		count = JointTransformCount;
+		return JointTransforms;
+	}
+
+	//! Returns true if the skinned variants of the built-in materials are available.
+	/** They use the vertex shader SolidSkinned.vsh in the shader path, or
+	without it a variant of Solid.vsh, which needs GLSL 1.30 or GLSL ES 3.00. */
+	bool queryHardwareSkinning() const
+	{
+		return SkinnedMaterialRenderers[EMT_SOLID] >= 0;
+	}
+
+	//! Sets the decoding of the quantized vertices drawn next.
+	/** While set, the built-in materials are drawn with their quantized variants,
+	which expect the vertex layout of getQuantizedVertexTypeDescription(). The
+	values are uploaded to the uniforms uPositionScale and uPositionOffset.
+	\param scale Scale of the positions, must stay valid until reset. Null to
+	draw unquantized geometry again.
+	\param offset Offset of the positions, see IVertexBuffer::getQuantization(). */
+	void setVertexQuantization(const core::vector3df *scale, const core::vector3df *offset);
+
+	//! Returns the decoding set with setVertexQuantization(), false if none is set.
+	bool getVertexQuantization(core::vector3df &scale, core::vector3df &offset) const
+	{
+		if (!QuantizationScale)
+			return false;
+		scale = *QuantizationScale;
+		offset = *QuantizationOffset;
+		return true;
+	}
+
+	//! Returns true if a material type has a quantized variant.
+	/** Only the built-in 3D materials have them, and only with the vertex
+	shader SolidQuantized.vsh in the shader path. Other materials expect
+	full precision vertices. */
+	bool queryVertexQuantization(E_MATERIAL_TYPE type = EMT_SOLID) const
+	{
+		const u32 idx = static_cast<u32>(type);
+		return idx <= EMT_ONETEXTURE_BLEND && QuantizedMaterialRenderers[idx] >= 0;
+	}
+
 	void setBasicRenderStates(const SMaterial &material, const SMaterial &lastMaterial, bool resetAllRenderStates);
 
 	//! Compare in SMaterial doesn't check texture parameters, so we should call this on each OnRender call.
@@ -137,8 +208,22 @@ private:
 
 	void createMaterialRenderers();
 
+	//! Adds variants of the built-in 3D materials drawn with another vertex shader
+	/** \param vertexShader Source of the vertex shader, nothing is added if empty.
+	\param callbacks Callback of each material, in E_MATERIAL_TYPE order.
+	\param renderers Receives the renderer of each material.
+	\return False if the variants are unavailable. */
+	bool addMaterialVariants(const std::string &vertexShader, const std::string &suffix,
+			IShaderConstantSetCallBack *const *callbacks, const scene::VertexDescriptor &vDesc, s32 *renderers);
+
+	//! Returns the content of a shader file, empty if it is missing
+	std::string readShaderFile(const io::path &fileName) const;
+
 	void chooseMaterial2D();
 
+	//! Returns the renderer drawing the material type with the current joint transforms
+	u32 getMaterialRendererIndex(E_MATERIAL_TYPE type) const;
+
     bool setMaterialTexture(u32 layerIdx, const GLTexture *texture);
 
 	void loadShaderData(
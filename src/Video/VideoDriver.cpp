@@ -119,6 +119,8 @@ bool VideoDriver::genericDriverInit(const core::dimension2d<u32> &screenSize, bo
 bool VideoDriver::beginScene(u16 clearFlag, SColor clearColor, f32 clearDepth, u8 clearStencil, core::rect<s32> *sourceRect)
 {
 	FrameStats = {};
+	for (auto &counter : AnimationUpdates)
+		counter = 0;
 
 	Context->clearBuffers(clearFlag, clearColor, clearDepth, clearStencil);
 